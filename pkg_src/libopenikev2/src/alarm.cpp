@@ -7,51 +7,68 @@
 *   of the Apache license.  See the LICENSE file for details.             *
 ***************************************************************************/
 #include "alarm.h"
-#include "threadcontroller.h"
-#include "autolock.h"
+#include "alarmcontroller.h"
 #include "log.h"
+#include "printable.h"
 
 #include <memory.h>
+#include <chrono>
 
 namespace openikev2 {
 
     Alarm::Alarm( Alarmable &alarmable, uint32_t msec_total ) : alarmable( alarmable ) {
         this->msec_total = msec_total;
-        this->msec_left = msec_total;
-        this->enabled = false;
+        this->deadline = ALARM_DISARMED;
+        this->scheduled_deadline = ALARM_DISARMED;
 
-        this->mutex = ThreadController::getMutex();
-
-        Log::writeLockedMessage( this->getLogId(), "New Alarm created", Log::LOG_ALRM, true );
+        LOG_LOCKED_MESSAGE( this->getLogId(), "New Alarm created", Log::LOG_ALRM, true );
     }
 
     Alarm::~Alarm() {
-        Log::writeLockedMessage( this->getLogId(), "Alarm deleted", Log::LOG_ALRM, true );
+        LOG_LOCKED_MESSAGE( this->getLogId(), "Alarm deleted", Log::LOG_ALRM, true );
+    }
+
+    int64_t Alarm::now() {
+        return chrono::duration_cast<chrono::milliseconds> ( chrono::steady_clock::now().time_since_epoch() ).count();
     }
 
     void Alarm::reset( ) {
-        AutoLock auto_lock(  );
+        int64_t new_deadline = now() + this->msec_total;
+        this->deadline = new_deadline;
 
-        this->msec_left = this->msec_total;
-        this->enabled = true;
+        // Later deadlines are found by the AlarmController when the scheduled one comes
+        if ( new_deadline < this->scheduled_deadline )
+            AlarmController::updateAlarm( *this );
 
-        Log::writeLockedMessage( this->getLogId(), "Alarm reseted", Log::LOG_ALRM, true );
+        LOG_LOCKED_MESSAGE( this->getLogId(), "Alarm reseted", Log::LOG_ALRM, true );
     }
 
     void Alarm::disable( ) {
-        AutoLock auto_lock( *this->mutex );
-
-        this->enabled = false;
+        this->deadline = ALARM_DISARMED;
 
-        Log::writeLockedMessage( this->getLogId(), "Alarm disabled", Log::LOG_ALRM, true );
+        LOG_LOCKED_MESSAGE( this->getLogId(), "Alarm disabled", Log::LOG_ALRM, true );
     }
 
     void Alarm::setTime( uint32_t milliseconds ) {
-        AutoLock auto_lock( *this->mutex );
-
         this->msec_total = milliseconds;
     }
 
+    bool Alarm::isEnabled() const {
+        return this->deadline != ALARM_DISARMED;
+    }
+
+    int64_t Alarm::getDeadline() const {
+        return this->deadline;
+    }
+
+    bool Alarm::expire( int64_t deadline ) {
+        return this->deadline.compare_exchange_strong( deadline, ALARM_DISARMED );
+    }
+
+    void Alarm::setScheduledDeadline( int64_t deadline ) {
+        this->scheduled_deadline = deadline;
+    }
+
     void Alarm::notifyAlarmable( ) {
         this->alarmable.notifyAlarm( *this );
     }
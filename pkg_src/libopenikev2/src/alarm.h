@@ -13,38 +13,53 @@
 #include "config.h"
 #endif
 
-#include "mutex.h"
 #include "alarmable.h"
 
 #include <memory>
 #include <stdint.h>
 #include <iostream>
+#include <atomic>
+#include <string>
+
+#define ALARM_DISARMED              INT64_MAX   // Deadline of the disabled Alarms
+
+using namespace std;
 
 
 namespace openikev2 {
 
     /**
         This class represents an Alarm used to receive programmed events.
+        The Alarm state is an absolute monotonic deadline, armed and disarmed with atomic operations, so resetting or
+        disabling an Alarm doesn't need any lock. The AlarmController checks the deadline only when the time it scheduled
+        the Alarm for comes, and it is only called by reset() if the new deadline is earlier than that time.
         @author Pedro J. Fernandez Ruiz, Alejandro Perez Mendez <pedroj@um.es, alex@um.es>
     */
     class Alarm {
             /****************************** ATTRIBUTES ******************************/
         public:
-            bool enabled;               /**< Indicates if this alarm must notify to the Alarmable object when its time expires */
-            Alarmable &alarmable;       /**< Alarmable object to be notified */
-            int64_t msec_total;         /**< Total time of the Alarm (in milliseconds).This time is used when the Alarm is reseted */
-            int64_t msec_left;          /**< Remainig time of the Alarm (in milliseconds) */
-            auto_ptr<Mutex> mutex;      /**< Mutex used to protect Alarm accesses */
+            Alarmable &alarmable;               /**< Alarmable object to be notified */
+
+        protected:
+            atomic<uint32_t> msec_total;        /**< Total time of the Alarm (in milliseconds).This time is used when the Alarm is reseted */
+            atomic<int64_t> deadline;           /**< Monotonic time (in milliseconds) when the Alarm expires. ALARM_DISARMED if disabled */
+            atomic<int64_t> scheduled_deadline; /**< Deadline the AlarmController has scheduled the Alarm for. ALARM_DISARMED if none */
 
             /****************************** METHODS ******************************/
         public:
             /**
-             * Creates a new Alarm, setting the receiver of the notification and the total Alarm time
+             * Creates a new disabled Alarm, setting the receiver of the notification and the total Alarm time
              * @param alarmable Receiver of the alarm notification
              * @param msec_total Total time of the alarm (in milliseconds)
              */
             Alarm( Alarmable &alarmable, uint32_t msec_total );
 
+            /**
+             * Gets the current monotonic time, used for the deadlines
+             * @return Current monotonic time (in milliseconds)
+             */
+            static int64_t now();
+
             /**
              * Resets the count down and enables the Alarm
              */
@@ -56,7 +71,7 @@ namespace openikev2 {
             virtual void disable();
 
             /**
-             * Sets the alarm total time.
+             * Sets the alarm total time. It is applied on the next reset()
              * @param milliseconds Total time in milliseconds.
              */
             virtual void setTime( uint32_t milliseconds );
@@ -67,6 +82,32 @@ namespace openikev2 {
              */
             virtual uint32_t getTotalTime() const;
 
+            /**
+             * Indicates if the Alarm is enabled
+             * @return TRUE if the Alarm is enabled. FALSE otherwise
+             */
+            bool isEnabled() const;
+
+            /**
+             * Gets the deadline of the Alarm
+             * @return Monotonic time (in milliseconds) when the Alarm expires. ALARM_DISARMED if disabled
+             */
+            int64_t getDeadline() const;
+
+            /**
+             * Disables the Alarm if its deadline has not changed. Used by the AlarmController before notifying it (one-shot semantics)
+             * @param deadline Deadline found expired
+             * @return TRUE if the Alarm has been disabled. FALSE if it has been reset or disabled meanwhile
+             */
+            bool expire( int64_t deadline );
+
+            /**
+             * Records the deadline the AlarmController has scheduled the Alarm for. It must be called before checking
+             * the Alarm deadline again, so no concurrent reset() is missed
+             * @param deadline Scheduled deadline. ALARM_DISARMED if the Alarm is not scheduled
+             */
+            void setScheduledDeadline( int64_t deadline );
+
             /**
              * Notifies alarm timeout to the receiver of the event.
              */
@@ -25,6 +25,11 @@ namespace openikev2 {
         assert (implementation != NULL);
         return implementation->removeAlarm( alarm );
     }
+
+    void AlarmController::updateAlarm( Alarm& alarm ) {
+        assert (implementation != NULL);
+        return implementation->updateAlarm( alarm );
+    }
 }
 
 
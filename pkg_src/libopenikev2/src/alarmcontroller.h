@@ -47,6 +47,12 @@ namespace openikev2 {
              */
             static void removeAlarm( Alarm& alarm );
 
+            /**
+             * Notifies the implementation that the Alarm has been reset or disabled
+             * @param alarm Updated Alarm
+             */
+            static void updateAlarm( Alarm& alarm );
+
     };
 }
 #endif
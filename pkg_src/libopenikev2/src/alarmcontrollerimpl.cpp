@@ -12,5 +12,7 @@
 #include "log.h"
 
 namespace openikev2 {
+    void AlarmControllerImpl::updateAlarm( Alarm& ) {}
+
     AlarmControllerImpl::~AlarmControllerImpl() {}
 }
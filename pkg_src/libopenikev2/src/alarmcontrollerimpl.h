@@ -38,6 +38,13 @@ namespace openikev2 {
              */
             virtual void removeAlarm( Alarm& alarm ) = 0;
 
+            /**
+             * Notifies that the Alarm has been reset or disabled.
+             * Implementations that poll Alarm::getDeadline() don't need to redefine it.
+             * @param alarm Updated Alarm
+             */
+            virtual void updateAlarm( Alarm& alarm );
+
             virtual ~AlarmControllerImpl();
     };
 
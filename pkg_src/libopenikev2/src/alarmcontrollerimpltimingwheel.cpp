@@ -0,0 +1,273 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#include "alarmcontrollerimpltimingwheel.h"
+#include "threadcontroller.h"
+#include "autolock.h"
+#include "log.h"
+#include "utils.h"
+
+#include <assert.h>
+
+#define LEVEL0_SIZE     ( 1ULL << TIMING_WHEEL_LEVEL0_BITS )
+#define LEVEL0_MASK     ( LEVEL0_SIZE - 1 )
+#define LEVEL_SIZE      ( 1ULL << TIMING_WHEEL_LEVEL_BITS )
+#define LEVEL_MASK      ( LEVEL_SIZE - 1 )
+
+namespace openikev2 {
+
+    AlarmControllerImplTimingWheel::AlarmControllerImplTimingWheel( uint32_t tick_msec ) {
+        this->condition = ThreadController::getCondition();
+        this->notifying = NULL;
+        this->remove_waiters = 0;
+        this->tick_msec = ( tick_msec > 0 ) ? tick_msec : 1;
+        this->current_tick = 0;
+
+        for ( uint32_t i = 0; i < LEVEL0_SIZE; i++ ) {
+            this->level0[ i ].alarm = NULL;
+            this->level0[ i ].prev = this->level0[ i ].next = &this->level0[ i ];
+        }
+
+        for ( uint32_t level = 0; level < TIMING_WHEEL_LEVELS - 1; level++ ) {
+            for ( uint32_t i = 0; i < LEVEL_SIZE; i++ ) {
+                this->levels[ level ][ i ].alarm = NULL;
+                this->levels[ level ][ i ].prev = this->levels[ level ][ i ].next = &this->levels[ level ][ i ];
+            }
+        }
+
+        this->exiting = false;
+        this->start_time = chrono::steady_clock::now();
+        this->start_msec = chrono::duration_cast<chrono::milliseconds> ( this->start_time.time_since_epoch() ).count();
+        this->timer = thread( &AlarmControllerImplTimingWheel::runTimer, this );
+    }
+
+    AlarmControllerImplTimingWheel::~AlarmControllerImplTimingWheel() {
+        this->exiting = true;
+        this->timer.join();
+
+        for ( unordered_map<Alarm*, Node*>::iterator it = this->nodes.begin(); it != this->nodes.end(); it++ )
+            delete it->second;
+    }
+
+    void AlarmControllerImplTimingWheel::link( Node& head, Node* node ) {
+        node->prev = head.prev;
+        node->next = &head;
+        head.prev->next = node;
+        head.prev = node;
+    }
+
+    void AlarmControllerImplTimingWheel::unlink( Node* node ) {
+        if ( node->next == NULL )
+            return;
+
+        node->prev->next = node->next;
+        node->next->prev = node->prev;
+        node->prev = node->next = NULL;
+    }
+
+    void AlarmControllerImplTimingWheel::place( Node* node ) {
+        if ( node->expires <= this->current_tick )
+            node->expires = this->current_tick + 1;
+
+        uint64_t delta = node->expires - this->current_tick;
+
+        if ( delta < LEVEL0_SIZE ) {
+            link( this->level0[ node->expires & LEVEL0_MASK ], node );
+            return;
+        }
+
+        for ( uint32_t level = 0; level < TIMING_WHEEL_LEVELS - 1; level++ ) {
+            uint32_t slot_shift = TIMING_WHEEL_LEVEL0_BITS + level * TIMING_WHEEL_LEVEL_BITS;
+            uint64_t range = 1ULL << ( slot_shift + TIMING_WHEEL_LEVEL_BITS );
+
+            if ( delta < range ) {
+                link( this->levels[ level ][ ( node->expires >> slot_shift ) & LEVEL_MASK ], node );
+                return;
+            }
+
+            // Beyond the wheel range: park it in the farthest slot. It will be placed again when cascaded
+            if ( level == TIMING_WHEEL_LEVELS - 2 ) {
+                uint64_t parked = this->current_tick + range - 1;
+                link( this->levels[ level ][ ( parked >> slot_shift ) & LEVEL_MASK ], node );
+                return;
+            }
+        }
+    }
+
+    void AlarmControllerImplTimingWheel::reschedule( Node* node ) {
+        unlink( node );
+
+        Alarm& alarm = *node->alarm;
+
+        // The scheduled deadline is published before reading the deadline again, so a concurrent reset() either is
+        // seen here or calls updateAlarm()
+        int64_t deadline;
+        do {
+            deadline = alarm.getDeadline();
+            alarm.setScheduledDeadline( deadline );
+        }
+        while ( alarm.getDeadline() != deadline );
+
+        if ( deadline == ALARM_DISARMED )
+            return;
+
+        int64_t msec = deadline - this->start_msec;
+        node->expires = ( msec > 0 ) ? ( msec + this->tick_msec - 1 ) / this->tick_msec : 0;
+        this->place( node );
+    }
+
+    void AlarmControllerImplTimingWheel::cascade( Node& head ) {
+        Node* node = head.next;
+
+        // Detaches the whole list before placing again its nodes, since they can return to this same slot
+        head.prev->next = NULL;
+        head.prev = head.next = &head;
+
+        while ( node != NULL && node != &head ) {
+            Node* next = node->next;
+            node->prev = node->next = NULL;
+            this->place( node );
+            node = next;
+        }
+    }
+
+    void AlarmControllerImplTimingWheel::processTick() {
+        uint64_t tick = ++this->current_tick;
+
+        // When the first level completes a lap, the next slot of the upper level is distributed (and so on)
+        if ( ( tick & LEVEL0_MASK ) == 0 ) {
+            for ( uint32_t level = 0; level < TIMING_WHEEL_LEVELS - 1; level++ ) {
+                uint64_t index = ( tick >> ( TIMING_WHEEL_LEVEL0_BITS + level * TIMING_WHEEL_LEVEL_BITS ) ) & LEVEL_MASK;
+                this->cascade( this->levels[ level ][ index ] );
+                if ( index != 0 )
+                    break;
+            }
+        }
+
+        // Only the alarms scheduled for this tick are visited
+        int64_t tick_msec_time = this->start_msec + ( int64_t ) ( tick * this->tick_msec );
+        Node& head = this->level0[ tick & LEVEL0_MASK ];
+        while ( head.next != &head ) {
+            Node* node = head.next;
+            Alarm& alarm = *node->alarm;
+
+            // Disabled, or reset to a later deadline: dropped or placed again
+            int64_t deadline = alarm.getDeadline();
+            if ( deadline > tick_msec_time || !alarm.expire( deadline ) ) {
+                this->reschedule( node );
+                continue;
+            }
+
+            // Unschedules it, catching any reset() done after expiring it
+            this->reschedule( node );
+
+            node->expired = true;
+            this->expired.push_back( node );
+        }
+    }
+
+    void AlarmControllerImplTimingWheel::notifyExpired() {
+        for ( vector<Node*>::iterator it = this->expired.begin(); it != this->expired.end(); it++ ) {
+            Node* node = *it;
+            node->expired = false;
+
+            // Removed after expiring: the Alarm may already be deleted
+            if ( node->removed ) {
+                delete node;
+                continue;
+            }
+
+            // Notified without the wheel lock. removeAlarm() waits while this node is being notified
+            this->notifying = node;
+            this->condition->release();
+
+            node->alarm->notifyAlarmable();
+
+            this->condition->acquire();
+            this->notifying = NULL;
+            for ( uint32_t i = 0; i < this->remove_waiters; i++ )
+                this->condition->notify();
+
+            // Removed from notifyAlarm() itself
+            if ( node->removed )
+                delete node;
+        }
+
+        this->expired.clear();
+    }
+
+    void AlarmControllerImplTimingWheel::runTimer() {
+        chrono::milliseconds tick_duration( this->tick_msec );
+
+        while ( !this->exiting ) {
+            // Only this thread modifies current_tick, so it can be read without the lock
+            this_thread::sleep_until( this->start_time + tick_duration * ( this->current_tick + 1 ) );
+
+            uint64_t target_tick = ( chrono::steady_clock::now() - this->start_time ) / tick_duration;
+
+            AutoLock auto_lock( *this->condition );
+            while ( this->current_tick < target_tick )
+                this->processTick();
+            this->notifyExpired();
+        }
+    }
+
+    void AlarmControllerImplTimingWheel::addAlarm( Alarm& alarm ) {
+        AutoLock auto_lock( *this->condition );
+
+        assert( this->nodes.find( &alarm ) == this->nodes.end() );
+
+        Node* node = new Node();
+        node->alarm = &alarm;
+        node->expires = 0;
+        node->expired = false;
+        node->removed = false;
+        node->prev = node->next = NULL;
+        this->nodes[ &alarm ] = node;
+
+        this->reschedule( node );
+    }
+
+    void AlarmControllerImplTimingWheel::removeAlarm( Alarm& alarm ) {
+        AutoLock auto_lock( *this->condition );
+
+        unordered_map<Alarm*, Node*>::iterator it = this->nodes.find( &alarm );
+        if ( it == this->nodes.end() )
+            return;
+
+        Node* node = it->second;
+        unlink( node );
+        this->nodes.erase( it );
+
+        // The timer thread deletes the nodes it still references
+        if ( node->expired || node == this->notifying ) {
+            node->removed = true;
+
+            // Waits for the ongoing notification, unless it is done by this same thread (i.e. from notifyAlarm())
+            if ( node == this->notifying && this_thread::get_id() != this->timer.get_id() ) {
+                this->remove_waiters++;
+                while ( this->notifying == node )
+                    this->condition->wait();
+                this->remove_waiters--;
+            }
+            return;
+        }
+
+        delete node;
+    }
+
+    void AlarmControllerImplTimingWheel::updateAlarm( Alarm& alarm ) {
+        AutoLock auto_lock( *this->condition );
+
+        unordered_map<Alarm*, Node*>::iterator it = this->nodes.find( &alarm );
+        if ( it == this->nodes.end() )
+            return;
+
+        this->reschedule( it->second );
+    }
+}
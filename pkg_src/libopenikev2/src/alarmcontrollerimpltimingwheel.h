@@ -0,0 +1,137 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#ifndef OPENIKEV2ALARMCONTROLLERIMPLTIMINGWHEEL_H
+#define OPENIKEV2ALARMCONTROLLERIMPLTIMINGWHEEL_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "alarmcontrollerimpl.h"
+#include "condition.h"
+
+#include <unordered_map>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+#define TIMING_WHEEL_LEVEL0_BITS    8       // Slot bits of the first wheel level
+#define TIMING_WHEEL_LEVEL_BITS     6       // Slot bits of the upper wheel levels
+#define TIMING_WHEEL_LEVELS         4       // Number of wheel levels (including the first one)
+
+namespace openikev2 {
+
+    /**
+        This class implements an AlarmController using a hierarchical timing wheel. Adding, removing and rescheduling an Alarm
+        cost O(1), and a single timer thread driven by a monotonic clock advances the wheel one tick at a time.
+        Alarms are rescheduled lazily: disabling an Alarm or moving its deadline later doesn't touch the wheel. When its slot
+        comes, the Alarm is dropped if disabled, placed again if its deadline is still ahead, or notified otherwise.
+        Expired Alarms are disabled before notifying them (one-shot semantics). They are notified after releasing the wheel lock,
+        so notifyAlarm() can reset or remove the Alarm. removeAlarm() waits for an ongoing notification of the Alarm, so the
+        Alarm can be deleted once it returns.
+        @author Alejandro Perez Mendez, Pedro J. Fernandez Ruiz <alex@um.es, pedroj@um.es>
+    */
+    class AlarmControllerImplTimingWheel : public AlarmControllerImpl {
+
+            /****************************** STRUCTS ******************************/
+        protected:
+            /** Wheel node of an Alarm. Nodes of the same slot form a circular doubly linked list */
+            struct Node {
+                Alarm* alarm;                               /**< Alarm. NULL in the slot list heads */
+                uint64_t expires;                           /**< Tick when the Alarm expires */
+                bool expired;                               /**< Indicates if the node is waiting in the expired list */
+                bool removed;                               /**< Indicates if the Alarm was removed while in the expired list. The timer thread deletes the node */
+                Node* prev;                                 /**< Previous node in the slot */
+                Node* next;                                 /**< Next node in the slot */
+            };
+
+            /****************************** ATTRIBUTES ******************************/
+        protected:
+            auto_ptr<Condition> condition;                  /**< Condition protecting the wheel and waking up removeAlarm() */
+            unordered_map<Alarm*, Node*> nodes;             /**< Node of each registered Alarm */
+            vector<Node*> expired;                          /**< Expired nodes waiting to be notified */
+            Node* notifying;                                /**< Node being notified. NULL if none */
+            uint32_t remove_waiters;                        /**< Number of threads waiting in removeAlarm() */
+            Node level0[ 1 << TIMING_WHEEL_LEVEL0_BITS ];   /**< First level slots (one tick each) */
+            Node levels[ TIMING_WHEEL_LEVELS - 1 ][ 1 << TIMING_WHEEL_LEVEL_BITS ]; /**< Upper level slots */
+            uint64_t current_tick;                          /**< Last processed tick */
+            uint32_t tick_msec;                             /**< Tick duration (in milliseconds) */
+            chrono::steady_clock::time_point start_time;    /**< Monotonic time of the tick 0 */
+            int64_t start_msec;                             /**< Monotonic time of the tick 0 (in milliseconds, as the Alarm deadlines) */
+            atomic<bool> exiting;                           /**< Indicates if the timer thread must finish */
+            thread timer;                                   /**< Timer thread */
+
+            /****************************** METHODS ******************************/
+        protected:
+            /**
+             * Links the node into the slot list
+             * @param head Slot list head
+             * @param node Node to be linked
+             */
+            static void link( Node& head, Node* node );
+
+            /**
+             * Unlinks the node from its slot list (if linked)
+             * @param node Node to be unlinked
+             */
+            static void unlink( Node* node );
+
+            /**
+             * Places the node in the slot corresponding to its expiration tick. Condition must be acquired.
+             * @param node Node to be placed
+             */
+            void place( Node* node );
+
+            /**
+             * Unlinks the node and, if the Alarm is enabled, places it again using the Alarm deadline. Condition must be acquired.
+             * @param node Node to be rescheduled
+             */
+            void reschedule( Node* node );
+
+            /**
+             * Moves all the nodes of a slot to their new slots. Condition must be acquired.
+             * @param head Slot list head
+             */
+            void cascade( Node& head );
+
+            /**
+             * Advances the wheel one tick, moving the expired Alarms to the expired list. Condition must be acquired.
+             */
+            void processTick();
+
+            /**
+             * Notifies the Alarms in the expired list. Condition must be acquired. It is released while notifying each Alarm
+             */
+            void notifyExpired();
+
+            /**
+             * Main loop of the timer thread
+             */
+            void runTimer();
+
+        public:
+            /**
+             * Creates a new AlarmControllerImplTimingWheel and starts its timer thread
+             * @param tick_msec Wheel resolution (in milliseconds)
+             */
+            AlarmControllerImplTimingWheel( uint32_t tick_msec );
+
+            virtual void addAlarm( Alarm& alarm );
+            virtual void removeAlarm( Alarm& alarm );
+            virtual void updateAlarm( Alarm& alarm );
+
+            /**
+             * Stops the timer thread
+             */
+            virtual ~AlarmControllerImplTimingWheel();
+    };
+}
+
+#endif
@@ -0,0 +1,34 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#include "authenticationjob.h"
+#include "ikesa.h"
+
+namespace openikev2 {
+
+    AuthenticationJob::AuthenticationJob( const IkeSa& ike_sa, Authenticator& authenticator, auto_ptr<Message> message )
+            : CryptoJob( ike_sa.my_spi ), authenticator( authenticator ), ike_sa( ike_sa ) {
+        this->message = message;
+        this->verified = false;
+    }
+
+    AuthenticationJob::~AuthenticationJob() {}
+
+    void AuthenticationJob::execute() {
+        // process authentication payloads (CERT+, AUTH)
+        this->verified = this->authenticator.verifyAuthPayload( *this->message, this->ike_sa );
+
+        // generates our authentication payload
+        if ( this->verified )
+            this->payload_auth = this->authenticator.generateAuthPayload( this->ike_sa );
+    }
+
+    string AuthenticationJob::getJobName() const {
+        return "AUTHENTICATION";
+    }
+}
@@ -0,0 +1,58 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#ifndef OPENIKEV2AUTHENTICATIONJOB_H
+#define OPENIKEV2AUTHENTICATIONJOB_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "cryptojob.h"
+#include "authenticator.h"
+
+namespace openikev2 {
+
+    /**
+        This class represents a CryptoJob that verifies the AUTH payload of a received IKE_AUTH request and, if valid,
+        generates our AUTH payload. The IkeSa is only read, and it does not process any other Command until the job is completed.
+        The IkeSa destructor cancels the job (see CryptoJobPool::cancelJobs()), so the IkeSa outlives its execution.
+        @author Alejandro Perez Mendez, Pedro J. Fernandez Ruiz <alex@um.es, pedroj@um.es>
+    */
+    class AuthenticationJob : public CryptoJob {
+
+            /****************************** ATTRIBUTES ******************************/
+        protected:
+            Authenticator& authenticator;               /**< Authenticator of the IkeSa */
+            const IkeSa& ike_sa;                        /**< Waiting IkeSa */
+
+        public:
+            auto_ptr<Message> message;                  /**< Received request */
+            bool verified;                              /**< Indicates if the peer AUTH payload is valid */
+            auto_ptr<Payload_AUTH> payload_auth;        /**< Generated AUTH payload. NULL if not verified or if it cannot be generated */
+
+            /****************************** METHODS ******************************/
+        protected:
+            virtual void execute();
+
+        public:
+            /**
+             * Creates a new AuthenticationJob
+             * @param ike_sa Waiting IkeSa
+             * @param authenticator Authenticator of the IkeSa
+             * @param message Received request
+             */
+            AuthenticationJob( const IkeSa& ike_sa, Authenticator& authenticator, auto_ptr<Message> message );
+
+            virtual string getJobName() const;
+
+            virtual ~AuthenticationJob();
+    };
+}
+
+#endif
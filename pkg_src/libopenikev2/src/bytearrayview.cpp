@@ -0,0 +1,19 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#include "bytearrayview.h"
+
+namespace openikev2 {
+
+    ByteArrayView::ByteArrayView( const void* array, uint32_t size ) : ByteArray( array, size, size, true ) {}
+
+    ByteArrayView::~ByteArrayView() {
+        // the memory is not owned
+        this->begin_array = NULL;
+    }
+}
@@ -0,0 +1,41 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+
+#ifndef BYTEARRAYVIEW_H
+#define BYTEARRAYVIEW_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "bytearray.h"
+
+namespace openikev2 {
+
+    /**
+        This class represents a ByteArray that refers to memory owned by another object (i.e. the received Message buffer).
+        It never copies nor releases that memory, so it must not outlive its owner. Its clone() returns an owning ByteArray.
+        @author Alejandro Perez Mendez, Pedro J. Fernandez Ruiz <alex@um.es, pedroj@um.es>
+    */
+    class ByteArrayView : public ByteArray {
+
+            /****************************** METHODS ******************************/
+        public:
+            /**
+             * Creates a new ByteArrayView
+             * @param array Pointer to the referred memory
+             * @param size Size of the referred memory
+             */
+            ByteArrayView( const void* array, uint32_t size );
+
+            virtual ~ByteArrayView();
+    };
+}
+
+#endif
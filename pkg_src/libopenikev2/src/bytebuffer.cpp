@@ -7,6 +7,7 @@
 *   of the Apache license.  See the LICENSE file for details.             *
 ***************************************************************************/
 #include "bytebuffer.h"
+#include "bytearrayview.h"
 #include "netinet/in.h"
 #include "exception.h"
 #include <string.h>
@@ -41,6 +42,13 @@ namespace openikev2 {
     }
 
 
+    ByteBuffer::ByteBuffer( auto_ptr<ByteArray> byte_array ) : ByteArray( byte_array->begin_array, byte_array->size(), byte_array->capacity() - 1, true ) {
+        this->real_begin_array = this->begin_array;
+
+        // the memory is now owned by this ByteBuffer
+        byte_array->begin_array = NULL;
+    }
+
     ByteBuffer::~ ByteBuffer( ) {
         delete[] this->real_begin_array;
 
@@ -114,6 +122,15 @@ namespace openikev2 {
         return result;
     }
 
+    auto_ptr< ByteArray > ByteBuffer::readByteArrayView( uint32_t size ) {
+        if ( this->begin_array + size > this->end_data )
+            throw BufferExceededException( "ByteBuffer: Cannot read more data" );
+
+        auto_ptr<ByteArray> result ( new ByteArrayView( this->begin_array, size ) );
+        this->begin_array += size;
+        return result;
+    }
+
     uint8_t ByteBuffer::readInt8( ) {
         uint8_t temp;
         this->readBuffer( 1, ( uint8_t* ) & temp );
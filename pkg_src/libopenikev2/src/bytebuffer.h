@@ -60,6 +60,12 @@ namespace openikev2 {
              */
             ByteBuffer( const ByteArray& byte_array );
 
+            /**
+             * Creates a new ByteBuffer taking the memory of a ByteArray, without copying it
+             * @param byte_array Plain ByteArray (neither a ByteBuffer nor a ByteArrayView) whose memory will be owned by the new ByteBuffer
+             */
+            ByteBuffer( auto_ptr<ByteArray> byte_array );
+
             /**
              * Appends a standard byte array at the end of this ByteBuffer
              * @param buffer Standard byte arrray
@@ -112,6 +118,14 @@ namespace openikev2 {
              */
             virtual auto_ptr<ByteArray> readByteArray( uint32_t size );
 
+            /**
+             * Reads size bytes without copying them. The returned ByteArray refers to the ByteBuffer memory, so it
+             * must not outlive this ByteBuffer. Use clone() to get an independent copy.
+             * @param size Size to read
+             * @return New ByteArrayView with the read bytes
+             */
+            virtual auto_ptr<ByteArray> readByteArrayView( uint32_t size );
+
             /**
              * Reads a 8 bit integer from the begin of the ByteBuffer
              * @return 8 bit integer
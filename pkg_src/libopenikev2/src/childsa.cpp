@@ -7,6 +7,7 @@
 *   of the Apache license.  See the LICENSE file for details.             *
 ***************************************************************************/
 #include "childsa.h"
+#include "childsacollection.h"
 #include "ipseccontroller.h"
 #include "log.h"
 #include "utils.h"
@@ -18,6 +19,7 @@ namespace openikev2 {
 
     ChildSa::ChildSa( uint32_t inbound_spi, bool child_sa_initiator ) {
         this->state = ChildSa::CHILD_SA_CREATING;
+        this->collection = NULL;
 
         this->inbound_spi = inbound_spi;
         this->outbound_spi = 0;
@@ -31,6 +33,7 @@ namespace openikev2 {
 
     ChildSa::ChildSa( uint32_t inbound_spi, Enums::PROTOCOL_ID ipsec_protocol, bool child_sa_initiator ) {
         this->state = ChildSa::CHILD_SA_CREATING;
+        this->collection = NULL;
 
         this->inbound_spi = inbound_spi;
         this->outbound_spi = 0;
@@ -45,6 +48,7 @@ namespace openikev2 {
 
     ChildSa::ChildSa( uint32_t inbound_spi, auto_ptr< ChildSaRequest > child_sa_request ) {
         this->state = ChildSa::CHILD_SA_CREATING;
+        this->collection = NULL;
         this->child_sa_initiator = true;
         this->inbound_spi = inbound_spi;
         this->outbound_spi = 0;
@@ -60,6 +64,7 @@ namespace openikev2 {
 
     ChildSa::ChildSa( uint32_t inbound_spi, bool child_sa_initiator, const ChildSa & rekeyed_child_sa ) {
         this->state = ChildSa::CHILD_SA_CREATING;
+        this->collection = NULL;
         this->rekeyed_spi = rekeyed_child_sa.inbound_spi;
         this->inbound_spi = inbound_spi;
         this->outbound_spi = 0;
@@ -176,7 +181,9 @@ namespace openikev2 {
     }
 
     void ChildSa::setState( CHILD_SA_STATE next_state ) {
-        Log::writeLockedMessage( this->getLogId(), "Transition: [" + CHILD_SA_STATE_STR( this->state ) + " ---> " + CHILD_SA_STATE_STR( next_state ) + "]", Log::LOG_STAT, true );
+        LOG_LOCKED_MESSAGE( this->getLogId(), "Transition: [" + CHILD_SA_STATE_STR( this->state ) + " ---> " + CHILD_SA_STATE_STR( next_state ) + "]", Log::LOG_STAT, true );
+        if ( this->collection != NULL )
+            this->collection->updateStateCounters( this->state, next_state );
         this->state = next_state;
     }
 
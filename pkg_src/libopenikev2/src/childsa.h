@@ -28,11 +28,14 @@ using namespace std;
 
 namespace openikev2 {
 
+    class ChildSaCollection;
+
     /**
         This class represents a CHILD_SA
         @author Pedro J. Fernandez Ruiz, Alejandro Perez Mendez <pedroj@um.es, alex@um.es>
     */
     class ChildSa: public Printable {
+            friend class ChildSaCollection;
 
             /****************************** ENUMS ******************************/
         public:
@@ -49,6 +52,7 @@ namespace openikev2 {
         protected:
             auto_ptr<ChildSaConfiguration> child_sa_configuration; /**< IPsec configuration to be used with this ChildSa */
             CHILD_SA_STATE state;                                  /**< ChildSa state */
+            ChildSaCollection* collection;                         /**< ChildSaCollection containing this ChildSa (if any), to keep its state counters */
 
         public:
             uint32_t inbound_spi;                           /**< SPI of the inbound IPsec SA */
@@ -10,48 +10,196 @@
 #include "ipseccontroller.h"
 #include "threadcontroller.h"
 
+#include <unordered_map>
+#include <mutex>
+#include <string.h>
+
 namespace openikev2 {
 
-    ChildSaCollection::ChildSaCollection() {
+    /** Process wide index from Child SA SPI to the SPI of the owning IKE SA */
+    struct ChildSaSpiIndex {
+        std::mutex index_mutex;                                 /**< Mutex protecting the index */
+        unordered_map<uint32_t, uint64_t> inbound;              /**< Index by inbound SPI (allocated locally, so unique) */
+        unordered_multimap<uint32_t, uint64_t> outbound;        /**< Index by outbound SPI (chosen by the peers) */
+    };
+
+    static ChildSaSpiIndex& getChildSaSpiIndex() {
+        static ChildSaSpiIndex index;
+        return index;
+    }
+
+    static inline uint32_t hashSpi( uint32_t spi, uint32_t mask ) {
+        // Fibonacci hashing, so sequential SPIs are spread too
+        return ( spi * 2654435761U ) & mask;
+    }
+
+    ChildSaCollection::SpiTable::SpiTable() {
+        this->count = 0;
+    }
+
+    uint32_t ChildSaCollection::SpiTable::findSlot( uint32_t spi ) const {
+        uint32_t mask = this->slots.size() - 1;
+        uint32_t position = hashSpi( spi, mask );
+        while ( this->slots[ position ].child_sa != NULL && this->slots[ position ].spi != spi )
+            position = ( position + 1 ) & mask;
+        return position;
+    }
+
+    ChildSa* ChildSaCollection::SpiTable::find( uint32_t spi ) const {
+        if ( this->count == 0 )
+            return NULL;
+        return this->slots[ this->findSlot( spi ) ].child_sa;
+    }
+
+    void ChildSaCollection::SpiTable::insert( uint32_t spi, ChildSa* child_sa ) {
+        // Keeps the load factor under 1/2, so probe sequences stay short
+        if ( ( this->count + 1 ) * 2 > this->slots.size() ) {
+            vector<Slot> old_slots( this->slots.size() ? this->slots.size() * 2 : 8 );
+            old_slots.swap( this->slots );
+            this->count = 0;
+            for ( vector<Slot>::iterator it = old_slots.begin(); it != old_slots.end(); it++ ) {
+                if ( it->child_sa != NULL )
+                    this->insert( it->spi, it->child_sa );
+            }
+        }
+
+        Slot& slot = this->slots[ this->findSlot( spi ) ];
+        if ( slot.child_sa == NULL )
+            this->count++;
+        slot.spi = spi;
+        slot.child_sa = child_sa;
+    }
+
+    bool ChildSaCollection::SpiTable::erase( uint32_t spi ) {
+        if ( this->count == 0 )
+            return false;
+
+        uint32_t mask = this->slots.size() - 1;
+        uint32_t hole = this->findSlot( spi );
+        if ( this->slots[ hole ].child_sa == NULL )
+            return false;
+
+        // Moves back the following entries of the cluster that would not be reachable through the hole
+        for ( uint32_t position = ( hole + 1 ) & mask; this->slots[ position ].child_sa != NULL; position = ( position + 1 ) & mask ) {
+            uint32_t home = hashSpi( this->slots[ position ].spi, mask );
+            if ( ( ( position - home ) & mask ) >= ( ( position - hole ) & mask ) ) {
+                this->slots[ hole ] = this->slots[ position ];
+                hole = position;
+            }
+        }
+
+        this->slots[ hole ].child_sa = NULL;
+        this->count--;
+        return true;
+    }
+
+    ChildSaCollection::ChildSaCollection( uint64_t ike_sa_spi ) {
+        this->ike_sa_spi = ike_sa_spi;
+        memset( this->state_counters, 0, sizeof( this->state_counters ) );
         this->mutex = ThreadController::getMutex();
     }
 
     ChildSaCollection::~ChildSaCollection() {
         AutoLock auto_lock( *this->mutex );
         // Deletes all CHILD SA (by inbound SPI)
-        for ( map<uint32_t, ChildSa*>::iterator it = this->child_sa_collection_inbound.begin(); it != this->child_sa_collection_inbound.end(); it++ ) {
-            delete it->second;
+        for ( vector<Slot>::iterator it = this->child_sa_collection_inbound.slots.begin(); it != this->child_sa_collection_inbound.slots.end(); it++ ) {
+            if ( it->child_sa == NULL )
+                continue;
+            if ( this->ike_sa_spi != 0 )
+                unindexChildSa( *it->child_sa, this->ike_sa_spi );
+            delete it->child_sa;
         }
     }
 
-    ChildSa * ChildSaCollection::getChildSa( uint32_t spi ) {
+    void ChildSaCollection::indexChildSa( const ChildSa& child_sa, uint64_t ike_sa_spi ) {
+        ChildSaSpiIndex& index = getChildSaSpiIndex();
+        lock_guard<std::mutex> lock( index.index_mutex );
+        index.inbound[ child_sa.inbound_spi ] = ike_sa_spi;
+        index.outbound.insert( pair<uint32_t, uint64_t>( child_sa.outbound_spi, ike_sa_spi ) );
+    }
+
+    void ChildSaCollection::unindexChildSa( const ChildSa& child_sa, uint64_t ike_sa_spi ) {
+        ChildSaSpiIndex& index = getChildSaSpiIndex();
+        lock_guard<std::mutex> lock( index.index_mutex );
+
+        unordered_map<uint32_t, uint64_t>::iterator it = index.inbound.find( child_sa.inbound_spi );
+        if ( it != index.inbound.end() && it->second == ike_sa_spi )
+            index.inbound.erase( it );
+
+        pair<unordered_multimap<uint32_t, uint64_t>::iterator, unordered_multimap<uint32_t, uint64_t>::iterator> range = index.outbound.equal_range( child_sa.outbound_spi );
+        for ( unordered_multimap<uint32_t, uint64_t>::iterator it_outbound = range.first; it_outbound != range.second; it_outbound++ ) {
+            if ( it_outbound->second == ike_sa_spi ) {
+                index.outbound.erase( it_outbound );
+                break;
+            }
+        }
+    }
+
+    void ChildSaCollection::findIkeSaSpis( uint32_t spi, vector<uint64_t>& ike_sa_spis ) {
+        ChildSaSpiIndex& index = getChildSaSpiIndex();
+        lock_guard<std::mutex> lock( index.index_mutex );
+
+        unordered_map<uint32_t, uint64_t>::const_iterator it = index.inbound.find( spi );
+        if ( it != index.inbound.end() )
+            ike_sa_spis.push_back( it->second );
+
+        pair<unordered_multimap<uint32_t, uint64_t>::const_iterator, unordered_multimap<uint32_t, uint64_t>::const_iterator> range = index.outbound.equal_range( spi );
+        for ( unordered_multimap<uint32_t, uint64_t>::const_iterator it_outbound = range.first; it_outbound != range.second; it_outbound++ )
+            ike_sa_spis.push_back( it_outbound->second );
+    }
+
+    void ChildSaCollection::setIkeSaSpi( uint64_t ike_sa_spi ) {
         AutoLock auto_lock( *this->mutex );
-        map<uint32_t, ChildSa*>::iterator it = this->child_sa_collection_inbound.find( spi );
-        if ( it != this->child_sa_collection_inbound.end() )
-            return ( *it ).second;
+        if ( ike_sa_spi == this->ike_sa_spi )
+            return;
+
+        for ( vector<Slot>::iterator it = this->child_sa_collection_inbound.slots.begin(); it != this->child_sa_collection_inbound.slots.end(); it++ ) {
+            if ( it->child_sa == NULL )
+                continue;
+            if ( this->ike_sa_spi != 0 )
+                unindexChildSa( *it->child_sa, this->ike_sa_spi );
+            if ( ike_sa_spi != 0 )
+                indexChildSa( *it->child_sa, ike_sa_spi );
+        }
 
-        it = this->child_sa_collection_outbound.find( spi );
-        if ( it != this->child_sa_collection_outbound.end() )
-            return ( *it ).second;
+        this->ike_sa_spi = ike_sa_spi;
+    }
 
-        return NULL;
+    void ChildSaCollection::updateStateCounters( ChildSa::CHILD_SA_STATE current_state, ChildSa::CHILD_SA_STATE next_state ) {
+        AutoLock auto_lock( *this->mutex );
+        this->state_counters[ current_state ]--;
+        this->state_counters[ next_state ]++;
+    }
+
+    ChildSa * ChildSaCollection::getChildSa( uint32_t spi ) {
+        AutoLock auto_lock( *this->mutex );
+        ChildSa* child_sa = this->child_sa_collection_inbound.find( spi );
+        if ( child_sa != NULL )
+            return child_sa;
+
+        return this->child_sa_collection_outbound.find( spi );
     }
 
     ChildSa * openikev2::ChildSaCollection::getFirstChildSa() {
         AutoLock auto_lock( *this->mutex );
-        if ( this->child_sa_collection_inbound.size() > 0 ) {
-            map<uint32_t, ChildSa*>::iterator it = this->child_sa_collection_inbound.begin();
-            return it->second;
+        for ( vector<Slot>::iterator it = this->child_sa_collection_inbound.slots.begin(); it != this->child_sa_collection_inbound.slots.end(); it++ ) {
+            if ( it->child_sa != NULL )
+                return it->child_sa;
         }
-        else
-            return NULL;
+        return NULL;
     }
 
     void ChildSaCollection::addChildSa( auto_ptr< ChildSa > child_sa ) {
         AutoLock auto_lock( *this->mutex );
-        this->child_sa_collection_inbound[ child_sa->inbound_spi ] = child_sa.get();
-        this->child_sa_collection_outbound[ child_sa->outbound_spi ] = child_sa.release();
+        if ( this->ike_sa_spi != 0 )
+            indexChildSa( *child_sa, this->ike_sa_spi );
+
+        child_sa->collection = this;
+        this->state_counters[ child_sa->getState() ]++;
 
+        this->child_sa_collection_inbound.insert( child_sa->inbound_spi, child_sa.get() );
+        this->child_sa_collection_outbound.insert( child_sa->outbound_spi, child_sa.get() );
+        child_sa.release();
     }
 
     string ChildSaCollection::toStringTab( uint8_t tabs ) const {
@@ -60,10 +208,11 @@ namespace openikev2 {
 
         oss << Printable::generateTabs( tabs ) << "<CHILD_SA_COLLECTION> {\n";
 
-        oss << Printable::generateTabs( tabs ) << "Count=[" << intToString( this->child_sa_collection_inbound.size() ) << "]" << endl;
+        oss << Printable::generateTabs( tabs ) << "Count=[" << intToString( this->child_sa_collection_inbound.count ) << "]" << endl;
 
-        for ( map<uint32_t, ChildSa*>::const_iterator it = this->child_sa_collection_inbound.begin(); it != this->child_sa_collection_inbound.end(); it++ )
-            oss << it->second->toStringTab( tabs + 1 );
+        for ( vector<Slot>::const_iterator it = this->child_sa_collection_inbound.slots.begin(); it != this->child_sa_collection_inbound.slots.end(); it++ )
+            if ( it->child_sa != NULL )
+                oss << it->child_sa->toStringTab( tabs + 1 );
 
         oss << Printable::generateTabs( tabs ) << "}\n";
 
@@ -74,56 +223,43 @@ namespace openikev2 {
         AutoLock auto_lock( *this->mutex );
 
         // deletes the inbound spi
-        map<uint32_t, ChildSa*>::iterator it = this->child_sa_collection_inbound.find( spi );
-        assert ( it != this->child_sa_collection_inbound.end() );
-        ChildSa* child_sa = it->second;
-        uint32_t outbound_spi = child_sa->outbound_spi;
-        this->child_sa_collection_inbound.erase( it );
+        ChildSa* child_sa = this->child_sa_collection_inbound.find( spi );
+        assert ( child_sa != NULL );
+        this->child_sa_collection_inbound.erase( spi );
 
-        it = this->child_sa_collection_outbound.find( outbound_spi );
-        assert ( it != this->child_sa_collection_outbound.end() );
-        this->child_sa_collection_outbound.erase( it );
+        bool found = this->child_sa_collection_outbound.erase( child_sa->outbound_spi );
+        assert ( found );
+        ( void ) found;
+
+        if ( this->ike_sa_spi != 0 )
+            unindexChildSa( *child_sa, this->ike_sa_spi );
+
+        this->state_counters[ child_sa->getState() ]--;
+        child_sa->collection = NULL;
 
         //delete child_sa;
     }
 
     bool ChildSaCollection::hasHalfClosedChildSas( ) const {
         AutoLock auto_lock( *this->mutex );
-        for ( map<uint32_t, ChildSa*>::const_iterator it = this->child_sa_collection_inbound.begin(); it != this->child_sa_collection_inbound.end(); it++ ) {
-            ChildSa * current = it->second;
-            if ( current->getState() == ChildSa::CHILD_SA_DELETING )
-                return true;
-        }
-        return false;
+        return this->state_counters[ ChildSa::CHILD_SA_DELETING ] > 0;
+    }
+
+    uint32_t ChildSaCollection::getStateCount( ChildSa::CHILD_SA_STATE state ) const {
+        AutoLock auto_lock( *this->mutex );
+        return this->state_counters[ state ];
     }
 
     bool ChildSaCollection::hasChildSa( uint32_t spi ) {
         AutoLock auto_lock( *this->mutex );
-        map<uint32_t, ChildSa*>::iterator it = this->child_sa_collection_inbound.find( spi );
-        if ( it != this->child_sa_collection_inbound.end() )
+        if ( this->child_sa_collection_inbound.find( spi ) != NULL )
             return true;
 
-        it = this->child_sa_collection_outbound.find( spi );
-        if ( it != this->child_sa_collection_outbound.end() )
-            return true;
-        return false;
+        return ( this->child_sa_collection_outbound.find( spi ) != NULL );
     }
 
     uint32_t ChildSaCollection::size() {
         AutoLock auto_lock( *this->mutex );
-        return this->child_sa_collection_inbound.size();
+        return this->child_sa_collection_inbound.count;
     }
 }
-
-
-
-
-
-
-
-
-
-
-
-
-
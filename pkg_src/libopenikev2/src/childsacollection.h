@@ -9,7 +9,7 @@
 #ifndef OPENIKEV2CHILDSACOLLECTION_H
 #define OPENIKEV2CHILDSACOLLECTION_H
 
-#include <map>
+#include <vector>
 #include "childsa.h"
 #include "mutex.h"
 #include "autolock.h"
@@ -19,22 +19,111 @@ using namespace std;
 namespace openikev2 {
 
     /**
-     This class represent a CHILD SA collection
+     This class represent a CHILD SA collection.
+     ChildSas are indexed by inbound and outbound SPI in two open addressing hash tables, and the collection keeps
+     the number of ChildSas in each state (updated by ChildSa::setState()).
+     All the collections also maintain a process wide index from SPI to the SPI of the owning IKE SA, so the
+     IkeSaController can find the IKE SA controlling a Child SA without searching every IKE SA.
      @author Alejandro Perez Mendez, Pedro J. Fernandez Ruiz <alex@um.es, pedroj@um.es>
     */
     class ChildSaCollection : public Printable {
+            friend class ChildSa;
+
+            /****************************** STRUCTS ******************************/
+        protected:
+            /** Slot of a SpiTable. Empty slots have a NULL child_sa */
+            struct Slot {
+                uint32_t spi;                                               /**< SPI value */
+                ChildSa* child_sa;                                          /**< ChildSa owning the SPI */
+            };
+
+            /** Open addressing (linear probing) hash table from SPI to ChildSa */
+            struct SpiTable {
+                vector<Slot> slots;                                         /**< Slots (power of two size) */
+                uint32_t count;                                             /**< Number of used slots */
+
+                SpiTable();
+
+                /**
+                 * Gets the slot where the SPI is, or the empty slot where it would be inserted
+                 * @param spi SPI value
+                 * @return Slot position
+                 */
+                uint32_t findSlot( uint32_t spi ) const;
+
+                /**
+                 * Gets the ChildSa owning the SPI
+                 * @param spi SPI value
+                 * @return The ChildSa, or NULL if not found
+                 */
+                ChildSa* find( uint32_t spi ) const;
+
+                /**
+                 * Inserts (or replaces) an SPI
+                 * @param spi SPI value
+                 * @param child_sa ChildSa owning the SPI
+                 */
+                void insert( uint32_t spi, ChildSa* child_sa );
+
+                /**
+                 * Removes an SPI, shifting back the following slots of the probe sequence
+                 * @param spi SPI value
+                 * @return TRUE if the SPI was found. FALSE otherwise
+                 */
+                bool erase( uint32_t spi );
+            };
+
             /****************************** ATTRIBUTES ******************************/
         protected:
-            map<uint32_t, ChildSa*> child_sa_collection_inbound;            /**< Child SA collection (indexed by inbound SPI) */
-            map<uint32_t, ChildSa*> child_sa_collection_outbound;           /**< Child SA collection (indexed by outbound SPI) */
+            SpiTable child_sa_collection_inbound;                           /**< Child SA collection (indexed by inbound SPI) */
+            SpiTable child_sa_collection_outbound;                          /**< Child SA collection (indexed by outbound SPI) */
+            uint32_t state_counters[ ChildSa::CHILD_SA_REKEYING + 1 ];      /**< Number of ChildSas in each state */
+            uint64_t ike_sa_spi;                                            /**< SPI of the IKE SA owning this collection (0 if none) */
             auto_ptr<Mutex> mutex;                                          /**< Mutex to protect accesses */
 
             /****************************** METHODS ******************************/
+        protected:
+            /**
+             * Updates the state counters when a ChildSa of the collection changes its state
+             * @param current_state Current state
+             * @param next_state Next state
+             */
+            virtual void updateStateCounters( ChildSa::CHILD_SA_STATE current_state, ChildSa::CHILD_SA_STATE next_state );
+
+            /**
+             * Adds the SPIs of a ChildSa to the process wide SPI index
+             * @param child_sa ChildSa
+             * @param ike_sa_spi SPI of the owning IKE SA
+             */
+            static void indexChildSa( const ChildSa& child_sa, uint64_t ike_sa_spi );
+
+            /**
+             * Removes the SPIs of a ChildSa from the process wide SPI index
+             * @param child_sa ChildSa
+             * @param ike_sa_spi SPI of the owning IKE SA
+             */
+            static void unindexChildSa( const ChildSa& child_sa, uint64_t ike_sa_spi );
+
         public:
             /**
              * Creates an empty ChildSa collection
+             * @param ike_sa_spi SPI of the IKE SA owning the collection. If 0, the ChildSas are not added to the SPI index
+             */
+            ChildSaCollection( uint64_t ike_sa_spi = 0 );
+
+            /**
+             * Sets the IKE SA owning the collection, updating the SPI index for all its ChildSas
+             * @param ike_sa_spi SPI of the IKE SA owning the collection
              */
-            ChildSaCollection();
+            virtual void setIkeSaSpi( uint64_t ike_sa_spi );
+
+            /**
+             * Finds the IKE SAs that may control the indicated Child SA SPI, using the process wide SPI index.
+             * Inbound SPIs are unique, but outbound ones are chosen by the peers and may be found in several IKE SAs.
+             * @param spi SPI value
+             * @param ike_sa_spis Where the SPIs of the candidate IKE SAs are appended (inbound matches first)
+             */
+            static void findIkeSaSpis( uint32_t spi, vector<uint64_t>& ike_sa_spis );
 
             /**
              * Adds a ChildSa object to the collection
@@ -74,6 +163,13 @@ namespace openikev2 {
              */
             virtual bool hasHalfClosedChildSas() const;
 
+            /**
+             * Indicates the number of ChildSa objects in the indicated state
+             * @param state ChildSa state
+             * @return The number of ChildSa objects in the state
+             */
+            virtual uint32_t getStateCount( ChildSa::CHILD_SA_STATE state ) const;
+
             /**
              * Indicates the number of ChildSa objects in the collection
              * @return The number of ChildSa objects in the collection
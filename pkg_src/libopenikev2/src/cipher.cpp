@@ -7,7 +7,56 @@
 *   of the Apache license.  See the LICENSE file for details.             *
 ***************************************************************************/
 #include "cipher.h"
+#include "cryptocontroller.h"
+#include "exception.h"
+#include <string.h>
 
 namespace openikev2 {
+    Cipher::Cipher() {
+        this->encr_block_size = 0;
+        this->integ_hash_size = 0;
+        this->iv_size = 0;
+        this->is_aead = false;
+    }
+
+    bool Cipher::isAead( Enums::ENCR_ID encr_id ) {
+        switch ( encr_id ) {
+            case Enums::ENCR_AES_GCM_8:
+            case Enums::ENCR_AES_GCM_12:
+            case Enums::ENCR_AES_GCM_16:
+            case Enums::ENCR_CHACHA20_POLY1305:
+                return true;
+            default:
+                return false;
+        }
+    }
+
+    void Cipher::encryptInPlace( uint8_t* data, uint32_t size, const uint8_t* initialization_vector ) {
+        ByteArray plain_text( data, size );
+        ByteArray iv( initialization_vector, this->encr_block_size );
+
+        auto_ptr<ByteArray> cipher_text = this->encrypt( plain_text, iv );
+        memcpy( data, cipher_text->getRawPointer(), size );
+    }
+
+    void Cipher::writeIntegrity( const uint8_t* data, uint32_t size, uint8_t* checksum ) {
+        ByteArray data_buffer( data, size );
+
+        auto_ptr<ByteArray> integrity = this->computeIntegrity( data_buffer );
+        memcpy( checksum, integrity->getRawPointer(), this->integ_hash_size );
+    }
+
+    void Cipher::writeInitializationVector( uint8_t* initialization_vector ) {
+        CryptoController::writeRandomBytes( initialization_vector, this->iv_size );
+    }
+
+    void Cipher::encryptAuthenticated( uint8_t*, uint32_t, const uint8_t*, const uint8_t*, uint32_t, uint8_t* ) {
+        throw CipherException( "AEAD encryption not supported by this cipher" );
+    }
+
+    bool Cipher::decryptAuthenticated( const uint8_t*, uint32_t, const uint8_t*, const uint8_t*, uint32_t, const uint8_t*, uint8_t* ) {
+        throw CipherException( "AEAD decryption not supported by this cipher" );
+    }
+
     Cipher::~Cipher() {}
 }
@@ -16,12 +16,15 @@
 #include <stdint.h>
 
 #include "bytearray.h"
+#include "enums.h"
 
 namespace openikev2 {
 
     /**
         This abstract class represets a cipher, with methods to encrypt, decrypt, and to compute integrity of byte array.
         This class holds internally the keys, so it is no needed to pass them as argument.
+        AEAD ciphers (RFC 5282) encrypt and compute the integrity in a single operation, using the encryptAuthenticated()
+        and decryptAuthenticated() methods instead of the separate ones.
         @author Pedro J. Fernandez Ruiz, Alejandro Perez Mendez <pedroj@um.es, alex@um.es>
     */
     class Cipher {
@@ -29,10 +32,23 @@ namespace openikev2 {
             /****************************** ATTRIBUTES ******************************/
         public:
             uint32_t encr_block_size;       /**< Encryption block size */
-            uint32_t integ_hash_size;       /**< Integrity hash size */
+            uint32_t integ_hash_size;       /**< Integrity hash size (ICV size for AEAD ciphers) */
+            uint32_t iv_size;               /**< Initialization vector size */
+            bool is_aead;                   /**< Indicates if this is an AEAD cipher */
 
             /****************************** METHODS ******************************/
         public:
+            /**
+             * Creates a new Cipher
+             */
+            Cipher();
+
+            /**
+             * Indicates if an ENCR algorithm is an AEAD one, that doesn't need a separate INTEG transform
+             * @param encr_id ENCR algorithm
+             * @return TRUE if the algorithm is an AEAD one. FALSE otherwise
+             */
+            static bool isAead( Enums::ENCR_ID encr_id );
 
             /**
              * Encrypts a plain text using the internal crypto algorithm and the internal key.
@@ -65,6 +81,56 @@ namespace openikev2 {
              */
             virtual auto_ptr<ByteArray> hmac( ByteArray& data_buffer, ByteArray& hmac_key ) = 0;
 
+            /**
+             * Encrypts a plain text in place. The default implementation relies on encrypt(), so implementations
+             * should redefine it to avoid the intermediate copies.
+             * @param data Plain text to be replaced by the cipher text. Its size must be multiple of the block size.
+             * @param size Size of the plain text
+             * @param initialization_vector Initialization vector. Its size must be equal to the block size
+             */
+            virtual void encryptInPlace( uint8_t* data, uint32_t size, const uint8_t* initialization_vector );
+
+            /**
+             * Computes the integrity of a raw data buffer and writes it in the indicated position.
+             * The default implementation relies on computeIntegrity().
+             * @param data Data buffer to compute its integrity
+             * @param size Size of the data buffer
+             * @param checksum Position where the integ_hash_size bytes of the integrity data will be written
+             */
+            virtual void writeIntegrity( const uint8_t* data, uint32_t size, uint8_t* checksum );
+
+            /**
+             * Writes a new initialization vector. The default implementation generates random bytes.
+             * @param initialization_vector Position where the iv_size bytes of the initialization vector will be written
+             */
+            virtual void writeInitializationVector( uint8_t* initialization_vector );
+
+            /**
+             * Encrypts a plain text in place and computes its ICV, using an AEAD cipher.
+             * The default implementation throws a CipherException.
+             * @param data Plain text to be replaced by the cipher text
+             * @param size Size of the plain text
+             * @param initialization_vector Initialization vector. Its size must be equal to iv_size
+             * @param associated_data Data to be authenticated but not encrypted
+             * @param associated_data_size Size of the associated data
+             * @param icv Position where the integ_hash_size bytes of the ICV will be written
+             */
+            virtual void encryptAuthenticated( uint8_t* data, uint32_t size, const uint8_t* initialization_vector, const uint8_t* associated_data, uint32_t associated_data_size, uint8_t* icv );
+
+            /**
+             * Checks the ICV of a cipher text and decrypts it, using an AEAD cipher.
+             * The default implementation throws a CipherException.
+             * @param data Cipher text
+             * @param size Size of the cipher text
+             * @param initialization_vector Initialization vector. Its size must be equal to iv_size
+             * @param associated_data Data authenticated but not encrypted
+             * @param associated_data_size Size of the associated data
+             * @param icv Received ICV. Its size must be equal to integ_hash_size
+             * @param output Output buffer for the plain text. It can be the cipher text buffer itself
+             * @return TRUE if the ICV is valid. FALSE otherwise
+             */
+            virtual bool decryptAuthenticated( const uint8_t* data, uint32_t size, const uint8_t* initialization_vector, const uint8_t* associated_data, uint32_t associated_data_size, const uint8_t* icv, uint8_t* output );
+
             virtual ~Cipher();
     };
 };
@@ -0,0 +1,324 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#include "cipheropenssl.h"
+#include "exception.h"
+#include "utils.h"
+
+#include <string.h>
+#include <assert.h>
+#include <openssl/crypto.h>
+
+namespace openikev2 {
+
+    const EVP_CIPHER* CipherOpenSSL::getEvpCipher( const Transform& encr_transform ) {
+        switch ( encr_transform.id ) {
+            case Enums::ENCR_3DES:
+                return EVP_des_ede3_cbc();
+
+            case Enums::ENCR_AES_CBC:
+                switch ( getEncrKeySize( encr_transform ) ) {
+                    case 16:
+                        return EVP_aes_128_cbc();
+                    case 24:
+                        return EVP_aes_192_cbc();
+                    case 32:
+                        return EVP_aes_256_cbc();
+                }
+                return NULL;
+
+            case Enums::ENCR_AES_GCM_8:
+            case Enums::ENCR_AES_GCM_12:
+            case Enums::ENCR_AES_GCM_16:
+                // The key length includes the 4 bytes salt
+                switch ( getEncrKeySize( encr_transform ) - 4 ) {
+                    case 16:
+                        return EVP_aes_128_gcm();
+                    case 24:
+                        return EVP_aes_192_gcm();
+                    case 32:
+                        return EVP_aes_256_gcm();
+                }
+                return NULL;
+
+            case Enums::ENCR_CHACHA20_POLY1305:
+                return EVP_chacha20_poly1305();
+
+            default:
+                return NULL;
+        }
+    }
+
+    const char* CipherOpenSSL::getDigestName( Enums::INTEG_ID integ_id ) {
+        switch ( integ_id ) {
+            case Enums::AUTH_HMAC_MD5_96:
+                return "MD5";
+            case Enums::AUTH_HMAC_SHA1_96:
+                return "SHA1";
+            case Enums::AUTH_HMAC_SHA2_256_128:
+                return "SHA256";
+            case Enums::AUTH_HMAC_SHA2_384_192:
+                return "SHA384";
+            case Enums::AUTH_HMAC_SHA2_512_256:
+                return "SHA512";
+            default:
+                return NULL;
+        }
+    }
+
+    uint32_t CipherOpenSSL::getEncrKeySize( const Transform& encr_transform ) {
+        // Variable length algorithms indicate the key length (in bits) as attribute
+        for ( vector<TransformAttribute*>::const_iterator it = encr_transform.attributes->begin(); it != encr_transform.attributes->end(); it++ ) {
+            if ( ( *it )->type == Enums::ATTR_KEY_LEN && ( *it )->isTV ) {
+                uint32_t key_size = ( *it )->TVvalue / 8;
+                // AES-CTR keys include the 4 bytes nonce (RFC 3686), and AES-GCM ones the 4 bytes salt (RFC 5282)
+                return ( encr_transform.id == Enums::ENCR_AES_CTR || Cipher::isAead( ( Enums::ENCR_ID ) encr_transform.id ) ) ? key_size + 4 : key_size;
+            }
+        }
+
+        switch ( encr_transform.id ) {
+            case Enums::ENCR_DES:
+            case Enums::ENCR_DES_IV64:
+            case Enums::ENCR_DES_IV32:
+                return 8;
+            case Enums::ENCR_3DES:
+                return 24;
+            case Enums::ENCR_AES_CBC:
+                return 16;
+            case Enums::ENCR_AES_CTR:
+            case Enums::ENCR_AES_GCM_8:
+            case Enums::ENCR_AES_GCM_12:
+            case Enums::ENCR_AES_GCM_16:
+                return 20;
+            case Enums::ENCR_CHACHA20_POLY1305:
+                return 36;
+            default:
+                return 0;
+        }
+    }
+
+    uint32_t CipherOpenSSL::getIntegKeySize( Enums::INTEG_ID integ_id ) {
+        switch ( integ_id ) {
+            case Enums::AUTH_HMAC_MD5_96:
+            case Enums::AUTH_AES_XCBC_96:
+                return 16;
+            case Enums::AUTH_HMAC_SHA1_96:
+                return 20;
+            case Enums::AUTH_HMAC_SHA2_256_128:
+                return 32;
+            case Enums::AUTH_HMAC_SHA2_384_192:
+                return 48;
+            case Enums::AUTH_HMAC_SHA2_512_256:
+                return 64;
+            default:
+                return 0;
+        }
+    }
+
+    uint32_t CipherOpenSSL::getIntegHashSize( Enums::INTEG_ID integ_id ) {
+        switch ( integ_id ) {
+            case Enums::AUTH_HMAC_MD5_96:
+            case Enums::AUTH_HMAC_SHA1_96:
+            case Enums::AUTH_AES_XCBC_96:
+                return 12;
+            case Enums::AUTH_HMAC_SHA2_256_128:
+                return 16;
+            case Enums::AUTH_HMAC_SHA2_384_192:
+                return 24;
+            case Enums::AUTH_HMAC_SHA2_512_256:
+                return 32;
+            default:
+                return 0;
+        }
+    }
+
+    uint32_t CipherOpenSSL::getIcvSize( Enums::ENCR_ID encr_id ) {
+        switch ( encr_id ) {
+            case Enums::ENCR_AES_GCM_8:
+                return 8;
+            case Enums::ENCR_AES_GCM_12:
+                return 12;
+            case Enums::ENCR_AES_GCM_16:
+            case Enums::ENCR_CHACHA20_POLY1305:
+                return 16;
+            default:
+                return 0;
+        }
+    }
+
+    CipherOpenSSL::CipherOpenSSL( const Transform& encr_transform, Enums::INTEG_ID integ_id, const ByteArray& encr_key, const ByteArray& integ_key ) {
+        const EVP_CIPHER* evp_cipher = getEvpCipher( encr_transform );
+        if ( evp_cipher == NULL )
+            throw CipherException( "ENCR algorithm not supported: " + Enums::ENCR_ID_STR( ( Enums::ENCR_ID ) encr_transform.id ) );
+
+        this->is_aead = Cipher::isAead( ( Enums::ENCR_ID ) encr_transform.id );
+        this->iv_counter = 0;
+        memset( this->salt, 0, sizeof( this->salt ) );
+
+        const char* digest_name = NULL;
+        if ( !this->is_aead ) {
+            digest_name = getDigestName( integ_id );
+            if ( digest_name == NULL )
+                throw CipherException( "INTEG algorithm not supported: " + Enums::INTEG_ID_STR( integ_id ) );
+        }
+
+        // AEAD keys end with the salt of the nonce
+        uint32_t salt_size = this->is_aead ? sizeof( this->salt ) : 0;
+        if ( encr_key.size() != ( uint32_t ) EVP_CIPHER_get_key_length( evp_cipher ) + salt_size )
+            throw CipherException( "Invalid encryption key size: " + intToString( encr_key.size() ) );
+
+        if ( this->is_aead ) {
+            memcpy( this->salt, encr_key.getRawPointer() + encr_key.size() - salt_size, salt_size );
+
+            // Stream modes don't need the padding to be aligned
+            this->encr_block_size = 1;
+            this->iv_size = 8;
+            this->integ_hash_size = getIcvSize( ( Enums::ENCR_ID ) encr_transform.id );
+        }
+        else {
+            this->encr_block_size = EVP_CIPHER_get_block_size( evp_cipher );
+            this->iv_size = this->encr_block_size;
+            this->integ_hash_size = getIntegHashSize( integ_id );
+        }
+
+        // The key schedules are computed only once. Operations just set the IV
+        this->encrypt_context = EVP_CIPHER_CTX_new();
+        this->decrypt_context = EVP_CIPHER_CTX_new();
+        if ( !EVP_EncryptInit_ex( this->encrypt_context, evp_cipher, NULL, encr_key.getRawPointer(), NULL ) ||
+                !EVP_DecryptInit_ex( this->decrypt_context, evp_cipher, NULL, encr_key.getRawPointer(), NULL ) )
+            throw CipherException( "Cannot initialize cipher context" );
+
+        // IKEv2 uses its own padding
+        EVP_CIPHER_CTX_set_padding( this->encrypt_context, 0 );
+        EVP_CIPHER_CTX_set_padding( this->decrypt_context, 0 );
+
+        // AEAD ciphers compute the integrity themselves
+        if ( this->is_aead )
+            return;
+
+        this->integrity_hmac.reset( new HmacOpenSSL( digest_name ) );
+        this->integrity_hmac->setKey( integ_key.getRawPointer(), integ_key.size() );
+        this->generic_hmac.reset( new HmacOpenSSL( digest_name ) );
+    }
+
+    CipherOpenSSL::~CipherOpenSSL() {
+        EVP_CIPHER_CTX_free( this->encrypt_context );
+        EVP_CIPHER_CTX_free( this->decrypt_context );
+        OPENSSL_cleanse( this->salt, sizeof( this->salt ) );
+    }
+
+    void CipherOpenSSL::cipherData( EVP_CIPHER_CTX* context, const uint8_t* input, uint32_t size, const uint8_t* initialization_vector, uint8_t* output ) {
+        if ( this->is_aead )
+            throw CipherException( "AEAD ciphers only support authenticated encryption" );
+
+        if ( size % this->encr_block_size != 0 )
+            throw CipherException( "Data size is not multiple of the block size: " + intToString( size ) );
+
+        // Only the IV is set. The cipher and the key schedule remain loaded
+        int output_size;
+        if ( !EVP_CipherInit_ex( context, NULL, NULL, NULL, initialization_vector, -1 ) ||
+                !EVP_CipherUpdate( context, output, &output_size, input, size ) )
+            throw CipherException( "Cannot cipher data" );
+    }
+
+    auto_ptr<ByteArray> CipherOpenSSL::encrypt( ByteArray& plain_text, ByteArray& initialization_vector ) {
+        auto_ptr<ByteArray> cipher_text ( new ByteArray( plain_text.size() ) );
+        this->cipherData( this->encrypt_context, plain_text.getRawPointer(), plain_text.size(), initialization_vector.getRawPointer(), cipher_text->getRawPointer() );
+        cipher_text->setSize( plain_text.size() );
+        return cipher_text;
+    }
+
+    auto_ptr<ByteArray> CipherOpenSSL::decrypt( ByteArray& cipher_text, ByteArray& initialization_vector ) {
+        auto_ptr<ByteArray> plain_text ( new ByteArray( cipher_text.size() ) );
+        this->cipherData( this->decrypt_context, cipher_text.getRawPointer(), cipher_text.size(), initialization_vector.getRawPointer(), plain_text->getRawPointer() );
+        plain_text->setSize( cipher_text.size() );
+        return plain_text;
+    }
+
+    void CipherOpenSSL::encryptInPlace( uint8_t* data, uint32_t size, const uint8_t* initialization_vector ) {
+        this->cipherData( this->encrypt_context, data, size, initialization_vector, data );
+    }
+
+    bool CipherOpenSSL::beginAuthenticated( EVP_CIPHER_CTX* context, const uint8_t* initialization_vector, const uint8_t* associated_data, uint32_t associated_data_size ) {
+        // nonce = salt | IV (RFC 5282, section 4 and RFC 7634, section 2)
+        uint8_t nonce[ 12 ];
+        memcpy( nonce, this->salt, 4 );
+        memcpy( nonce + 4, initialization_vector, 8 );
+
+        int output_size;
+        return EVP_CipherInit_ex( context, NULL, NULL, NULL, nonce, -1 ) &&
+               ( associated_data_size == 0 || EVP_CipherUpdate( context, NULL, &output_size, associated_data, associated_data_size ) );
+    }
+
+    void CipherOpenSSL::writeInitializationVector( uint8_t* initialization_vector ) {
+        if ( !this->is_aead ) {
+            Cipher::writeInitializationVector( initialization_vector );
+            return;
+        }
+
+        // AEAD IVs must never be repeated with the same key, so they are generated from a counter
+        uint64_t counter = this->iv_counter++;
+        for ( int16_t i = 7; i >= 0; i-- ) {
+            initialization_vector[ i ] = counter & 0xFF;
+            counter >>= 8;
+        }
+    }
+
+    void CipherOpenSSL::encryptAuthenticated( uint8_t* data, uint32_t size, const uint8_t* initialization_vector, const uint8_t* associated_data, uint32_t associated_data_size, uint8_t* icv ) {
+        assert( this->is_aead );
+
+        uint8_t final_block[ EVP_MAX_BLOCK_LENGTH ];
+        int output_size;
+        if ( !this->beginAuthenticated( this->encrypt_context, initialization_vector, associated_data, associated_data_size ) ||
+                !EVP_CipherUpdate( this->encrypt_context, data, &output_size, data, size ) ||
+                !EVP_CipherFinal_ex( this->encrypt_context, final_block, &output_size ) ||
+                !EVP_CIPHER_CTX_ctrl( this->encrypt_context, EVP_CTRL_AEAD_GET_TAG, this->integ_hash_size, icv ) )
+            throw CipherException( "Cannot encrypt data" );
+    }
+
+    bool CipherOpenSSL::decryptAuthenticated( const uint8_t* data, uint32_t size, const uint8_t* initialization_vector, const uint8_t* associated_data, uint32_t associated_data_size, const uint8_t* icv, uint8_t* output ) {
+        assert( this->is_aead );
+
+        uint8_t final_block[ EVP_MAX_BLOCK_LENGTH ];
+        int output_size;
+        if ( !this->beginAuthenticated( this->decrypt_context, initialization_vector, associated_data, associated_data_size ) ||
+                !EVP_CIPHER_CTX_ctrl( this->decrypt_context, EVP_CTRL_AEAD_SET_TAG, this->integ_hash_size, ( void* ) icv ) ||
+                !EVP_CipherUpdate( this->decrypt_context, output, &output_size, data, size ) )
+            throw CipherException( "Cannot decrypt data" );
+
+        // The ICV is checked when finishing the operation
+        return EVP_CipherFinal_ex( this->decrypt_context, final_block, &output_size ) > 0;
+    }
+
+    void CipherOpenSSL::writeIntegrity( const uint8_t* data, uint32_t size, uint8_t* checksum ) {
+        if ( this->is_aead )
+            throw CipherException( "AEAD ciphers don't compute a separate integrity checksum" );
+
+        uint8_t result[ EVP_MAX_MD_SIZE ];
+        this->integrity_hmac->compute( data, size, result );
+        memcpy( checksum, result, this->integ_hash_size );
+    }
+
+    auto_ptr<ByteArray> CipherOpenSSL::computeIntegrity( ByteArray& data_buffer ) {
+        auto_ptr<ByteArray> result ( new ByteArray( this->integ_hash_size ) );
+        this->writeIntegrity( data_buffer.getRawPointer(), data_buffer.size(), result->getRawPointer() );
+        result->setSize( this->integ_hash_size );
+        return result;
+    }
+
+    auto_ptr<ByteArray> CipherOpenSSL::hmac( ByteArray& data_buffer, ByteArray& hmac_key ) {
+        if ( this->is_aead )
+            throw CipherException( "AEAD ciphers don't have an HMAC algorithm" );
+
+        auto_ptr<ByteArray> result ( new ByteArray( this->generic_hmac->hmac_size ) );
+        this->generic_hmac->setKey( hmac_key.getRawPointer(), hmac_key.size() );
+        this->generic_hmac->compute( data_buffer.getRawPointer(), data_buffer.size(), result->getRawPointer() );
+        result->setSize( this->generic_hmac->hmac_size );
+        return result;
+    }
+}
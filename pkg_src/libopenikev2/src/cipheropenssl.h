@@ -0,0 +1,130 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#ifndef OPENIKEV2CIPHEROPENSSL_H
+#define OPENIKEV2CIPHEROPENSSL_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "cipher.h"
+#include "hmacopenssl.h"
+#include "transform.h"
+
+#include <openssl/evp.h>
+
+namespace openikev2 {
+
+    /**
+        This class implements a Cipher using OpenSSL. The encryption and decryption EVP_CIPHER_CTX are initialized
+        once with their key schedule, so each operation only sets the IV. The integrity HMAC context is reused as well.
+        AES-GCM (RFC 5282) and ChaCha20-Poly1305 (RFC 7634) are supported as AEAD ciphers. Their keys include a 4 bytes salt,
+        and the nonce is built as salt | IV, using an IV counter so it is never repeated with the same key.
+        @author Alejandro Perez Mendez, Pedro J. Fernandez Ruiz <alex@um.es, pedroj@um.es>
+    */
+    class CipherOpenSSL : public Cipher {
+
+            /****************************** ATTRIBUTES ******************************/
+        protected:
+            EVP_CIPHER_CTX* encrypt_context;        /**< Encryption context, with the key loaded */
+            EVP_CIPHER_CTX* decrypt_context;        /**< Decryption context, with the key loaded */
+            auto_ptr<HmacOpenSSL> integrity_hmac;   /**< Integrity HMAC context, with the key loaded */
+            auto_ptr<HmacOpenSSL> generic_hmac;     /**< HMAC context for the hmac() method */
+            uint8_t salt[ 4 ];                      /**< Salt of the AEAD nonce */
+            uint64_t iv_counter;                    /**< Counter used to generate the AEAD IVs */
+
+            /****************************** METHODS ******************************/
+        protected:
+            /**
+             * Gets the OpenSSL cipher of an ENCR transform
+             * @param encr_transform ENCR transform
+             * @return The OpenSSL cipher. NULL if not supported
+             */
+            static const EVP_CIPHER* getEvpCipher( const Transform& encr_transform );
+
+            /**
+             * Gets the digest name used by an INTEG algorithm
+             * @param integ_id INTEG algorithm
+             * @return Digest name. NULL if not supported
+             */
+            static const char* getDigestName( Enums::INTEG_ID integ_id );
+
+            /**
+             * Encrypts or decrypts a buffer using the indicated context
+             * @param context Context
+             * @param input Input data. Its size must be multiple of the block size.
+             * @param size Input data size
+             * @param initialization_vector Initialization vector
+             * @param output Output buffer. It can be the input buffer itself
+             */
+            void cipherData( EVP_CIPHER_CTX* context, const uint8_t* input, uint32_t size, const uint8_t* initialization_vector, uint8_t* output );
+
+            /**
+             * Starts an AEAD operation: sets the nonce and processes the associated data
+             * @param context Context
+             * @param initialization_vector Initialization vector
+             * @param associated_data Associated data
+             * @param associated_data_size Size of the associated data
+             * @return TRUE if success. FALSE otherwise
+             */
+            bool beginAuthenticated( EVP_CIPHER_CTX* context, const uint8_t* initialization_vector, const uint8_t* associated_data, uint32_t associated_data_size );
+
+        public:
+            /**
+             * Gets the key length of an ENCR transform
+             * @param encr_transform ENCR transform
+             * @return The key length (in bytes)
+             */
+            static uint32_t getEncrKeySize( const Transform& encr_transform );
+
+            /**
+             * Gets the key length of an INTEG algorithm
+             * @param integ_id INTEG algorithm
+             * @return The key length (in bytes)
+             */
+            static uint32_t getIntegKeySize( Enums::INTEG_ID integ_id );
+
+            /**
+             * Gets the truncated integrity checksum length of an INTEG algorithm
+             * @param integ_id INTEG algorithm
+             * @return The checksum length (in bytes)
+             */
+            static uint32_t getIntegHashSize( Enums::INTEG_ID integ_id );
+
+            /**
+             * Gets the ICV length of an AEAD algorithm
+             * @param encr_id ENCR algorithm
+             * @return The ICV length (in bytes)
+             */
+            static uint32_t getIcvSize( Enums::ENCR_ID encr_id );
+
+            /**
+             * Creates a new CipherOpenSSL, loading the keys in their contexts
+             * @param encr_transform ENCR transform
+             * @param integ_id INTEG algorithm. AUTH_NONE for the AEAD algorithms
+             * @param encr_key Encryption key (including the salt for the AEAD algorithms)
+             * @param integ_key Integrity key. Empty for the AEAD algorithms
+             */
+            CipherOpenSSL( const Transform& encr_transform, Enums::INTEG_ID integ_id, const ByteArray& encr_key, const ByteArray& integ_key );
+
+            virtual auto_ptr<ByteArray> encrypt( ByteArray& plain_text, ByteArray& initialization_vector );
+            virtual auto_ptr<ByteArray> decrypt( ByteArray& cipher_text, ByteArray& initialization_vector );
+            virtual auto_ptr<ByteArray> computeIntegrity( ByteArray& data_buffer );
+            virtual auto_ptr<ByteArray> hmac( ByteArray& data_buffer, ByteArray& hmac_key );
+            virtual void encryptInPlace( uint8_t* data, uint32_t size, const uint8_t* initialization_vector );
+            virtual void writeIntegrity( const uint8_t* data, uint32_t size, uint8_t* checksum );
+            virtual void writeInitializationVector( uint8_t* initialization_vector );
+            virtual void encryptAuthenticated( uint8_t* data, uint32_t size, const uint8_t* initialization_vector, const uint8_t* associated_data, uint32_t associated_data_size, uint8_t* icv );
+            virtual bool decryptAuthenticated( const uint8_t* data, uint32_t size, const uint8_t* initialization_vector, const uint8_t* associated_data, uint32_t associated_data_size, const uint8_t* icv, uint8_t* output );
+
+            virtual ~CipherOpenSSL();
+    };
+}
+
+#endif
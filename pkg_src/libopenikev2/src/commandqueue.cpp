@@ -0,0 +1,154 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by                                                 *
+ *   Alejandro Perez Mendez     alex@um.es                                 *
+ *   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+ *                                                                         *
+ *   This software may be modified and distributed under the terms         *
+ *   of the Apache license.  See the LICENSE file for details.             *
+ ***************************************************************************/
+#include "commandqueue.h"
+#include "command.h"
+
+namespace openikev2 {
+
+    CommandQueue::Ring::Ring( size_t capacity ) {
+        size_t size = 2;
+        while ( size < capacity )
+            size <<= 1;
+
+        this->cells = new Cell[ size ];
+        this->mask = size - 1;
+
+        for ( size_t i = 0; i < size; i++ ) {
+            this->cells[ i ].sequence.store( i, memory_order_relaxed );
+            this->cells[ i ].command = NULL;
+        }
+
+        this->enqueue_pos.store( 0, memory_order_relaxed );
+        this->dequeue_pos.store( 0, memory_order_relaxed );
+        this->overflow_size.store( 0, memory_order_relaxed );
+    }
+
+    CommandQueue::Ring::~Ring() {
+        Command* command;
+        while ( ( command = this->pop() ) != NULL )
+            delete command;
+        delete[] this->cells;
+    }
+
+    bool CommandQueue::Ring::tryPush( Command* command ) {
+        size_t pos = this->enqueue_pos.load( memory_order_relaxed );
+        Cell* cell;
+
+        // Claims a slot. The slot is free when its sequence is equal to the position
+        while ( true ) {
+            cell = &this->cells[ pos & this->mask ];
+            size_t sequence = cell->sequence.load( memory_order_acquire );
+            intptr_t diff = ( intptr_t ) sequence - ( intptr_t ) pos;
+
+            if ( diff == 0 ) {
+                if ( this->enqueue_pos.compare_exchange_weak( pos, pos + 1, memory_order_relaxed ) )
+                    break;
+            }
+            else if ( diff < 0 )
+                return false;
+            else
+                pos = this->enqueue_pos.load( memory_order_relaxed );
+        }
+
+        // Publishes the command to the consumer
+        cell->command = command;
+        cell->sequence.store( pos + 1, memory_order_release );
+        return true;
+    }
+
+    Command* CommandQueue::Ring::tryPop() {
+        size_t pos = this->dequeue_pos.load( memory_order_relaxed );
+        Cell* cell = &this->cells[ pos & this->mask ];
+
+        if ( cell->sequence.load( memory_order_acquire ) != pos + 1 )
+            return NULL;
+
+        Command* command = cell->command;
+        cell->command = NULL;
+        this->dequeue_pos.store( pos + 1, memory_order_relaxed );
+
+        // Gives the slot back to the producers, one lap ahead
+        cell->sequence.store( pos + this->mask + 1, memory_order_release );
+        return command;
+    }
+
+    void CommandQueue::Ring::push( Command* command ) {
+        // While there are overflowed commands, new ones go after them to keep the order
+        if ( this->overflow_size.load( memory_order_acquire ) == 0 && this->tryPush( command ) )
+            return;
+
+        lock_guard<std::mutex> lock( this->overflow_mutex );
+        this->overflow.push_back( command );
+        this->overflow_size.store( this->overflow.size(), memory_order_release );
+    }
+
+    Command* CommandQueue::Ring::pop() {
+        Command* command = this->tryPop();
+        if ( command != NULL || this->overflow_size.load( memory_order_acquire ) == 0 )
+            return command;
+
+        lock_guard<std::mutex> lock( this->overflow_mutex );
+        if ( this->overflow.empty() )
+            return NULL;
+
+        command = this->overflow.front();
+        this->overflow.pop_front();
+        this->overflow_size.store( this->overflow.size(), memory_order_release );
+        return command;
+    }
+
+    bool CommandQueue::Ring::isEmpty() const {
+        size_t pos = this->dequeue_pos.load( memory_order_relaxed );
+        return this->cells[ pos & this->mask ].sequence.load( memory_order_acquire ) != pos + 1 && this->overflow_size.load( memory_order_acquire ) == 0;
+    }
+
+    void CommandQueue::Ring::popInheritable( vector<Command*>& inheritable ) {
+        vector<Command*> remaining;
+        Command* command;
+
+        while ( ( command = this->pop() ) != NULL ) {
+            if ( command->isInheritable() )
+                inheritable.push_back( command );
+            else
+                remaining.push_back( command );
+        }
+
+        // Queued again after the commands pushed meanwhile. Those that do not fit in the ring go to the overflow list
+        for ( vector<Command*>::iterator it = remaining.begin(); it != remaining.end(); it++ )
+            this->push( *it );
+    }
+
+    CommandQueue::CommandQueue( size_t capacity, size_t priority_capacity )
+            : normal_ring( capacity ), priority_ring( priority_capacity ) {}
+
+    CommandQueue::~CommandQueue() {}
+
+    void CommandQueue::push( auto_ptr<Command> command, bool priority ) {
+        Ring& ring = priority ? this->priority_ring : this->normal_ring;
+        ring.push( command.release() );
+    }
+
+    auto_ptr<Command> CommandQueue::pop() {
+        Command* command = this->priority_ring.pop();
+        if ( command == NULL )
+            command = this->normal_ring.pop();
+        return auto_ptr<Command> ( command );
+    }
+
+    bool CommandQueue::isEmpty() const {
+        return this->priority_ring.isEmpty() && this->normal_ring.isEmpty();
+    }
+
+    AutoVector<Command> CommandQueue::popInheritable() {
+        AutoVector<Command> result;
+        this->priority_ring.popInheritable( result.get() );
+        this->normal_ring.popInheritable( result.get() );
+        return result;
+    }
+}
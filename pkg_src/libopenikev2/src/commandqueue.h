@@ -0,0 +1,114 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by                                                 *
+ *   Alejandro Perez Mendez     alex@um.es                                 *
+ *   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+ *                                                                         *
+ *   This software may be modified and distributed under the terms         *
+ *   of the Apache license.  See the LICENSE file for details.             *
+ ***************************************************************************/
+#ifndef OPENIKEV2COMMANDQUEUE_H
+#define OPENIKEV2COMMANDQUEUE_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "autovector.h"
+
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <deque>
+#include <stdint.h>
+#include <stddef.h>
+
+using namespace std;
+
+namespace openikev2 {
+    class Command;
+
+    /**
+        This class represents a multi-producer/single-consumer Command queue, lock-free while its rings have room.
+        Any thread can push Commands, but only the thread executing the IkeSa commands can pop them.
+        Priority Commands are kept in a separate ring that is always drained first.
+        Commands are never discarded: when a ring is full, they are kept in its overflow list (protected by a mutex)
+        until the consumer drains the ring.
+        @author Alejandro Perez Mendez, Pedro J. Fernandez Ruiz <alex@um.es, pedroj@um.es>
+    */
+    class CommandQueue {
+
+            /****************************** STRUCTS ******************************/
+        protected:
+            /** Ring slot. Its sequence number tells producers and consumer who owns it */
+            struct Cell {
+                atomic<size_t> sequence;            /**< Sequence number of the slot */
+                Command* command;                   /**< Stored Command */
+            };
+
+            /** MPSC ring of Command pointers, with an overflow list for the Commands that do not fit */
+            class Ring {
+                protected:
+                    Cell* cells;                    /**< Ring slots */
+                    size_t mask;                    /**< Capacity - 1. Capacity is a power of two */
+                    atomic<size_t> enqueue_pos;     /**< Next position to be claimed by the producers */
+                    atomic<size_t> dequeue_pos;     /**< Next position to be read by the consumer */
+                    std::mutex overflow_mutex;      /**< Mutex to protect the overflow list */
+                    deque<Command*> overflow;       /**< Commands pushed while the ring was full (or while this list was not empty) */
+                    atomic<size_t> overflow_size;   /**< Size of the overflow list, readable without the mutex */
+
+                    bool tryPush( Command* command );
+                    Command* tryPop();
+
+                public:
+                    Ring( size_t capacity );
+                    void push( Command* command );
+                    Command* pop();
+                    bool isEmpty() const;
+                    void popInheritable( vector<Command*>& inheritable );
+                    ~Ring();
+            };
+
+            /****************************** ATTRIBUTES ******************************/
+        protected:
+            Ring normal_ring;                       /**< Ring with the normal Commands */
+            Ring priority_ring;                     /**< Ring with the priority Commands */
+
+            /****************************** METHODS ******************************/
+        public:
+            /**
+             * Creates a new CommandQueue
+             * @param capacity Ring size for the normal Commands. Rounded up to a power of two.
+             * @param priority_capacity Ring size for the priority Commands. Rounded up to a power of two.
+             */
+            CommandQueue( size_t capacity, size_t priority_capacity );
+
+            /**
+             * Pushes a Command into the queue. Can be called from any thread.
+             * @param command Command to be pushed
+             * @param priority If TRUE, the Command will be popped before all the normal Commands.
+             */
+            void push( auto_ptr<Command> command, bool priority );
+
+            /**
+             * Pops the next Command. Only the consumer thread can call it.
+             * @return The next Command, or NULL if the queue is empty
+             */
+            auto_ptr<Command> pop();
+
+            /**
+             * Indicates if there are published Commands. Only reliable from the consumer thread.
+             * @return TRUE if the queue is empty. FALSE otherwise
+             */
+            bool isEmpty() const;
+
+            /**
+             * Extracts the Commands that must be inherited on IKE_SA rekeyings. The rest of Commands are queued again, after
+             * the ones pushed meanwhile by other threads. Only the consumer thread can call it.
+             * @return The inheritable Commands, in queue order (priority ones first)
+             */
+            AutoVector<Command> popInheritable();
+
+            virtual ~CommandQueue();
+    };
+}
+#endif
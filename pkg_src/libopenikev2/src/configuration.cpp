@@ -30,10 +30,10 @@ namespace openikev2 {
 
         oss << Printable::generateTabs( tabs ) << "<CONFIGURATION> {\n";
 
-        oss << this->general_configuration->toStringTab( tabs + 1 );
+        oss << atomic_load( &this->general_configuration )->toStringTab( tabs + 1 );
 
         // generates the representation of the PeerConfiguration collection
-        for ( vector<PeerConfiguration*>::const_iterator it = this->peer_configuration->begin(); it != this->peer_configuration->end(); it++ )
+        for ( vector<shared_ptr<const PeerConfiguration> >::const_iterator it = this->peer_configuration.begin(); it != this->peer_configuration.end(); it++ )
             oss << ( *it ) ->toStringTab( tabs + 1 );
 
         oss << Printable::generateTabs( tabs ) << "}\n";
@@ -43,59 +43,59 @@ namespace openikev2 {
     void Configuration::addPeerConfiguration( auto_ptr<PeerConfiguration> peer_configuration ) {
         assert( peer_configuration.get() != NULL );
         AutoLock auto_lock( *this->mutex_config );
-        this->peer_configuration->push_back( peer_configuration.release() );
+        shared_ptr<const PeerConfiguration> shared_peer_configuration ( peer_configuration.release() );
+        this->peer_configuration.push_back( shared_peer_configuration );
+        this->peer_configuration_index.addPeerConfiguration( shared_peer_configuration );
     }
 
     void Configuration::setGeneralConfiguration( auto_ptr<GeneralConfiguration> general_configuration ) {
         assert( general_configuration.get() != NULL );
-        AutoLock auto_lock( *this->mutex_config );
-        this->general_configuration = general_configuration;
+        general_configuration->loadFlagsFromAttributes();
+        atomic_store( &this->general_configuration, shared_ptr<const GeneralConfiguration> ( general_configuration.release() ) );
     }
 
-    auto_ptr<PeerConfiguration> Configuration::getPeerConfiguration( const IpAddress& ip_address, Enums::ROLE_ID role ) {
+    shared_ptr<const PeerConfiguration> Configuration::getPeerConfiguration( const IpAddress& ip_address, Enums::ROLE_ID role ) {
         assert( role != Enums::ROLE_ANY );
         AutoLock auto_lock( *this->mutex_config );
 
-        // Find a matching PeerConfiguration
-        for ( vector<PeerConfiguration*>::iterator it = this->peer_configuration->begin(); it != this->peer_configuration->end(); it++ ) {
-            PeerConfiguration * current_peer_configuration = ( *it );
-
-            // Check role. If current peer configuration is not ANY and is not equal to parameter then omit current peer configuration
-            if ( current_peer_configuration->role != Enums::ROLE_ANY && current_peer_configuration->role != role )
-                continue;
-
-            // If role are OK then find ID
-            if ( current_peer_configuration->hasIpAddress( ip_address) )
-                return current_peer_configuration->clone();
-        }
+        shared_ptr<const PeerConfiguration> result = this->peer_configuration_index.find( ip_address, role );
 
         // If not found, throw exception
-        throw NoConfigurationFoundException( "Requesting a Peer Configuration" );
+        if ( result.get() == NULL )
+            throw NoConfigurationFoundException( "Requesting a Peer Configuration" );
+
+        return result;
     }
 
-    auto_ptr<GeneralConfiguration> Configuration::getGeneralConfiguration( ) {
-        AutoLock auto_lock( *this->mutex_config );
-        return auto_ptr<GeneralConfiguration>( this->general_configuration->clone() );
+    shared_ptr<const GeneralConfiguration> Configuration::getGeneralConfiguration( ) const {
+        return atomic_load( &this->general_configuration );
     }
 
     void Configuration::deletePeerConfiguration( const NetworkPrefix& network_prefix ) {
         AutoLock auto_lock( *this->mutex_config );
 
         // Find a matching PeerConfiguration
-        for ( vector<PeerConfiguration*>::iterator it = this->peer_configuration->begin(); it != this->peer_configuration->end(); it++ ) {
-            PeerConfiguration * current_peer_configuration = ( *it );
+        for ( vector<shared_ptr<const PeerConfiguration> >::iterator it = this->peer_configuration.begin(); it != this->peer_configuration.end(); it++ ) {
+            const PeerConfiguration& current_peer_configuration = *( *it );
 
             // If it contains the indicated network prefix
-            if ( current_peer_configuration->hasNetworkPrefix( network_prefix ) ) {
-
-                // delete the Network prefix from the Peer Configuration
-                current_peer_configuration->deleteNetworkPrefix( network_prefix );
+            if ( current_peer_configuration.hasNetworkPrefix( network_prefix ) ) {
 
-                // if the peer configuration has no more network prefixes, then delete the peer configuration
-                if ( current_peer_configuration->getNetworkPrefixCount() == 0 ) {
-                    this->peer_configuration->erase( it );
-                    delete ( current_peer_configuration );
+                // if the peer configuration has no more network prefixes, then delete the peer configuration.
+                // Otherwise, it is replaced by a copy without the network prefix, since it can be in use by some IKE_SA
+                if ( current_peer_configuration.getNetworkPrefixCount() == 1 ) {
+                    this->peer_configuration.erase( it );
                 }
+                else {
+                    auto_ptr<PeerConfiguration> new_peer_configuration = current_peer_configuration.clone();
+                    new_peer_configuration->deleteNetworkPrefix( network_prefix );
+                    *it = shared_ptr<const PeerConfiguration> ( new_peer_configuration.release() );
+                }
+
+                // Prefixes are rarely deleted, so the index is rebuilt
+                this->peer_configuration_index.clear();
+                for ( it = this->peer_configuration.begin(); it != this->peer_configuration.end(); it++ )
+                    this->peer_configuration_index.addPeerConfiguration( *it );
 
                 return ;
             }
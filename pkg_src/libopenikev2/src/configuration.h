@@ -11,9 +11,12 @@
 
 #include "generalconfiguration.h"
 #include "peerconfiguration.h"
+#include "peerconfigurationindex.h"
 #include "mutex.h"
 #include "autovector.h"
 
+#include <memory>
+
 
 namespace openikev2 {
 
@@ -26,8 +29,9 @@ namespace openikev2 {
             /****************************** ATTRIBUTES ******************************/
         protected:
             static Configuration* instance;                         /**< Singleton unique intance */
-            AutoVector<PeerConfiguration> peer_configuration;       /**< Peer configurations */
-            auto_ptr<GeneralConfiguration> general_configuration;   /**< General configuration */
+            vector<shared_ptr<const PeerConfiguration> > peer_configuration;  /**< Peer configurations, in addition order. They are never modified once added */
+            PeerConfigurationIndex peer_configuration_index;        /**< Peer configurations indexed by network prefix */
+            shared_ptr<const GeneralConfiguration> general_configuration;   /**< General configuration. Immutable snapshot, replaced as a whole. Use atomic_load()/atomic_store() */
             auto_ptr<Mutex> mutex_config;                           /**< Mutex to protect configuration accesses */
 
             /****************************** METHODS ******************************/
@@ -50,7 +54,7 @@ namespace openikev2 {
             static void deleteConfiguration();
 
             /**
-             * Changes the GeneralConfiguration of the Configuration.
+             * Publishes a new GeneralConfiguration. The current snapshot remains valid for the readers still using it.
              * @param general_configuration New GeneralConfiguration to be used.
              */
             virtual void setGeneralConfiguration( auto_ptr<GeneralConfiguration> general_configuration );
@@ -69,18 +73,19 @@ namespace openikev2 {
             virtual void deletePeerConfiguration( const NetworkPrefix& peer_network_prefix );
 
             /**
-             * Gets a copy of the PeerConfiguration to be applied with indicated peer IP address and role.
+             * Gets the PeerConfiguration to be applied with indicated peer IP address and role: the one with the longest
+             * network prefix containing the address. The returned PeerConfiguration is shared and must not be modified.
              * @param ip_address Peer IP address
              * @param role Role (cannot be ANY)
-             * @return A copy of the PeerConfiguration.
+             * @return The shared PeerConfiguration.
              */
-            virtual auto_ptr<PeerConfiguration> getPeerConfiguration( const IpAddress& ip_address, Enums::ROLE_ID role );
+            virtual shared_ptr<const PeerConfiguration> getPeerConfiguration( const IpAddress& ip_address, Enums::ROLE_ID role );
 
             /**
-            * Gets a copy of the GeneralConfiguration.
-            * @return Copy of the GeneralConfiguration.
+            * Gets the current GeneralConfiguration snapshot, without locking. It must not be modified.
+            * @return The shared GeneralConfiguration snapshot.
             */
-            virtual auto_ptr<GeneralConfiguration> getGeneralConfiguration();
+            virtual shared_ptr<const GeneralConfiguration> getGeneralConfiguration() const;
 
             virtual string toStringTab( uint8_t tabs ) const ;
 
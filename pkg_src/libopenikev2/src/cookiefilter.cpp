@@ -0,0 +1,95 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by                                                 *
+ *   Alejandro Perez Mendez     alex@um.es                                 *
+ *   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+ *                                                                         *
+ *   This software may be modified and distributed under the terms         *
+ *   of the Apache license.  See the LICENSE file for details.             *
+ ***************************************************************************/
+#include "cookiefilter.h"
+#include "ikesacontroller.h"
+#include "cryptocontroller.h"
+#include "networkcontroller.h"
+#include "configuration.h"
+#include "message.h"
+#include "exception.h"
+#include "log.h"
+
+#include <chrono>
+
+namespace openikev2 {
+    atomic<int64_t> CookieFilter::last_rotation ( 0 );
+
+    bool CookieFilter::isIkeSaInitRequest( const ByteBuffer& datagram ) {
+        if ( datagram.size() < 28 )
+            return false;
+
+        const uint8_t* header = datagram.getReadPosition();
+
+        // Responder SPI must be 0
+        for ( uint16_t i = 8; i < 16; i++ ) {
+            if ( header[ i ] != 0 )
+                return false;
+        }
+
+        // Exchange type must be IKE_SA_INIT, and the message must be a request
+        if ( header[ 18 ] != Message::IKE_SA_INIT || ( header[ 19 ] & 0x20 ) )
+            return false;
+
+        // Message ID must be 0
+        return ( header[ 20 ] | header[ 21 ] | header[ 22 ] | header[ 23 ] ) == 0;
+    }
+
+    void CookieFilter::checkSecretRotation( uint32_t cookie_lifetime ) {
+        int64_t now = chrono::duration_cast<chrono::seconds> ( chrono::steady_clock::now().time_since_epoch() ).count();
+        int64_t last = last_rotation.load();
+
+        // The first check only starts counting the lifetime
+        if ( last == 0 ) {
+            last_rotation.compare_exchange_strong( last, now );
+            return;
+        }
+
+        if ( now - last < ( int64_t ) cookie_lifetime )
+            return;
+
+        // Only one thread performs the rotation
+        if ( last_rotation.compare_exchange_strong( last, now ) ) {
+            CryptoController::rotateCookieSecret();
+            LOG_LOCKED_MESSAGE( "CookieFilter", "Cookie secret rotated", Log::LOG_HALF, true );
+        }
+    }
+
+    bool CookieFilter::acceptDatagram( const SocketAddress& src_addr, const SocketAddress& dst_addr, ByteBuffer& datagram ) {
+        // Only initial IKE_SA_INIT requests can create new IKE SAs
+        if ( !CookieFilter::isIkeSaInitRequest( datagram ) )
+            return true;
+
+        shared_ptr<const GeneralConfiguration> general_conf = Configuration::getInstance().getGeneralConfiguration();
+        CookieFilter::checkSecretRotation( general_conf->cookie_lifetime );
+
+        if ( !IkeSaController::useCookies() )
+            return true;
+
+        try {
+            // Only the payloads needed to check the cookie are decoded
+            Message message( src_addr.clone(), dst_addr.clone(), datagram, true );
+
+            Payload_NOTIFY* cookie = message.getFirstNotifyByType( Payload_NOTIFY::COOKIE );
+            if ( cookie != NULL && cookie->notification_data.get() != NULL && CryptoController::checkCookie( message, *cookie->notification_data ) )
+                return true;
+
+            // Sends the expected cookie without creating any state
+            auto_ptr<Message> response ( new Message( dst_addr.clone(), src_addr.clone(), message.spi_i, 0, 2, 0, Message::IKE_SA_INIT, Message::RESPONSE, false, false, 0 ) );
+            response->addPayload( auto_ptr<Payload> ( CryptoController::generateCookie( message ) ), false );
+            NetworkController::sendMessage( *response, NULL );
+
+            LOG_LOCKED_MESSAGE( "CookieFilter", "IKE_SA_INIT request without a valid cookie from " + src_addr.toString() + ". Stateless cookie sent", Log::LOG_HALF, true );
+        }
+        catch ( Exception & ex ) {
+            LOG_LOCKED_MESSAGE( "CookieFilter", "Invalid IKE_SA_INIT request dropped: " + string( ex.what() ), Log::LOG_HALF, true );
+        }
+
+        return false;
+    }
+}
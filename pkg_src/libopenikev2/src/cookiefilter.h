@@ -0,0 +1,61 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by                                                 *
+ *   Alejandro Perez Mendez     alex@um.es                                 *
+ *   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+ *                                                                         *
+ *   This software may be modified and distributed under the terms         *
+ *   of the Apache license.  See the LICENSE file for details.             *
+ ***************************************************************************/
+#ifndef OPENIKEV2COOKIEFILTER_H
+#define OPENIKEV2COOKIEFILTER_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "bytebuffer.h"
+#include "socketaddress.h"
+
+#include <atomic>
+
+namespace openikev2 {
+
+    /**
+     This class checks the received datagrams before any IkeSa is created for them. While the cookie DoS protection is
+     active, IKE_SA_INIT requests without a valid COOKIE notify are answered with a stateless COOKIE response and dropped.
+     It also rotates the cookie secret every GeneralConfiguration::cookie_lifetime seconds.
+     @author Alejandro Perez Mendez, Pedro J. Fernandez Ruiz <alex@um.es, pedroj@um.es>
+    */
+    class CookieFilter {
+
+            /****************************** ATTRIBUTES ******************************/
+        protected:
+            static atomic<int64_t> last_rotation;           /**< Monotonic time (in seconds) of the last cookie secret rotation */
+
+            /****************************** METHODS ******************************/
+        protected:
+            /**
+             * Indicates if a datagram seems to be an initial IKE_SA_INIT request, looking only at its fixed header
+             * @param datagram Received datagram
+             * @return TRUE if it is an initial IKE_SA_INIT request. FALSE otherwise
+             */
+            static bool isIkeSaInitRequest( const ByteBuffer& datagram );
+
+            /**
+             * Rotates the cookie secret if its lifetime has expired
+             * @param cookie_lifetime Lifetime of the cookie secret (in seconds)
+             */
+            static void checkSecretRotation( uint32_t cookie_lifetime );
+
+        public:
+            /**
+             * Checks a received datagram. It must be called before creating an IkeSa for it.
+             * @param src_addr Source address of the datagram
+             * @param dst_addr Destination address of the datagram
+             * @param datagram Received datagram. It is not modified
+             * @return TRUE if the datagram must be processed. FALSE if it has been answered or dropped
+             */
+            static bool acceptDatagram( const SocketAddress& src_addr, const SocketAddress& dst_addr, ByteBuffer& datagram );
+    };
+}
+#endif
@@ -11,13 +11,39 @@
 namespace openikev2 {
 
     CryptoControllerImpl* CryptoController::implementation ( NULL );
+    DiffieHellmanPool* CryptoController::diffie_hellman_pool ( NULL );
+    CryptoJobPool* CryptoController::crypto_job_pool ( NULL );
 
     void CryptoController::setImplementation( CryptoControllerImpl* impl ) {
         implementation = impl;
     }
 
+    void CryptoController::setDiffieHellmanPool( DiffieHellmanPool* pool ) {
+        diffie_hellman_pool = pool;
+    }
+
+    void CryptoController::setCryptoJobPool( CryptoJobPool* pool ) {
+        crypto_job_pool = pool;
+    }
+
+    bool CryptoController::hasCryptoJobPool() {
+        return crypto_job_pool != NULL;
+    }
+
+    void CryptoController::submitCryptoJob( auto_ptr<CryptoJob> job ) {
+        assert (crypto_job_pool != NULL);
+        crypto_job_pool->submit( job );
+    }
+
+    void CryptoController::cancelCryptoJobs( uint64_t ike_sa_spi ) {
+        if ( crypto_job_pool != NULL )
+            crypto_job_pool->cancelJobs( ike_sa_spi );
+    }
+
     auto_ptr<DiffieHellman> CryptoController::getDiffieHellman( Enums::DH_ID group ) {
         assert (implementation != NULL);
+        if ( diffie_hellman_pool != NULL )
+            return diffie_hellman_pool->getDiffieHellman( group );
         return implementation->getDiffieHellman( group );
     }
 
@@ -26,6 +52,21 @@ namespace openikev2 {
         return implementation->getRandom();
     }
 
+    void CryptoController::writeRandomBytes( uint8_t* buffer, uint32_t size ) {
+        assert (implementation != NULL);
+        implementation->writeRandomBytes( buffer, size );
+    }
+
+    uint32_t CryptoController::getRandomInt32( uint32_t min, uint32_t max ) {
+        assert (implementation != NULL);
+        return ( uint32_t ) implementation->getRandomInt64( min, max );
+    }
+
+    uint64_t CryptoController::getRandomInt64( uint64_t min, uint64_t max ) {
+        assert (implementation != NULL);
+        return implementation->getRandomInt64( min, max );
+    }
+
     auto_ptr<Cipher> CryptoController::getCipher( Proposal& proposal, auto_ptr<ByteArray> encr_key, auto_ptr<ByteArray> integ_key ) {
         assert (implementation != NULL);
         return implementation->getCipher( proposal, encr_key, integ_key );
@@ -41,9 +82,19 @@ namespace openikev2 {
         return implementation->generateCookie( message );
     }
 
-    auto_ptr<Proposal> CryptoController::chooseProposal( Payload_SA& received_payload_sa, Proposal& desired_proposal ) {
+    bool CryptoController::checkCookie( Message& message, ByteArray& cookie ) {
+        assert (implementation != NULL);
+        return implementation->checkCookie( message, cookie );
+    }
+
+    void CryptoController::rotateCookieSecret() {
+        assert (implementation != NULL);
+        implementation->rotateCookieSecret();
+    }
+
+    auto_ptr<Proposal> CryptoController::chooseProposal( Payload_SA& received_payload_sa, Proposal& desired_proposal, Enums::DH_ID received_group ) {
         assert (implementation != NULL);
-        return implementation->chooseProposal( received_payload_sa, desired_proposal );
+        return implementation->chooseProposal( received_payload_sa, desired_proposal, received_group );
     }
 
     auto_ptr< KeyRing > CryptoController::getKeyRing( Proposal & proposal, const PseudoRandomFunction& prf ) {
@@ -10,6 +10,8 @@
 #define CRYPTOCONTROLLER_H
 
 #include "cryptocontrollerimpl.h"
+#include "diffiehellmanpool.h"
+#include "cryptojobpool.h"
 // #include "message.h"
 #include "ipaddress.h"
 
@@ -24,6 +26,8 @@ namespace openikev2 {
             /****************************** ATTRIBUTES ******************************/
         protected:
             static CryptoControllerImpl* implementation;        /**< Implementation of the CryptoController */
+            static DiffieHellmanPool* diffie_hellman_pool;      /**< Pool of pregenerated DiffieHellman key pairs. NULL if not used */
+            static CryptoJobPool* crypto_job_pool;              /**< Pool executing the expensive operations of the IkeSa objects. NULL if not used */
 
             /****************************** METHODS ******************************/
         public:
@@ -34,6 +38,37 @@ namespace openikev2 {
              */
             static void setImplementation( CryptoControllerImpl* impl );
 
+            /**
+             * Sets the pool of pregenerated DiffieHellman key pairs used by getDiffieHellman(). It is not owned by the CryptoController.
+             * @param pool DiffieHellmanPool. NULL to generate all the key pairs synchronously
+             */
+            static void setDiffieHellmanPool( DiffieHellmanPool* pool );
+
+            /**
+             * Sets the pool executing the expensive operations (DiffieHellman and authentication) of the IkeSa objects.
+             * It is not owned by the CryptoController.
+             * @param pool CryptoJobPool. NULL to execute them synchronously
+             */
+            static void setCryptoJobPool( CryptoJobPool* pool );
+
+            /**
+             * Indicates if the expensive operations are executed asynchronously by a CryptoJobPool
+             * @return TRUE if there is a CryptoJobPool. FALSE otherwise
+             */
+            static bool hasCryptoJobPool();
+
+            /**
+             * Enqueues a CryptoJob in the CryptoJobPool. Its IkeSa will receive a CryptoJobCompletedCommand once executed
+             * @param job Job to be executed
+             */
+            static void submitCryptoJob( auto_ptr<CryptoJob> job );
+
+            /**
+             * Deletes the pending CryptoJobs of an IkeSa and waits for its running ones. It must be called before deleting the IkeSa
+             * @param ike_sa_spi SPI of the IkeSa
+             */
+            static void cancelCryptoJobs( uint64_t ike_sa_spi );
+
             /**
              * Creates a new DiffieHellman object using the current implementation
              * @param group DiffieHellman group
@@ -57,6 +92,29 @@ namespace openikev2 {
              */
             static auto_ptr<Random> getRandom();
 
+            /**
+             * Fills a caller provided buffer with random bytes using the current implementation, without allocating
+             * @param buffer Buffer to be filled
+             * @param size Number of bytes to be written
+             */
+            static void writeRandomBytes( uint8_t* buffer, uint32_t size );
+
+            /**
+             * Generates a 32 bits random number between min and max (both included), without allocating
+             * @param min Minimun number to be generated.
+             * @param max Maximun number to be generated.
+             * @return Random number generated.
+             */
+            static uint32_t getRandomInt32( uint32_t min, uint32_t max );
+
+            /**
+             * Generates a 64 bits random number between min and max (both included), without allocating
+             * @param min Minimun number to be generated.
+             * @param max Maximun number to be generated.
+             * @return Random number generated.
+             */
+            static uint64_t getRandomInt64( uint64_t min, uint64_t max );
+
             /**
              * Creates a new PseudoRandomFunction object
              * @param prf_transform PRF trandform
@@ -79,13 +137,28 @@ namespace openikev2 {
             */
             static auto_ptr<Payload_NOTIFY> generateCookie( Message& message );
 
+            /**
+             * Checks a received cookie using the current implementation
+             * @param message Full IKE_SA_INIT request message
+             * @param cookie Received cookie value
+             * @return TRUE if the cookie is valid (with the current or the previous secret). FALSE otherwise
+             */
+            static bool checkCookie( Message& message, ByteArray& cookie );
+
+            /**
+             * Rotates the cookie secret of the current implementation
+             */
+            static void rotateCookieSecret();
+
             /**
              * Creates a new Proposal containing the matching selection between a received Payload_SA and a desired Proposal
              * @param received_payload_sa Received Payload_SA
              * @param desired_proposal Our desired Proposal
+             * @param received_group DH group of the received KE payload (DH_NONE if there is no one). If acceptable, it is
+             * selected, so the peer doesn't need to retry with another KE payload
              * @return A new negociated Proposal
              */
-            static auto_ptr<Proposal> chooseProposal( Payload_SA& received_payload_sa, Proposal& desired_proposal );
+            static auto_ptr<Proposal> chooseProposal( Payload_SA& received_payload_sa, Proposal& desired_proposal, Enums::DH_ID received_group = Enums::DH_NONE );
     };
 }
 
@@ -12,39 +12,30 @@ namespace openikev2 {
 
     CryptoControllerImpl::~CryptoControllerImpl() {}
 
-    auto_ptr<Proposal> CryptoControllerImpl::selectBestTransfroms( Proposal& proposal ) {
-        auto_ptr<Proposal> result ( new Proposal( proposal.protocol_id ) );
-        result->spi = proposal.spi->clone();
-
-        // We assume the first ENCR transform is the best
-        Transform* best_encr_transform = proposal.getFirstTransformByType( Enums::ENCR );
-        if ( best_encr_transform != NULL )
-            result->addTransform( best_encr_transform->clone() );
-
-        // We assume the first INTEG transform is the best
-        Transform* best_integ_transform = proposal.getFirstTransformByType( Enums::INTEG );
-        if ( best_integ_transform != NULL )
-            result->addTransform( best_integ_transform->clone() );
-
-        // We assume the first PRF transform is the best
-        Transform* best_prf_transform = proposal.getFirstTransformByType( Enums::PRF );
-        if ( best_prf_transform != NULL )
-            result->addTransform( best_prf_transform->clone() );
-
-        // We assume the first DH transform is the best
-        Transform* best_dh_transform = proposal.getFirstTransformByType( Enums::D_H );
-        if ( best_dh_transform != NULL )
-            result->addTransform( best_dh_transform->clone() );
-
-        // We assume the first ESN transform is the best
-        Transform* best_esn_transform = proposal.getFirstTransformByType( Enums::ESN );
-        if ( best_esn_transform != NULL )
-            result->addTransform( best_esn_transform->clone() );
-
-        return result;
+    bool CryptoControllerImpl::checkCookie( Message& message, ByteArray& cookie ) {
+        auto_ptr<Payload_NOTIFY> expected_cookie = this->generateCookie( message );
+        return expected_cookie->notification_data.get() != NULL && cookie == *expected_cookie->notification_data;
     }
 
-    auto_ptr<Proposal> CryptoControllerImpl::chooseProposal( Payload_SA& received_payload_sa, Proposal& desired_proposal ) {
+    void CryptoControllerImpl::rotateCookieSecret() {}
+
+    void CryptoControllerImpl::writeRandomBytes( uint8_t* buffer, uint32_t size ) {
+        this->getRandom()->writeRandomBytes( buffer, size );
+    }
+
+    uint64_t CryptoControllerImpl::getRandomInt64( uint64_t min, uint64_t max ) {
+        return this->getRandom()->getRandomInt64( min, max );
+    }
+
+    bool CryptoControllerImpl::preferTransform( const Transform& candidate, const Transform& current ) {
+        // We prefer the elliptic curve DH groups, much cheaper than the MODP groups
+        if ( candidate.type == Enums::D_H )
+            return DiffieHellman::isEllipticCurve( ( Enums::DH_ID ) candidate.id ) && !DiffieHellman::isEllipticCurve( ( Enums::DH_ID ) current.id );
+
+        return false;
+    }
+
+    auto_ptr<Proposal> CryptoControllerImpl::chooseProposal( Payload_SA& received_payload_sa, Proposal& desired_proposal, Enums::DH_ID received_group ) {
         // For each received proposal, select it if matches protocols with at least one of the desired proposals
         for ( vector<Proposal*>::iterator proposal_iterator = received_payload_sa.proposals->begin(); proposal_iterator != received_payload_sa.proposals->end(); proposal_iterator++ ) {
             Proposal *current_received_proposal = ( *proposal_iterator );
@@ -53,15 +44,44 @@ namespace openikev2 {
             if ( current_received_proposal->protocol_id != desired_proposal.protocol_id )
                 continue;
 
-            // gets the intersection between received proposal and desired proposal
-            auto_ptr<Proposal> common_proposal = Proposal::intersection( *current_received_proposal, desired_proposal );
-
-            // check if the best common proposal have the same transform types than the desired proposal after the intersection process
-            if ( !desired_proposal.hasTheSameTransformTypes( *common_proposal ) )
+            // Selects the best common transform of each type. Nothing is copied until the proposal is chosen
+            Transform* best_transforms[ Enums::ESN + 1 ] = { NULL };
+            for ( vector<Transform*>::iterator it = current_received_proposal->transforms->begin(); it != current_received_proposal->transforms->end(); it++ ) {
+                Transform* current_transform = ( *it );
+                if ( current_transform->type > Enums::ESN || !desired_proposal.hasTransform( *current_transform ) )
+                    continue;
+
+                // The DH group of the received KE payload always wins, since any other one costs an INVALID_KE_PAYLOAD round trip
+                Transform*& best_transform = best_transforms[ current_transform->type ];
+                bool is_received_group = ( received_group != Enums::DH_NONE && current_transform->type == Enums::D_H && current_transform->id == received_group );
+                bool has_received_group = ( best_transform != NULL && received_group != Enums::DH_NONE && best_transform->type == Enums::D_H && best_transform->id == received_group );
+                if ( best_transform == NULL || is_received_group || ( !has_received_group && this->preferTransform( *current_transform, *best_transform ) ) )
+                    best_transform = current_transform;
+            }
+
+            // AEAD algorithms don't use any INTEG transform (RFC 5282, section 8)
+            bool is_aead = best_transforms[ Enums::ENCR ] != NULL && Cipher::isAead( ( Enums::ENCR_ID ) best_transforms[ Enums::ENCR ]->id );
+            if ( is_aead )
+                best_transforms[ Enums::INTEG ] = NULL;
+
+            // check if the best common transforms have the same transform types than the desired proposal.
+            // INTEG transforms are not required when an AEAD algorithm is selected
+            bool has_all_types = true;
+            for ( uint16_t type = Enums::ENCR; type <= Enums::ESN; type++ ) {
+                if ( best_transforms[ type ] == NULL && desired_proposal.hasTransformType( ( Enums::TRANSFORM_TYPE ) type ) && !( is_aead && type == Enums::INTEG ) )
+                    has_all_types = false;
+            }
+            if ( !has_all_types )
                 continue;
 
-            // get the best transforms of the common proposal
-            auto_ptr<Proposal> result = this->selectBestTransfroms( *common_proposal );
+            auto_ptr<Proposal> result ( new Proposal( current_received_proposal->protocol_id ) );
+            result->spi = current_received_proposal->spi->clone();
+
+            static const Enums::TRANSFORM_TYPE result_order[] = { Enums::ENCR, Enums::INTEG, Enums::PRF, Enums::D_H, Enums::ESN };
+            for ( uint16_t i = 0; i < sizeof( result_order ) / sizeof( result_order[ 0 ] ); i++ ) {
+                if ( best_transforms[ result_order[ i ] ] != NULL )
+                    result->addTransform( best_transforms[ result_order[ i ] ]->clone() );
+            }
 
             return result;
         }
@@ -70,6 +90,3 @@ namespace openikev2 {
         return auto_ptr<Proposal> ( NULL );
     }
 }
-
-
-
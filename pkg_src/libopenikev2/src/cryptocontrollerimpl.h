@@ -29,11 +29,13 @@ namespace openikev2 {
             /****************************** METHODS ******************************/
         protected:
             /**
-             * Generates a Proposal with the best of the contained Transforms for each type
-             * @param proposal Proposal
-             * @return A proposal containing the best Transforms for each type
+             * Indicates if a Transform is better than the one currently selected for its type. The transforms are
+             * offered in the peer order, so the first acceptable one is kept unless this method prefers a later one.
+             * @param candidate Acceptable Transform found later in the received proposal
+             * @param current Currently selected Transform of the same type
+             * @return TRUE if the candidate must replace the current one. FALSE otherwise
              */
-            virtual auto_ptr<Proposal> selectBestTransfroms( Proposal& proposal );
+            virtual bool preferTransform( const Transform& candidate, const Transform& current );
 
         public:
             /**
@@ -58,6 +60,21 @@ namespace openikev2 {
              */
             virtual auto_ptr<Random> getRandom() = 0;
 
+            /**
+             * Fills a caller provided buffer with random bytes. Implementations should avoid any allocation or locking
+             * @param buffer Buffer to be filled
+             * @param size Number of bytes to be written
+             */
+            virtual void writeRandomBytes( uint8_t* buffer, uint32_t size );
+
+            /**
+             * Generates a 64 bits random number between min and max (both included)
+             * @param min Minimun number to be generated.
+             * @param max Maximun number to be generated.
+             * @return Random number generated.
+             */
+            virtual uint64_t getRandomInt64( uint64_t min, uint64_t max );
+
             /**
              * Creates a new PseudoRandomFunction object
              * @param prf_transform PRF tranform
@@ -80,13 +97,30 @@ namespace openikev2 {
              */
             virtual auto_ptr<Payload_NOTIFY> generateCookie( Message& message ) = 0;
 
+            /**
+             * Checks a received cookie. Implementations rotating the cookie secret must also accept the cookies generated
+             * with the previous secret. The default implementation compares it with generateCookie().
+             * @param message Full IKE_SA_INIT request message
+             * @param cookie Received cookie value
+             * @return TRUE if the cookie is valid. FALSE otherwise
+             */
+            virtual bool checkCookie( Message& message, ByteArray& cookie );
+
+            /**
+             * Replaces the cookie secret with a new one, keeping the current one as the previous secret.
+             * The default implementation does nothing.
+             */
+            virtual void rotateCookieSecret();
+
             /**
              * Creates a new Proposal containing the matching selection between a received Payload_SA and a desired Proposal
              * @param received_payload_sa Received Payload_SA
              * @param desired_proposal Our desired Proposal
+             * @param received_group DH group of the received KE payload (DH_NONE if there is no one). If acceptable, it is
+             * selected, so the peer doesn't need to retry with another KE payload
              * @return A new negociated Proposal
              */
-            virtual auto_ptr<Proposal> chooseProposal( Payload_SA& received_payload_sa, Proposal& desired_proposal );
+            virtual auto_ptr<Proposal> chooseProposal( Payload_SA& received_payload_sa, Proposal& desired_proposal, Enums::DH_ID received_group = Enums::DH_NONE );
 
             virtual ~CryptoControllerImpl();
 
@@ -0,0 +1,144 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#include "cryptocontrollerimplopenssl.h"
+#include "cipheropenssl.h"
+#include "pseudorandomfunctionopenssl.h"
+#include "diffiehellmanopenssl.h"
+#include "diffiehellmanecopenssl.h"
+#include "randomopenssl.h"
+#include "keyringopenssl.h"
+#include "payload_nonce.h"
+#include "threadcontroller.h"
+#include "autolock.h"
+#include "exception.h"
+
+#include <openssl/crypto.h>
+
+namespace openikev2 {
+
+    CryptoControllerImplOpenSSL::CryptoControllerImplOpenSSL() {
+        this->cookie_mutex = ThreadController::getMutex();
+        this->cookie_version = 0;
+        this->rotateCookieSecret();
+    }
+
+    CryptoControllerImplOpenSSL::~CryptoControllerImplOpenSSL() {}
+
+    auto_ptr<DiffieHellman> CryptoControllerImplOpenSSL::getDiffieHellman( Enums::DH_ID group ) {
+        if ( DiffieHellman::isEllipticCurve( group ) )
+            return auto_ptr<DiffieHellman> ( new DiffieHellmanEcOpenSSL( group ) );
+
+        return auto_ptr<DiffieHellman> ( new DiffieHellmanOpenSSL( group ) );
+    }
+
+    auto_ptr<Cipher> CryptoControllerImplOpenSSL::getCipher( Proposal& proposal, auto_ptr<ByteArray> encr_key, auto_ptr<ByteArray> integ_key ) {
+        Transform* encr_transform = proposal.getFirstTransformByType( Enums::ENCR );
+        Transform* integ_transform = proposal.getFirstTransformByType( Enums::INTEG );
+
+        // AEAD algorithms don't need an INTEG transform
+        if ( encr_transform == NULL || ( integ_transform == NULL && !Cipher::isAead( ( Enums::ENCR_ID ) encr_transform->id ) ) )
+            throw CipherException( "Proposal must contain ENCR and INTEG transforms" );
+
+        Enums::INTEG_ID integ_id = ( integ_transform != NULL ) ? ( Enums::INTEG_ID ) integ_transform->id : Enums::AUTH_NONE;
+        auto_ptr<Cipher> result ( new CipherOpenSSL( *encr_transform, integ_id, *encr_key, *integ_key ) );
+
+        // The keys remain only in the cipher contexts
+        OPENSSL_cleanse( encr_key->getRawPointer(), encr_key->size() );
+        OPENSSL_cleanse( integ_key->getRawPointer(), integ_key->size() );
+
+        return result;
+    }
+
+    auto_ptr<Random> CryptoControllerImplOpenSSL::getRandom() {
+        return auto_ptr<Random> ( new RandomOpenSSL() );
+    }
+
+    void CryptoControllerImplOpenSSL::writeRandomBytes( uint8_t* buffer, uint32_t size ) {
+        RandomOpenSSL::fill( buffer, size );
+    }
+
+    uint64_t CryptoControllerImplOpenSSL::getRandomInt64( uint64_t min, uint64_t max ) {
+        // RandomOpenSSL has no state of its own, so it doesn't need to be allocated
+        RandomOpenSSL random;
+        return random.getRandomInt64( min, max );
+    }
+
+    auto_ptr<PseudoRandomFunction> CryptoControllerImplOpenSSL::getPseudoRandomFunction( Transform& prf_transform ) {
+        return auto_ptr<PseudoRandomFunction> ( new PseudoRandomFunctionOpenSSL( ( Enums::PRF_ID ) prf_transform.id ) );
+    }
+
+    auto_ptr<KeyRing> CryptoControllerImplOpenSSL::getKeyRing( Proposal& proposal, const PseudoRandomFunction& prf ) {
+        return auto_ptr<KeyRing> ( new KeyRingOpenSSL( proposal, prf ) );
+    }
+
+    auto_ptr<ByteArray> CryptoControllerImplOpenSSL::computeCookie( Message& message, HmacOpenSSL& hmac, uint8_t version ) {
+        Payload_NONCE& payload_nonce = ( Payload_NONCE& ) message.getUniquePayloadByType( Payload::PAYLOAD_NONCE );
+        ByteArray& nonce = payload_nonce.getNonceValue();
+        auto_ptr<ByteArray> initiator_address = message.src_addr->getIpAddress().getBytes();
+
+        // Ni | IPi | SPIi
+        ByteBuffer data( nonce.size() + initiator_address->size() + 8 );
+        data.writeByteArray( nonce );
+        data.writeByteArray( *initiator_address );
+        data.writeBuffer( &message.spi_i, 8 );
+
+        // <VersionIDofSecret> | Hash
+        auto_ptr<ByteArray> cookie ( new ByteArray( 1 + hmac.hmac_size ) );
+        cookie->getRawPointer() [ 0 ] = version;
+        hmac.compute( data.getRawPointer(), data.size(), cookie->getRawPointer() + 1 );
+        cookie->setSize( 1 + hmac.hmac_size );
+
+        return cookie;
+    }
+
+    auto_ptr<Payload_NOTIFY> CryptoControllerImplOpenSSL::generateCookie( Message& message ) {
+        AutoLock auto_lock( *this->cookie_mutex );
+        auto_ptr<ByteArray> cookie = this->computeCookie( message, *this->cookie_hmac, this->cookie_version );
+
+        return auto_ptr<Payload_NOTIFY> ( new Payload_NOTIFY( Payload_NOTIFY::COOKIE, Enums::PROTO_NONE, auto_ptr<ByteArray> ( NULL ), cookie ) );
+    }
+
+    bool CryptoControllerImplOpenSSL::checkCookie( Message& message, ByteArray& cookie ) {
+        if ( cookie.size() == 0 )
+            return false;
+
+        AutoLock auto_lock( *this->cookie_mutex );
+
+        // The version byte selects the secret
+        uint8_t version = cookie.getRawPointer() [ 0 ];
+        auto_ptr<ByteArray> expected;
+        if ( version == this->cookie_version )
+            expected = this->computeCookie( message, *this->cookie_hmac, version );
+        else if ( version == ( uint8_t ) ( this->cookie_version - 1 ) && this->previous_cookie_hmac.get() != NULL )
+            expected = this->computeCookie( message, *this->previous_cookie_hmac, version );
+        else
+            return false;
+
+        // Constant time comparison, so the cookie cannot be guessed byte by byte
+        if ( cookie.size() != expected->size() )
+            return false;
+
+        return CRYPTO_memcmp( cookie.getRawPointer(), expected->getRawPointer(), cookie.size() ) == 0;
+    }
+
+    void CryptoControllerImplOpenSSL::rotateCookieSecret() {
+        auto_ptr<ByteArray> secret = RandomOpenSSL().getRandomBytes( COOKIE_SECRET_SIZE );
+
+        auto_ptr<HmacOpenSSL> hmac ( new HmacOpenSSL( "SHA256" ) );
+        hmac->setKey( secret->getRawPointer(), secret->size() );
+        OPENSSL_cleanse( secret->getRawPointer(), secret->size() );
+
+        AutoLock auto_lock( *this->cookie_mutex );
+        if ( this->cookie_hmac.get() != NULL ) {
+            this->previous_cookie_hmac = this->cookie_hmac;
+            this->cookie_version++;
+        }
+        this->cookie_hmac = hmac;
+    }
+}
@@ -0,0 +1,70 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#ifndef OPENIKEV2CRYPTOCONTROLLERIMPLOPENSSL_H
+#define OPENIKEV2CRYPTOCONTROLLERIMPLOPENSSL_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "cryptocontrollerimpl.h"
+#include "hmacopenssl.h"
+#include "mutex.h"
+
+#define COOKIE_SECRET_SIZE      32      // Size of the cookie secrets
+
+namespace openikev2 {
+
+    /**
+        This class implements a CryptoController using OpenSSL.
+        Cookies are computed as <secret version> | HMAC-SHA256(secret, Ni | IPi | SPIi), accepting the previous secret after a rotation.
+        @author Alejandro Perez Mendez, Pedro J. Fernandez Ruiz <alex@um.es, pedroj@um.es>
+    */
+    class CryptoControllerImplOpenSSL : public CryptoControllerImpl {
+
+            /****************************** ATTRIBUTES ******************************/
+        protected:
+            auto_ptr<Mutex> cookie_mutex;                   /**< Mutex protecting the cookie secrets */
+            auto_ptr<HmacOpenSSL> cookie_hmac;              /**< HMAC context loaded with the current cookie secret */
+            auto_ptr<HmacOpenSSL> previous_cookie_hmac;     /**< HMAC context loaded with the previous cookie secret */
+            uint8_t cookie_version;                         /**< Version of the current cookie secret */
+
+            /****************************** METHODS ******************************/
+        protected:
+            /**
+             * Computes the cookie value of an IKE_SA_INIT request. Cookie mutex must be acquired.
+             * @param message Full IKE_SA_INIT request message
+             * @param hmac HMAC context loaded with the secret
+             * @param version Version of the secret
+             * @return The cookie value
+             */
+            auto_ptr<ByteArray> computeCookie( Message& message, HmacOpenSSL& hmac, uint8_t version );
+
+        public:
+            /**
+             * Creates a new CryptoControllerImplOpenSSL, with a new random cookie secret
+             */
+            CryptoControllerImplOpenSSL();
+
+            virtual auto_ptr<DiffieHellman> getDiffieHellman( Enums::DH_ID group );
+            virtual auto_ptr<Cipher> getCipher( Proposal& proposal, auto_ptr<ByteArray> encr_key, auto_ptr<ByteArray> integ_key );
+            virtual auto_ptr<Random> getRandom();
+            virtual void writeRandomBytes( uint8_t* buffer, uint32_t size );
+            virtual uint64_t getRandomInt64( uint64_t min, uint64_t max );
+            virtual auto_ptr<PseudoRandomFunction> getPseudoRandomFunction( Transform& prf_transform );
+            virtual auto_ptr<KeyRing> getKeyRing( Proposal& proposal, const PseudoRandomFunction& prf );
+            virtual auto_ptr<Payload_NOTIFY> generateCookie( Message& message );
+            virtual bool checkCookie( Message& message, ByteArray& cookie );
+            virtual void rotateCookieSecret();
+
+            virtual ~CryptoControllerImplOpenSSL();
+    };
+}
+
+#endif
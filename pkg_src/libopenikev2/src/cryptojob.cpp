@@ -0,0 +1,31 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#include "cryptojob.h"
+
+#include <exception>
+
+namespace openikev2 {
+
+    CryptoJob::CryptoJob( uint64_t ike_sa_spi ) {
+        this->ike_sa_spi = ike_sa_spi;
+        this->failed = false;
+    }
+
+    CryptoJob::~CryptoJob() {}
+
+    void CryptoJob::run() {
+        try {
+            this->execute();
+        }
+        catch ( exception & ex ) {
+            this->failed = true;
+            this->error = ex.what();
+        }
+    }
+}
@@ -0,0 +1,65 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#ifndef OPENIKEV2CRYPTOJOB_H
+#define OPENIKEV2CRYPTOJOB_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <string>
+#include <stdint.h>
+
+using namespace std;
+
+namespace openikev2 {
+
+    /**
+        This abstract class represents an expensive cryptographic operation requested by an IkeSa, that can be executed
+        by the CryptoJobPool threads. The IkeSa waits in an intermediate state until the job is completed.
+        @author Alejandro Perez Mendez, Pedro J. Fernandez Ruiz <alex@um.es, pedroj@um.es>
+    */
+    class CryptoJob {
+
+            /****************************** ATTRIBUTES ******************************/
+        public:
+            uint64_t ike_sa_spi;                    /**< SPI of the IkeSa waiting for the job */
+            bool failed;                            /**< Indicates if the job execution threw an exception */
+            string error;                           /**< Exception message, if the job failed */
+
+            /****************************** METHODS ******************************/
+        protected:
+            /**
+             * Creates a new CryptoJob
+             * @param ike_sa_spi SPI of the IkeSa waiting for the job
+             */
+            CryptoJob( uint64_t ike_sa_spi );
+
+            /**
+             * Performs the cryptographic operation. It must not modify the waiting IkeSa
+             */
+            virtual void execute() = 0;
+
+        public:
+            /**
+             * Executes the job, storing any exception in the "failed" and "error" attributes
+             */
+            void run();
+
+            /**
+             * Gets the job name
+             * @return The job name
+             */
+            virtual string getJobName() const = 0;
+
+            virtual ~CryptoJob();
+    };
+}
+
+#endif
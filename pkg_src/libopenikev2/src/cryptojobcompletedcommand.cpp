@@ -0,0 +1,27 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#include "cryptojobcompletedcommand.h"
+
+namespace openikev2 {
+
+    CryptoJobCompletedCommand::CryptoJobCompletedCommand( auto_ptr<CryptoJob> job )
+            : Command( false ) {
+        this->job = job;
+    }
+
+    IkeSa::IKE_SA_ACTION CryptoJobCompletedCommand::executeCommand( IkeSa & ike_sa ) {
+        return ike_sa.processCryptoJob( *this->job );
+    }
+
+    string CryptoJobCompletedCommand::getCommandName( ) const {
+        return "CRYPTO_JOB_COMPLETED";
+    }
+
+    CryptoJobCompletedCommand::~CryptoJobCompletedCommand() {}
+}
@@ -0,0 +1,43 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#ifndef OPENIKEV2CRYPTOJOBCOMPLETEDCOMMAND_H
+#define OPENIKEV2CRYPTOJOBCOMPLETEDCOMMAND_H
+
+#include "command.h"
+#include "cryptojob.h"
+
+namespace openikev2 {
+
+    /**
+        This class represents a CryptoJob Completed Command, indicating that a CryptoJob requested by the IkeSa has been executed
+        @author Alejandro Perez Mendez, Pedro J. Fernandez Ruiz <alex@um.es, pedroj@um.es>
+    */
+    class CryptoJobCompletedCommand : public Command {
+
+            /****************************** ATTRIBUTES ******************************/
+        protected:
+            auto_ptr<CryptoJob> job;                /**< Completed job */
+
+            /****************************** METHODS ******************************/
+        public:
+            /**
+             * Creates a new CryptoJobCompletedCommand
+             * @param job Completed job
+             */
+            CryptoJobCompletedCommand( auto_ptr<CryptoJob> job );
+
+            virtual IkeSa::IKE_SA_ACTION executeCommand( IkeSa& ike_sa );
+
+            virtual string getCommandName() const;
+
+            virtual ~CryptoJobCompletedCommand();
+    };
+}
+
+#endif
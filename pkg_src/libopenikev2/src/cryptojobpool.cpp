@@ -0,0 +1,129 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#include "cryptojobpool.h"
+#include "cryptojobcompletedcommand.h"
+#include "ikesacontroller.h"
+#include "threadcontroller.h"
+#include "autolock.h"
+#include "log.h"
+
+#include <algorithm>
+
+namespace openikev2 {
+
+    CryptoJobPool::CryptoJobPool( uint16_t num_workers ) {
+        if ( num_workers == 0 )
+            num_workers = max( thread::hardware_concurrency(), 1u );
+
+        this->condition = ThreadController::getCondition();
+        this->running_condition = ThreadController::getCondition();
+        this->cancel_waiters = 0;
+        this->exiting = false;
+        this->discarded.store( 0 );
+
+        for ( uint16_t i = 0; i < num_workers; i++ )
+            this->workers.push_back( thread( &CryptoJobPool::runWorker, this ) );
+    }
+
+    CryptoJobPool::~CryptoJobPool() {
+        {
+            AutoLock auto_lock( *this->condition );
+            this->exiting = true;
+            for ( uint16_t i = 0; i < this->workers.size(); i++ )
+                this->condition->notify();
+        }
+
+        for ( vector<thread>::iterator it = this->workers.begin(); it != this->workers.end(); it++ )
+            it->join();
+
+        for ( deque<CryptoJob*>::iterator it = this->jobs.begin(); it != this->jobs.end(); it++ )
+            delete *it;
+    }
+
+    void CryptoJobPool::submit( auto_ptr<CryptoJob> job ) {
+        AutoLock auto_lock( *this->condition );
+        this->jobs.push_back( job.release() );
+        this->condition->notify();
+    }
+
+    void CryptoJobPool::cancelJobs( uint64_t ike_sa_spi ) {
+        this->condition->acquire();
+
+        deque<CryptoJob*>::iterator it = this->jobs.begin();
+        while ( it != this->jobs.end() ) {
+            if ( ( *it )->ike_sa_spi == ike_sa_spi ) {
+                delete *it;
+                it = this->jobs.erase( it );
+            }
+            else
+                it++;
+        }
+
+        // The running set is locked before releasing the queue, so a job cannot be taken without being seen here
+        this->running_condition->acquire();
+        this->condition->release();
+
+        this->cancel_waiters++;
+        while ( find( this->running.begin(), this->running.end(), ike_sa_spi ) != this->running.end() )
+            this->running_condition->wait();
+        this->cancel_waiters--;
+
+        this->running_condition->release();
+    }
+
+    void CryptoJobPool::runWorker() {
+        while ( true ) {
+            this->condition->acquire();
+
+            while ( this->jobs.empty() && !this->exiting )
+                this->condition->wait();
+
+            if ( this->exiting ) {
+                this->condition->release();
+                return;
+            }
+
+            auto_ptr<CryptoJob> job ( this->jobs.front() );
+            this->jobs.pop_front();
+
+            this->running_condition->acquire();
+            this->running.push_back( job->ike_sa_spi );
+            this->running_condition->release();
+
+            this->condition->release();
+
+            job->run();
+
+            // From now on the job does not reference its IkeSa anymore
+            this->running_condition->acquire();
+            this->running.erase( find( this->running.begin(), this->running.end(), job->ike_sa_spi ) );
+            for ( uint32_t i = 0; i < this->cancel_waiters; i++ )
+                this->running_condition->notify();
+            this->running_condition->release();
+
+            // Returns the job to its IkeSa, ahead of its regular commands. The command queue never discards commands,
+            // so it can only fail if the IkeSa was deleted
+            uint64_t spi = job->ike_sa_spi;
+            string job_name = job->getJobName();
+            if ( !IkeSaController::pushCommandByIkeSaSpi( spi, auto_ptr<Command> ( new CryptoJobCompletedCommand( job ) ), true ) ) {
+                this->discarded++;
+                LOG_LOCKED_MESSAGE( "CryptoJobPool", "IKE_SA not found for completed job=[" + job_name + "]. Discarding it", Log::LOG_WARN, true );
+            }
+        }
+    }
+
+    uint32_t CryptoJobPool::getPendingJobs() {
+        AutoLock auto_lock( *this->condition );
+        return this->jobs.size();
+    }
+
+    uint64_t CryptoJobPool::getDiscardedJobs() const {
+        return this->discarded.load();
+    }
+}
@@ -0,0 +1,92 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#ifndef OPENIKEV2CRYPTOJOBPOOL_H
+#define OPENIKEV2CRYPTOJOBPOOL_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "cryptojob.h"
+#include "condition.h"
+
+#include <memory>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+namespace openikev2 {
+
+    /**
+        This class executes CryptoJob objects in a set of dedicated threads, so the IkeSa workers never block on expensive
+        cryptographic operations. Once executed, each job is returned to its IkeSa inside a CryptoJobCompletedCommand,
+        using IkeSaController::pushCommandByIkeSaSpi().
+        @author Alejandro Perez Mendez, Pedro J. Fernandez Ruiz <alex@um.es, pedroj@um.es>
+    */
+    class CryptoJobPool {
+
+            /****************************** ATTRIBUTES ******************************/
+        protected:
+            auto_ptr<Condition> condition;                  /**< Condition to protect the job queue and wake up the workers */
+            deque<CryptoJob*> jobs;                         /**< Pending jobs */
+            auto_ptr<Condition> running_condition;          /**< Condition to protect the running jobs and wake up cancelJobs() */
+            vector<uint64_t> running;                       /**< IkeSa SPIs of the running jobs */
+            uint32_t cancel_waiters;                        /**< Number of threads waiting in cancelJobs() */
+            bool exiting;                                   /**< Indicates if the workers must finish */
+            vector<thread> workers;                         /**< Worker threads */
+            atomic<uint64_t> discarded;                     /**< Completed jobs whose IkeSa no longer exists */
+
+            /****************************** METHODS ******************************/
+        protected:
+            /**
+             * Main loop of the workers
+             */
+            void runWorker();
+
+        public:
+            /**
+             * Creates a new CryptoJobPool and starts its workers
+             * @param num_workers Number of workers. If 0, the number of available cores is used.
+             */
+            CryptoJobPool( uint16_t num_workers );
+
+            /**
+             * Enqueues a job to be executed by the workers
+             * @param job Job to be executed
+             */
+            void submit( auto_ptr<CryptoJob> job );
+
+            /**
+             * Deletes the pending jobs of an IkeSa, and waits until its running jobs are executed.
+             * After that, no job references the IkeSa, so it can be deleted
+             * @param ike_sa_spi SPI of the IkeSa
+             */
+            void cancelJobs( uint64_t ike_sa_spi );
+
+            /**
+             * Gets the number of pending jobs
+             * @return Number of pending jobs
+             */
+            uint32_t getPendingJobs();
+
+            /**
+             * Gets the number of completed jobs whose IkeSa no longer exists
+             * @return Number of discarded jobs
+             */
+            uint64_t getDiscardedJobs() const;
+
+            /**
+             * Stops the workers and deletes the pending jobs. It must be deleted before the IkeSaController implementation
+             */
+            virtual ~CryptoJobPool();
+    };
+}
+
+#endif
@@ -15,5 +15,51 @@ namespace openikev2 {
 
     DiffieHellman::~DiffieHellman() {}
 
+    uint32_t DiffieHellman::getPublicKeySize( Enums::DH_ID group_id ) {
+        switch ( group_id ) {
+            case Enums::DH_GROUP_1:
+                return 96;
+            case Enums::DH_GROUP_2:
+                return 128;
+            case Enums::DH_GROUP_5:
+                return 192;
+            case Enums::DH_GROUP_14:
+                return 256;
+            case Enums::DH_GROUP_15:
+                return 384;
+            case Enums::DH_GROUP_16:
+                return 512;
+            case Enums::DH_GROUP_17:
+                return 768;
+            case Enums::DH_GROUP_18:
+                return 1024;
+            case Enums::DH_GROUP_19:
+                return 64;
+            case Enums::DH_GROUP_20:
+                return 96;
+            case Enums::DH_GROUP_21:
+                return 132;
+            case Enums::DH_GROUP_31:
+                return 32;
+            case Enums::DH_GROUP_32:
+                return 56;
+            default:
+                return 0;
+        }
+    }
+
+    bool DiffieHellman::isEllipticCurve( Enums::DH_ID group_id ) {
+        switch ( group_id ) {
+            case Enums::DH_GROUP_19:
+            case Enums::DH_GROUP_20:
+            case Enums::DH_GROUP_21:
+            case Enums::DH_GROUP_31:
+            case Enums::DH_GROUP_32:
+                return true;
+            default:
+                return false;
+        }
+    }
+
 }
 
@@ -56,6 +56,21 @@ namespace openikev2 {
              */
             virtual ByteArray& getSharedSecret() const = 0;
 
+            /**
+             * Gets the size of the public values of a group, as transported in the KE payload.
+             * ECP public values are the concatenation of the x and y coordinates (RFC 5903, section 7)
+             * @param group_id Group id
+             * @return The public value size. 0 if the group is unknown
+             */
+            static uint32_t getPublicKeySize( Enums::DH_ID group_id );
+
+            /**
+             * Indicates if a group is an elliptic curve group (ECP or Curve25519/Curve448)
+             * @param group_id Group id
+             * @return TRUE if the group is an elliptic curve group. FALSE otherwise
+             */
+            static bool isEllipticCurve( Enums::DH_ID group_id );
+
             virtual ~DiffieHellman();
 
     };
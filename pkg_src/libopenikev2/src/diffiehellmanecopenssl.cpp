@@ -0,0 +1,158 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#include "diffiehellmanecopenssl.h"
+#include "exception.h"
+
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+#include <string.h>
+#include <assert.h>
+
+namespace openikev2 {
+
+    DiffieHellmanEcOpenSSL::DiffieHellmanEcOpenSSL( Enums::DH_ID group )
+            : DiffieHellman( group ) {
+        this->curve = NULL;
+        switch ( group ) {
+            case Enums::DH_GROUP_19:
+                this->algorithm = "EC";
+                this->curve = "P-256";
+                this->coordinate_size = 32;
+                break;
+            case Enums::DH_GROUP_20:
+                this->algorithm = "EC";
+                this->curve = "P-384";
+                this->coordinate_size = 48;
+                break;
+            case Enums::DH_GROUP_21:
+                this->algorithm = "EC";
+                this->curve = "P-521";
+                this->coordinate_size = 66;
+                break;
+            case Enums::DH_GROUP_31:
+                this->algorithm = "X25519";
+                this->coordinate_size = 32;
+                break;
+            case Enums::DH_GROUP_32:
+                this->algorithm = "X448";
+                this->coordinate_size = 56;
+                break;
+            default:
+                throw CipherException( "DH group not supported: " + Enums::DH_ID_STR( group ) );
+        }
+
+        this->key_pair = NULL;
+        EVP_PKEY_CTX* context = EVP_PKEY_CTX_new_from_name( NULL, this->algorithm, NULL );
+        bool valid = context != NULL && EVP_PKEY_keygen_init( context ) > 0 &&
+                     ( this->curve == NULL || EVP_PKEY_CTX_set_group_name( context, this->curve ) > 0 ) &&
+                     EVP_PKEY_generate( context, &this->key_pair ) > 0;
+        EVP_PKEY_CTX_free( context );
+
+        if ( !valid )
+            throw CipherException( "Cannot generate the DH key pair of the group " + Enums::DH_ID_STR( group ) );
+
+        uint32_t public_key_size = DiffieHellman::getPublicKeySize( group );
+        this->public_key.reset( new ByteArray( public_key_size ) );
+
+        if ( this->curve != NULL ) {
+            // Uncompressed point (0x04 | x | y). The KE payload omits the leading octet (RFC 5903, section 7)
+            uint8_t encoded_point[ 1 + 2 * 66 ];
+            size_t encoded_size = 0;
+            valid = EVP_PKEY_get_octet_string_param( this->key_pair, OSSL_PKEY_PARAM_ENCODED_PUBLIC_KEY, encoded_point, sizeof( encoded_point ), &encoded_size ) > 0 &&
+                    encoded_size == 1 + public_key_size && encoded_point[ 0 ] == 0x04;
+            if ( valid )
+                memcpy( this->public_key->getRawPointer(), encoded_point + 1, public_key_size );
+        }
+        else {
+            size_t raw_size = public_key_size;
+            valid = EVP_PKEY_get_raw_public_key( this->key_pair, this->public_key->getRawPointer(), &raw_size ) > 0 && raw_size == public_key_size;
+        }
+
+        if ( !valid ) {
+            EVP_PKEY_free( this->key_pair );
+            throw CipherException( "Cannot get the DH public key of the group " + Enums::DH_ID_STR( group ) );
+        }
+
+        this->public_key->setSize( public_key_size );
+    }
+
+    DiffieHellmanEcOpenSSL::~DiffieHellmanEcOpenSSL() {
+        EVP_PKEY_free( this->key_pair );
+
+        if ( this->shared_secret.get() != NULL )
+            OPENSSL_cleanse( this->shared_secret->getRawPointer(), this->shared_secret->size() );
+    }
+
+    ByteArray& DiffieHellmanEcOpenSSL::getPublicKey() const {
+        return *this->public_key;
+    }
+
+    EVP_PKEY* DiffieHellmanEcOpenSSL::buildPeerKey( const ByteArray& peer_public_key ) const {
+        if ( this->curve == NULL )
+            return EVP_PKEY_new_raw_public_key_ex( NULL, this->algorithm, NULL, peer_public_key.getRawPointer(), peer_public_key.size() );
+
+        // Restores the leading octet of the uncompressed point
+        uint8_t encoded_point[ 1 + 2 * 66 ];
+        encoded_point[ 0 ] = 0x04;
+        memcpy( encoded_point + 1, peer_public_key.getRawPointer(), peer_public_key.size() );
+
+        OSSL_PARAM params[ 3 ];
+        params[ 0 ] = OSSL_PARAM_construct_utf8_string( OSSL_PKEY_PARAM_GROUP_NAME, ( char* ) this->curve, 0 );
+        params[ 1 ] = OSSL_PARAM_construct_octet_string( OSSL_PKEY_PARAM_PUB_KEY, encoded_point, 1 + peer_public_key.size() );
+        params[ 2 ] = OSSL_PARAM_construct_end();
+
+        EVP_PKEY* peer_key = NULL;
+        EVP_PKEY_CTX* context = EVP_PKEY_CTX_new_from_name( NULL, "EC", NULL );
+        if ( EVP_PKEY_fromdata_init( context ) <= 0 || EVP_PKEY_fromdata( context, &peer_key, EVP_PKEY_PUBLIC_KEY, params ) <= 0 )
+            peer_key = NULL;
+        EVP_PKEY_CTX_free( context );
+
+        // The point must be on the curve (RFC 5903, section 7 and RFC 6989)
+        if ( peer_key != NULL ) {
+            context = EVP_PKEY_CTX_new_from_pkey( NULL, peer_key, NULL );
+            if ( EVP_PKEY_public_check_quick( context ) <= 0 ) {
+                EVP_PKEY_free( peer_key );
+                peer_key = NULL;
+            }
+            EVP_PKEY_CTX_free( context );
+        }
+
+        return peer_key;
+    }
+
+    void DiffieHellmanEcOpenSSL::generateSharedSecret( const ByteArray& peer_public_key ) {
+        if ( peer_public_key.size() != this->public_key->size() )
+            throw CipherException( "Invalid DH public key size" );
+
+        EVP_PKEY* peer_key = this->buildPeerKey( peer_public_key );
+
+        // The shared secret is the x coordinate (ECP) or the u coordinate (Curve25519/Curve448)
+        auto_ptr<ByteArray> result ( new ByteArray( this->coordinate_size, 0 ) );
+        size_t result_size = this->coordinate_size;
+
+        // OpenSSL rejects the all-zero Curve25519/Curve448 results (RFC 8031, section 2.3)
+        EVP_PKEY_CTX* context = EVP_PKEY_CTX_new_from_pkey( NULL, this->key_pair, NULL );
+        bool valid = peer_key != NULL && EVP_PKEY_derive_init( context ) > 0 &&
+                     EVP_PKEY_derive_set_peer( context, peer_key ) > 0 && EVP_PKEY_derive( context, result->getRawPointer(), &result_size ) > 0;
+
+        EVP_PKEY_CTX_free( context );
+        EVP_PKEY_free( peer_key );
+
+        if ( !valid || result_size != this->coordinate_size )
+            throw CipherException( "Cannot generate the DH shared secret" );
+
+        result->setSize( this->coordinate_size );
+        this->shared_secret = result;
+    }
+
+    ByteArray& DiffieHellmanEcOpenSSL::getSharedSecret() const {
+        assert( this->shared_secret.get() != NULL );
+        return *this->shared_secret;
+    }
+}
@@ -0,0 +1,64 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#ifndef OPENIKEV2DIFFIEHELLMANECOPENSSL_H
+#define OPENIKEV2DIFFIEHELLMANECOPENSSL_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "diffiehellman.h"
+
+#include <openssl/evp.h>
+
+namespace openikev2 {
+
+    /**
+        This class implements the elliptic curve DiffieHellman groups using OpenSSL: the ECP groups 19, 20 and 21
+        (RFC 5903) and the Curve25519 and Curve448 groups 31 and 32 (RFC 8031).
+        ECP public values are transported as the concatenation of the x and y coordinates, and the shared secret is
+        the x coordinate of the resulting point.
+        @author Alejandro Perez Mendez, Pedro J. Fernandez Ruiz <alex@um.es, pedroj@um.es>
+    */
+    class DiffieHellmanEcOpenSSL : public DiffieHellman {
+
+            /****************************** ATTRIBUTES ******************************/
+        protected:
+            const char* algorithm;                  /**< OpenSSL key type ("EC", "X25519" or "X448") */
+            const char* curve;                      /**< Curve name for the ECP groups. NULL otherwise */
+            uint32_t coordinate_size;               /**< Size of each coordinate (in bytes) */
+            EVP_PKEY* key_pair;                     /**< Generated key pair */
+            auto_ptr<ByteArray> public_key;         /**< Public value, in the KE payload encoding */
+            auto_ptr<ByteArray> shared_secret;      /**< Shared secret */
+
+            /****************************** METHODS ******************************/
+        protected:
+            /**
+             * Builds the peer key from its public value
+             * @param peer_public_key Public value, in the KE payload encoding
+             * @return The peer key. NULL if the public value is not valid
+             */
+            EVP_PKEY* buildPeerKey( const ByteArray& peer_public_key ) const;
+
+        public:
+            /**
+             * Creates a new DiffieHellmanEcOpenSSL, generating a new key pair
+             * @param group DiffieHellman group
+             */
+            DiffieHellmanEcOpenSSL( Enums::DH_ID group );
+
+            virtual ByteArray& getPublicKey() const;
+            virtual void generateSharedSecret( const ByteArray& peer_public_key );
+            virtual ByteArray& getSharedSecret() const;
+
+            virtual ~DiffieHellmanEcOpenSSL();
+    };
+}
+
+#endif
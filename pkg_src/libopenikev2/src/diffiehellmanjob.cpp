@@ -0,0 +1,30 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#include "diffiehellmanjob.h"
+#include "cryptocontroller.h"
+
+namespace openikev2 {
+
+    DiffieHellmanJob::DiffieHellmanJob( uint64_t ike_sa_spi, Enums::DH_ID group, auto_ptr<ByteArray> peer_public_key )
+            : CryptoJob( ike_sa_spi ) {
+        this->group = group;
+        this->peer_public_key = peer_public_key;
+    }
+
+    DiffieHellmanJob::~DiffieHellmanJob() {}
+
+    void DiffieHellmanJob::execute() {
+        this->diffie_hellman = CryptoController::getDiffieHellman( this->group );
+        this->diffie_hellman->generateSharedSecret( *this->peer_public_key );
+    }
+
+    string DiffieHellmanJob::getJobName() const {
+        return "DIFFIE_HELLMAN";
+    }
+}
@@ -0,0 +1,52 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#ifndef OPENIKEV2DIFFIEHELLMANJOB_H
+#define OPENIKEV2DIFFIEHELLMANJOB_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "cryptojob.h"
+#include "diffiehellman.h"
+
+namespace openikev2 {
+
+    /**
+        This class represents a CryptoJob that obtains a DiffieHellman key pair and generates the shared secret with the peer public key.
+        @author Alejandro Perez Mendez, Pedro J. Fernandez Ruiz <alex@um.es, pedroj@um.es>
+    */
+    class DiffieHellmanJob : public CryptoJob {
+
+            /****************************** ATTRIBUTES ******************************/
+        public:
+            Enums::DH_ID group;                         /**< DiffieHellman group */
+            auto_ptr<ByteArray> peer_public_key;        /**< Public key of the peer */
+            auto_ptr<DiffieHellman> diffie_hellman;     /**< DiffieHellman object with the shared secret. NULL until executed */
+
+            /****************************** METHODS ******************************/
+        protected:
+            virtual void execute();
+
+        public:
+            /**
+             * Creates a new DiffieHellmanJob
+             * @param ike_sa_spi SPI of the IkeSa waiting for the job
+             * @param group DiffieHellman group
+             * @param peer_public_key Public key of the peer
+             */
+            DiffieHellmanJob( uint64_t ike_sa_spi, Enums::DH_ID group, auto_ptr<ByteArray> peer_public_key );
+
+            virtual string getJobName() const;
+
+            virtual ~DiffieHellmanJob();
+    };
+}
+
+#endif
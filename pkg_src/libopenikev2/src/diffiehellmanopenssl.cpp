@@ -0,0 +1,167 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#include "diffiehellmanopenssl.h"
+#include "exception.h"
+
+#include <openssl/core_names.h>
+#include <openssl/param_build.h>
+#include <openssl/dh.h>
+#include <openssl/crypto.h>
+#include <mutex>
+#include <assert.h>
+
+namespace openikev2 {
+
+    const DiffieHellmanOpenSSL::Domain* DiffieHellmanOpenSSL::getDomain( Enums::DH_ID group ) {
+        static mutex domains_mutex;
+        static Domain* domains[ Enums::DH_GROUP_18 + 1 ] = { NULL };
+
+        BIGNUM* ( *get_prime ) ( BIGNUM* ) = NULL;
+        switch ( group ) {
+            case Enums::DH_GROUP_1:
+                get_prime = BN_get_rfc2409_prime_768;
+                break;
+            case Enums::DH_GROUP_2:
+                get_prime = BN_get_rfc2409_prime_1024;
+                break;
+            case Enums::DH_GROUP_5:
+                get_prime = BN_get_rfc3526_prime_1536;
+                break;
+            case Enums::DH_GROUP_14:
+                get_prime = BN_get_rfc3526_prime_2048;
+                break;
+            case Enums::DH_GROUP_15:
+                get_prime = BN_get_rfc3526_prime_3072;
+                break;
+            case Enums::DH_GROUP_16:
+                get_prime = BN_get_rfc3526_prime_4096;
+                break;
+            case Enums::DH_GROUP_17:
+                get_prime = BN_get_rfc3526_prime_6144;
+                break;
+            case Enums::DH_GROUP_18:
+                get_prime = BN_get_rfc3526_prime_8192;
+                break;
+            default:
+                return NULL;
+        }
+
+        lock_guard<mutex> lock( domains_mutex );
+        if ( domains[ group ] != NULL )
+            return domains[ group ];
+
+        Domain* domain = new Domain();
+        domain->prime = get_prime( NULL );
+        domain->generator = BN_new();
+        BN_set_word( domain->generator, 2 );
+        domain->size = BN_num_bytes( domain->prime );
+        domain->parameters = NULL;
+
+        OSSL_PARAM_BLD* builder = OSSL_PARAM_BLD_new();
+        OSSL_PARAM_BLD_push_BN( builder, OSSL_PKEY_PARAM_FFC_P, domain->prime );
+        OSSL_PARAM_BLD_push_BN( builder, OSSL_PKEY_PARAM_FFC_G, domain->generator );
+        OSSL_PARAM* params = OSSL_PARAM_BLD_to_param( builder );
+
+        EVP_PKEY_CTX* context = EVP_PKEY_CTX_new_from_name( NULL, "DH", NULL );
+        if ( EVP_PKEY_fromdata_init( context ) <= 0 || EVP_PKEY_fromdata( context, &domain->parameters, EVP_PKEY_KEY_PARAMETERS, params ) <= 0 )
+            domain->parameters = NULL;
+
+        EVP_PKEY_CTX_free( context );
+        OSSL_PARAM_free( params );
+        OSSL_PARAM_BLD_free( builder );
+
+        if ( domain->parameters == NULL ) {
+            BN_free( domain->prime );
+            BN_free( domain->generator );
+            delete domain;
+            throw CipherException( "Cannot build the domain parameters of the DH group " + Enums::DH_ID_STR( group ) );
+        }
+
+        domains[ group ] = domain;
+        return domain;
+    }
+
+    DiffieHellmanOpenSSL::DiffieHellmanOpenSSL( Enums::DH_ID group )
+            : DiffieHellman( group ) {
+        this->domain = getDomain( group );
+        if ( this->domain == NULL )
+            throw CipherException( "DH group not supported: " + Enums::DH_ID_STR( group ) );
+
+        this->key_pair = NULL;
+        EVP_PKEY_CTX* context = EVP_PKEY_CTX_new_from_pkey( NULL, this->domain->parameters, NULL );
+        if ( EVP_PKEY_keygen_init( context ) <= 0 || EVP_PKEY_generate( context, &this->key_pair ) <= 0 ) {
+            EVP_PKEY_CTX_free( context );
+            throw CipherException( "Cannot generate the DH key pair" );
+        }
+        EVP_PKEY_CTX_free( context );
+
+        BIGNUM* public_value = NULL;
+        EVP_PKEY_get_bn_param( this->key_pair, OSSL_PKEY_PARAM_PUB_KEY, &public_value );
+
+        this->public_key.reset( new ByteArray( this->domain->size ) );
+        BN_bn2binpad( public_value, this->public_key->getRawPointer(), this->domain->size );
+        this->public_key->setSize( this->domain->size );
+        BN_free( public_value );
+    }
+
+    DiffieHellmanOpenSSL::~DiffieHellmanOpenSSL() {
+        EVP_PKEY_free( this->key_pair );
+
+        if ( this->shared_secret.get() != NULL )
+            OPENSSL_cleanse( this->shared_secret->getRawPointer(), this->shared_secret->size() );
+    }
+
+    ByteArray& DiffieHellmanOpenSSL::getPublicKey() const {
+        return *this->public_key;
+    }
+
+    void DiffieHellmanOpenSSL::generateSharedSecret( const ByteArray& peer_public_key ) {
+        if ( peer_public_key.size() != this->domain->size )
+            throw CipherException( "Invalid DH public key size" );
+
+        // Builds the peer key with the same domain parameters
+        BIGNUM* peer_value = BN_bin2bn( peer_public_key.getRawPointer(), peer_public_key.size(), NULL );
+        OSSL_PARAM_BLD* builder = OSSL_PARAM_BLD_new();
+        OSSL_PARAM_BLD_push_BN( builder, OSSL_PKEY_PARAM_FFC_P, this->domain->prime );
+        OSSL_PARAM_BLD_push_BN( builder, OSSL_PKEY_PARAM_FFC_G, this->domain->generator );
+        OSSL_PARAM_BLD_push_BN( builder, OSSL_PKEY_PARAM_PUB_KEY, peer_value );
+        OSSL_PARAM* params = OSSL_PARAM_BLD_to_param( builder );
+
+        EVP_PKEY* peer_key = NULL;
+        EVP_PKEY_CTX* peer_context = EVP_PKEY_CTX_new_from_name( NULL, "DH", NULL );
+        bool valid = EVP_PKEY_fromdata_init( peer_context ) > 0 && EVP_PKEY_fromdata( peer_context, &peer_key, EVP_PKEY_PUBLIC_KEY, params ) > 0;
+
+        EVP_PKEY_CTX_free( peer_context );
+        OSSL_PARAM_free( params );
+        OSSL_PARAM_BLD_free( builder );
+        BN_free( peer_value );
+
+        // The shared secret is left-padded to the prime size (RFC 7296, section 2.14)
+        auto_ptr<ByteArray> result ( new ByteArray( this->domain->size, 0 ) );
+        size_t result_size = this->domain->size;
+
+        EVP_PKEY_CTX* context = EVP_PKEY_CTX_new_from_pkey( NULL, this->key_pair, NULL );
+        valid = valid && EVP_PKEY_derive_init( context ) > 0 && EVP_PKEY_CTX_set_dh_pad( context, 1 ) > 0 &&
+                EVP_PKEY_derive_set_peer( context, peer_key ) > 0 && EVP_PKEY_derive( context, result->getRawPointer(), &result_size ) > 0;
+
+        EVP_PKEY_CTX_free( context );
+        EVP_PKEY_free( peer_key );
+
+        if ( !valid || result_size != this->domain->size )
+            throw CipherException( "Cannot generate the DH shared secret" );
+
+        result->setSize( this->domain->size );
+        this->shared_secret = result;
+    }
+
+    ByteArray& DiffieHellmanOpenSSL::getSharedSecret() const {
+        assert( this->shared_secret.get() != NULL );
+        return *this->shared_secret;
+    }
+}
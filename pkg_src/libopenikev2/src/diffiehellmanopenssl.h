@@ -0,0 +1,71 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#ifndef OPENIKEV2DIFFIEHELLMANOPENSSL_H
+#define OPENIKEV2DIFFIEHELLMANOPENSSL_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "diffiehellman.h"
+
+#include <openssl/evp.h>
+#include <openssl/bn.h>
+
+namespace openikev2 {
+
+    /**
+        This class implements the MODP DiffieHellman groups using OpenSSL.
+        The domain parameters of each group are built only once and shared by all the instances.
+        @author Alejandro Perez Mendez, Pedro J. Fernandez Ruiz <alex@um.es, pedroj@um.es>
+    */
+    class DiffieHellmanOpenSSL : public DiffieHellman {
+
+            /****************************** STRUCTS ******************************/
+        protected:
+            /** Domain parameters of a group */
+            struct Domain {
+                BIGNUM* prime;                      /**< Prime */
+                BIGNUM* generator;                  /**< Generator */
+                EVP_PKEY* parameters;               /**< Domain parameters, ready for key generation */
+                uint32_t size;                      /**< Prime size (in bytes) */
+            };
+
+            /****************************** ATTRIBUTES ******************************/
+        protected:
+            const Domain* domain;                   /**< Domain parameters of the group */
+            EVP_PKEY* key_pair;                     /**< Generated key pair */
+            auto_ptr<ByteArray> public_key;         /**< Public key, padded to the prime size */
+            auto_ptr<ByteArray> shared_secret;      /**< Shared secret, padded to the prime size */
+
+            /****************************** METHODS ******************************/
+        protected:
+            /**
+             * Gets the domain parameters of a group, building them the first time
+             * @param group DiffieHellman group
+             * @return The domain parameters. NULL if the group is not supported
+             */
+            static const Domain* getDomain( Enums::DH_ID group );
+
+        public:
+            /**
+             * Creates a new DiffieHellmanOpenSSL, generating a new key pair
+             * @param group DiffieHellman group
+             */
+            DiffieHellmanOpenSSL( Enums::DH_ID group );
+
+            virtual ByteArray& getPublicKey() const;
+            virtual void generateSharedSecret( const ByteArray& peer_public_key );
+            virtual ByteArray& getSharedSecret() const;
+
+            virtual ~DiffieHellmanOpenSSL();
+    };
+}
+
+#endif
@@ -0,0 +1,179 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#include "diffiehellmanpool.h"
+#include "threadcontroller.h"
+#include "autolock.h"
+#include "exception.h"
+#include "log.h"
+
+#include <pthread.h>
+#include <sched.h>
+
+namespace openikev2 {
+
+    DiffieHellmanPool::DiffieHellmanPool( CryptoControllerImpl& generator, uint16_t num_threads )
+            : generator( generator ) {
+        this->condition = ThreadController::getCondition();
+        this->exiting = false;
+        this->hits.store( 0 );
+        this->misses.store( 0 );
+
+        for ( uint16_t i = 0; i < num_threads; i++ ) {
+            this->refillers.push_back( thread( &DiffieHellmanPool::runRefiller, this ) );
+
+#ifdef SCHED_IDLE
+            // Refilling only uses the otherwise idle CPU time
+            struct sched_param param;
+            param.sched_priority = 0;
+            pthread_setschedparam( this->refillers.back().native_handle(), SCHED_IDLE, &param );
+#endif
+        }
+    }
+
+    DiffieHellmanPool::~DiffieHellmanPool() {
+        {
+            AutoLock auto_lock( *this->condition );
+            this->exiting = true;
+            for ( uint16_t i = 0; i < this->refillers.size(); i++ )
+                this->condition->notify();
+        }
+
+        for ( vector<thread>::iterator it = this->refillers.begin(); it != this->refillers.end(); it++ )
+            it->join();
+
+        for ( map<Enums::DH_ID, GroupPool*>::iterator it = this->groups.begin(); it != this->groups.end(); it++ ) {
+            GroupPool* group_pool = it->second;
+            for ( deque<DiffieHellman*>::iterator key_pair = group_pool->key_pairs.begin(); key_pair != group_pool->key_pairs.end(); key_pair++ )
+                delete *key_pair;
+            delete group_pool;
+        }
+    }
+
+    void DiffieHellmanPool::enableGroup( Enums::DH_ID group, uint32_t low_watermark, uint32_t high_watermark ) {
+        assert( low_watermark <= high_watermark );
+
+        AutoLock auto_lock( *this->condition );
+
+        GroupPool* group_pool = NULL;
+        map<Enums::DH_ID, GroupPool*>::iterator it = this->groups.find( group );
+        if ( it == this->groups.end() ) {
+            group_pool = new GroupPool();
+            group_pool->generating = 0;
+            this->groups[ group ] = group_pool;
+        }
+        else
+            group_pool = it->second;
+
+        group_pool->low_watermark = low_watermark;
+        group_pool->high_watermark = high_watermark;
+        group_pool->refilling = ( group_pool->key_pairs.size() < high_watermark );
+
+        this->condition->notify();
+    }
+
+    auto_ptr<DiffieHellman> DiffieHellmanPool::getDiffieHellman( Enums::DH_ID group ) {
+        bool pooled = false;
+        {
+            AutoLock auto_lock( *this->condition );
+
+            map<Enums::DH_ID, GroupPool*>::iterator it = this->groups.find( group );
+            if ( it != this->groups.end() ) {
+                GroupPool& group_pool = *it->second;
+                pooled = true;
+
+                DiffieHellman* result = NULL;
+                if ( !group_pool.key_pairs.empty() ) {
+                    result = group_pool.key_pairs.front();
+                    group_pool.key_pairs.pop_front();
+                }
+
+                if ( !group_pool.refilling && group_pool.key_pairs.size() < group_pool.low_watermark ) {
+                    group_pool.refilling = true;
+                    this->condition->notify();
+                }
+
+                if ( result != NULL ) {
+                    this->hits++;
+                    return auto_ptr<DiffieHellman> ( result );
+                }
+            }
+        }
+
+        // Groups without pool, or with the pool exhausted, are generated in the caller thread
+        if ( pooled )
+            this->misses++;
+        return this->generator.getDiffieHellman( group );
+    }
+
+    Enums::DH_ID DiffieHellmanPool::getGroupToRefill() {
+        Enums::DH_ID result = Enums::DH_NONE;
+        uint32_t result_available = 0;
+
+        // Chooses the refilling group with less available (or pending) key pairs
+        for ( map<Enums::DH_ID, GroupPool*>::iterator it = this->groups.begin(); it != this->groups.end(); it++ ) {
+            GroupPool& group_pool = *it->second;
+            uint32_t available = group_pool.key_pairs.size() + group_pool.generating;
+
+            if ( group_pool.refilling && available < group_pool.high_watermark && ( result == Enums::DH_NONE || available < result_available ) ) {
+                result = it->first;
+                result_available = available;
+            }
+        }
+
+        return result;
+    }
+
+    void DiffieHellmanPool::runRefiller() {
+        this->condition->acquire();
+
+        while ( !this->exiting ) {
+            Enums::DH_ID group = this->getGroupToRefill();
+            if ( group == Enums::DH_NONE ) {
+                this->condition->wait();
+                continue;
+            }
+
+            GroupPool& group_pool = *this->groups[ group ];
+            group_pool.generating++;
+            this->condition->release();
+
+            // Key pair is generated without holding the condition
+            auto_ptr<DiffieHellman> key_pair;
+            try {
+                key_pair = this->generator.getDiffieHellman( group );
+            }
+            catch ( Exception & ex ) {
+                LOG_MESSAGE( "DiffieHellmanPool", "Cannot generate key pairs for group " + Enums::DH_ID_STR( group ) + ": " + ex.what(), Log::LOG_ERRO, true );
+            }
+
+            this->condition->acquire();
+            group_pool.generating--;
+
+            // Stops refilling the group. It is retried when a key pair is requested again
+            if ( key_pair.get() == NULL ) {
+                group_pool.refilling = false;
+                continue;
+            }
+
+            group_pool.key_pairs.push_back( key_pair.release() );
+            if ( group_pool.key_pairs.size() >= group_pool.high_watermark )
+                group_pool.refilling = false;
+        }
+
+        this->condition->release();
+    }
+
+    uint64_t DiffieHellmanPool::getHits() const {
+        return this->hits.load();
+    }
+
+    uint64_t DiffieHellmanPool::getMisses() const {
+        return this->misses.load();
+    }
+}
@@ -0,0 +1,114 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#ifndef OPENIKEV2DIFFIEHELLMANPOOL_H
+#define OPENIKEV2DIFFIEHELLMANPOOL_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "cryptocontrollerimpl.h"
+#include "condition.h"
+
+#include <map>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#define DH_POOL_LOW_WATERMARK       16      // Default number of key pairs below which a group is refilled
+#define DH_POOL_HIGH_WATERMARK      64      // Default number of key pairs a group is refilled up to
+
+namespace openikev2 {
+
+    /**
+        This class keeps pools of pregenerated DiffieHellman key pairs, one per enabled group, so the key generation is
+        out of the IKE_SA_INIT and CREATE_CHILD_SA critical path. Low priority background threads refill a group when it
+        falls below its low watermark, up to its high watermark. Each key pair is handed out exactly once.
+        @author Alejandro Perez Mendez, Pedro J. Fernandez Ruiz <alex@um.es, pedroj@um.es>
+    */
+    class DiffieHellmanPool {
+
+            /****************************** STRUCTS ******************************/
+        protected:
+            /** Pool of key pairs of a group */
+            struct GroupPool {
+                deque<DiffieHellman*> key_pairs;            /**< Pregenerated key pairs */
+                uint32_t low_watermark;                     /**< The group is refilled when it has less key pairs than this */
+                uint32_t high_watermark;                    /**< The group is refilled up to this number of key pairs */
+                uint32_t generating;                        /**< Key pairs being generated right now */
+                bool refilling;                             /**< Indicates if the group is being refilled */
+            };
+
+            /****************************** ATTRIBUTES ******************************/
+        protected:
+            CryptoControllerImpl& generator;                /**< Implementation generating the key pairs */
+            auto_ptr<Condition> condition;                  /**< Condition to protect the pools and wake up the refill threads */
+            map<Enums::DH_ID, GroupPool*> groups;           /**< Pools of the enabled groups */
+            bool exiting;                                   /**< Indicates if the refill threads must finish */
+            vector<thread> refillers;                       /**< Refill threads */
+            atomic<uint64_t> hits;                          /**< Key pairs taken from the pools */
+            atomic<uint64_t> misses;                        /**< Key pairs generated synchronously because the pool was empty */
+
+            /****************************** METHODS ******************************/
+        protected:
+            /**
+             * Gets the group that needs a new key pair the most. Condition must be acquired.
+             * @return The group. DH_NONE if no group needs to be refilled
+             */
+            Enums::DH_ID getGroupToRefill();
+
+            /**
+             * Main loop of the refill threads
+             */
+            void runRefiller();
+
+        public:
+            /**
+             * Creates a new DiffieHellmanPool and starts its refill threads
+             * @param generator Implementation generating the key pairs
+             * @param num_threads Number of refill threads
+             */
+            DiffieHellmanPool( CryptoControllerImpl& generator, uint16_t num_threads = 1 );
+
+            /**
+             * Enables (or reconfigures) the pool of a group
+             * @param group DiffieHellman group
+             * @param low_watermark The group is refilled when it has less key pairs than this
+             * @param high_watermark The group is refilled up to this number of key pairs
+             */
+            void enableGroup( Enums::DH_ID group, uint32_t low_watermark = DH_POOL_LOW_WATERMARK, uint32_t high_watermark = DH_POOL_HIGH_WATERMARK );
+
+            /**
+             * Gets a new DiffieHellman key pair. It is taken from the pool if available, or generated otherwise
+             * @param group DiffieHellman group
+             * @return A new DiffieHellman object, never returned before
+             */
+            auto_ptr<DiffieHellman> getDiffieHellman( Enums::DH_ID group );
+
+            /**
+             * Gets the number of key pairs taken from the pools
+             * @return Number of key pairs taken from the pools
+             */
+            uint64_t getHits() const;
+
+            /**
+             * Gets the number of key pairs generated synchronously because the pool was empty
+             * @return Number of key pairs generated synchronously
+             */
+            uint64_t getMisses() const;
+
+            /**
+             * Stops the refill threads and deletes the pregenerated key pairs
+             */
+            virtual ~DiffieHellmanPool();
+    };
+}
+
+#endif
@@ -83,10 +83,18 @@ namespace openikev2 {
                 return "ENCR_AES_CBC";
             case Enums::ENCR_AES_CTR:
                 return "ENCR_AES_CTR";
+            case Enums::ENCR_AES_GCM_8:
+                return "ENCR_AES_GCM_8";
+            case Enums::ENCR_AES_GCM_12:
+                return "ENCR_AES_GCM_12";
+            case Enums::ENCR_AES_GCM_16:
+                return "ENCR_AES_GCM_16";
             case Enums::ENCR_BLOWFISH:
                 return "ENCR_BLOWFISH";
             case Enums::ENCR_CAST:
                 return "ENCR_CAST";
+            case Enums::ENCR_CHACHA20_POLY1305:
+                return "ENCR_CHACHA20_POLY1305";
             case Enums::ENCR_DES:
                 return "ENCR_DES";
             case Enums::ENCR_DES_IV32:
@@ -116,6 +124,12 @@ namespace openikev2 {
                 return "PRF_HMAC_SHA1";
             case Enums::PRF_HMAC_TIGER:
                 return "PRF_HMAC_TIGER";
+            case Enums::PRF_HMAC_SHA2_256:
+                return "PRF_HMAC_SHA2_256";
+            case Enums::PRF_HMAC_SHA2_384:
+                return "PRF_HMAC_SHA2_384";
+            case Enums::PRF_HMAC_SHA2_512:
+                return "PRF_HMAC_SHA2_512";
             default:
                 return intToString( prf_id );
         }
@@ -133,6 +147,12 @@ namespace openikev2 {
                 return "AUTH_HMAC_SHA1_96";
             case Enums::AUTH_KPDK_MD5:
                 return "AUTH_KPDK_MD5";
+            case Enums::AUTH_HMAC_SHA2_256_128:
+                return "AUTH_HMAC_SHA2_256_128";
+            case Enums::AUTH_HMAC_SHA2_384_192:
+                return "AUTH_HMAC_SHA2_384_192";
+            case Enums::AUTH_HMAC_SHA2_512_256:
+                return "AUTH_HMAC_SHA2_512_256";
             case Enums::AUTH_NONE:
                 return "AUTH_NONE";
             default:
@@ -142,6 +162,34 @@ namespace openikev2 {
 
     string Enums::DH_ID_STR( DH_ID dh_id ) {
         switch ( dh_id ) {
+            case Enums::DH_NONE:
+                return "DH_NONE";
+            case Enums::DH_GROUP_1:
+                return "DH_GROUP_1 (MODP_768)";
+            case Enums::DH_GROUP_2:
+                return "DH_GROUP_2 (MODP_1024)";
+            case Enums::DH_GROUP_5:
+                return "DH_GROUP_5 (MODP_1536)";
+            case Enums::DH_GROUP_14:
+                return "DH_GROUP_14 (MODP_2048)";
+            case Enums::DH_GROUP_15:
+                return "DH_GROUP_15 (MODP_3072)";
+            case Enums::DH_GROUP_16:
+                return "DH_GROUP_16 (MODP_4096)";
+            case Enums::DH_GROUP_17:
+                return "DH_GROUP_17 (MODP_6144)";
+            case Enums::DH_GROUP_18:
+                return "DH_GROUP_18 (MODP_8192)";
+            case Enums::DH_GROUP_19:
+                return "DH_GROUP_19 (ECP_256)";
+            case Enums::DH_GROUP_20:
+                return "DH_GROUP_20 (ECP_384)";
+            case Enums::DH_GROUP_21:
+                return "DH_GROUP_21 (ECP_521)";
+            case Enums::DH_GROUP_31:
+                return "DH_GROUP_31 (CURVE25519)";
+            case Enums::DH_GROUP_32:
+                return "DH_GROUP_32 (CURVE448)";
             default:
                 return intToString( dh_id );
         }
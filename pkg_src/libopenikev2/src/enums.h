@@ -82,6 +82,10 @@ namespace openikev2 {
                 ENCR_NULL = 11,           /**< NULL algorithm (RFC 2410) */
                 ENCR_AES_CBC = 12,        /**< AES algorithm in CBC mode (RFC 3602) */
                 ENCR_AES_CTR = 13,        /**< AES algorithm in CTR mode (RFC 3664) */
+                ENCR_AES_GCM_8 = 18,      /**< AES algorithm in GCM mode with an 8 octet ICV (RFC 5282) */
+                ENCR_AES_GCM_12 = 19,     /**< AES algorithm in GCM mode with a 12 octet ICV (RFC 5282) */
+                ENCR_AES_GCM_16 = 20,     /**< AES algorithm in GCM mode with a 16 octet ICV (RFC 5282) */
+                ENCR_CHACHA20_POLY1305 = 28, /**< ChaCha20 algorithm with Poly1305 authenticator (RFC 7634) */
             };
 
             /** Transform type 2 (PRF) IDs */
@@ -91,6 +95,9 @@ namespace openikev2 {
                 PRF_HMAC_SHA1 = 2,        /**< Pseudo random function based on SHA1 HMAC (RFC 2104) */
                 PRF_HMAC_TIGER = 3,       /**< Pseudo random function based on TIGER HMAC (RFC 2104) */
                 PRF_AES128_CBC = 4,       /**< Pseudo random function based on AES128 in CBC mode (RFC 3664) */
+                PRF_HMAC_SHA2_256 = 5,    /**< Pseudo random function based on SHA2-256 HMAC (RFC 4868) */
+                PRF_HMAC_SHA2_384 = 6,    /**< Pseudo random function based on SHA2-384 HMAC (RFC 4868) */
+                PRF_HMAC_SHA2_512 = 7,    /**< Pseudo random function based on SHA2-512 HMAC (RFC 4868) */
             };
 
             /** Transform type 3 (INTEG) IDs */
@@ -101,6 +108,9 @@ namespace openikev2 {
                 AUTH_DES_MAC = 3,         /**< DES MAC algorithm */
                 AUTH_KPDK_MD5 = 4,        /**< MD5 KPDK algorithm (RFC 1826) */
                 AUTH_AES_XCBC_96 = 5,     /**< AES XCBC 96 algorithm (RFC 3566) */
+                AUTH_HMAC_SHA2_256_128 = 12, /**< SHA2-256 HMAC 128 algorithm (RFC 4868) */
+                AUTH_HMAC_SHA2_384_192 = 13, /**< SHA2-384 HMAC 192 algorithm (RFC 4868) */
+                AUTH_HMAC_SHA2_512_256 = 14, /**< SHA2-512 HMAC 256 algorithm (RFC 4868) */
             };
 
             /** Transform type 4 (D_H) IDs */
@@ -114,6 +124,11 @@ namespace openikev2 {
                 DH_GROUP_16 = 16,         /**< Diffie Hellman group 16 (MODP 4096) */
                 DH_GROUP_17 = 17,         /**< Diffie Hellman group 17 (MODP 6144) */
                 DH_GROUP_18 = 18,         /**< Diffie Hellman group 18 (MODP 8192) */
+                DH_GROUP_19 = 19,         /**< Diffie Hellman group 19 (ECP 256, RFC 5903) */
+                DH_GROUP_20 = 20,         /**< Diffie Hellman group 20 (ECP 384, RFC 5903) */
+                DH_GROUP_21 = 21,         /**< Diffie Hellman group 21 (ECP 521, RFC 5903) */
+                DH_GROUP_31 = 31,         /**< Diffie Hellman group 31 (Curve25519, RFC 8031) */
+                DH_GROUP_32 = 32,         /**< Diffie Hellman group 32 (Curve448, RFC 8031) */
             };
 
             /** Transform type 5 (ESN) IDs */
@@ -35,7 +35,7 @@ namespace openikev2 {
             vector<BusObserver*>::iterator it_observers = ( *it_map ).second.begin();
             while ( it_observers != ( *it_map ).second.end() ) {
                 if ( *it_observers == &observer ) {
-                    Log::writeLockedMessage( "EventBus", "Deleting bus observer from EventBus lists\n", Log::LOG_EBUS, true );
+                    LOG_LOCKED_MESSAGE( "EventBus", "Deleting bus observer from EventBus lists\n", Log::LOG_EBUS, true );
                     it_observers = ( *it_map ).second.erase( it_observers );
                 }
                 else
@@ -8,6 +8,7 @@
 ***************************************************************************/
 #include "generalconfiguration.h"
 #include "utils.h"
+#include "boolattribute.h"
 
 namespace openikev2 {
 
@@ -18,6 +19,18 @@ namespace openikev2 {
         this->ike_max_halfopen_time = 0xFFFF;
         this->attributemap.reset ( new AttributeMap() );
         this->radvd_enabled = false;
+        this->is_ha = false;
+        this->mobility = false;
+    }
+
+    void GeneralConfiguration::loadFlagsFromAttributes() {
+        BoolAttribute* is_ha_attr = this->attributemap->getAttribute<BoolAttribute>( "is_ha" );
+        if ( is_ha_attr != NULL )
+            this->is_ha = is_ha_attr->value;
+
+        BoolAttribute* mobility_attr = this->attributemap->getAttribute<BoolAttribute>( "mobility" );
+        if ( mobility_attr != NULL )
+            this->mobility = mobility_attr->value;
     }
 
     GeneralConfiguration::~GeneralConfiguration() {  }
@@ -33,6 +46,10 @@ namespace openikev2 {
 
         oss << Printable::generateTabs( tabs + 1 ) << "ike_max_halfopen_time=" << this->ike_max_halfopen_time << "\n";
 
+        oss << Printable::generateTabs( tabs + 1 ) << "is_ha=" << this->is_ha << "\n";
+
+        oss << Printable::generateTabs( tabs + 1 ) << "mobility=" << this->mobility << "\n";
+
 	oss << Printable::generateTabs( tabs + 1 ) << "radvd_enabled=" << this->radvd_enabled << "\n";
 
 	oss << Printable::generateTabs( tabs + 1 ) << "radvd_config_file=" << this->radvd_config_file << "\n";
@@ -53,6 +70,10 @@ namespace openikev2 {
         result->cookie_lifetime = this->cookie_lifetime;
         result->cookie_threshold = this->cookie_threshold;
         result->ike_max_halfopen_time = this->ike_max_halfopen_time;
+        result->is_ha = this->is_ha;
+        result->mobility = this->mobility;
+        result->radvd_enabled = this->radvd_enabled;
+        result->radvd_config_file = this->radvd_config_file;
 
         if ( this->vendor_id.get() != NULL )
             result->vendor_id = this->vendor_id->clone();
@@ -32,6 +32,8 @@ namespace openikev2 {
             uint32_t cookie_threshold;          /**< Number of Half-Opened IKE_SAs to start cookie DoS protection mechanism */
             uint32_t cookie_lifetime;           /**< Lifetime of the cookie secret. */
             uint32_t ike_max_halfopen_time;     /**< Maximun time to perform initial exchanges */
+            bool is_ha;                         /**< Indicates if this node acts as a Home Agent (mobility support) */
+            bool mobility;                      /**< Indicates if the mobility support is enabled */
             bool radvd_enabled;
             string radvd_config_file;
             auto_ptr<ByteArray> vendor_id;      /**< Vendor ID to be used */
@@ -50,6 +52,12 @@ namespace openikev2 {
              */
             virtual auto_ptr<GeneralConfiguration> clone() const;
 
+            /**
+             * Loads the typed flags from their AttributeMap entries ("is_ha" and "mobility"), when present.
+             * Allows to keep configuring them as BoolAttributes.
+             */
+            virtual void loadFlagsFromAttributes();
+
             virtual string toStringTab( uint8_t tabs ) const ;
 
             virtual ~GeneralConfiguration();
@@ -0,0 +1,83 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#include "hmacopenssl.h"
+#include "exception.h"
+
+#include <string.h>
+#include <assert.h>
+#include <openssl/core_names.h>
+#include <openssl/crypto.h>
+
+namespace openikev2 {
+
+    EVP_MAC* HmacOpenSSL::getMac() {
+        static EVP_MAC* mac = EVP_MAC_fetch( NULL, "HMAC", NULL );
+        return mac;
+    }
+
+    HmacOpenSSL::HmacOpenSSL( const char* digest_name ) {
+        this->digest_name = digest_name;
+
+        const EVP_MD* md = EVP_get_digestbyname( digest_name );
+        if ( getMac() == NULL || md == NULL )
+            throw CipherException( "HMAC algorithm not available: " + string( digest_name ) );
+
+        this->hmac_size = EVP_MD_get_size( md );
+        this->context = EVP_MAC_CTX_new( getMac() );
+    }
+
+    HmacOpenSSL::~HmacOpenSSL() {
+        EVP_MAC_CTX_free( this->context );
+
+        if ( this->key.get() != NULL )
+            OPENSSL_cleanse( this->key->getRawPointer(), this->key->size() );
+    }
+
+    void HmacOpenSSL::setKey( const uint8_t* key, uint32_t key_size ) {
+        // The key schedule is already loaded
+        if ( this->key.get() != NULL && this->key->size() == key_size && memcmp( this->key->getRawPointer(), key, key_size ) == 0 )
+            return;
+
+        OSSL_PARAM params[ 2 ];
+        params[ 0 ] = OSSL_PARAM_construct_utf8_string( OSSL_MAC_PARAM_DIGEST, ( char* ) this->digest_name, 0 );
+        params[ 1 ] = OSSL_PARAM_construct_end();
+
+        if ( !EVP_MAC_init( this->context, key, key_size, params ) )
+            throw CipherException( "Cannot initialize HMAC context" );
+
+        if ( this->key.get() != NULL )
+            OPENSSL_cleanse( this->key->getRawPointer(), this->key->size() );
+        this->key.reset( new ByteArray( key, key_size ) );
+    }
+
+    void HmacOpenSSL::begin() {
+        assert( this->key.get() != NULL );
+
+        // Restarts the context, reusing the loaded key
+        if ( !EVP_MAC_init( this->context, NULL, 0, NULL ) )
+            throw CipherException( "Cannot compute HMAC value" );
+    }
+
+    void HmacOpenSSL::update( const uint8_t* data, uint32_t size ) {
+        if ( !EVP_MAC_update( this->context, data, size ) )
+            throw CipherException( "Cannot compute HMAC value" );
+    }
+
+    void HmacOpenSSL::finish( uint8_t* result ) {
+        size_t result_size;
+        if ( !EVP_MAC_final( this->context, result, &result_size, this->hmac_size ) )
+            throw CipherException( "Cannot compute HMAC value" );
+    }
+
+    void HmacOpenSSL::compute( const uint8_t* data, uint32_t size, uint8_t* result ) {
+        this->begin();
+        this->update( data, size );
+        this->finish( result );
+    }
+}
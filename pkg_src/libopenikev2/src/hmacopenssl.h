@@ -0,0 +1,90 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#ifndef OPENIKEV2HMACOPENSSL_H
+#define OPENIKEV2HMACOPENSSL_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "bytearray.h"
+
+#include <openssl/evp.h>
+
+namespace openikev2 {
+
+    /**
+        This class computes HMAC values using OpenSSL. The EVP_MAC_CTX keeps the key schedule loaded,
+        so consecutive computations with the same key only reset the context.
+        @author Alejandro Perez Mendez, Pedro J. Fernandez Ruiz <alex@um.es, pedroj@um.es>
+    */
+    class HmacOpenSSL {
+
+            /****************************** ATTRIBUTES ******************************/
+        protected:
+            EVP_MAC_CTX* context;                   /**< HMAC context, with the current key loaded */
+            const char* digest_name;                /**< Digest name (SHA256, SHA1, ...) */
+            auto_ptr<ByteArray> key;                /**< Current key. NULL if no key was loaded yet */
+
+        public:
+            uint32_t hmac_size;                     /**< HMAC result size */
+
+            /****************************** METHODS ******************************/
+        protected:
+            /**
+             * Gets the HMAC algorithm, fetched only once
+             * @return The HMAC algorithm
+             */
+            static EVP_MAC* getMac();
+
+        public:
+            /**
+             * Creates a new HmacOpenSSL
+             * @param digest_name Digest name (SHA256, SHA1, ...)
+             */
+            HmacOpenSSL( const char* digest_name );
+
+            /**
+             * Loads a new key in the context, if different from the current one
+             * @param key Key data
+             * @param key_size Key size
+             */
+            void setKey( const uint8_t* key, uint32_t key_size );
+
+            /**
+             * Starts an incremental HMAC computation using the current key
+             */
+            void begin();
+
+            /**
+             * Adds data to the HMAC computation started with begin()
+             * @param data Data buffer
+             * @param size Data buffer size
+             */
+            void update( const uint8_t* data, uint32_t size );
+
+            /**
+             * Finishes the HMAC computation started with begin()
+             * @param result Buffer where the hmac_size bytes of the result will be written
+             */
+            void finish( uint8_t* result );
+
+            /**
+             * Computes the HMAC value of a data buffer using the current key
+             * @param data Data buffer
+             * @param size Data buffer size
+             * @param result Buffer where the hmac_size bytes of the result will be written
+             */
+            void compute( const uint8_t* data, uint32_t size, uint8_t* result );
+
+            ~HmacOpenSSL();
+    };
+}
+
+#endif
@@ -32,6 +32,8 @@
 #include "eventbus.h"
 #include "buseventchildsa.h"
 #include "buseventikesa.h"
+#include "diffiehellmanjob.h"
+#include "authenticationjob.h"
 
 #include "senddeletechildsareqcommand.h"
 #include "senddeleteikesareqcommand.h"
@@ -50,6 +52,7 @@
 #include "stringattribute.h"
 
 #include "exception.h"
+#include "spirouting.h"
 
 #include <sys/time.h>
 #include <stdio.h>
@@ -71,38 +74,35 @@ namespace openikev2 {
 
         this->attributemap.reset( new AttributeMap() );
 
-        this->child_sa_collection.reset ( new ChildSaCollection() );
+        this->child_sa_collection.reset ( new ChildSaCollection( this->my_spi ) );
 
-        auto_ptr<GeneralConfiguration> general_conf = Configuration::getInstance().getGeneralConfiguration();
+        this->command_queue.reset( new CommandQueue( IKE_SA_COMMAND_QUEUE_SIZE, IKE_SA_PRIORITY_COMMAND_QUEUE_SIZE ) );
+
+        shared_ptr<const GeneralConfiguration> general_conf = Configuration::getInstance().getGeneralConfiguration();
 
         if ( general_conf->vendor_id.get() )
             this->my_vendor_id = general_conf->vendor_id->clone();
 
-        BoolAttribute* is_ha_attr = general_conf->attributemap->getAttribute<BoolAttribute>( "is_ha" );
-        bool is_ha = false;
-        if (is_ha_attr  != NULL )
-		      is_ha = is_ha_attr->value;
+        bool is_ha = general_conf->is_ha;
 
 	    this->is_ha = is_ha;
 
 
-    	BoolAttribute* mobility_attr = general_conf->attributemap->getAttribute<BoolAttribute>( "mobility" );
-    	if (mobility_attr  != NULL )
-        	this->mobility = mobility_attr->value;
+        this->mobility = general_conf->mobility;
     	if ( this->mobility ) {
 
 		if (!is_ha){ // It is MR
-			Log::writeLockedMessage( this->getLogId(), "During the IKE_SA creation.....", Log::LOG_THRD, true );
+			LOG_LOCKED_MESSAGE( this->getLogId(), "During the IKE_SA creation.....", Log::LOG_THRD, true );
 
        			StringAttribute* string_attr = general_conf->attributemap->getAttribute<StringAttribute>( "home_address" );
     			if (string_attr!=NULL ){
-				Log::writeLockedMessage( this->getLogId(), "1.....", Log::LOG_THRD, true );
+				LOG_LOCKED_MESSAGE( this->getLogId(), "1.....", Log::LOG_THRD, true );
                			this->home_address = NetworkController::getSocketAddress(string_attr->value,500);
-				Log::writeLockedMessage( this->getLogId(), "2.....", Log::LOG_THRD, true );
+				LOG_LOCKED_MESSAGE( this->getLogId(), "2.....", Log::LOG_THRD, true );
     			    	//auto_ptr<IpAddress> coa (NetworkController::getCurrentCoA());
 			    	//NetworkController::getSocketAddress(coa,500);
     			    	this->care_of_address = this->my_addr->clone();
-				Log::writeLockedMessage( this->getLogId(), "3.....", Log::LOG_THRD, true );
+				LOG_LOCKED_MESSAGE( this->getLogId(), "3.....", Log::LOG_THRD, true );
                 	}
     		}
     	}
@@ -112,9 +112,8 @@ namespace openikev2 {
         this->peer_supports_hash_url = false;
 
         // calculates rekeying time
-        auto_ptr<Random> random = CryptoController::getRandom();
         uint32_t temp_10percent = ( uint32_t ) ( ( float ) this->getIkeSaConfiguration().rekey_time * 0.1 );
-        uint32_t jitter = random->getRandomInt32( 0, temp_10percent * 2 );
+        uint32_t jitter = CryptoController::getRandomInt32( 0, temp_10percent * 2 );
         uint32_t rekey_time = this->getIkeSaConfiguration().rekey_time - temp_10percent + jitter;
 
         this->retransmition_alarm.reset( new Alarm( *this, this->getIkeSaConfiguration().retransmition_time * 1000 ) );
@@ -141,18 +140,19 @@ namespace openikev2 {
         this->peer_id.reset( new ID( peer_addr->getIpAddress() ) );
 
         this->peer_configuration = Configuration::getInstance().getPeerConfiguration( peer_addr->getIpAddress(), is_initiator ? Enums::ROLE_INITIATOR : Enums::ROLE_RESPONDER );
+        this->ike_sa_configuration = this->peer_configuration->getIkeSaConfiguration().clone();
 
         this->base( my_spi, is_initiator, my_addr, peer_addr );
 
         this->is_auth_initiator = is_initiator;
 
         Log::acquire();
-        Log::writeMessage( this->getLogId(), "New IKE_SA", Log::LOG_INFO, true );
-        Log::writeMessage( this->getLogId(), Printable::generateTabs( 1 ) + "Local peer:\n" + Printable::generateTabs( 1 ) + "IP=[" + this->my_addr->toString() + "]\n" + this->my_id->toStringTab( 1 ), Log::LOG_INFO, false );
-        Log::writeMessage( this->getLogId(), Printable::generateTabs( 1 ) + "Remote peer:\n" + Printable::generateTabs( 1 ) + "IP=[" + this->peer_addr->toString() + "]\n" + this->peer_id->toStringTab( 1 ) , Log::LOG_INFO, false );
-        Log::writeMessage( this->getLogId(), Printable::generateTabs( 1 ) + "REKEY_TIME=[" + intToString( this->getIkeSaConfiguration().rekey_time ) + "]" , Log::LOG_INFO, false );
-        Log::writeMessage( this->getLogId(), Printable::generateTabs( 1 ) + "TIMEOUT=[" + intToString( this->getIkeSaConfiguration().retransmition_time ) + "]" , Log::LOG_INFO, false );
-        Log::writeMessage( this->getLogId(), Printable::generateTabs( 1 ) + "RETRIES=[" + intToString( this->getIkeSaConfiguration().ike_max_exchange_retransmitions ) + "]", Log::LOG_INFO, false );
+        LOG_MESSAGE( this->getLogId(), "New IKE_SA", Log::LOG_INFO, true );
+        LOG_MESSAGE( this->getLogId(), Printable::generateTabs( 1 ) + "Local peer:\n" + Printable::generateTabs( 1 ) + "IP=[" + this->my_addr->toString() + "]\n" + this->my_id->toStringTab( 1 ), Log::LOG_INFO, false );
+        LOG_MESSAGE( this->getLogId(), Printable::generateTabs( 1 ) + "Remote peer:\n" + Printable::generateTabs( 1 ) + "IP=[" + this->peer_addr->toString() + "]\n" + this->peer_id->toStringTab( 1 ) , Log::LOG_INFO, false );
+        LOG_MESSAGE( this->getLogId(), Printable::generateTabs( 1 ) + "REKEY_TIME=[" + intToString( this->getIkeSaConfiguration().rekey_time ) + "]" , Log::LOG_INFO, false );
+        LOG_MESSAGE( this->getLogId(), Printable::generateTabs( 1 ) + "TIMEOUT=[" + intToString( this->getIkeSaConfiguration().retransmition_time ) + "]" , Log::LOG_INFO, false );
+        LOG_MESSAGE( this->getLogId(), Printable::generateTabs( 1 ) + "RETRIES=[" + intToString( this->getIkeSaConfiguration().ike_max_exchange_retransmitions ) + "]", Log::LOG_INFO, false );
         Log::release();
     }
 
@@ -162,7 +162,8 @@ namespace openikev2 {
         this->my_id = rekeyed_ike_sa.my_id->clone();
         this->peer_id = rekeyed_ike_sa.peer_id->clone();
 
-        this->peer_configuration = rekeyed_ike_sa.peer_configuration->clone();
+        this->peer_configuration = rekeyed_ike_sa.peer_configuration;
+        this->ike_sa_configuration = rekeyed_ike_sa.ike_sa_configuration->clone();
 
         this->base( my_spi, is_initiator, rekeyed_ike_sa.my_addr->clone(), rekeyed_ike_sa.peer_addr->clone() );
 
@@ -170,18 +171,21 @@ namespace openikev2 {
         this->is_auth_initiator = rekeyed_ike_sa.is_auth_initiator;
 
         Log::acquire();
-        Log::writeMessage( this->getLogId(), "New IKE_SA: (Rekeying)", Log::LOG_INFO, true );
-        Log::writeMessage( this->getLogId(), Printable::generateTabs( 1 ) + "Local peer:\n" + Printable::generateTabs( 1 ) + "IP=[" + this->my_addr->toString() + "]\n" + this->my_id->toStringTab( 1 ), Log::LOG_INFO, false );
-        Log::writeMessage( this->getLogId(), Printable::generateTabs( 1 ) + "Remote peer:\n" + Printable::generateTabs( 1 ) + "IP=[" + this->peer_addr->toString() + "]\n" + this->peer_id->toStringTab( 1 ) , Log::LOG_INFO, false );
-        Log::writeMessage( this->getLogId(), Printable::generateTabs( 1 ) + "REKEY_TIME=[" + intToString( this->getIkeSaConfiguration().rekey_time ) + "]" , Log::LOG_INFO, false );
-        Log::writeMessage( this->getLogId(), Printable::generateTabs( 1 ) + "TIMEOUT=[" + intToString( this->getIkeSaConfiguration().retransmition_time ) + "]" , Log::LOG_INFO, false );
-        Log::writeMessage( this->getLogId(), Printable::generateTabs( 1 ) + "RETRIES=[" + intToString( this->getIkeSaConfiguration().ike_max_exchange_retransmitions ) + "]", Log::LOG_INFO, false );
-        Log::writeMessage( this->getLogId(), Printable::generateTabs( 1 ) + "Is original initiator=[" + boolToString( is_initiator ) + "]", Log::LOG_INFO, false );
-        Log::writeMessage( this->getLogId(), Printable::generateTabs( 1 ) + "Is original auth initiator=[" + boolToString( is_auth_initiator ) + "]", Log::LOG_INFO, false );
+        LOG_MESSAGE( this->getLogId(), "New IKE_SA: (Rekeying)", Log::LOG_INFO, true );
+        LOG_MESSAGE( this->getLogId(), Printable::generateTabs( 1 ) + "Local peer:\n" + Printable::generateTabs( 1 ) + "IP=[" + this->my_addr->toString() + "]\n" + this->my_id->toStringTab( 1 ), Log::LOG_INFO, false );
+        LOG_MESSAGE( this->getLogId(), Printable::generateTabs( 1 ) + "Remote peer:\n" + Printable::generateTabs( 1 ) + "IP=[" + this->peer_addr->toString() + "]\n" + this->peer_id->toStringTab( 1 ) , Log::LOG_INFO, false );
+        LOG_MESSAGE( this->getLogId(), Printable::generateTabs( 1 ) + "REKEY_TIME=[" + intToString( this->getIkeSaConfiguration().rekey_time ) + "]" , Log::LOG_INFO, false );
+        LOG_MESSAGE( this->getLogId(), Printable::generateTabs( 1 ) + "TIMEOUT=[" + intToString( this->getIkeSaConfiguration().retransmition_time ) + "]" , Log::LOG_INFO, false );
+        LOG_MESSAGE( this->getLogId(), Printable::generateTabs( 1 ) + "RETRIES=[" + intToString( this->getIkeSaConfiguration().ike_max_exchange_retransmitions ) + "]", Log::LOG_INFO, false );
+        LOG_MESSAGE( this->getLogId(), Printable::generateTabs( 1 ) + "Is original initiator=[" + boolToString( is_initiator ) + "]", Log::LOG_INFO, false );
+        LOG_MESSAGE( this->getLogId(), Printable::generateTabs( 1 ) + "Is original auth initiator=[" + boolToString( is_auth_initiator ) + "]", Log::LOG_INFO, false );
         Log::release();
     }
 
     IkeSa::~IkeSa() {
+        // No CryptoJob can reference this IkeSa once deleted
+        CryptoController::cancelCryptoJobs( this->my_spi );
+
         EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_DELETED, *this ) ) );
 
         // If this IkeSa is half open, the deletes it from the half open counter
@@ -194,11 +198,11 @@ namespace openikev2 {
         AlarmController::removeAlarm( *this->halfopen_alarm );
         AlarmController::removeAlarm( *this->idle_ike_sa_alarm );
 
-        // Deletes remainig commands
-        for ( deque<Command*>::iterator it = this->command_queue.begin(); it != this->command_queue.end(); it++ )
-            delete ( *it );
+        // Deletes remainig deferred commands (the command queue deletes its own ones)
         for ( deque<Command*>::iterator it = this->deferred_queue.begin(); it != this->deferred_queue.end(); it++ )
             delete ( *it );
+        for ( deque<Command*>::iterator it = this->parked_queue.begin(); it != this->parked_queue.end(); it++ )
+            delete ( *it );
 
         // Deletes all CHILD SAs physically
         while ( child_sa_collection->size() > 0 ) {
@@ -208,7 +212,7 @@ namespace openikev2 {
             child_sa_collection->deleteChildSa( current->inbound_spi );
         }
 
-        Log::writeLockedMessage( this->getLogId(), "IKE_SA deleted", Log::LOG_INFO, true );
+        LOG_LOCKED_MESSAGE( this->getLogId(), "IKE_SA deleted", Log::LOG_INFO, true );
     }
 
     IkeSa & IkeSa::hasMinNonce( const IkeSa & ike_sa1, const IkeSa & ike_sa2 ) {
@@ -230,6 +234,12 @@ namespace openikev2 {
 
     string IkeSa::IKE_SA_STATE_STR( IKE_SA_STATE state ) {
         switch ( state ) {
+            case IkeSa::STATE_IKE_SA_INIT_CRYPTO_PENDING:
+                return "STATE_IKE_SA_INIT_CRYPTO_PENDING";
+
+            case IkeSa::STATE_IKE_AUTH_CRYPTO_PENDING:
+                return "STATE_IKE_AUTH_CRYPTO_PENDING";
+
             case IkeSa::STATE_DELETE_CHILD_SA_REQ_SENT:
                 return "STATE_DELETE_CHILD_SA_REQ_SENT";
 
@@ -305,50 +315,54 @@ namespace openikev2 {
         // removes the first command in the queue
         this->deferred_queue.pop_front();
 
-        Log::writeLockedMessage( this->getLogId(), "Pop deferred command=[" + result->getCommandName() + "]", Log::LOG_THRD, true );
+        LOG_LOCKED_MESSAGE( this->getLogId(), "Pop deferred command=[" + result->getCommandName() + "]", Log::LOG_THRD, true );
 
         return result;
     }
 
     auto_ptr<Command> IkeSa::popCommand( ) {
-        AutoLock auto_lock( *this->mutex );
-
         if ( ( this->state == STATE_IKE_SA_ESTABLISHED ) && !( deferred_queue.empty() ) ) {
             return this->popDeferredCommand();
         }
+        else if ( !this->isWaitingForCryptoJob() && !this->parked_queue.empty() ) {
+            // Commands parked while waiting for a CryptoJob go before the ones queued later
+            auto_ptr<Command> result ( this->parked_queue.front() );
+            this->parked_queue.pop_front();
+            return result;
+        }
         else {
-            assert( !command_queue.empty() );
-
-            // Gets the first command in the queue
-            auto_ptr<Command> result ( this->command_queue.front() );
-
-            // removes the first command in the queue
-            this->command_queue.pop_front();
+            // Gets the first command in the queue (priority ones first)
+            auto_ptr<Command> result = this->command_queue->pop();
+            assert( result.get() != NULL );
 
             return result;
         }
     }
 
     void IkeSa::pushDeferredCommand( auto_ptr<Command> command ) {
-        Log::writeLockedMessage( this->getLogId(), "Push deferred command=[" + command->getCommandName() + "]", Log::LOG_THRD, true );
+        LOG_LOCKED_MESSAGE( this->getLogId(), "Push deferred command=[" + command->getCommandName() + "]", Log::LOG_THRD, true );
 
         this->deferred_queue.push_back( command.release() );
     }
 
     void IkeSa::pushCommand( auto_ptr<Command> command , bool priority ) {
-        AutoLock auto_lock( *this->mutex );
-
-        if ( priority )
-            command_queue.push_front( command.release() );
-        else
-            command_queue.push_back( command.release() );
+        this->command_queue->push( command, priority );
     }
 
     IkeSa::IKE_SA_ACTION IkeSa::processCommand( ) {
         try {
             // Gets a command, deferred or not
             auto_ptr<Command> command = this->popCommand();
-            Log::writeLockedMessage( this->getLogId(), "Processing command=[" + command->getCommandName() + "]", Log::LOG_THRD, true );
+
+            // While waiting for a CryptoJob, the other commands are parked until the job is completed.
+            // Alarms are not parked, so the halfopen alarm can still delete the IKE SA
+            if ( this->isWaitingForCryptoJob() && command->getCommandName() != "CRYPTO_JOB_COMPLETED" && command->getCommandName() != "ALARM_TIMEOUT" ) {
+                LOG_LOCKED_MESSAGE( this->getLogId(), "Park command=[" + command->getCommandName() + "]", Log::LOG_THRD, true );
+                this->parked_queue.push_back( command.release() );
+                return IKE_SA_ACTION_CONTINUE;
+            }
+
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Processing command=[" + command->getCommandName() + "]", Log::LOG_THRD, true );
 
             // If a command is processed (and it is not a ALARM COMMAND), then the IKE SA is not idle
             if ( command->getCommandName() != "ALARM_TIMEOUT" )
@@ -357,14 +371,53 @@ namespace openikev2 {
             return command->executeCommand( *this );
         }
         catch ( exception & ex ) {
-            Log::writeLockedMessage( this->getLogId(), ex.what(), Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), ex.what(), Log::LOG_ERRO, true );
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return IKE_SA_ACTION_DELETE_IKE_SA;
         }
     }
 
+    IkeSa::IKE_SA_ACTION IkeSa::processCryptoJob( CryptoJob& job ) {
+        if ( !this->isWaitingForCryptoJob() ) {
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Transition error: event=[Crypto job completed] job=[" + job.getJobName() + "] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_WARN, true );
+            return IKE_SA_ACTION_CONTINUE;
+        }
+
+        // The parked commands are processed after this one (see popCommand())
+        Message::EXCHANGE_TYPE exchange_type = ( this->state == STATE_IKE_SA_INIT_CRYPTO_PENDING ) ? Message::IKE_SA_INIT : Message::IKE_AUTH;
+        auto_ptr<ByteArray> request_data = this->pending_request;
+
+        try {
+            MESSAGE_ACTION action = MESSAGE_ACTION_OMIT;
+            if ( this->state == STATE_IKE_SA_INIT_CRYPTO_PENDING )
+                action = this->completeIkeSaInitRequest( ( DiffieHellmanJob& ) job );
+            else
+                action = this->completeIkeAuthNoEapRequest( ( AuthenticationJob& ) job );
+
+            if ( action == MESSAGE_ACTION_DELETE_IKE_SA )
+                return IKE_SA_ACTION_DELETE_IKE_SA;
+
+            // Commits the request, as processMessage() does with the synchronous ones
+            if ( action == MESSAGE_ACTION_COMMIT ) {
+                this->peer_message_id++;
+                this->last_received_request = request_data;
+            }
+            return IKE_SA_ACTION_CONTINUE;
+        }
+        catch ( Exception & ex ) {
+            LOG_LOCKED_MESSAGE( this->getLogId(), "GENERIC FAILURE: " + string( ex.what() ), Log::LOG_ERRO, true );
+            this->sendNotifyResponse( exchange_type, Payload_NOTIFY::INVALID_SYNTAX );
+            EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
+            return IKE_SA_ACTION_DELETE_IKE_SA;
+        }
+    }
+
+    bool IkeSa::isWaitingForCryptoJob() const {
+        return this->state == STATE_IKE_SA_INIT_CRYPTO_PENDING || this->state == STATE_IKE_AUTH_CRYPTO_PENDING;
+    }
+
     IkeSaConfiguration & IkeSa::getIkeSaConfiguration( ) const {
-        return this->peer_configuration->getIkeSaConfiguration();
+        return *this->ike_sa_configuration;
     }
 
     ChildSaConfiguration & IkeSa::getChildSaConfiguration( ) const {
@@ -388,7 +441,7 @@ namespace openikev2 {
             uint64_t received_peer_spi = message.is_initiator ? message.spi_i : message.spi_r;
 
             if ( received_peer_spi != this->peer_spi ) {
-                Log::writeLockedMessage( this->getLogId(), "Invalid Peer SPI: expected=" + Printable::toHexString( &this->peer_spi, 8 ) +
+                LOG_LOCKED_MESSAGE( this->getLogId(), "Invalid Peer SPI: expected=" + Printable::toHexString( &this->peer_spi, 8 ) +
                                          " received=" + Printable::toHexString( &received_peer_spi, 8 ), Log::LOG_WARN, true );
                 return false;
             }
@@ -399,12 +452,12 @@ namespace openikev2 {
     bool IkeSa::checkMessageId( Message & message ) {
         // This message has a invalid sequence number
         if ( ( message.message_type == Message::REQUEST && message.message_id != this->peer_message_id && message.message_id != this->peer_message_id - 1 ) ) {
-            Log::writeLockedMessage( this->getLogId(), "Invalid Request ID: expected=" + intToString( this->peer_message_id ) + " received=" + intToString( message.message_id ), Log::LOG_WARN, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Invalid Request ID: expected=" + intToString( this->peer_message_id ) + " received=" + intToString( message.message_id ), Log::LOG_WARN, true );
             return false;
         }
 
         if ( message.message_type == Message::RESPONSE && message.message_id != this->my_message_id ) {
-            Log::writeLockedMessage( this->getLogId(), "Invalid Response ID: expected=" + intToString( this->my_message_id ) + " received=" + intToString( message.message_id ), Log::LOG_WARN, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Invalid Response ID: expected=" + intToString( this->my_message_id ) + " received=" + intToString( message.message_id ), Log::LOG_WARN, true );
             return false;
         }
 
@@ -412,7 +465,7 @@ namespace openikev2 {
     }
 
     void IkeSa::setState( IKE_SA_STATE next_state ) {
-        Log::writeLockedMessage( this->getLogId(), "Transition: [" + IKE_SA_STATE_STR( this->state ) + " ---> " + IKE_SA_STATE_STR( next_state ) + "]", Log::LOG_STAT, true );
+        LOG_LOCKED_MESSAGE( this->getLogId(), "Transition: [" + IKE_SA_STATE_STR( this->state ) + " ---> " + IKE_SA_STATE_STR( next_state ) + "]", Log::LOG_STAT, true );
         this->state = next_state;
 
         // If STATE_IKE_SA_ESTABLISHED and halfopen, then full open
@@ -438,12 +491,9 @@ namespace openikev2 {
     auto_ptr< Message > IkeSa::createMessage( Message::EXCHANGE_TYPE exchange_type, Message::MESSAGE_TYPE message_type ) const {
          // Choose CoA address in case of mobility protection enabled
 
-        auto_ptr<GeneralConfiguration> general_conf = Configuration::getInstance().getGeneralConfiguration();
+        shared_ptr<const GeneralConfiguration> general_conf = Configuration::getInstance().getGeneralConfiguration();
 
-        BoolAttribute* is_ha_attr = general_conf->attributemap->getAttribute<BoolAttribute>( "is_ha" );
-        bool is_ha = false;
-        if (is_ha_attr  != NULL )
-		is_ha = is_ha_attr->value;
+        bool is_ha = general_conf->is_ha;
 
 	if ( this->mobility ) {
 
@@ -509,8 +559,8 @@ namespace openikev2 {
 
         if ( payload_vendor != NULL ) {
             this->peer_vendor_id = payload_vendor->getVendorId().clone();
-            Log::writeMessage( this->getLogId(), "Peer indicates its vendor ID", Log::LOG_INFO, true );
-            Log::writeMessage( this->getLogId(), Printable::generateTabs( 1 ) + this->peer_vendor_id->toStringTab( 1 ), Log::LOG_INFO, false );
+            LOG_MESSAGE( this->getLogId(), "Peer indicates its vendor ID", Log::LOG_INFO, true );
+            LOG_MESSAGE( this->getLogId(), Printable::generateTabs( 1 ) + this->peer_vendor_id->toStringTab( 1 ), Log::LOG_INFO, false );
         }
 
         // Gets all notifies in the message
@@ -537,16 +587,16 @@ namespace openikev2 {
                 if ( notify->isError() ) {
                     // We don't allow ERROR notifies in REQUESTs
                     if ( message.message_type == Message::REQUEST ) {
-                        Log::writeLockedMessage( this->getLogId(), "Notify found in a request: " + intToString( notify->notification_type ), Log::LOG_ERRO, true );
+                        LOG_LOCKED_MESSAGE( this->getLogId(), "Notify found in a request: " + intToString( notify->notification_type ), Log::LOG_ERRO, true );
                         this->sendNotifyResponse( message.exchange_type, Payload_NOTIFY::INVALID_SYNTAX );
                     }
                     else if ( message.message_type == Message::RESPONSE ) {
-                        Log::writeLockedMessage( this->getLogId(), "Unknown error notify received: " + intToString( notify->notification_type ), Log::LOG_ERRO, true );
+                        LOG_LOCKED_MESSAGE( this->getLogId(), "Unknown error notify received: " + intToString( notify->notification_type ), Log::LOG_ERRO, true );
                     }
                     return NOTIFY_ACTION_ERROR;
                 }
                 else {
-                    Log::writeLockedMessage( this->getLogId(), "Unknown status notify received: " + intToString( notify->notification_type ), Log::LOG_WARN, true );
+                    LOG_LOCKED_MESSAGE( this->getLogId(), "Unknown status notify received: " + intToString( notify->notification_type ), Log::LOG_WARN, true );
                 }
             }
         }
@@ -556,20 +606,14 @@ namespace openikev2 {
 
     void IkeSa::createChildSa( auto_ptr<ChildSa> child_sa ) {
 
-	auto_ptr<GeneralConfiguration> general_conf = Configuration::getInstance().getGeneralConfiguration();
+	shared_ptr<const GeneralConfiguration> general_conf = Configuration::getInstance().getGeneralConfiguration();
 
-        BoolAttribute* is_ha_attr = general_conf->attributemap->getAttribute<BoolAttribute>( "is_ha" );
-        bool is_ha = false;
-        if (is_ha_attr  != NULL )
-		is_ha = is_ha_attr->value;
+        bool is_ha = general_conf->is_ha;
 
 
-    	BoolAttribute* mobility_attr = general_conf->attributemap->getAttribute<BoolAttribute>( "mobility" );
-    	bool mobility = false;
+    	bool mobility = general_conf->mobility;
 	auto_ptr<SocketAddress> hoa (NULL);
 	auto_ptr<SocketAddress>	coa (NULL);
-        if (mobility_attr  != NULL )
-		mobility = mobility_attr->value;
 
 	if (mobility && (child_sa->mode == Enums::TUNNEL_MODE)){
 		if (is_ha) {
@@ -593,8 +637,8 @@ namespace openikev2 {
         uint32_t count = this->child_sa_collection->size() + 1;
 
         Log::acquire();
-        Log::writeMessage( this->getLogId(), "New Child SA: Count=[" + intToString( count ) + "]", Log::LOG_INFO, true );
-        Log::writeMessage( this->getLogId(), child_sa->toStringTab( 1 ), Log::LOG_INFO, false );
+        LOG_MESSAGE( this->getLogId(), "New Child SA: Count=[" + intToString( count ) + "]", Log::LOG_INFO, true );
+        LOG_MESSAGE( this->getLogId(), child_sa->toStringTab( 1 ), Log::LOG_INFO, false );
         Log::release();
 
         // send CHILD_SA creation event
@@ -614,8 +658,8 @@ namespace openikev2 {
         uint32_t count = this->child_sa_collection->size() + 1;
 
         Log::acquire();
-        Log::writeMessage( this->getLogId(), "New Child SA: Count=[" + intToString( count ) + "]", Log::LOG_INFO, true );
-        Log::writeMessage( this->getLogId(), child_sa->toStringTab( 1 ), Log::LOG_INFO, false );
+        LOG_MESSAGE( this->getLogId(), "New Child SA: Count=[" + intToString( count ) + "]", Log::LOG_INFO, true );
+        LOG_MESSAGE( this->getLogId(), child_sa->toStringTab( 1 ), Log::LOG_INFO, false );
         Log::release();
 
         // send CHILD_SA creation event
@@ -632,43 +676,37 @@ namespace openikev2 {
     IkeSa::IKE_SA_ACTION IkeSa::createIkeSaInitRequest( auto_ptr<ChildSaRequest> child_sa_request ) {
         // Check state
         if ( this->state != STATE_INITIAL ) {
-            Log::writeLockedMessage( this->getLogId(), "Transition error: event=[Start IKE_SA_INIT] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Transition error: event=[Start IKE_SA_INIT] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_ERRO, true );
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return IKE_SA_ACTION_DELETE_IKE_SA;
         }
 
-        Log::writeLockedMessage( this->getLogId(), "Create the IKE_SA request message ", Log::LOG_ERRO, true );
+        LOG_LOCKED_MESSAGE( this->getLogId(), "Create the IKE_SA request message ", Log::LOG_ERRO, true );
 
- 	auto_ptr<GeneralConfiguration> general_conf = Configuration::getInstance().getGeneralConfiguration();
-        BoolAttribute* mobility_attr = general_conf->attributemap->getAttribute<BoolAttribute>( "mobility" );
-        bool mobility = false;
-        if (mobility_attr  != NULL )
-        	mobility = mobility_attr->value;
+ 	shared_ptr<const GeneralConfiguration> general_conf = Configuration::getInstance().getGeneralConfiguration();
+        bool mobility = general_conf->mobility;
 
-	BoolAttribute* is_ha_attr = general_conf->attributemap->getAttribute<BoolAttribute>( "is_ha" );
-	bool is_ha = false;
-	if (is_ha_attr  != NULL )
-	is_ha = is_ha_attr->value;
+	bool is_ha = general_conf->is_ha;
 
 	if (mobility){
 
 		if (!is_ha){
 			// is MR
-		        Log::writeLockedMessage( this->getLogId(), "Changin CoA to Hoa for child sa creation (MR)", Log::LOG_ERRO, true );
-	       		this->my_creating_child_sa.reset ( new ChildSa( IpsecController::getSpi(this->peer_addr->getIpAddress(),this->home_address->getIpAddress(),child_sa_request->ipsec_protocol), child_sa_request ) );
-                        Log::writeLockedMessage( this->getLogId(), "Get SPI using HoA instead of CoA.", Log::LOG_WARN, true );
+		        LOG_LOCKED_MESSAGE( this->getLogId(), "Changin CoA to Hoa for child sa creation (MR)", Log::LOG_ERRO, true );
+	       		this->my_creating_child_sa.reset ( new ChildSa( IpsecController::getSpi(this->peer_addr->getIpAddress(),this->home_address->getIpAddress(),child_sa_request->ipsec_protocol, SpiRouting::getIkeSaSpiWorker( this->my_spi ) ), child_sa_request ) );
+                        LOG_LOCKED_MESSAGE( this->getLogId(), "Get SPI using HoA instead of CoA.", Log::LOG_WARN, true );
 
 		}
 		else {
-		        Log::writeLockedMessage( this->getLogId(), "Changin CoA to Hoa for child sa creation (HA)", Log::LOG_ERRO, true );
-	        	this->my_creating_child_sa.reset ( new ChildSa( IpsecController::getSpi(this->peer_addr->getIpAddress(),this->my_addr->getIpAddress(),child_sa_request->ipsec_protocol), child_sa_request ) );
-                        Log::writeLockedMessage( this->getLogId(), "The IKE_SA_INIT exchange can not be started by the HA using mobility.", Log::LOG_WARN, true );
+		        LOG_LOCKED_MESSAGE( this->getLogId(), "Changin CoA to Hoa for child sa creation (HA)", Log::LOG_ERRO, true );
+	        	this->my_creating_child_sa.reset ( new ChildSa( IpsecController::getSpi(this->peer_addr->getIpAddress(),this->my_addr->getIpAddress(),child_sa_request->ipsec_protocol, SpiRouting::getIkeSaSpiWorker( this->my_spi ) ), child_sa_request ) );
+                        LOG_LOCKED_MESSAGE( this->getLogId(), "The IKE_SA_INIT exchange can not be started by the HA using mobility.", Log::LOG_WARN, true );
 
 		}
 	}
 	else {
 
-        	this->my_creating_child_sa.reset ( new ChildSa( IpsecController::getSpi(this->peer_addr->getIpAddress(),this->my_addr->getIpAddress(),child_sa_request->ipsec_protocol), child_sa_request ) );
+        	this->my_creating_child_sa.reset ( new ChildSa( IpsecController::getSpi(this->peer_addr->getIpAddress(),this->my_addr->getIpAddress(),child_sa_request->ipsec_protocol, SpiRouting::getIkeSaSpiWorker( this->my_spi ) ), child_sa_request ) );
 
 	}
 
@@ -704,13 +742,13 @@ namespace openikev2 {
     IkeSa::MESSAGE_ACTION IkeSa::processIkeSaInitResponse( Message& message ) {
         // Check state
         if ( this->state != STATE_IKE_SA_INIT_REQ_SENT ) {
-            Log::writeLockedMessage( this->getLogId(), "Transition error: event=[Receive IKE_SA_INIT response] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_WARN, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Transition error: event=[Receive IKE_SA_INIT response] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_WARN, true );
             return MESSAGE_ACTION_OMIT;
         }
 
         Log::acquire();
-        Log::writeMessage( this->getLogId(), "Recv: IKE_SA_INIT response", Log::LOG_MESG, true );
-        Log::writeMessage( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
+        LOG_MESSAGE( this->getLogId(), "Recv: IKE_SA_INIT response", Log::LOG_MESG, true );
+        LOG_MESSAGE( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
         Log::release();
 
         //  Process notify (N) and vendor (V) payloads
@@ -749,21 +787,21 @@ namespace openikev2 {
     IkeSa::MESSAGE_ACTION IkeSa::processIkeSaInitRequest( Message &message ) {
         // Check state
         if ( this->state != STATE_INITIAL ) {
-            Log::writeLockedMessage( this->getLogId(), "Transition error: event=[Receive IKE_SA_INIT request] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Transition error: event=[Receive IKE_SA_INIT request] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_ERRO, true );
             this->sendNotifyResponse( Message::IKE_SA_INIT, Payload_NOTIFY::INVALID_SYNTAX );
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return MESSAGE_ACTION_DELETE_IKE_SA;
         }
 
         Log::acquire();
-        Log::writeMessage( this->getLogId(), "Recv: IKE_SA_INIT request", Log::LOG_MESG, true );
-        Log::writeMessage( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
+        LOG_MESSAGE( this->getLogId(), "Recv: IKE_SA_INIT request", Log::LOG_MESG, true );
+        LOG_MESSAGE( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
         Log::release();
 
         // Check if cookies are needed, check that there is unless one
         if ( IkeSaController::useCookies() ) {
             if ( message.getFirstNotifyByType( Payload_NOTIFY::COOKIE ) == NULL ) {
-                Log::writeLockedMessage( this->getLogId(), "Cookie needed and not received. Sending cookie", Log::LOG_WARN, true );
+                LOG_LOCKED_MESSAGE( this->getLogId(), "Cookie needed and not received. Sending cookie", Log::LOG_WARN, true );
                 auto_ptr<Payload_NOTIFY> expected_cookie = CryptoController::generateCookie( message );
                 this->sendNotifyResponse( Message::IKE_SA_INIT, expected_cookie );
                 return MESSAGE_ACTION_DELETE_IKE_SA;
@@ -780,8 +818,8 @@ namespace openikev2 {
             return MESSAGE_ACTION_OMIT;
 
 
-        // process the IKE_SA negotiation request (SA, KE, NONCE)
-        NEGOTIATION_ACTION negotiation_action = this->processIkeSaNegotiationRequest( message, *this );
+        // process the IKE_SA negotiation request (SA, KE, NONCE). The DH shared secret is generated by a DiffieHellmanJob
+        NEGOTIATION_ACTION negotiation_action = this->processIkeSaNegotiationRequest( message, *this, false );
         if ( negotiation_action == NEGOTIATION_ACTION_ERROR ) {
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return MESSAGE_ACTION_DELETE_IKE_SA;
@@ -793,6 +831,25 @@ namespace openikev2 {
         // start the countdown to perform initial exchanges
         this->halfopen_alarm->reset();
 
+        // Generates the DH key pair and shared secret, in the CryptoJobPool if available
+        Payload_KE& payload_ke = ( Payload_KE& ) message.getUniquePayloadByType( Payload::PAYLOAD_KE );
+        auto_ptr<DiffieHellmanJob> job ( new DiffieHellmanJob( this->my_spi, payload_ke.group, payload_ke.getPublicKey().clone() ) );
+        if ( CryptoController::hasCryptoJobPool() ) {
+            this->setState( STATE_IKE_SA_INIT_CRYPTO_PENDING );
+            CryptoController::submitCryptoJob( auto_ptr<CryptoJob> ( job ) );
+            return MESSAGE_ACTION_PENDING;
+        }
+
+        job->run();
+        return this->completeIkeSaInitRequest( *job );
+    }
+
+    IkeSa::MESSAGE_ACTION IkeSa::completeIkeSaInitRequest( DiffieHellmanJob& job ) {
+        if ( job.failed )
+            throw CipherException( "Cannot generate the DH shared secret: " + job.error );
+
+        this->setSharedSecret( *this, job.diffie_hellman );
+
         // creates the response to the IKE_SA_INIT request
         return this->createIkeSaInitResponse( );
     }
@@ -845,13 +902,13 @@ namespace openikev2 {
             return this->processEapFinishRequest( message );
 
         else if ( this->state < STATE_IKE_SA_ESTABLISHED ) {
-            Log::writeLockedMessage( this->getLogId(), "Transition error: event=[Receive IKE_AUTH request] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Transition error: event=[Receive IKE_AUTH request] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_ERRO, true );
             this->sendNotifyResponse( Message::IKE_AUTH, Payload_NOTIFY::INVALID_SYNTAX );
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return MESSAGE_ACTION_DELETE_IKE_SA;
         }
         else {
-            Log::writeLockedMessage( this->getLogId(), "Transition error: event=[Receive IKE_AUTH request] state=[" + IKE_SA_STATE_STR( this->state ) + "]. Ommiting request", Payload_NOTIFY::INVALID_SYNTAX, Message::IKE_AUTH );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Transition error: event=[Receive IKE_AUTH request] state=[" + IKE_SA_STATE_STR( this->state ) + "]. Ommiting request", Payload_NOTIFY::INVALID_SYNTAX, Message::IKE_AUTH );
             return MESSAGE_ACTION_OMIT;
         }
     }
@@ -871,7 +928,7 @@ namespace openikev2 {
             return this->processEapFinishResponse( message );
 
         else {
-            Log::writeLockedMessage( this->getLogId(), "Transition error: event=[Receive IKE_AUTH response] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_WARN, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Transition error: event=[Receive IKE_AUTH response] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_WARN, true );
             return MESSAGE_ACTION_OMIT;
         }
     }
@@ -879,7 +936,7 @@ namespace openikev2 {
     IkeSa::IKE_SA_ACTION IkeSa::createIkeAuthRequest( vector<Payload_CERT_REQ*> received_payloads_cert_req_r ) {
         // Check state
         if ( this->state != STATE_IKE_SA_INIT_REQ_SENT ) {
-            Log::writeLockedMessage( this->getLogId(), "Transition error: event=[Start IKE_AUTH request] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Transition error: event=[Start IKE_AUTH request] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_ERRO, true );
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return IKE_SA_ACTION_DELETE_IKE_SA;
         }
@@ -906,7 +963,7 @@ namespace openikev2 {
         if ( !this->getIkeSaConfiguration().getAuthenticator().initiatorUsesEap() ) {
             auto_ptr<Payload_AUTH> payload_auth = this->getIkeSaConfiguration().getAuthenticator().generateAuthPayload( *this );
             if ( payload_auth.get() == NULL ) {
-                Log::writeLockedMessage( this->getLogId(), "AUTHENTICATION_FAILED", Log::LOG_ERRO, true );
+                LOG_LOCKED_MESSAGE( this->getLogId(), "AUTHENTICATION_FAILED", Log::LOG_ERRO, true );
                 EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
                 return IKE_SA_ACTION_DELETE_IKE_SA;
             }
@@ -930,17 +987,17 @@ namespace openikev2 {
 
     IkeSa::MESSAGE_ACTION IkeSa::processIkeAuthNoEapResponse( Message & message ) {
         Log::acquire();
-        Log::writeMessage( this->getLogId(), "Recv: IKE_AUTH response", Log::LOG_MESG, true );
-        Log::writeMessage( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
+        LOG_MESSAGE( this->getLogId(), "Recv: IKE_AUTH response", Log::LOG_MESG, true );
+        LOG_MESSAGE( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
         Log::release();
 
-        Log::writeLockedMessage( this->getLogId(), "DEBUG: processing IKE_AUTH", Log::LOG_INFO, true );
+        LOG_LOCKED_MESSAGE( this->getLogId(), "DEBUG: processing IKE_AUTH", Log::LOG_INFO, true );
 
         // Process notifies (N). Exits if an error notify is found.
         NOTIFY_ACTION action = this->processNotifies( message, this->my_creating_child_sa.get() );
         if ( action == NOTIFY_ACTION_ERROR ) {
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
-            Log::writeLockedMessage( this->getLogId(), "DEBUG: Notifies error", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "DEBUG: Notifies error", Log::LOG_ERRO, true );
 
             return MESSAGE_ACTION_DELETE_IKE_SA;
         }
@@ -952,7 +1009,7 @@ namespace openikev2 {
         this->my_id = this->getIkeSaConfiguration().my_id->clone();
         this->peer_id = payload_id_r.id->clone();
         if ( !this->getIkeSaConfiguration().checkId( *this->peer_id ) ) {
-            Log::writeLockedMessage( this->getLogId(), "AUTHENTICATION_FAILED: The peer ID is not allowed", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "AUTHENTICATION_FAILED: The peer ID is not allowed", Log::LOG_ERRO, true );
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return MESSAGE_ACTION_DELETE_IKE_SA;
         }
@@ -960,7 +1017,7 @@ namespace openikev2 {
         // Process authentication payload (AUTH)
         bool auth_check = this->getIkeSaConfiguration().getAuthenticator().verifyAuthPayload( message, *this );
         if ( !auth_check ) {
-            Log::writeLockedMessage( this->getLogId(), "AUTHENTICATION_FAILED: Cannot verify AUTH payload", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "AUTHENTICATION_FAILED: Cannot verify AUTH payload", Log::LOG_ERRO, true );
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return MESSAGE_ACTION_DELETE_IKE_SA;
         }
@@ -969,17 +1026,17 @@ namespace openikev2 {
         NEGOTIATION_ACTION negotiation_action = this->processChildSaNegotiationResponse( message );
         if ( negotiation_action == NEGOTIATION_ACTION_ERROR ) {
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
-            Log::writeLockedMessage( this->getLogId(), "DEBUG: error processing CHILD_SA", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "DEBUG: error processing CHILD_SA", Log::LOG_ERRO, true );
 
             return MESSAGE_ACTION_DELETE_IKE_SA;
         }
 
         // Install the CHILD_SA in the kernel
-		Log::writeLockedMessage( this->getLogId(), "DEBUG: Before creating Child_SA", Log::LOG_INFO, true );
+		LOG_LOCKED_MESSAGE( this->getLogId(), "DEBUG: Before creating Child_SA", Log::LOG_INFO, true );
 
         this->createChildSa( this->my_creating_child_sa );
 
-		Log::writeLockedMessage( this->getLogId(), "DEBUG: After creating Child_SA", Log::LOG_INFO, true );
+		LOG_LOCKED_MESSAGE( this->getLogId(), "DEBUG: After creating Child_SA", Log::LOG_INFO, true );
 
         this->setState( STATE_IKE_SA_ESTABLISHED );
 
@@ -990,8 +1047,8 @@ namespace openikev2 {
 
     IkeSa::MESSAGE_ACTION IkeSa::processEapInitResponse( Message & message ) {
         Log::acquire();
-        Log::writeMessage( this->getLogId(), "Recv: EAP_INIT response", Log::LOG_MESG, true );
-        Log::writeMessage( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
+        LOG_MESSAGE( this->getLogId(), "Recv: EAP_INIT response", Log::LOG_MESG, true );
+        LOG_MESSAGE( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
         Log::release();
 
         // process notifies (N)
@@ -1008,7 +1065,7 @@ namespace openikev2 {
         this->my_id = this->getIkeSaConfiguration().my_id->clone();
         this->peer_id = payload_id_r.id->clone();
         if ( !this->getIkeSaConfiguration().checkId( *this->peer_id ) ) {
-            Log::writeLockedMessage( this->getLogId(), "AUTHENTICATION_FAILED: The peer ID is not allowed", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "AUTHENTICATION_FAILED: The peer ID is not allowed", Log::LOG_ERRO, true );
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return MESSAGE_ACTION_DELETE_IKE_SA;
         }
@@ -1016,7 +1073,7 @@ namespace openikev2 {
         // process authentication payload (AUTH)
         bool auth_check = this->getIkeSaConfiguration().getAuthenticator().verifyAuthPayload( message, *this );
         if ( !auth_check ) {
-            Log::writeLockedMessage( this->getLogId(), "AUTHENTICATION_FAILED: Cannot verify AUTH payload", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "AUTHENTICATION_FAILED: Cannot verify AUTH payload", Log::LOG_ERRO, true );
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return MESSAGE_ACTION_DELETE_IKE_SA;
         }
@@ -1025,7 +1082,7 @@ namespace openikev2 {
         Payload_EAP& payload_eap = ( Payload_EAP& ) message.getUniquePayloadByType( Payload::PAYLOAD_EAP );
         auto_ptr<Payload_EAP> eap_response = this->getIkeSaConfiguration().getAuthenticator().processEapRequest( payload_eap );
         if ( eap_response.get() == NULL ) {
-            Log::writeLockedMessage( this->getLogId(), "AUTHENTICATION_FAILED: Cannot create EAP CONTINUE request", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "AUTHENTICATION_FAILED: Cannot create EAP CONTINUE request", Log::LOG_ERRO, true );
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return MESSAGE_ACTION_DELETE_IKE_SA;
         }
@@ -1039,8 +1096,8 @@ namespace openikev2 {
     IkeSa::MESSAGE_ACTION IkeSa::processIkeAuthNoEapRequest( Message & message ) {
 
 	Log::acquire();
-        Log::writeMessage( this->getLogId(), "Recv: IKE_AUTH request", Log::LOG_MESG, true );
-        Log::writeMessage( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
+        LOG_MESSAGE( this->getLogId(), "Recv: IKE_AUTH request", Log::LOG_MESG, true );
+        LOG_MESSAGE( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
         Log::release();
 
 	// update policies, in case they have changed
@@ -1053,7 +1110,7 @@ namespace openikev2 {
 
 
         // creates the CHILD_SA
-        this->peer_creating_child_sa.reset( new ChildSa( IpsecController::getSpi(this->peer_addr->getIpAddress(),this->my_addr->getIpAddress(), peer_selected_ipsec_proto), peer_selected_ipsec_proto, false ) );
+        this->peer_creating_child_sa.reset( new ChildSa( IpsecController::getSpi(this->peer_addr->getIpAddress(),this->my_addr->getIpAddress(), peer_selected_ipsec_proto, SpiRouting::getIkeSaSpiWorker( this->my_spi ) ), peer_selected_ipsec_proto, false ) );
 
         // process notify payloads (N) and vendor payloads (V)
         NOTIFY_ACTION action = this->processNotifies( message, this->peer_creating_child_sa.get() );
@@ -1069,69 +1126,80 @@ namespace openikev2 {
         this->my_id = this->getIkeSaConfiguration().my_id->clone();
         this->peer_id = payload_id_i.id->clone();
         if ( !this->getIkeSaConfiguration().checkId( *this->peer_id ) ) {
-            Log::writeLockedMessage( this->getLogId(), "AUTHENTICATION_FAILED: The peer ID is not allowed", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "AUTHENTICATION_FAILED: The peer ID is not allowed", Log::LOG_ERRO, true );
             this->sendNotifyResponse( Message::IKE_AUTH, Payload_NOTIFY::AUTHENTICATION_FAILED );
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return MESSAGE_ACTION_DELETE_IKE_SA;
         }
 
-        Log::writeLockedMessage( this->getLogId(), "***** 7", Log::LOG_ERRO, true );
+        LOG_LOCKED_MESSAGE( this->getLogId(), "***** 7", Log::LOG_ERRO, true );
 
 
 
- 	auto_ptr<GeneralConfiguration> general_conf = Configuration::getInstance().getGeneralConfiguration();
-        BoolAttribute* mobility_attr = general_conf->attributemap->getAttribute<BoolAttribute>( "mobility" );
-        bool mobility = false;
-        if (mobility_attr  != NULL )
-        	mobility = mobility_attr->value;
+ 	shared_ptr<const GeneralConfiguration> general_conf = Configuration::getInstance().getGeneralConfiguration();
+        bool mobility = general_conf->mobility;
 
-	BoolAttribute* is_ha_attr = general_conf->attributemap->getAttribute<BoolAttribute>( "is_ha" );
-	bool is_ha = false;
-	if (is_ha_attr  != NULL )
-	is_ha = is_ha_attr->value;
+	bool is_ha = general_conf->is_ha;
 
 	if (mobility && is_ha){
-                Log::writeLockedMessage( this->getLogId(), "***** 8", Log::LOG_ERRO, true );
+                LOG_LOCKED_MESSAGE( this->getLogId(), "***** 8", Log::LOG_ERRO, true );
 
 
 		if (payload_id_i.id->id_type == Enums::ID_IPV6_ADDR){
-			Log::writeLockedMessage( this->getLogId(), "MOBILITY 1", Log::LOG_ERRO, true );
+			LOG_LOCKED_MESSAGE( this->getLogId(), "MOBILITY 1", Log::LOG_ERRO, true );
 
 			this->home_address = NetworkController::getSocketAddress(NetworkController::getIpAddress( Enums::ADDR_IPV6 , payload_id_i.id->id_data->clone()) ,500);
-			Log::writeLockedMessage( this->getLogId(), "MOBILITY 2", Log::LOG_ERRO, true );
+			LOG_LOCKED_MESSAGE( this->getLogId(), "MOBILITY 2", Log::LOG_ERRO, true );
 			this->peer_addr = this->home_address->clone();
-			Log::writeLockedMessage( this->getLogId(), "MOBILITY 3", Log::LOG_ERRO, true );
+			LOG_LOCKED_MESSAGE( this->getLogId(), "MOBILITY 3", Log::LOG_ERRO, true );
 
 		}
 		else {
-			Log::writeLockedMessage( this->getLogId(), "MOBILITY ERROR: You forgot to configure the HoA as ID in the initiator (IDi)", Log::LOG_ERRO, true );
+			LOG_LOCKED_MESSAGE( this->getLogId(), "MOBILITY ERROR: You forgot to configure the HoA as ID in the initiator (IDi)", Log::LOG_ERRO, true );
 		    	this->sendNotifyResponse( Message::IKE_AUTH, Payload_NOTIFY::AUTHENTICATION_FAILED );
 		    	EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
 		    	return MESSAGE_ACTION_DELETE_IKE_SA;
 		}
 	}
 
-			Log::writeLockedMessage( this->getLogId(), "MOBILITY 4", Log::LOG_ERRO, true );
+			LOG_LOCKED_MESSAGE( this->getLogId(), "MOBILITY 4", Log::LOG_ERRO, true );
+
 
+			LOG_LOCKED_MESSAGE( this->getLogId(), "MOBILITY 5", Log::LOG_ERRO, true );
 
-			Log::writeLockedMessage( this->getLogId(), "MOBILITY 5", Log::LOG_ERRO, true );
+        // verifies the authentication payloads (CERT+, AUTH) and generates ours, in the CryptoJobPool if available
+        auto_ptr<AuthenticationJob> job ( new AuthenticationJob( *this, this->getIkeSaConfiguration().getAuthenticator(), message.clone() ) );
+        if ( CryptoController::hasCryptoJobPool() ) {
+            this->setState( STATE_IKE_AUTH_CRYPTO_PENDING );
+            CryptoController::submitCryptoJob( auto_ptr<CryptoJob> ( job ) );
+            return MESSAGE_ACTION_PENDING;
+        }
+
+        job->run();
+        return this->completeIkeAuthNoEapRequest( *job );
+    }
+
+    IkeSa::MESSAGE_ACTION IkeSa::completeIkeAuthNoEapRequest( AuthenticationJob& job ) {
+        if ( job.failed )
+            throw CipherException( "Cannot process the AUTH payloads: " + job.error );
+
+        Message& message = *job.message;
 
         // process certificate request payloads (CERTREQ+)
         vector<Payload*> payloads_cert_req = message.getPayloadsByType( Payload::PAYLOAD_CERT_REQ ) ;
         vector<Payload_CERT_REQ*> payloads_cert_req_i;
         for ( vector<Payload*>::iterator it = payloads_cert_req.begin(); it != payloads_cert_req.end(); it++ )
             payloads_cert_req_i.push_back( ( Payload_CERT_REQ* ) *it );
-			Log::writeLockedMessage( this->getLogId(), "MOBILITY 6", Log::LOG_ERRO, true );
+			LOG_LOCKED_MESSAGE( this->getLogId(), "MOBILITY 6", Log::LOG_ERRO, true );
 
         // process authentication payloads (CERT+, AUTH)
-        bool auth_check = this->getIkeSaConfiguration().getAuthenticator().verifyAuthPayload( message, *this );
-        if ( !auth_check ) {
-            Log::writeLockedMessage( this->getLogId(), "AUTHENTICATION_FAILED", Log::LOG_ERRO, true );
+        if ( !job.verified ) {
+            LOG_LOCKED_MESSAGE( this->getLogId(), "AUTHENTICATION_FAILED", Log::LOG_ERRO, true );
             this->sendNotifyResponse( Message::IKE_AUTH, Payload_NOTIFY::AUTHENTICATION_FAILED );
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return MESSAGE_ACTION_DELETE_IKE_SA;
         }
-			Log::writeLockedMessage( this->getLogId(), "MOBILITY 7", Log::LOG_ERRO, true );
+			LOG_LOCKED_MESSAGE( this->getLogId(), "MOBILITY 7", Log::LOG_ERRO, true );
 
         // process CHILD_SA negotiation request payloads (SA, TSi, TSr)
         NEGOTIATION_ACTION negotiation_action = this->processChildSaNegotiationRequest( message );
@@ -1139,13 +1207,13 @@ namespace openikev2 {
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return MESSAGE_ACTION_DELETE_IKE_SA;
         }
-			Log::writeLockedMessage( this->getLogId(), "MOBILITY 8", Log::LOG_ERRO, true );
+			LOG_LOCKED_MESSAGE( this->getLogId(), "MOBILITY 8", Log::LOG_ERRO, true );
 
         // Create the IKE_AUTH response for the request
-        return this->createIkeAuthNoEapResponse( payloads_cert_req_i );
+        return this->createIkeAuthNoEapResponse( payloads_cert_req_i, job.payload_auth );
     }
 
-    IkeSa::MESSAGE_ACTION IkeSa::createIkeAuthNoEapResponse( const vector<Payload_CERT_REQ*> payloads_cert_req_i ) {
+    IkeSa::MESSAGE_ACTION IkeSa::createIkeAuthNoEapResponse( const vector<Payload_CERT_REQ*> payloads_cert_req_i, auto_ptr<Payload_AUTH> payload_auth ) {
         // creates the response message
         auto_ptr<Message> message = this->createMessage( Message::IKE_AUTH, Message::RESPONSE );
 
@@ -1161,9 +1229,8 @@ namespace openikev2 {
         message->addPayloads( payloads_cert.convertType<Payload>(), true );
 
         // include the authentication payload
-        auto_ptr<Payload_AUTH> payload_auth = this->getIkeSaConfiguration().authenticator->generateAuthPayload( *this );
         if ( payload_auth.get() == NULL ) {
-            Log::writeLockedMessage( this->getLogId(), "AUTHENTICATION_FAILED", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "AUTHENTICATION_FAILED", Log::LOG_ERRO, true );
             this->sendNotifyResponse( Message::IKE_AUTH, Payload_NOTIFY::AUTHENTICATION_FAILED );
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return MESSAGE_ACTION_DELETE_IKE_SA;
@@ -1190,8 +1257,8 @@ namespace openikev2 {
 
     IkeSa::MESSAGE_ACTION IkeSa::processEapInitRequest( Message & message ) {
         Log::acquire();
-        Log::writeMessage( this->getLogId(), "Recv: EAP_INIT request", Log::LOG_MESG, true );
-        Log::writeMessage( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
+        LOG_MESSAGE( this->getLogId(), "Recv: EAP_INIT request", Log::LOG_MESG, true );
+        LOG_MESSAGE( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
         Log::release();
 
         // do not process IKE_SA notifies (N). It will be done after authentication
@@ -1204,7 +1271,7 @@ namespace openikev2 {
 		peer_selected_ipsec_proto = proposal_sa->protocol_id;
 
         // creates the new CHILD_SA
-        this->peer_creating_child_sa.reset( new ChildSa( IpsecController::getSpi(this->peer_addr->getIpAddress(),this->my_addr->getIpAddress(), peer_selected_ipsec_proto), peer_selected_ipsec_proto, false ) );
+        this->peer_creating_child_sa.reset( new ChildSa( IpsecController::getSpi(this->peer_addr->getIpAddress(),this->my_addr->getIpAddress(), peer_selected_ipsec_proto, SpiRouting::getIkeSaSpiWorker( this->my_spi ) ), peer_selected_ipsec_proto, false ) );
 
 
         // process the identity payload (IDi)
@@ -1212,7 +1279,7 @@ namespace openikev2 {
         this->my_id = this->getIkeSaConfiguration().my_id->clone();
         this->peer_id = payload_id_i.id->clone();
         if ( !this->getIkeSaConfiguration().checkId( *this->peer_id ) ) {
-            Log::writeLockedMessage( this->getLogId(), "AUTHENTICATION_FAILED: The peer ID is not allowed", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "AUTHENTICATION_FAILED: The peer ID is not allowed", Log::LOG_ERRO, true );
             this->sendNotifyResponse( Message::IKE_AUTH, Payload_NOTIFY::AUTHENTICATION_FAILED );
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return MESSAGE_ACTION_DELETE_IKE_SA;
@@ -1255,7 +1322,7 @@ namespace openikev2 {
         // includes the intial EAP request payload (EAP)
         auto_ptr<Payload_EAP> eap_initial_request = this->getIkeSaConfiguration().getAuthenticator().generateInitialEapRequest( *this->peer_id );
         if ( eap_initial_request.get() == NULL ) {
-            Log::writeLockedMessage( this->getLogId(), "AUTHENTICATION_FAILED: Cannot create EAP INIT response", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "AUTHENTICATION_FAILED: Cannot create EAP INIT response", Log::LOG_ERRO, true );
             this->sendNotifyResponse( Message::IKE_AUTH, Payload_NOTIFY::AUTHENTICATION_FAILED );
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return MESSAGE_ACTION_DELETE_IKE_SA;
@@ -1273,7 +1340,7 @@ namespace openikev2 {
     IkeSa::IKE_SA_ACTION IkeSa::createEapContinueRequest( auto_ptr<Payload_EAP> payload_eap ) {
         // Check state
         if ( this->state != STATE_IKE_AUTH_EAP_INIT_REQ_SENT && this->state != STATE_IKE_AUTH_EAP_CONT_REQ_SENT ) {
-            Log::writeLockedMessage( this->getLogId(), "Transition error: event=[Start IKE_AUTH_EAP_CONT] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Transition error: event=[Start IKE_AUTH_EAP_CONT] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_ERRO, true );
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return IKE_SA_ACTION_DELETE_IKE_SA;
         }
@@ -1294,8 +1361,8 @@ namespace openikev2 {
 
     IkeSa::MESSAGE_ACTION IkeSa::processEapContinueResponse( Message & message ) {
         Log::acquire();
-        Log::writeMessage( this->getLogId(), "Recv: EAP_CONT response", Log::LOG_MESG, true );
-        Log::writeMessage( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
+        LOG_MESSAGE( this->getLogId(), "Recv: EAP_CONT response", Log::LOG_MESG, true );
+        LOG_MESSAGE( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
         Log::release();
 
         // process the EAP payload (EAP)
@@ -1304,7 +1371,7 @@ namespace openikev2 {
 
         // If EAP FAILURE
         if ( eap_packet.code == EapPacket::EAP_CODE_FAILURE ) {
-            Log::writeLockedMessage( this->getLogId(), "AUTHENTICATION_FAILED: EAP authentication failed", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "AUTHENTICATION_FAILED: EAP authentication failed", Log::LOG_ERRO, true );
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return MESSAGE_ACTION_DELETE_IKE_SA;
         }
@@ -1319,7 +1386,7 @@ namespace openikev2 {
         else {
             auto_ptr<Payload_EAP> eap_response = this->getIkeSaConfiguration().getAuthenticator().processEapRequest( payload_eap );
             if ( eap_response.get() == NULL ) {
-                Log::writeLockedMessage( this->getLogId(), "AUTHENTICATION_FAILED: Cannot create EAP CONTINUE request", Log::LOG_ERRO, true );
+                LOG_LOCKED_MESSAGE( this->getLogId(), "AUTHENTICATION_FAILED: Cannot create EAP CONTINUE request", Log::LOG_ERRO, true );
                 EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
                 return MESSAGE_ACTION_DELETE_IKE_SA;
             }
@@ -1331,8 +1398,8 @@ namespace openikev2 {
 
     IkeSa::MESSAGE_ACTION IkeSa::processEapContinueRequest( Message & message ) {
         Log::acquire();
-        Log::writeMessage( this->getLogId(), "Recv: EAP_CONT request", Log::LOG_MESG, true );
-        Log::writeMessage( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
+        LOG_MESSAGE( this->getLogId(), "Recv: EAP_CONT request", Log::LOG_MESG, true );
+        LOG_MESSAGE( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
         Log::release();
 
         // process EAP payload (EAP)
@@ -1340,7 +1407,7 @@ namespace openikev2 {
 
         auto_ptr<Payload_EAP> eap_request = this->getIkeSaConfiguration().getAuthenticator().processEapResponse( payload_eap, *this->peer_id );
         if ( eap_request.get() == NULL ) {
-            Log::writeLockedMessage( this->getLogId(), "AUTHENTICATION_FAILED: Cannot create EAP CONT response", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "AUTHENTICATION_FAILED: Cannot create EAP CONT response", Log::LOG_ERRO, true );
             this->sendNotifyResponse( Message::IKE_AUTH, Payload_NOTIFY::AUTHENTICATION_FAILED );
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return MESSAGE_ACTION_DELETE_IKE_SA;
@@ -1381,7 +1448,7 @@ namespace openikev2 {
     IkeSa::IKE_SA_ACTION IkeSa::createEapFinishRequest() {
         // Check state
         if ( this->state != STATE_IKE_AUTH_EAP_CONT_REQ_SENT ) {
-            Log::writeLockedMessage( this->getLogId(), "Transition error: event=[Start IKE_AUTH_EAP_FINISH] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Transition error: event=[Start IKE_AUTH_EAP_FINISH] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_ERRO, true );
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return IKE_SA_ACTION_DELETE_IKE_SA;
         }
@@ -1403,8 +1470,8 @@ namespace openikev2 {
 
     IkeSa::MESSAGE_ACTION IkeSa::processEapFinishResponse( Message & message ) {
         Log::acquire();
-        Log::writeMessage( this->getLogId(), "Recv: EAP_FINISH response", Log::LOG_MESG, true );
-        Log::writeMessage( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
+        LOG_MESSAGE( this->getLogId(), "Recv: EAP_FINISH response", Log::LOG_MESG, true );
+        LOG_MESSAGE( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
         Log::release();
 
         // process notification payloads (N) and vendor payloads (V)
@@ -1419,7 +1486,7 @@ namespace openikev2 {
         // process authentication payload (AUTH)
         bool auth_check = this->getIkeSaConfiguration().getAuthenticator().verifyEapAuthPayload( message, *this );
         if ( !auth_check ) {
-            Log::writeLockedMessage( this->getLogId(), "AUTHENTICATION_FAILED: Cannot verify AUTH payload", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "AUTHENTICATION_FAILED: Cannot verify AUTH payload", Log::LOG_ERRO, true );
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return MESSAGE_ACTION_DELETE_IKE_SA;
         }
@@ -1443,8 +1510,8 @@ namespace openikev2 {
 
     IkeSa::MESSAGE_ACTION IkeSa::processEapFinishRequest( Message & message ) {
         Log::acquire();
-        Log::writeMessage( this->getLogId(), "Recv: EAP_FINISH request", Log::LOG_MESG, true );
-        Log::writeMessage( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
+        LOG_MESSAGE( this->getLogId(), "Recv: EAP_FINISH request", Log::LOG_MESG, true );
+        LOG_MESSAGE( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
         Log::release();
 
 
@@ -1463,7 +1530,7 @@ namespace openikev2 {
         // process the authentication payload (AUTH)
         bool auth_check = this->getIkeSaConfiguration().getAuthenticator().verifyEapAuthPayload( message, *this );
         if ( !auth_check ) {
-            Log::writeLockedMessage( this->getLogId(), "AUTHENTICATION_FAILED: Cannot veirfy AUTH payload", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "AUTHENTICATION_FAILED: Cannot veirfy AUTH payload", Log::LOG_ERRO, true );
             this->sendNotifyResponse( Message::IKE_AUTH, Payload_NOTIFY::AUTHENTICATION_FAILED );
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return MESSAGE_ACTION_DELETE_IKE_SA;
@@ -1510,7 +1577,7 @@ namespace openikev2 {
     IkeSa::MESSAGE_ACTION IkeSa::processCreateChildSaRequest( Message & message ) {
         // Check state
         if ( this->state < STATE_IKE_SA_ESTABLISHED ) {
-            Log::writeLockedMessage( this->getLogId(), "Transition error: event=[Receive CREATE_CHILD_SA request] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Transition error: event=[Receive CREATE_CHILD_SA request] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_ERRO, true );
             this->sendNotifyResponse( Message::CREATE_CHILD_SA, Payload_NOTIFY::INVALID_SYNTAX );
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return MESSAGE_ACTION_DELETE_IKE_SA;
@@ -1554,71 +1621,65 @@ namespace openikev2 {
             return this->processRedundantRekeyIkeSaResponse( message );
 
         else {
-            Log::writeLockedMessage( this->getLogId(), "Transition error: event=[Receive CREATE_CHILD_SA response] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_WARN, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Transition error: event=[Receive CREATE_CHILD_SA response] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_WARN, true );
             return MESSAGE_ACTION_OMIT;
         }
     }
 
     IkeSa::IKE_SA_ACTION IkeSa::createNewChildSaRequest( auto_ptr<ChildSaRequest> child_sa_request ) {
         // Check state
-	Log::writeLockedMessage( this->getLogId(), "Entrando en createNewChildSaRequest", Log::LOG_WARN, true );
+	LOG_LOCKED_MESSAGE( this->getLogId(), "Entrando en createNewChildSaRequest", Log::LOG_WARN, true );
 
 	if ( this->state < STATE_IKE_SA_ESTABLISHED ) {
-            Log::writeLockedMessage( this->getLogId(), "Transition error: event=[Start NEW_CHILD_SA] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Transition error: event=[Start NEW_CHILD_SA] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_ERRO, true );
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return IKE_SA_ACTION_DELETE_IKE_SA;
         }
         else if ( this->state == STATE_WAITING_FOR_DELETION || this->state == STATE_DELETE_IKE_SA_REQ_SENT ) {
             // Omit the command
-	Log::writeLockedMessage( this->getLogId(), "Punto 1", Log::LOG_WARN, true );
+	LOG_LOCKED_MESSAGE( this->getLogId(), "Punto 1", Log::LOG_WARN, true );
 
             return IKE_SA_ACTION_CONTINUE;
         }
         else if ( this->state > STATE_IKE_SA_ESTABLISHED ) {
-	    Log::writeLockedMessage( this->getLogId(), "Punto 2", Log::LOG_WARN, true );
+	    LOG_LOCKED_MESSAGE( this->getLogId(), "Punto 2", Log::LOG_WARN, true );
             this->pushDeferredCommand( auto_ptr<Command> ( new SendNewChildSaReqCommand( child_sa_request ) ) );
             return IKE_SA_ACTION_CONTINUE;
         }
-	Log::writeLockedMessage( this->getLogId(), "Punto 3", Log::LOG_WARN, true );
+	LOG_LOCKED_MESSAGE( this->getLogId(), "Punto 3", Log::LOG_WARN, true );
 
 
-    auto_ptr<GeneralConfiguration> general_conf = Configuration::getInstance().getGeneralConfiguration();
+    shared_ptr<const GeneralConfiguration> general_conf = Configuration::getInstance().getGeneralConfiguration();
 
-        BoolAttribute* is_ha_attr = general_conf->attributemap->getAttribute<BoolAttribute>( "is_ha" );
-        bool is_ha = false;
-        if (is_ha_attr  != NULL )
-        is_ha = is_ha_attr->value;
+        bool is_ha = general_conf->is_ha;
 
 
-        BoolAttribute* mobility_attr = general_conf->attributemap->getAttribute<BoolAttribute>( "mobility" );
-        bool mobility = false;
+        bool mobility = general_conf->mobility;
     auto_ptr<SocketAddress> hoa (NULL);
     auto_ptr<SocketAddress> coa (NULL);
-        if (mobility_attr  != NULL )
-        mobility = mobility_attr->value;
 
     if (mobility && (child_sa_request->mode == Enums::TUNNEL_MODE)){
         if (is_ha) {
             // creates outbound SA in the kernel
-            this->my_creating_child_sa.reset ( new ChildSa( IpsecController::getSpi(this->care_of_address->getIpAddress(),this->my_addr->getIpAddress(),child_sa_request->ipsec_protocol ), child_sa_request ) );
+            this->my_creating_child_sa.reset ( new ChildSa( IpsecController::getSpi(this->care_of_address->getIpAddress(),this->my_addr->getIpAddress(),child_sa_request->ipsec_protocol, SpiRouting::getIkeSaSpiWorker( this->my_spi ) ), child_sa_request ) );
 
         }
         else {
             // creates outbound SA in the kernel
-            this->my_creating_child_sa.reset ( new ChildSa( IpsecController::getSpi(this->peer_addr->getIpAddress(),this->care_of_address->getIpAddress(),child_sa_request->ipsec_protocol ), child_sa_request ) );
+            this->my_creating_child_sa.reset ( new ChildSa( IpsecController::getSpi(this->peer_addr->getIpAddress(),this->care_of_address->getIpAddress(),child_sa_request->ipsec_protocol, SpiRouting::getIkeSaSpiWorker( this->my_spi ) ), child_sa_request ) );
 
         }
     }
     else {
         // creates outbound SA in the kernel
-        this->my_creating_child_sa.reset ( new ChildSa( IpsecController::getSpi(this->peer_addr->getIpAddress(),this->my_addr->getIpAddress(),child_sa_request->ipsec_protocol ), child_sa_request ) );
+        this->my_creating_child_sa.reset ( new ChildSa( IpsecController::getSpi(this->peer_addr->getIpAddress(),this->my_addr->getIpAddress(),child_sa_request->ipsec_protocol, SpiRouting::getIkeSaSpiWorker( this->my_spi ) ), child_sa_request ) );
 
 
     }
 
 
 
-	Log::writeLockedMessage( this->getLogId(), "Punto 4", Log::LOG_WARN, true );
+	LOG_LOCKED_MESSAGE( this->getLogId(), "Punto 4", Log::LOG_WARN, true );
 
         // creates the request message
         auto_ptr<Message> message = this->createMessage( Message::CREATE_CHILD_SA, Message::REQUEST );
@@ -1626,12 +1687,9 @@ namespace openikev2 {
 
 
 /*
- 	auto_ptr<GeneralConfiguration> general_conf = Configuration::getInstance().getGeneralConfiguration();
+ 	shared_ptr<const GeneralConfiguration> general_conf = Configuration::getInstance().getGeneralConfiguration();
 
-        BoolAttribute* is_ha_attr = general_conf->attributemap->getAttribute<BoolAttribute>( "is_ha" );
-        bool is_ha = false;
-        if (is_ha_attr  != NULL )
-		is_ha = is_ha_attr->value;
+        bool is_ha = general_conf->is_ha;
 
         // TODO
 
@@ -1640,36 +1698,36 @@ namespace openikev2 {
 		if (child_sa_request->mode == Enums::TUNNEL_MODE){
 			if (is_ha){
 				message->dst_addr = this->care_of_address->clone();
-				Log::writeLockedMessage( this->getLogId(), "Cambiando el destino del mensaje por la ", Log::LOG_WARN, true );
+				LOG_LOCKED_MESSAGE( this->getLogId(), "Cambiando el destino del mensaje por la ", Log::LOG_WARN, true );
 			}
 			else {
 				message->src_addr = this->care_of_address->clone();
-				Log::writeLockedMessage( this->getLogId(), "Punto 1", Log::LOG_WARN, true );
+				LOG_LOCKED_MESSAGE( this->getLogId(), "Punto 1", Log::LOG_WARN, true );
 			}
 		}
 
 	}
 
 */
-	Log::writeLockedMessage( this->getLogId(), "Punto 5", Log::LOG_WARN, true );
+	LOG_LOCKED_MESSAGE( this->getLogId(), "Punto 5", Log::LOG_WARN, true );
 
 
         // include notify payloads (N)
         NetworkController::addNotifies( *message, *this, this->my_creating_child_sa.get() );
 
-	Log::writeLockedMessage( this->getLogId(), "Punto 6", Log::LOG_WARN, true );
+	LOG_LOCKED_MESSAGE( this->getLogId(), "Punto 6", Log::LOG_WARN, true );
 
 
         // include the CHILD_SA negotiation request payloads (SA, [KE], NONCE, TSi, TSr)
         this->createChildSaNegotiationRequest( *message );
 
-	Log::writeLockedMessage( this->getLogId(), "Punto 7", Log::LOG_WARN, true );
+	LOG_LOCKED_MESSAGE( this->getLogId(), "Punto 7", Log::LOG_WARN, true );
 
 
         // sends the message
         this->sendMessage( message, "Send: NEW_CHILD_SA request" );
 
-	Log::writeLockedMessage( this->getLogId(), "Punto 8", Log::LOG_WARN, true );
+	LOG_LOCKED_MESSAGE( this->getLogId(), "Punto 8", Log::LOG_WARN, true );
 
 
         // updates IKE_SA state
@@ -1680,8 +1738,8 @@ namespace openikev2 {
 
     IkeSa::MESSAGE_ACTION IkeSa::processNewChildSaResponse( Message & message ) {
         Log::acquire();
-        Log::writeMessage( this->getLogId(), "Recv: CREATE_CHILD response", Log::LOG_MESG, true );
-        Log::writeMessage( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
+        LOG_MESSAGE( this->getLogId(), "Recv: CREATE_CHILD response", Log::LOG_MESG, true );
+        LOG_MESSAGE( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
         Log::release();
 
         // process notifications (N)
@@ -1711,7 +1769,7 @@ namespace openikev2 {
     IkeSa::IKE_SA_ACTION IkeSa::createRekeyChildSaRequest ( uint32_t spi_rekey ) {
         // Check state
         if ( this->state < STATE_IKE_SA_ESTABLISHED ) {
-            Log::writeLockedMessage( this->getLogId(), "Transition error: event=[Start REKEY_CHILD_SA] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Transition error: event=[Start REKEY_CHILD_SA] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_ERRO, true );
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return IKE_SA_ACTION_DELETE_IKE_SA;
         }
@@ -1729,19 +1787,19 @@ namespace openikev2 {
 
         // If we don't controls this ChildSa, then omit
         if ( rekeyed_child_sa == NULL ) {
-            Log::writeLockedMessage( this->getLogId(), "Warning: IKE_SA doesn't control this IPsec SA", Log::LOG_WARN, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Warning: IKE_SA doesn't control this IPsec SA", Log::LOG_WARN, true );
             return IKE_SA_ACTION_CONTINUE;
         }
 
         // If the rekeyed CHILD_SA is already being rekeyed, then omit
         if ( rekeyed_child_sa->getState() == ChildSa::CHILD_SA_REKEYING || rekeyed_child_sa->getState() == ChildSa::CHILD_SA_REKEYED ) {
-            Log::writeLockedMessage( this->getLogId(), "Warning: IPSec SA=" + rekeyed_child_sa->getId() ->toString() + " already rekeyed or rekeying.", Log::LOG_WARN, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Warning: IPSec SA=" + rekeyed_child_sa->getId() ->toString() + " already rekeyed or rekeying.", Log::LOG_WARN, true );
             return IKE_SA_ACTION_CONTINUE;
         }
 
         // If the CHILD_SA is being deleted, then omit
         if ( rekeyed_child_sa->getState() == ChildSa::CHILD_SA_DELETING ) {
-            Log::writeLockedMessage( this->getLogId(), "Warning: IPSec SA=" + rekeyed_child_sa->getId() ->toString() + " already deleting.", Log::LOG_WARN, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Warning: IPSec SA=" + rekeyed_child_sa->getId() ->toString() + " already deleting.", Log::LOG_WARN, true );
             return IKE_SA_ACTION_CONTINUE;
         }
 
@@ -1749,7 +1807,7 @@ namespace openikev2 {
         rekeyed_child_sa->setState( ChildSa::CHILD_SA_REKEYING );
 
         // creates the new SA, with the same attributes than the rekeyed
-        this->my_creating_child_sa.reset ( new ChildSa( IpsecController::getSpi(this->peer_addr->getIpAddress(), this->my_addr->getIpAddress() ,rekeyed_child_sa->ipsec_protocol), true, *rekeyed_child_sa ) );
+        this->my_creating_child_sa.reset ( new ChildSa( IpsecController::getSpi(this->peer_addr->getIpAddress(), this->my_addr->getIpAddress() ,rekeyed_child_sa->ipsec_protocol, SpiRouting::getIkeSaSpiWorker( this->my_spi ) ), true, *rekeyed_child_sa ) );
 
         // creates the request message
         auto_ptr<Message> message = this->createMessage( Message::CREATE_CHILD_SA, Message::REQUEST );
@@ -1770,8 +1828,8 @@ namespace openikev2 {
 
     IkeSa::MESSAGE_ACTION IkeSa::processRekeyChildSaResponse( Message & message ) {
         Log::acquire();
-        Log::writeMessage( this->getLogId(), "Recv: REKEY_CHILD_SA response", Log::LOG_MESG, true );
-        Log::writeMessage( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
+        LOG_MESSAGE( this->getLogId(), "Recv: REKEY_CHILD_SA response", Log::LOG_MESG, true );
+        LOG_MESSAGE( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
         Log::release();
 
         // Obtain the rekeyed SA
@@ -1780,7 +1838,7 @@ namespace openikev2 {
         // if IPSEC SPI no longer exist, then it will be deleted by the peer and we must omit the response
         if ( rekeyed_child_sa == NULL ) {
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventChildSa( BusEventChildSa::CHILD_SA_FAILED, *this, *this->my_creating_child_sa ) ) );
-            Log::writeLockedMessage( this->getLogId(), "Rekeyed SA no longer exists: Doing nothing", Log::LOG_WARN, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Rekeyed SA no longer exists: Doing nothing", Log::LOG_WARN, true );
             this->setState( STATE_IKE_SA_ESTABLISHED );
             return MESSAGE_ACTION_COMMIT;
         }
@@ -1817,8 +1875,8 @@ namespace openikev2 {
 
     IkeSa::MESSAGE_ACTION IkeSa::processRedundantRekeyChildSaResponse( Message & message ) {
         Log::acquire();
-        Log::writeMessage( this->getLogId(), "Recv: REKEY_CHILD_SA response", Log::LOG_MESG, true );
-        Log::writeMessage( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
+        LOG_MESSAGE( this->getLogId(), "Recv: REKEY_CHILD_SA response", Log::LOG_MESG, true );
+        LOG_MESSAGE( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
         Log::release();
 
         // Obtain the rekeyed SA
@@ -1826,7 +1884,7 @@ namespace openikev2 {
 
         // if IPSEC SPI no longer exist, then it will be deleted by the peer and we must omit the response
         if ( rekeyed_child_sa == NULL ) {
-            Log::writeLockedMessage( this->getLogId(), "Rekeyed SA no longer exists: Doing nothing", Log::LOG_WARN, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Rekeyed SA no longer exists: Doing nothing", Log::LOG_WARN, true );
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventChildSa( BusEventChildSa::CHILD_SA_FAILED, *this, *this->my_creating_child_sa ) ) );
             this->setState( STATE_IKE_SA_ESTABLISHED );
             return MESSAGE_ACTION_COMMIT;
@@ -1851,7 +1909,7 @@ namespace openikev2 {
 
         // find the looser redundant CHILD_SA
         ChildSa & looser_child_sa = ChildSa::hasMinNonce( *this->my_creating_child_sa, *this->peer_creating_child_sa );
-        Log::writeLockedMessage( this->getLogId(), "Warning: Found redundant Child SAs. SPI1=" + this->my_creating_child_sa->getId()->toString() + " SPI2=" + this->peer_creating_child_sa->getId()->toString() + " SPI to be deleted=" + looser_child_sa.getId()->toString(), Log::LOG_WARN, true );
+        LOG_LOCKED_MESSAGE( this->getLogId(), "Warning: Found redundant Child SAs. SPI1=" + this->my_creating_child_sa->getId()->toString() + " SPI2=" + this->peer_creating_child_sa->getId()->toString() + " SPI to be deleted=" + looser_child_sa.getId()->toString(), Log::LOG_WARN, true );
 
         // If loser is ours
         if ( &looser_child_sa == this->my_creating_child_sa.get() ) {
@@ -1878,14 +1936,14 @@ namespace openikev2 {
 
     IkeSa::MESSAGE_ACTION IkeSa::processNewChildSaRequest( Message & message ) {
         Log::acquire();
-        Log::writeMessage( this->getLogId(), "Recv: NEW_CHILD_SA request", Log::LOG_MESG, true );
-        Log::writeMessage( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
+        LOG_MESSAGE( this->getLogId(), "Recv: NEW_CHILD_SA request", Log::LOG_MESG, true );
+        LOG_MESSAGE( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
         Log::release();
 
         // If we are also rekeying the IKE SA, send NO_ADDITIONAL_SAS
         // Section 5.11.8 IKEv2 clarifications document */
         if ( this->state == STATE_REKEY_IKE_SA_REQ_SENT || this->state == STATE_REDUNDANT_IKE_SA || this->state == STATE_WAITING_FOR_DELETION ) {
-            Log::writeLockedMessage( this->getLogId(), "NO_ADDITIONAL_SAS: See section 5.11.8 of IKEv2 clarifications document", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "NO_ADDITIONAL_SAS: See section 5.11.8 of IKEv2 clarifications document", Log::LOG_ERRO, true );
             this->sendNotifyResponse( Message::CREATE_CHILD_SA, Payload_NOTIFY::NO_ADDITIONAL_SAS );
             this->setState( this->state );
             return MESSAGE_ACTION_COMMIT;
@@ -1903,44 +1961,38 @@ namespace openikev2 {
 
 
 
-    auto_ptr<GeneralConfiguration> general_conf = Configuration::getInstance().getGeneralConfiguration();
+    shared_ptr<const GeneralConfiguration> general_conf = Configuration::getInstance().getGeneralConfiguration();
 
-        BoolAttribute* is_ha_attr = general_conf->attributemap->getAttribute<BoolAttribute>( "is_ha" );
-        bool is_ha = false;
-        if (is_ha_attr  != NULL )
-        is_ha = is_ha_attr->value;
+        bool is_ha = general_conf->is_ha;
 
 
-        BoolAttribute* mobility_attr = general_conf->attributemap->getAttribute<BoolAttribute>( "mobility" );
-        bool mobility = false;
+        bool mobility = general_conf->mobility;
     auto_ptr<SocketAddress> hoa (NULL);
     auto_ptr<SocketAddress> coa (NULL);
-        if (mobility_attr  != NULL )
-        mobility = mobility_attr->value;
 
     Payload_NOTIFY* payload_notify = ( Payload_NOTIFY* ) message.getFirstPayloadByType( Payload::PAYLOAD_NOTIFY );
 
     if (mobility && (payload_notify == NULL)){ //TODO: asegurarse que sea realmente el notify que indica modo transporte
         if (is_ha) {
             // creates outbound SA in the kernel
-            Log::writeLockedMessage( this->getLogId(), "COA ANTES: "+this->care_of_address->toStringTab(0), Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "COA ANTES: "+this->care_of_address->toStringTab(0), Log::LOG_ERRO, true );
             this->care_of_address = message.src_addr->clone();
-            Log::writeLockedMessage( this->getLogId(), "COA DESPUES: "+this->care_of_address->toStringTab(0), Log::LOG_ERRO, true );
-            this->peer_creating_child_sa.reset( new ChildSa( IpsecController::getSpi(this->care_of_address->getIpAddress(),this->my_addr->getIpAddress(),peer_selected_ipsec_proto), peer_selected_ipsec_proto, false ) );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "COA DESPUES: "+this->care_of_address->toStringTab(0), Log::LOG_ERRO, true );
+            this->peer_creating_child_sa.reset( new ChildSa( IpsecController::getSpi(this->care_of_address->getIpAddress(),this->my_addr->getIpAddress(),peer_selected_ipsec_proto, SpiRouting::getIkeSaSpiWorker( this->my_spi ) ), peer_selected_ipsec_proto, false ) );
 
         }
         else {
             // creates outbound SA in the kernel
-            Log::writeLockedMessage( this->getLogId(), "COA ANTES: "+this->care_of_address->toStringTab(0), Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "COA ANTES: "+this->care_of_address->toStringTab(0), Log::LOG_ERRO, true );
             this->care_of_address = message.dst_addr->clone();
-            Log::writeLockedMessage( this->getLogId(), "COA DESPUES: "+this->care_of_address->toStringTab(0), Log::LOG_ERRO, true );
-            this->peer_creating_child_sa.reset( new ChildSa( IpsecController::getSpi(this->peer_addr->getIpAddress(),this->care_of_address->getIpAddress(),peer_selected_ipsec_proto), peer_selected_ipsec_proto, false ) );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "COA DESPUES: "+this->care_of_address->toStringTab(0), Log::LOG_ERRO, true );
+            this->peer_creating_child_sa.reset( new ChildSa( IpsecController::getSpi(this->peer_addr->getIpAddress(),this->care_of_address->getIpAddress(),peer_selected_ipsec_proto, SpiRouting::getIkeSaSpiWorker( this->my_spi ) ), peer_selected_ipsec_proto, false ) );
 
         }
     }
     else {
         // creates outbound SA in the kernel
-        this->peer_creating_child_sa.reset( new ChildSa( IpsecController::getSpi(this->peer_addr->getIpAddress(),this->my_addr->getIpAddress(),peer_selected_ipsec_proto), peer_selected_ipsec_proto, false ) );
+        this->peer_creating_child_sa.reset( new ChildSa( IpsecController::getSpi(this->peer_addr->getIpAddress(),this->my_addr->getIpAddress(),peer_selected_ipsec_proto, SpiRouting::getIkeSaSpiWorker( this->my_spi ) ), peer_selected_ipsec_proto, false ) );
 
 
     }
@@ -1992,14 +2044,14 @@ namespace openikev2 {
 
     IkeSa::MESSAGE_ACTION IkeSa::processRekeyChildSaRequest( Message & message ) {
         Log::acquire();
-        Log::writeMessage( this->getLogId(), "Recv: REKEY_CHILD_SA request", Log::LOG_MESG, true );
-        Log::writeMessage( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
+        LOG_MESSAGE( this->getLogId(), "Recv: REKEY_CHILD_SA request", Log::LOG_MESG, true );
+        LOG_MESSAGE( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
         Log::release();
 
         // If we are also rekeying the IKE SA, send NO_ADDITIONAL_SAS
         // Section 5.11.8 IKEv2 clarifications document */
         if ( this->state == STATE_REKEY_IKE_SA_REQ_SENT || this->state == STATE_REDUNDANT_IKE_SA || this->state == STATE_WAITING_FOR_DELETION ) {
-            Log::writeLockedMessage( this->getLogId(), "NO_ADDITIONAL_SAS: See section 5.11.8 of IKEv2 clarifications document", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "NO_ADDITIONAL_SAS: See section 5.11.8 of IKEv2 clarifications document", Log::LOG_ERRO, true );
             this->sendNotifyResponse( Message::CREATE_CHILD_SA, Payload_NOTIFY::NO_ADDITIONAL_SAS );
             this->setState( this->state );
             return MESSAGE_ACTION_COMMIT;
@@ -2013,7 +2065,7 @@ namespace openikev2 {
 		peer_selected_ipsec_proto = proposal_sa->protocol_id;
 
         // creates the new CHILD SA object
-        this->peer_creating_child_sa.reset ( new ChildSa( IpsecController::getSpi(this->peer_addr->getIpAddress(),this->my_addr->getIpAddress(),peer_selected_ipsec_proto), peer_selected_ipsec_proto, false ) );
+        this->peer_creating_child_sa.reset ( new ChildSa( IpsecController::getSpi(this->peer_addr->getIpAddress(),this->my_addr->getIpAddress(),peer_selected_ipsec_proto, SpiRouting::getIkeSaSpiWorker( this->my_spi ) ), peer_selected_ipsec_proto, false ) );
 
         // process notification payloads (N)
         NOTIFY_ACTION action = this->processNotifies( message, this->peer_creating_child_sa.get() );
@@ -2077,7 +2129,7 @@ namespace openikev2 {
     IkeSa::IKE_SA_ACTION IkeSa::createRekeyIkeSaRequest() {
         // Check state
         if ( this->state < STATE_IKE_SA_ESTABLISHED ) {
-            Log::writeLockedMessage( this->getLogId(), "Transition error: event=[Start REKEY_IKE_SA] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Transition error: event=[Start REKEY_IKE_SA] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_ERRO, true );
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return IKE_SA_ACTION_DELETE_IKE_SA;
         }
@@ -2113,8 +2165,8 @@ namespace openikev2 {
 
     IkeSa::MESSAGE_ACTION IkeSa::processRekeyIkeSaResponse( Message & message ) {
         Log::acquire();
-        Log::writeMessage( this->getLogId(), "Recv: IKE_SA_REKEY response", Log::LOG_MESG, true );
-        Log::writeMessage( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
+        LOG_MESSAGE( this->getLogId(), "Recv: IKE_SA_REKEY response", Log::LOG_MESG, true );
+        LOG_MESSAGE( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
         Log::release();
 
         // process notify (N) payloads
@@ -2149,8 +2201,8 @@ namespace openikev2 {
 
     IkeSa::MESSAGE_ACTION IkeSa::processRedundantRekeyIkeSaResponse( Message & message ) {
         Log::acquire();
-        Log::writeMessage( this->getLogId(), "Recv: IKE_SA_REKEY response", Log::LOG_MESG, true );
-        Log::writeMessage( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
+        LOG_MESSAGE( this->getLogId(), "Recv: IKE_SA_REKEY response", Log::LOG_MESG, true );
+        LOG_MESSAGE( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
         Log::release();
 
         // process notify (N) payloads
@@ -2174,7 +2226,7 @@ namespace openikev2 {
         // get the looser redundant IKE_SA
         IkeSa & looser_ike_sa = IkeSa::hasMinNonce( *this->my_creating_ike_sa, *this->peer_creating_ike_sa );
 
-        Log::writeLockedMessage( this->getLogId(), "Warning: Redundant IKE SA: SPI reduntant=" + Printable::toHexString( &looser_ike_sa.my_spi, 8 ), Log::LOG_WARN, true );
+        LOG_LOCKED_MESSAGE( this->getLogId(), "Warning: Redundant IKE SA: SPI reduntant=" + Printable::toHexString( &looser_ike_sa.my_spi, 8 ), Log::LOG_WARN, true );
 
         // If the redundant to be deleted is ours created, then start both and delete mine
         if ( &looser_ike_sa == this->my_creating_ike_sa.get() ) {
@@ -2199,13 +2251,13 @@ namespace openikev2 {
 
     IkeSa::MESSAGE_ACTION IkeSa::processRekeyIkeSaRequest( Message & message ) {
         Log::acquire();
-        Log::writeMessage( this->getLogId(), "Recv: IKE_SA_REKEY request", Log::LOG_MESG, true );
-        Log::writeMessage( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
+        LOG_MESSAGE( this->getLogId(), "Recv: IKE_SA_REKEY request", Log::LOG_MESG, true );
+        LOG_MESSAGE( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
         Log::release();
 
         // If the state is redundant, no additional REKEY IKE_SA is allowed
         if ( this->state == STATE_REDUNDANT_IKE_SA ) {
-            Log::writeLockedMessage( this->getLogId(), "Transition error: event=[Recv REKEY_IKE_SA request] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Transition error: event=[Recv REKEY_IKE_SA request] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_ERRO, true );
             this->sendNotifyResponse( Message::CREATE_CHILD_SA, Payload_NOTIFY::INVALID_SYNTAX );
             this->setState( this->state );
             return MESSAGE_ACTION_COMMIT;
@@ -2214,7 +2266,7 @@ namespace openikev2 {
         // If we have CHILD_SAs half-open, then reject the IKE_SA rekey
         // References 5.11.8 IKEv2 clarifications document
         if ( this->state == STATE_REKEY_CHILD_SA_REQ_SENT || this->state == STATE_REDUNDANT_CHILD_SA || this->state == STATE_NEW_CHILD_SA_REQ_SENT || this->state == STATE_DELETE_CHILD_SA_REQ_SENT ) {
-            Log::writeLockedMessage( this->getLogId(), "NO_PROPOSAL_CHOSEN: See section 5.11.8 of the IKEv2 clarification document", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "NO_PROPOSAL_CHOSEN: See section 5.11.8 of the IKEv2 clarification document", Log::LOG_ERRO, true );
             this->sendNotifyResponse( Message::CREATE_CHILD_SA, Payload_NOTIFY::NO_PROPOSAL_CHOSEN );
             this->setState( this->state );
             return MESSAGE_ACTION_COMMIT;
@@ -2223,7 +2275,7 @@ namespace openikev2 {
         // If we are DELETING the IKE_SA, then reject the IKE_SA rekey
         // References 5.11.9 IKEv2 clarifications document
         else if ( this->state == STATE_DELETE_IKE_SA_REQ_SENT ) {
-            Log::writeLockedMessage( this->getLogId(), "NO_PROPOSAL_CHOSEN: See section 5.11.9 of the IKEv2 clarification document", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "NO_PROPOSAL_CHOSEN: See section 5.11.9 of the IKEv2 clarification document", Log::LOG_ERRO, true );
             this->sendNotifyResponse( Message::CREATE_CHILD_SA, Payload_NOTIFY::NO_PROPOSAL_CHOSEN );
             this->setState( this->state );
             return MESSAGE_ACTION_COMMIT;
@@ -2232,7 +2284,7 @@ namespace openikev2 {
         // If we are DELETING the IKE_SA, then reject the IKE_SA rekey
         // References 5.11.9 IKEv2 clarifications document
         else if ( this->state == STATE_WAITING_FOR_DELETION ) {
-            Log::writeLockedMessage( this->getLogId(), "NO_PROPOSAL_CHOSEN: The IKE_SA has been already rekeyed. Waiting for delete exchange", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "NO_PROPOSAL_CHOSEN: The IKE_SA has been already rekeyed. Waiting for delete exchange", Log::LOG_ERRO, true );
             this->sendNotifyResponse( Message::CREATE_CHILD_SA, Payload_NOTIFY::NO_PROPOSAL_CHOSEN );
             this->setState( this->state );
             return MESSAGE_ACTION_COMMIT;
@@ -2313,7 +2365,7 @@ namespace openikev2 {
     IkeSa::IKE_SA_ACTION IkeSa::createDeleteChildSaRequest( uint32_t spi ) {
         // Check state
         if ( this->state < STATE_IKE_SA_ESTABLISHED ) {
-            Log::writeLockedMessage( this->getLogId(), "Transition error: event=[Start DELETE_CHILD_SA] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Transition error: event=[Start DELETE_CHILD_SA] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_ERRO, true );
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return IKE_SA_ACTION_DELETE_IKE_SA;
         }
@@ -2329,7 +2381,7 @@ namespace openikev2 {
         // get the child sa to be deleted. if the child sa has been already deleted or it is in deleting state, OMIT deletion
         ChildSa* child_sa = this->child_sa_collection->getChildSa( spi );
         if ( child_sa == NULL || child_sa->getState() == ChildSa::CHILD_SA_DELETING ) {
-            Log::writeLockedMessage( this->getLogId(), "Warning: IPSec SA=" + Printable::toHexString( &spi, 4 ) + " already deleted.", Log::LOG_WARN, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Warning: IPSec SA=" + Printable::toHexString( &spi, 4 ) + " already deleted.", Log::LOG_WARN, true );
             return IKE_SA_ACTION_CONTINUE;
         }
 
@@ -2345,7 +2397,7 @@ namespace openikev2 {
         this->sendMessage( message, "Send: DELETE_CHILD_SA request" );
 
         // deletes the inbound IPsec SA
-        Log::writeLockedMessage( this->getLogId(), "Deleting IPSEC SA=" + child_sa->getId() ->toString(), Log::LOG_IPSC, true );
+        LOG_LOCKED_MESSAGE( this->getLogId(), "Deleting IPSEC SA=" + child_sa->getId() ->toString(), Log::LOG_IPSC, true );
         IpsecController::deleteIpsecSa( this->peer_addr->getIpAddress(), this->my_addr->getIpAddress(), child_sa->ipsec_protocol, child_sa->inbound_spi );
 
         // updates IKE_SA and CHILD_SA states
@@ -2359,7 +2411,7 @@ namespace openikev2 {
     IkeSa::IKE_SA_ACTION IkeSa::createDeleteIkeSaRequest() {
         // Check state
         if ( this->state < STATE_IKE_SA_ESTABLISHED ) {
-            Log::writeLockedMessage( this->getLogId(), "Transition error: event=[Start DELETE_IKE_SA] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Transition error: event=[Start DELETE_IKE_SA] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_ERRO, true );
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return IKE_SA_ACTION_DELETE_IKE_SA;
         }
@@ -2391,7 +2443,7 @@ namespace openikev2 {
     IkeSa::IKE_SA_ACTION IkeSa::createGenericInformationalRequest( AutoVector< Payload > payloads ) {
         // Check state
         if ( this->state < STATE_IKE_SA_ESTABLISHED ) {
-            Log::writeLockedMessage( this->getLogId(), "Transition error: event=[Start generic INFORMATIONAL] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Transition error: event=[Start generic INFORMATIONAL] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_ERRO, true );
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return IKE_SA_ACTION_DELETE_IKE_SA;
         }
@@ -2421,15 +2473,15 @@ namespace openikev2 {
     IkeSa::MESSAGE_ACTION IkeSa::processInformationalRequest( Message & message ) {
         // Check state
         if ( this->state < STATE_IKE_SA_ESTABLISHED ) {
-            Log::writeLockedMessage( this->getLogId(), "Transition error: event=[Receive INFORMATIONAL request] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Transition error: event=[Receive INFORMATIONAL request] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_ERRO, true );
             this->sendNotifyResponse( Message::INFORMATIONAL, Payload_NOTIFY::INVALID_SYNTAX );
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return MESSAGE_ACTION_DELETE_IKE_SA;
         }
 
         Log::acquire();
-        Log::writeMessage( this->getLogId(), "Recv: INFORMATIONAL request", Log::LOG_MESG, true );
-        Log::writeMessage( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
+        LOG_MESSAGE( this->getLogId(), "Recv: INFORMATIONAL request", Log::LOG_MESG, true );
+        LOG_MESSAGE( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
         Log::release();
 
         // process notification payloads (N)
@@ -2469,15 +2521,15 @@ namespace openikev2 {
             return this->processGenericInformationalResponse( message );
         }
         else {
-            Log::writeLockedMessage( this->getLogId(), "Transition error: event=[Receive INFORMATIONAL response] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_WARN, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Transition error: event=[Receive INFORMATIONAL response] state=[" + IKE_SA_STATE_STR( this->state ) + "]", Log::LOG_WARN, true );
             return MESSAGE_ACTION_OMIT;
         }
     }
 
     IkeSa::MESSAGE_ACTION IkeSa::processGenericInformationalResponse( Message & message ) {
         Log::acquire();
-        Log::writeMessage( this->getLogId(), "Recv: INFORMATIONAL response", Log::LOG_MESG, true );
-        Log::writeMessage( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
+        LOG_MESSAGE( this->getLogId(), "Recv: INFORMATIONAL response", Log::LOG_MESG, true );
+        LOG_MESSAGE( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
         Log::release();
 
         // process notification payloads (N)
@@ -2499,8 +2551,8 @@ namespace openikev2 {
 
     IkeSa::MESSAGE_ACTION IkeSa::processDeleteIkeSaResponse( Message & message ) {
         Log::acquire();
-        Log::writeMessage( this->getLogId(), "Recv: DELETE_IKE_SA response", Log::LOG_MESG, true );
-        Log::writeMessage( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
+        LOG_MESSAGE( this->getLogId(), "Recv: DELETE_IKE_SA response", Log::LOG_MESG, true );
+        LOG_MESSAGE( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
         Log::release();
 
         // process the unique delete payload
@@ -2508,7 +2560,7 @@ namespace openikev2 {
 
         // check the protocol of the delete payload
         if ( payload_del.protocol_id != Enums::PROTO_IKE ) {
-            Log::writeLockedMessage( this->getLogId(), "Warning: Invalid DELETE_IKE_SA reponse received. Protocol mismatch received=[" + Enums::PROTOCOL_ID_STR( payload_del.protocol_id ) + "]", Log::LOG_WARN, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Warning: Invalid DELETE_IKE_SA reponse received. Protocol mismatch received=[" + Enums::PROTOCOL_ID_STR( payload_del.protocol_id ) + "]", Log::LOG_WARN, true );
             return MESSAGE_ACTION_OMIT;
         }
 
@@ -2520,8 +2572,8 @@ namespace openikev2 {
 
     IkeSa::MESSAGE_ACTION IkeSa::processDeleteChildSaResponse( Message & message ) {
         Log::acquire();
-        Log::writeMessage( this->getLogId(), "Recv: DELETE_CHILD_SA response", Log::LOG_MESG, true );
-        Log::writeMessage( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
+        LOG_MESSAGE( this->getLogId(), "Recv: DELETE_CHILD_SA response", Log::LOG_MESG, true );
+        LOG_MESSAGE( this->getLogId(), message.toStringTab( 1 ), Log::LOG_MESG, false );
         Log::release();
 
         // process the unique delete payload
@@ -2530,7 +2582,7 @@ namespace openikev2 {
         if ( payload_del == NULL ) {
             // check for half-closed CHILD_SAs
             if ( this->child_sa_collection->hasHalfClosedChildSas() ) {
-                Log::writeLockedMessage( this->getLogId(), "Warning: Peer doesn't delete all the CHILD SAs. Closing IKE_SA\n", Log::LOG_WARN, true );
+                LOG_LOCKED_MESSAGE( this->getLogId(), "Warning: Peer doesn't delete all the CHILD SAs. Closing IKE_SA\n", Log::LOG_WARN, true );
                 this->pushCommand( auto_ptr<Command> ( new SendDeleteIkeSaReqCommand() ), false );
             }
 
@@ -2540,7 +2592,7 @@ namespace openikev2 {
 
         // check the SPI count == 1
         if ( payload_del->ipsec_spi_values.size() != 1 ) {
-            Log::writeLockedMessage( this->getLogId(), "Warning: Invalid DELETE_CHILD_SA reponse received. More than one SPI count=[" + intToString( payload_del->ipsec_spi_values.size() ) + "]", Log::LOG_WARN, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Warning: Invalid DELETE_CHILD_SA reponse received. More than one SPI count=[" + intToString( payload_del->ipsec_spi_values.size() ) + "]", Log::LOG_WARN, true );
             return MESSAGE_ACTION_OMIT;
         }
 
@@ -2551,17 +2603,17 @@ namespace openikev2 {
 
         // If the child sa doesn't exist
         if ( child_sa == NULL ) {
-            Log::writeLockedMessage( this->getLogId(), "Warning: Invalid DELETE_CHILD_SA response. IKE_SA doesn't control indicated spi. SPI=" + Printable::toHexString( &spi, 4 ), Log::LOG_WARN, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Warning: Invalid DELETE_CHILD_SA response. IKE_SA doesn't control indicated spi. SPI=" + Printable::toHexString( &spi, 4 ), Log::LOG_WARN, true );
             return MESSAGE_ACTION_OMIT;
         }
 
         if ( child_sa->getState() != ChildSa::CHILD_SA_DELETING ) {
-            Log::writeLockedMessage( this->getLogId(), "Warning: Invalid DELETE_CHILD_SA response. CHILD_SA not in deleting state. SPI=" + child_sa->getId()->toString( ), Log::LOG_WARN, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Warning: Invalid DELETE_CHILD_SA response. CHILD_SA not in deleting state. SPI=" + child_sa->getId()->toString( ), Log::LOG_WARN, true );
             return MESSAGE_ACTION_OMIT;
         }
 
         uint16_t count = this->child_sa_collection->size() - 1;
-        Log::writeLockedMessage( this->getLogId(), "Deleting Child SA: Count=[" + intToString( count ) + "]", Log::LOG_INFO, true );
+        LOG_LOCKED_MESSAGE( this->getLogId(), "Deleting Child SA: Count=[" + intToString( count ) + "]", Log::LOG_INFO, true );
         EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventChildSa( BusEventChildSa::CHILD_SA_DELETED, *this, *child_sa, &count ) ) );
         this->child_sa_collection->deleteChildSa( child_sa->inbound_spi );
 
@@ -2640,13 +2692,13 @@ namespace openikev2 {
 
                     // If this IKE_SA doesn't controlls the CHILD_SA, then omit
                     if ( child_sa == NULL ) {
-                        Log::writeLockedMessage( this->getLogId(), "Warning: Invalid delete in request. Omitting", Log::LOG_WARN, true );
+                        LOG_LOCKED_MESSAGE( this->getLogId(), "Warning: Invalid delete in request. Omitting", Log::LOG_WARN, true );
                         continue;
                     }
 
                     // If the CHILD_SA doesn't match the payload_del protocol
                     if ( child_sa->ipsec_protocol != received_payload_del.protocol_id ) {
-                        Log::writeLockedMessage( this->getLogId(), "Warning: Invalid child_sa protocol. Omitting", Log::LOG_WARN, true );
+                        LOG_LOCKED_MESSAGE( this->getLogId(), "Warning: Invalid child_sa protocol. Omitting", Log::LOG_WARN, true );
                         continue;
                     }
 
@@ -2658,7 +2710,7 @@ namespace openikev2 {
                     }
 
                     // Deletes the outbound IPSec_SA
-                    Log::writeLockedMessage( this->getLogId(), "Deleting IPSEC SA=" + child_sa->getId() ->toString(), Log::LOG_IPSC, true );
+                    LOG_LOCKED_MESSAGE( this->getLogId(), "Deleting IPSEC SA=" + child_sa->getId() ->toString(), Log::LOG_IPSC, true );
                     IpsecController::deleteIpsecSa( this->my_addr->getIpAddress(), this->peer_addr->getIpAddress(), child_sa->ipsec_protocol, spi );
 
                     // If we are not already deleting this CHILD_SA, then add a delete payload for the inbound spi to the response
@@ -2672,7 +2724,7 @@ namespace openikev2 {
                     }
 
                     uint16_t count =  this->child_sa_collection->size() - 1;
-                    Log::writeLockedMessage( this->getLogId(), "Deleting Child SA: Count=[" + intToString( count ) + "]", Log::LOG_INFO, true );
+                    LOG_LOCKED_MESSAGE( this->getLogId(), "Deleting Child SA: Count=[" + intToString( count ) + "]", Log::LOG_INFO, true );
                     EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventChildSa( BusEventChildSa::CHILD_SA_DELETED, *this, *child_sa, &count ) ) ) ;
                     this->child_sa_collection->deleteChildSa( child_sa->inbound_spi );
                 }
@@ -2728,16 +2780,29 @@ namespace openikev2 {
         if ( !this->checkPeerIkeSpi( message ) || !this->checkMessageId( message ) )
             return IKE_SA_ACTION_CONTINUE;
 
-        // Check if the received message is an INVALID_IKE_SPI notify
-        if ( message.getFirstNotifyByType( Payload_NOTIFY::INVALID_IKE_SPI ) != NULL ) {
-            // Log response and omit it
-            Log::writeLockedMessage( this->getLogId(), "Peer sent INVALID_IKE_SPI message", Log::LOG_WARN, true );
+        // Check if the received message is an INVALID_IKE_SPI notify. The message is not authenticated yet, so a malformed one is just omitted
+        try {
+            if ( message.getFirstNotifyByType( Payload_NOTIFY::INVALID_IKE_SPI ) != NULL ) {
+                // Log response and omit it
+                LOG_LOCKED_MESSAGE( this->getLogId(), "Peer sent INVALID_IKE_SPI message", Log::LOG_WARN, true );
+                return IKE_SA_ACTION_CONTINUE;
+            }
+        }
+        catch ( ParsingException & ex ) {
+            LOG_LOCKED_MESSAGE( this->getLogId(), ex.what() , Log::LOG_ERRO, true );
+            return IKE_SA_ACTION_CONTINUE;
+        }
+
+        // A byte-identical copy of the last processed request is answered with the last response, without any crypto operation
+        if ( message.message_type == Message::REQUEST && message.message_id == this->peer_message_id - 1 &&
+                this->last_received_request.get() != NULL && *this->last_received_request == message.getBinaryRepresentation( NULL ) ) {
+            this->retransmitLastResponse();
             return IKE_SA_ACTION_CONTINUE;
         }
 
         // If integrity check fails, then omits message and log event
         if ( !message.checkIntegrity( this->receive_cipher.get() ) ) {
-            Log::writeLockedMessage( this->getLogId(), "Integrity check failed", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Integrity check failed", Log::LOG_ERRO, true );
             return IKE_SA_ACTION_CONTINUE;
         }
 
@@ -2748,12 +2813,18 @@ namespace openikev2 {
             return IKE_SA_ACTION_CONTINUE;
         }
 
-        // Generetes the payloads objects
+        // Keeps the wire bytes of the request, since its processing can modify the message
+        auto_ptr<ByteArray> request_data ( NULL );
+        if ( message.message_type == Message::REQUEST )
+            request_data = message.getBinaryRepresentation( NULL ).clone();
+
+        // Generetes the payloads objects. All of them are decoded here, so the processing below never finds a malformed one
         try {
             message.decryptPayloadSK( this->receive_cipher.get() );
+            message.decodeAllPayloads();
         }
         catch ( UnknownPayloadException & ex ) {
-            Log::writeLockedMessage( this->getLogId(), ex.what() , Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), ex.what() , Log::LOG_ERRO, true );
             if ( message.message_type == Message::RESPONSE ) {
                 // At this point is needed that peer_spi is initialized
                 this->peer_spi = message.spi_i;
@@ -2769,7 +2840,7 @@ namespace openikev2 {
             return IKE_SA_ACTION_CONTINUE;
         }
         catch ( ParsingException & ex ) {
-            Log::writeLockedMessage( this->getLogId(), ex.what() , Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), ex.what() , Log::LOG_ERRO, true );
             if ( message.message_type == Message::REQUEST )
                 this->sendNotifyResponse( message.exchange_type, Payload_NOTIFY::INVALID_SYNTAX );
 
@@ -2789,7 +2860,7 @@ namespace openikev2 {
             if ( this->mobility ) {
                 Payload_NOTIFY* payload_notify = ( Payload_NOTIFY* ) message.getFirstPayloadByType( Payload::PAYLOAD_NOTIFY );
 
-                auto_ptr<GeneralConfiguration> general_conf = Configuration::getInstance().getGeneralConfiguration();
+                shared_ptr<const GeneralConfiguration> general_conf = Configuration::getInstance().getGeneralConfiguration();
 
                 /*auto_ptr<SocketAddress> hoa (NULL);
                 StringAttribute* string_attr = general_conf->attributemap->getAttribute<StringAttribute>( "home_address" );
@@ -2800,28 +2871,28 @@ namespace openikev2 {
 
 
                 if (( message.exchange_type == Message::CREATE_CHILD_SA ) && (payload_notify!=NULL) ){
-                    Log::writeLockedMessage( "NetworkController", "Mobility: Changing CoA to HoA in received message in a second chance.", Log::LOG_WARN, true );
+                    LOG_LOCKED_MESSAGE( "NetworkController", "Mobility: Changing CoA to HoA in received message in a second chance.", Log::LOG_WARN, true );
                     if ( ! this->is_ha ){
-                        Log::writeLockedMessage( "NetworkController", "Mobility: Let's Changing CoA to HoA in MR .", Log::LOG_WARN, true );
+                        LOG_LOCKED_MESSAGE( "NetworkController", "Mobility: Let's Changing CoA to HoA in MR .", Log::LOG_WARN, true );
                         this->care_of_address = message.dst_addr->clone();
-                        Log::writeLockedMessage( "NetworkController", "Mobility: ------- .", Log::LOG_WARN, true );
+                        LOG_LOCKED_MESSAGE( "NetworkController", "Mobility: ------- .", Log::LOG_WARN, true );
 
                         message.dst_addr = this->home_address->clone();
-                        Log::writeLockedMessage( "NetworkController", "Mobility: CoA to HoA in MR  changed.", Log::LOG_WARN, true );
+                        LOG_LOCKED_MESSAGE( "NetworkController", "Mobility: CoA to HoA in MR  changed.", Log::LOG_WARN, true );
                     }
                     else {
-                        Log::writeLockedMessage( "NetworkController", "Mobility: Let's Changing CoA to HoA in HA .", Log::LOG_WARN, true );
+                        LOG_LOCKED_MESSAGE( "NetworkController", "Mobility: Let's Changing CoA to HoA in HA .", Log::LOG_WARN, true );
                         this->care_of_address = message.src_addr->clone();
-                        Log::writeLockedMessage( "NetworkController", "Mobility: ------- .", Log::LOG_WARN, true );
-                        Log::writeLockedMessage( "NetworkController", "CoA: ." + this->care_of_address->toStringTab(0), Log::LOG_WARN, true );
+                        LOG_LOCKED_MESSAGE( "NetworkController", "Mobility: ------- .", Log::LOG_WARN, true );
+                        LOG_LOCKED_MESSAGE( "NetworkController", "CoA: ." + this->care_of_address->toStringTab(0), Log::LOG_WARN, true );
 
                         message.src_addr = this->home_address->clone();
-                        Log::writeLockedMessage( "NetworkController", "Mobility: CoA to HoA in MR  changed.", Log::LOG_WARN, true );
-                        Log::writeLockedMessage( "NetworkController", "Source: ." + message.src_addr->toStringTab(0), Log::LOG_WARN, true );
+                        LOG_LOCKED_MESSAGE( "NetworkController", "Mobility: CoA to HoA in MR  changed.", Log::LOG_WARN, true );
+                        LOG_LOCKED_MESSAGE( "NetworkController", "Source: ." + message.src_addr->toStringTab(0), Log::LOG_WARN, true );
                     }
                 }
                 else {
-                   Log::writeLockedMessage( "NetworkController", "Mobility: NOT CHANGING CoA for HoA in a second chance.", Log::LOG_WARN, true );
+                   LOG_LOCKED_MESSAGE( "NetworkController", "Mobility: NOT CHANGING CoA for HoA in a second chance.", Log::LOG_WARN, true );
                 }
             }
 
@@ -2862,6 +2933,12 @@ namespace openikev2 {
             if ( action == MESSAGE_ACTION_OMIT )
                 return IKE_SA_ACTION_CONTINUE;
 
+            // If ACTION is PENDING, the request is committed when its CryptoJob is completed
+            else if ( action == MESSAGE_ACTION_PENDING ) {
+                this->pending_request = request_data;
+                return IKE_SA_ACTION_CONTINUE;
+            }
+
             // else if action is close IKE_SA, then return and deletes the IKE_SA
             else if ( action == MESSAGE_ACTION_DELETE_IKE_SA )
         		return IKE_SA_ACTION_DELETE_IKE_SA;
@@ -2879,18 +2956,20 @@ namespace openikev2 {
                 this->remaining_timeout_retries = this->getIkeSaConfiguration().ike_max_exchange_retransmitions;
             }
             // If we are responders
-            else
+            else {
                 this->peer_message_id++;
+                this->last_received_request = request_data;
+            }
             return IKE_SA_ACTION_CONTINUE;
         }
         catch ( Exception & ex ) {
             // If message is a response, then
             if ( message.message_type == Message::RESPONSE ) {
-                Log::writeLockedMessage( this->getLogId(), "GENERIC FAILURE: " + string( ex.what() ), Log::LOG_ERRO, true );
+                LOG_LOCKED_MESSAGE( this->getLogId(), "GENERIC FAILURE: " + string( ex.what() ), Log::LOG_ERRO, true );
             }
             // Else if message is a request, then
             else if ( message.message_type == Message::REQUEST ) {
-                Log::writeLockedMessage( this->getLogId(), "GENERIC FAILURE: " + string( ex.what() ), Log::LOG_ERRO, true );
+                LOG_LOCKED_MESSAGE( this->getLogId(), "GENERIC FAILURE: " + string( ex.what() ), Log::LOG_ERRO, true );
                 this->sendNotifyResponse( message.exchange_type, Payload_NOTIFY::INVALID_SYNTAX );
             }
 
@@ -2902,7 +2981,7 @@ namespace openikev2 {
     IkeSa::IKE_SA_ACTION IkeSa::retransmitLastRequest() {
         // If timeout retries count is exceded, finalices IkeSa execution
         if ( this->remaining_timeout_retries == 0 ) {
-            Log::writeLockedMessage( this->getLogId(), "Timeout retries exceeded", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Timeout retries exceeded", Log::LOG_ERRO, true );
             EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
             return IKE_SA_ACTION_DELETE_IKE_SA;
         }
@@ -2911,22 +2990,25 @@ namespace openikev2 {
         this->remaining_timeout_retries--;
 
         // Retransmit request
-        NetworkController::sendMessage( *this->last_sent_request, this->send_cipher.get() );
+        NetworkController::retransmitMessage( *this->last_sent_request );
 
         // Resets retransmition alarm
         this->retransmition_alarm->setTime( this->retransmition_alarm->getTotalTime() + this->getIkeSaConfiguration().retransmition_factor * 1000 );
         this->retransmition_alarm->reset();
 
-        Log::writeLockedMessage( this->getLogId(), "Retr: Last request. Next retransmition in=[" + intToString( this->retransmition_alarm->getTotalTime() / 1000 ) + "] seconds", Log::LOG_INFO, true );
+        LOG_LOCKED_MESSAGE( this->getLogId(), "Retr: Last request. Next retransmition in=[" + intToString( this->retransmition_alarm->getTotalTime() / 1000 ) + "] seconds", Log::LOG_INFO, true );
 
         return IKE_SA_ACTION_CONTINUE;
     }
 
     void IkeSa::retransmitLastResponse() {
+        if ( this->last_sent_response.get() == NULL )
+            return;
+
         // Retransmit last response
-        NetworkController::sendMessage( *this->last_sent_response, this->send_cipher.get() );
+        NetworkController::retransmitMessage( *this->last_sent_response );
 
-        Log::writeLockedMessage( this->getLogId(), "Retr: Last response", Log::LOG_INFO, true );
+        LOG_LOCKED_MESSAGE( this->getLogId(), "Retr: Last response", Log::LOG_INFO, true );
     }
 
     void IkeSa::inheritIkeSaStatus( IkeSa & other ) {
@@ -2935,36 +3017,32 @@ namespace openikev2 {
 
         // Inherits all child sas
         this->child_sa_collection = other.child_sa_collection;
-        other.child_sa_collection.reset ( new ChildSaCollection() );
+        this->child_sa_collection->setIkeSaSpi( this->my_spi );
+        other.child_sa_collection.reset ( new ChildSaCollection( other.my_spi ) );
 
         Log::acquire();
-        Log::writeMessage( this->getLogId(), "Inherit Child SAs from SPI=" + Printable::toHexString( &other.my_spi, 8 ), Log::LOG_INFO, true );
-        Log::writeMessage( this->getLogId(), this->child_sa_collection->toStringTab( 1 ), Log::LOG_INFO, false );
+        LOG_MESSAGE( this->getLogId(), "Inherit Child SAs from SPI=" + Printable::toHexString( &other.my_spi, 8 ), Log::LOG_INFO, true );
+        LOG_MESSAGE( this->getLogId(), this->child_sa_collection->toStringTab( 1 ), Log::LOG_INFO, false );
         Log::release();
 
         // Inherits the attributeMap //
         this->attributemap->inherit( *other.attributemap );
 
         // Inherits the CHILD_SA related commands (NEW, REKEY or DELETE) //
-        // From the Command Queue
-        deque<Command*>::iterator it_command_queue = other.command_queue.begin();
-        while ( it_command_queue != other.command_queue.end() ) {
-            Command * command = *it_command_queue;
-            if ( command->isInheritable() ) {
-                Log::writeMessage( this->getLogId(), "Inherit Command from SPI=" + Printable::toHexString( &other.my_spi, 8 ) + " Command=[" + command->getCommandName() + "]", Log::LOG_INFO, true );
-                it_command_queue = other.command_queue.erase( it_command_queue );
-                this->command_queue.push_back( command );
-            }
-            else
-                it_command_queue++;
+        // From the Command Queue. This runs in the thread processing the other IKE_SA commands, so it can pop them
+        AutoVector<Command> inherited_commands = other.command_queue->popInheritable();
+        for ( vector<Command*>::iterator it = inherited_commands->begin(); it != inherited_commands->end(); it++ ) {
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Inherit Command from SPI=" + Printable::toHexString( &other.my_spi, 8 ) + " Command=[" + ( *it )->getCommandName() + "]", Log::LOG_INFO, true );
+            this->pushCommand( auto_ptr<Command> ( *it ), false );
         }
+        inherited_commands->clear();
 
         // From the Deferred Command Queue
         deque<Command*>::iterator it_deferred_command_queue = other.deferred_queue.begin();
         while ( it_deferred_command_queue != other.deferred_queue.end() ) {
             Command * command = *it_deferred_command_queue;
             if ( command->isInheritable() ) {
-                Log::writeMessage( this->getLogId(), "Inherit Deferred Command from SPI=" + Printable::toHexString( &other.my_spi, 8 ) + " Command=[" + command->getCommandName() + "]", Log::LOG_INFO, true );
+                LOG_MESSAGE( this->getLogId(), "Inherit Deferred Command from SPI=" + Printable::toHexString( &other.my_spi, 8 ) + " Command=[" + command->getCommandName() + "]", Log::LOG_INFO, true );
                 it_deferred_command_queue = other.deferred_queue.erase( it_deferred_command_queue );
                 this->deferred_queue.push_back( command );
             }
@@ -2982,12 +3060,12 @@ namespace openikev2 {
     }
 
     IkeSa::IKE_SA_ACTION IkeSa::processAlarm( Alarm& alarm ) {
-        Log::writeLockedMessage( this->getLogId(), "AlarmController notifies IKE_SA: Alarm id=" + alarm.getLogId(), Log::LOG_ALRM, true );
+        LOG_LOCKED_MESSAGE( this->getLogId(), "AlarmController notifies IKE_SA: Alarm id=" + alarm.getLogId(), Log::LOG_ALRM, true );
 
         // If notification is from halfopen alarm, then if IKE_SA is not created close IKE_SA
         if ( &alarm == this->halfopen_alarm.get() ) {
             if ( this->state < STATE_IKE_SA_ESTABLISHED ) {
-                Log::writeLockedMessage( this->getLogId(), "IKE SA creation timeout", Log::LOG_INFO, true );
+                LOG_LOCKED_MESSAGE( this->getLogId(), "IKE SA creation timeout", Log::LOG_INFO, true );
                 EventBus::getInstance().sendBusEvent( auto_ptr<BusEvent> ( new BusEventIkeSa( BusEventIkeSa::IKE_SA_FAILED, *this ) ) );
                 return IKE_SA_ACTION_DELETE_IKE_SA;
             }
@@ -3002,7 +3080,7 @@ namespace openikev2 {
         // If notification is from IDLE alarm, then start Dead Peer Detection
         else if ( &alarm == this->idle_ike_sa_alarm.get() ) {
             if ( this->state >= STATE_IKE_SA_ESTABLISHED ) {
-                Log::writeLockedMessage( this->getLogId(), "Starting Dead Peer Detection", Log::LOG_INFO, true );
+                LOG_LOCKED_MESSAGE( this->getLogId(), "Starting Dead Peer Detection", Log::LOG_INFO, true );
                 AutoVector<Payload> payloads;
                 return this->createGenericInformationalRequest( payloads );
             }
@@ -3020,9 +3098,9 @@ namespace openikev2 {
     }
 
     bool IkeSa::hasMoreCommands() {
-        AutoLock auto_lock( *this->mutex );
-
-        if ( this->command_queue.size() > 0 || ( this->state == STATE_IKE_SA_ESTABLISHED && !this->deferred_queue.empty() ) )
+        if ( !this->command_queue->isEmpty() || ( this->state == STATE_IKE_SA_ESTABLISHED && !this->deferred_queue.empty() ) )
+            return true;
+        else if ( !this->isWaitingForCryptoJob() && !this->parked_queue.empty() )
             return true;
         else
             return false;
@@ -3086,14 +3164,14 @@ namespace openikev2 {
         // check if responder choose only one of the proposals
         Payload_SA& payload_sa = ( Payload_SA& ) message.getUniquePayloadByType( Payload::PAYLOAD_SA );
         if ( payload_sa.proposals->size() != 1 ) {
-            Log::writeLockedMessage( this->my_creating_child_sa->getLogId(), "IPSEC Proposal error: RESPONDER CHOOSE INVALID NUMBER OF IPSEC PROPOSALS:" + intToString( payload_sa.proposals->size() ), Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->my_creating_child_sa->getLogId(), "IPSEC Proposal error: RESPONDER CHOOSE INVALID NUMBER OF IPSEC PROPOSALS:" + intToString( payload_sa.proposals->size() ), Log::LOG_ERRO, true );
             return NEGOTIATION_ACTION_ERROR;
         }
 
         // checks if response proposal is valid
         auto_ptr<Proposal> best_proposal = CryptoController::chooseProposal( payload_sa, this->my_creating_child_sa->getProposal() );
         if ( best_proposal.get() == NULL ) {
-            Log::writeLockedMessage( this->my_creating_child_sa->getLogId(), "IPSEC Proposal error: RESPONDER CHOOSE INVALID IPSEC PROPOSAL", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->my_creating_child_sa->getLogId(), "IPSEC Proposal error: RESPONDER CHOOSE INVALID IPSEC PROPOSAL", Log::LOG_ERRO, true );
             return NEGOTIATION_ACTION_ERROR;
         }
 
@@ -3114,13 +3192,13 @@ namespace openikev2 {
             if ( this->my_creating_child_sa->pfs_dh.get() ) {
                 // If Payload KE doesn't exists
                 if ( payload_ke == NULL ) {
-                    Log::writeLockedMessage( this->my_creating_child_sa->getLogId(), "PFS PAYLOAD_KE required", Log::LOG_ERRO, true );
+                    LOG_LOCKED_MESSAGE( this->my_creating_child_sa->getLogId(), "PFS PAYLOAD_KE required", Log::LOG_ERRO, true );
                     return NEGOTIATION_ACTION_ERROR;
                 }
 
                 // checks the Payload_KE groups
                 if ( payload_ke->group != this->my_creating_child_sa->pfs_dh->group_id ) {
-                    Log::writeLockedMessage( this->my_creating_child_sa->getLogId(), "PFS DH groups differs", Log::LOG_ERRO, true );
+                    LOG_LOCKED_MESSAGE( this->my_creating_child_sa->getLogId(), "PFS DH groups differs", Log::LOG_ERRO, true );
                     return NEGOTIATION_ACTION_ERROR;
                 }
 
@@ -3129,8 +3207,8 @@ namespace openikev2 {
 
                 // Prints in log the DH shared secret
                 Log::acquire();
-                Log::writeMessage( this->getLogId(), "New shared secret (PFS)", Log::LOG_CRYP, true );
-                Log::writeMessage( this->getLogId(), this->my_creating_child_sa->pfs_dh->getSharedSecret().toStringTab( 1 ), Log::LOG_CRYP, false );
+                LOG_MESSAGE( this->getLogId(), "New shared secret (PFS)", Log::LOG_CRYP, true );
+                LOG_MESSAGE( this->getLogId(), this->my_creating_child_sa->pfs_dh->getSharedSecret().toStringTab( 1 ), Log::LOG_CRYP, false );
                 Log::release();
             }
         }
@@ -3146,7 +3224,7 @@ namespace openikev2 {
 
         // Checks if peer did a valid narrowing
         if ( !IpsecController::checkNarrowPayloadTS( payload_ts_i, payload_ts_r, *this->my_creating_child_sa ) ) {
-            Log::writeLockedMessage( this->my_creating_child_sa->getLogId(), "INVALID TRAFFIC SELECTOR NARROWING", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->my_creating_child_sa->getLogId(), "INVALID TRAFFIC SELECTOR NARROWING", Log::LOG_ERRO, true );
             return NEGOTIATION_ACTION_ERROR;
         }
 
@@ -3157,8 +3235,8 @@ namespace openikev2 {
         this->my_creating_child_sa->keyring->generateChildSaKeys( *this->my_creating_child_sa->my_nonce, *this->my_creating_child_sa->peer_nonce, *this->key_ring->sk_d, shared_secret );
 
         Log::acquire();
-        Log::writeMessage( this->getLogId(), "New IPSEC keying material", Log::LOG_CRYP, true );
-        Log::writeMessage( this->getLogId(), this->my_creating_child_sa->keyring->toStringTab( 1 ), Log::LOG_CRYP, false );
+        LOG_MESSAGE( this->getLogId(), "New IPSEC keying material", Log::LOG_CRYP, true );
+        LOG_MESSAGE( this->getLogId(), this->my_creating_child_sa->keyring->toStringTab( 1 ), Log::LOG_CRYP, false );
         Log::release();
 
         return NEGOTIATION_ACTION_CONTINUE;
@@ -3177,20 +3255,14 @@ namespace openikev2 {
 	// process Notify Payloads to see if transport mode is used
 
 
-	auto_ptr<GeneralConfiguration> general_conf = Configuration::getInstance().getGeneralConfiguration();
+	shared_ptr<const GeneralConfiguration> general_conf = Configuration::getInstance().getGeneralConfiguration();
 
-    	BoolAttribute* mobility_attr = general_conf->attributemap->getAttribute<BoolAttribute>( "mobility" );
-    	bool mobility = false;
+    	bool mobility = general_conf->mobility;
 
-        BoolAttribute* is_ha_attr = general_conf->attributemap->getAttribute<BoolAttribute>( "is_ha" );
-        bool is_ha = false;
-        if (is_ha_attr  != NULL )
-		is_ha = is_ha_attr->value;
+        bool is_ha = general_conf->is_ha;
 
 
 	auto_ptr<SocketAddress>	coa (NULL);
-        if (mobility_attr  != NULL )
-		mobility = mobility_attr->value;
 
     	if ( mobility ) {
 
@@ -3203,8 +3275,8 @@ namespace openikev2 {
 
 
 			if (!((message.exchange_type == Message::CREATE_CHILD_SA)&&(payload_notify==NULL))){
-				Log::writeLockedMessage( "NetworkController", "Mobility: Changing CoA to HoA in received message.", Log::LOG_WARN, true );
-				Log::writeLockedMessage( "NetworkController", "Mobility: TRANSPORT MODE.", Log::LOG_WARN, true );
+				LOG_LOCKED_MESSAGE( "NetworkController", "Mobility: Changing CoA to HoA in received message.", Log::LOG_WARN, true );
+				LOG_LOCKED_MESSAGE( "NetworkController", "Mobility: TRANSPORT MODE.", Log::LOG_WARN, true );
 				if ( is_ha ){
 				       coa = message.dst_addr->clone();
 				       message.dst_addr = this->home_address->clone();			                        }
@@ -3226,7 +3298,7 @@ namespace openikev2 {
         // process configuration payload (CP)
         IkeSa::NEGOTIATION_ACTION negotiation_action = NetworkController::processConfigurationRequest( message, *this );
         if ( negotiation_action == NEGOTIATION_ACTION_ERROR ) {
-            Log::writeLockedMessage( this->peer_creating_child_sa->getLogId(), "INTERNAL ADDRESS FAILURE", Log::LOG_ERRO, true  );
+            LOG_LOCKED_MESSAGE( this->peer_creating_child_sa->getLogId(), "INTERNAL ADDRESS FAILURE", Log::LOG_ERRO, true  );
             this->sendNotifyResponse( message.exchange_type, Payload_NOTIFY::INTERNAL_ADDRESS_FAILURE );
             return negotiation_action;
         }
@@ -3237,12 +3309,14 @@ namespace openikev2 {
         if ( message.exchange_type == Message::IKE_AUTH )
 	            this->peer_creating_child_sa->getProposal().deleteTransformsByType( Enums::D_H );
 
-        // Generate the intersection between my ipsec proposal and the initiator ipsec proposal
-        auto_ptr<Proposal> best_proposal = CryptoController::chooseProposal( payload_sa, this->peer_creating_child_sa->getProposal() );
+        // Generate the intersection between my ipsec proposal and the initiator ipsec proposal, keeping the PFS group of its KE payload if acceptable
+        Payload_KE* received_payload_ke = ( Payload_KE* ) message.getFirstPayloadByType( Payload::PAYLOAD_KE );
+        Enums::DH_ID received_group = ( received_payload_ke != NULL ) ? received_payload_ke->group : Enums::DH_NONE;
+        auto_ptr<Proposal> best_proposal = CryptoController::chooseProposal( payload_sa, this->peer_creating_child_sa->getProposal(), received_group );
 
         // If no proposal chosen, then send notify payloads
         if ( best_proposal.get() == NULL ) {
-            Log::writeLockedMessage( this->peer_creating_child_sa->getLogId(), "NO PROPOSAL CHOSEN(IPSEC)", Log::LOG_ERRO, true  );
+            LOG_LOCKED_MESSAGE( this->peer_creating_child_sa->getLogId(), "NO PROPOSAL CHOSEN(IPSEC)", Log::LOG_ERRO, true  );
             this->sendNotifyResponse( message.exchange_type, Payload_NOTIFY::NO_PROPOSAL_CHOSEN );
             return NEGOTIATION_ACTION_ERROR;
         }
@@ -3267,7 +3341,7 @@ namespace openikev2 {
             Transform *dh_transform = this->peer_creating_child_sa->getProposal().getFirstTransformByType( Enums::D_H );
             if ( dh_transform != NULL ) {
                 if ( payload_ke == NULL ) {
-                    Log::writeLockedMessage( this->peer_creating_child_sa->getLogId(), "Proposal error: DH specified but no PAYLOAD_KE present", Log::LOG_ERRO, true );
+                    LOG_LOCKED_MESSAGE( this->peer_creating_child_sa->getLogId(), "Proposal error: DH specified but no PAYLOAD_KE present", Log::LOG_ERRO, true );
                     this->sendNotifyResponse( Message::CREATE_CHILD_SA, Payload_NOTIFY::NO_PROPOSAL_CHOSEN );
                     return NEGOTIATION_ACTION_ERROR;
                 }
@@ -3277,7 +3351,7 @@ namespace openikev2 {
                     auto_ptr<ByteBuffer> temp ( new ByteBuffer( 2 ) );
                     temp->writeInt16( dh_transform->id );
                     auto_ptr<Payload_NOTIFY> notify ( new Payload_NOTIFY( Payload_NOTIFY::INVALID_KE_PAYLOAD, Enums::PROTO_NONE, auto_ptr<ByteArray> ( NULL ), auto_ptr<ByteArray> ( temp ) ) );
-                    Log::writeLockedMessage( this->peer_creating_child_sa->getLogId(), "INVALID KE PAYLOAD(PFS)", Log::LOG_ERRO, true );
+                    LOG_LOCKED_MESSAGE( this->peer_creating_child_sa->getLogId(), "INVALID KE PAYLOAD(PFS)", Log::LOG_ERRO, true );
                     this->sendNotifyResponse( Message::CREATE_CHILD_SA, notify );
                     return NEGOTIATION_ACTION_ERROR;
                 }
@@ -3290,8 +3364,8 @@ namespace openikev2 {
 
                 // Print in log the shared secret
                 Log::acquire();
-                Log::writeMessage( this->getLogId(), "New shared secret(PFS)", Log::LOG_CRYP, true );
-                Log::writeMessage( this->getLogId(), this->peer_creating_child_sa->pfs_dh->getSharedSecret().toStringTab( 1 ), Log::LOG_CRYP, false );
+                LOG_MESSAGE( this->getLogId(), "New shared secret(PFS)", Log::LOG_CRYP, true );
+                LOG_MESSAGE( this->getLogId(), this->peer_creating_child_sa->pfs_dh->getSharedSecret().toStringTab( 1 ), Log::LOG_CRYP, false );
                 Log::release();
             }
         }
@@ -3308,7 +3382,7 @@ namespace openikev2 {
         // Check if suggested traffic selectors are acceptables and select the narrowest
         bool result = IpsecController::narrowPayloadTS( payload_ts_i, payload_ts_r, *this, *this->peer_creating_child_sa );
         if ( !result ) {
-            Log::writeLockedMessage( this->peer_creating_child_sa->getLogId(), "TS_UNACCEPTABLE", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->peer_creating_child_sa->getLogId(), "TS_UNACCEPTABLE", Log::LOG_ERRO, true );
             this->sendNotifyResponse( message.exchange_type, Payload_NOTIFY::TS_UNACCEPTABLE );
             return NEGOTIATION_ACTION_ERROR;
         }
@@ -3358,8 +3432,8 @@ namespace openikev2 {
         this->peer_creating_child_sa->keyring->generateChildSaKeys( *this->peer_creating_child_sa->peer_nonce, *this->peer_creating_child_sa->my_nonce, *this->key_ring->sk_d, shared_secret );
 
         Log::acquire();
-        Log::writeMessage( this->getLogId(), "New IPSEC keying material", Log::LOG_CRYP, true );
-        Log::writeMessage( this->getLogId(), this->peer_creating_child_sa->keyring->toStringTab( 1 ), Log::LOG_CRYP, false );
+        LOG_MESSAGE( this->getLogId(), "New IPSEC keying material", Log::LOG_CRYP, true );
+        LOG_MESSAGE( this->getLogId(), this->peer_creating_child_sa->keyring->toStringTab( 1 ), Log::LOG_CRYP, false );
         Log::release();
     }
 
@@ -3387,14 +3461,14 @@ namespace openikev2 {
         // process security association payload (SA)
         Payload_SA& payload_sa = ( Payload_SA& ) message.getUniquePayloadByType( Payload::PAYLOAD_SA );
         if ( payload_sa.proposals->size() != 1 ) {
-            Log::writeLockedMessage( this->getLogId(), "Proposal error: RESPONDER CHOOSE INVALID NUMBER OF IKE PROPOSALS", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Proposal error: RESPONDER CHOOSE INVALID NUMBER OF IKE PROPOSALS", Log::LOG_ERRO, true );
             return NEGOTIATION_ACTION_ERROR;
         }
 
         // Checks if response proposal is valid (subset of initiator proposals)
         auto_ptr<Proposal> best_proposal = CryptoController::chooseProposal( payload_sa, ike_sa.getProposal() );
         if ( best_proposal.get() == NULL ) {
-            Log::writeLockedMessage( this->getLogId(), "Proposal error: RESPONDER CHOOSE INVALID IKE PROPOSAL", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Proposal error: RESPONDER CHOOSE INVALID IKE PROPOSAL", Log::LOG_ERRO, true );
             return NEGOTIATION_ACTION_ERROR;
         }
 
@@ -3414,7 +3488,7 @@ namespace openikev2 {
         Payload_KE& payload_ke = ( Payload_KE& ) message.getUniquePayloadByType( Payload::PAYLOAD_KE );
         // Check if DH groups match
         if ( payload_ke.group != ike_sa.dh->group_id ) {
-            Log::writeLockedMessage( this->getLogId(), "Invalid DH group received: Received a not proposed DH group", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "Invalid DH group received: Received a not proposed DH group", Log::LOG_ERRO, true );
             return NEGOTIATION_ACTION_ERROR;
         }
 
@@ -3423,8 +3497,8 @@ namespace openikev2 {
 
         // Prints in log the DH shared secret
         Log::acquire();
-        Log::writeMessage( ike_sa.getLogId(), "New shared secret", Log::LOG_CRYP, true );
-        Log::writeMessage( ike_sa.getLogId(), ike_sa.dh->getSharedSecret().toStringTab( 1 ), Log::LOG_CRYP, false );
+        LOG_MESSAGE( ike_sa.getLogId(), "New shared secret", Log::LOG_CRYP, true );
+        LOG_MESSAGE( ike_sa.getLogId(), ike_sa.dh->getSharedSecret().toStringTab( 1 ), Log::LOG_CRYP, false );
         Log::release();
 
         // process nonce payload (Nr)
@@ -3446,8 +3520,8 @@ namespace openikev2 {
             ike_sa.key_ring->generateIkeSaKeys( *ike_sa.my_nonce, *ike_sa.peer_nonce, ike_sa.my_spi, ike_sa.peer_spi, ike_sa.dh->getSharedSecret(), this->key_ring->sk_d.get() );
 
         Log::acquire();
-        Log::writeMessage( ike_sa.getLogId(), "New IKE keying material", Log::LOG_CRYP , true );
-        Log::writeMessage( ike_sa.getLogId(), ike_sa.key_ring->toStringTab( 1 ), Log::LOG_CRYP, false );
+        LOG_MESSAGE( ike_sa.getLogId(), "New IKE keying material", Log::LOG_CRYP , true );
+        LOG_MESSAGE( ike_sa.getLogId(), ike_sa.key_ring->toStringTab( 1 ), Log::LOG_CRYP, false );
         Log::release();
 
         // Creates ciphers & PRF
@@ -3457,16 +3531,19 @@ namespace openikev2 {
         return NEGOTIATION_ACTION_CONTINUE;
     }
 
-    IkeSa::NEGOTIATION_ACTION IkeSa::processIkeSaNegotiationRequest( Message & message, IkeSa & ike_sa ) {
+    IkeSa::NEGOTIATION_ACTION IkeSa::processIkeSaNegotiationRequest( Message & message, IkeSa & ike_sa, bool generate_shared_secret ) {
         // process security association payload (SA)
         Payload_SA& payload_sa = ( Payload_SA& ) message.getUniquePayloadByType( Payload::PAYLOAD_SA );
 
-        // Choose proposal
-        auto_ptr<Proposal> best_proposal = CryptoController::chooseProposal( payload_sa, ike_sa.getProposal() );
+        // process key exchange payload (KE)
+        Payload_KE& payload_ke = ( Payload_KE& ) message.getUniquePayloadByType( Payload::PAYLOAD_KE );
+
+        // Choose proposal, keeping the DH group of the KE payload if acceptable
+        auto_ptr<Proposal> best_proposal = CryptoController::chooseProposal( payload_sa, ike_sa.getProposal(), payload_ke.group );
 
         // If no proposal chosen, then send notification
         if ( best_proposal.get() == NULL ) {
-            Log::writeLockedMessage( this->getLogId(), "NO PROPOSAL CHOSEN(IKE)", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( this->getLogId(), "NO PROPOSAL CHOSEN(IKE)", Log::LOG_ERRO, true );
             this->sendNotifyResponse( message.exchange_type, Payload_NOTIFY::NO_PROPOSAL_CHOSEN );
             return NEGOTIATION_ACTION_ERROR;
         }
@@ -3478,9 +3555,6 @@ namespace openikev2 {
         if ( message.exchange_type == Message::CREATE_CHILD_SA )
             ike_sa.peer_spi = ike_sa.getProposal().getIkeSpi();
 
-        // process key exchange payload (KE)
-        Payload_KE& payload_ke = ( Payload_KE& ) message.getUniquePayloadByType( Payload::PAYLOAD_KE );
-
         // Get desired DH group
         Transform* transform = ike_sa.getProposal().getFirstTransformByType( Enums::D_H );
         assert ( transform != NULL );
@@ -3490,22 +3564,17 @@ namespace openikev2 {
             auto_ptr<ByteBuffer> temp ( new ByteBuffer( 2 ) );
             temp->writeInt16( transform->id );
             auto_ptr<Payload_NOTIFY> notify ( new Payload_NOTIFY( Payload_NOTIFY::INVALID_KE_PAYLOAD, Enums::PROTO_NONE, auto_ptr<ByteArray> ( NULL ), auto_ptr<ByteArray> ( temp ) ) );
-            Log::writeLockedMessage( ike_sa.getLogId(), "Received wrong KE payload. Sending INVALID KE PAYLOAD notification", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "Received wrong KE payload. Sending INVALID KE PAYLOAD notification", Log::LOG_ERRO, true );
             this->sendNotifyResponse( Message::IKE_SA_INIT, notify );
             return NEGOTIATION_ACTION_ERROR;
         }
 
-        // Creates the DH object
-        ike_sa.dh = CryptoController::getDiffieHellman( ( Enums::DH_ID ) transform->id );
-
-        // Generate shared secret
-        ike_sa.dh->generateSharedSecret( payload_ke.getPublicKey() );
-
-        // Prints in log the DH shared secret
-        Log::acquire();
-        Log::writeMessage( ike_sa.getLogId(), "New shared secret", Log::LOG_CRYP, true );
-        Log::writeMessage( ike_sa.getLogId(), ike_sa.dh->getSharedSecret().toStringTab( 1 ), Log::LOG_CRYP, false );
-        Log::release();
+        // Creates the DH object and generates the shared secret
+        if ( generate_shared_secret ) {
+            auto_ptr<DiffieHellman> diffie_hellman = CryptoController::getDiffieHellman( ( Enums::DH_ID ) transform->id );
+            diffie_hellman->generateSharedSecret( payload_ke.getPublicKey() );
+            this->setSharedSecret( ike_sa, diffie_hellman );
+        }
 
         // process nonce payload (Ni)
         Payload_NONCE& payload_nonce = ( Payload_NONCE& ) message.getUniquePayloadByType( Payload::PAYLOAD_NONCE );
@@ -3514,6 +3583,16 @@ namespace openikev2 {
         return NEGOTIATION_ACTION_CONTINUE;
     }
 
+    void IkeSa::setSharedSecret( IkeSa& ike_sa, auto_ptr<DiffieHellman> diffie_hellman ) {
+        ike_sa.dh = diffie_hellman;
+
+        // Prints in log the DH shared secret
+        Log::acquire();
+        LOG_MESSAGE( ike_sa.getLogId(), "New shared secret", Log::LOG_CRYP, true );
+        LOG_MESSAGE( ike_sa.getLogId(), ike_sa.dh->getSharedSecret().toStringTab( 1 ), Log::LOG_CRYP, false );
+        Log::release();
+    }
+
     void IkeSa::createIkeSaNegotiationResponse( Message & message, IkeSa & ike_sa ) {
         assert ( message.exchange_type == Message::IKE_SA_INIT || message.exchange_type == Message::CREATE_CHILD_SA );
         bool crypted = ( message.exchange_type == Message::CREATE_CHILD_SA );
@@ -3544,8 +3623,8 @@ namespace openikev2 {
             ike_sa.key_ring->generateIkeSaKeys( *ike_sa.peer_nonce, *ike_sa.my_nonce, ike_sa.peer_spi, ike_sa.my_spi, ike_sa.dh->getSharedSecret(), this->key_ring->sk_d.get() );
 
         Log::acquire();
-        Log::writeMessage( ike_sa.getLogId(), "New IKE keying material", Log::LOG_CRYP, true );
-        Log::writeMessage( ike_sa.getLogId(), ike_sa.key_ring->toStringTab( 1 ), Log::LOG_CRYP, false );
+        LOG_MESSAGE( ike_sa.getLogId(), "New IKE keying material", Log::LOG_CRYP, true );
+        LOG_MESSAGE( ike_sa.getLogId(), ike_sa.key_ring->toStringTab( 1 ), Log::LOG_CRYP, false );
         Log::release();
 
         // Creates ciphers & PRF
@@ -3565,10 +3644,13 @@ namespace openikev2 {
     void IkeSa::sendMessage( auto_ptr< Message > message, string text ) {
         // write a log message
         Log::acquire();
-        Log::writeMessage( this->getLogId(), text, Log::LOG_MESG, true );
-        Log::writeMessage( this->getLogId(), message->toStringTab( 1 ), Log::LOG_MESG, false );
+        LOG_MESSAGE( this->getLogId(), text, Log::LOG_MESG, true );
+        LOG_MESSAGE( this->getLogId(), message->toStringTab( 1 ), Log::LOG_MESG, false );
         Log::release();
 
+        // Generates the wire bytes once. They remain cached in the message for the retransmissions
+        message->getBinaryRepresentation( this->send_cipher.get() );
+
         // Sends message to the Peer
         NetworkController::sendMessage( *message, this->send_cipher.get() );
 
@@ -32,9 +32,16 @@
 #include "attributemap.h"
 #include "payload_conf.h"
 #include "childsacollection.h"
+#include "commandqueue.h"
+
+#define IKE_SA_COMMAND_QUEUE_SIZE               64      // Lock-free ring size for the commands of each IKE_SA (extra ones go to an overflow list)
+#define IKE_SA_PRIORITY_COMMAND_QUEUE_SIZE      16      // Lock-free ring size for the priority commands of each IKE_SA
 
 namespace openikev2 {
     class Command;
+    class CryptoJob;
+    class DiffieHellmanJob;
+    class AuthenticationJob;
 
     /**
         This class represents an IKE_SA Controller, that controls an IKE_SA and stores all its attributes and status.
@@ -58,10 +65,12 @@ namespace openikev2 {
                 STATE_IKE_AUTH_EAP_FINISH_REQ_SENT,             /**< IKE_AUTH exchange request has been sent with AUTH payload (EAP finish) */
 
                 // responder states
+                STATE_IKE_SA_INIT_CRYPTO_PENDING,               /**< IKE_SA_INIT exchange request is waiting for the DH shared secret */
                 STATE_IKE_SA_INIT_RES_SENT,                     /**< IKE_SA_INIT exchange response has been sent */
                 STATE_IKE_AUTH_EAP_INIT_RES_SENT,               /**< IKE_AUTH exchange response has been sent without AUTH paylaod (EAP init) */
                 STATE_IKE_AUTH_EAP_CONT_RES_SENT,               /**< IKE_AUTH exchange response has been sent with only an EAP payload (EAP coninue) */
                 STATE_IKE_AUTH_EAP_SUCCESS_RES_SENT,            /**< IKE_AUTH exchange response has been sent with AUTH payload (EAP success) */
+                STATE_IKE_AUTH_CRYPTO_PENDING,                  /**< IKE_AUTH exchange request is waiting for the AUTH payloads verification and generation */
 
                 // ESTABLISHED STATES
                 STATE_IKE_SA_ESTABLISHED,                       /**< IKE_SA is already established */
@@ -97,6 +106,7 @@ namespace openikev2 {
                 MESSAGE_ACTION_COMMIT = 0,                      /**< Continue processing message */
                 MESSAGE_ACTION_OMIT = 2,                        /**< Omit message */
                 MESSAGE_ACTION_DELETE_IKE_SA = 1,             /**< Close IKE_SA */
+                MESSAGE_ACTION_PENDING = 3,                     /**< Request waiting for a CryptoJob. It is committed when the job is completed */
             };
 
             enum IKE_SA_ACTION {
@@ -109,9 +119,11 @@ namespace openikev2 {
             /****************************** ATTRIBUTES ******************************/
         protected:
             IKE_SA_STATE state;                                     /**< IKE SA state */
-            auto_ptr<PeerConfiguration> peer_configuration;         /**< Peer configuration */
-            deque<Command*> command_queue;                          /**< Command Queue */
-            deque<Command*> deferred_queue;                         /**< Deferred Command Queue */
+            shared_ptr<const PeerConfiguration> peer_configuration; /**< Peer configuration. Shared, never modified */
+            auto_ptr<IkeSaConfiguration> ike_sa_configuration;      /**< Own copy of the IKE SA configuration, since its proposal and authenticator keep per IKE SA state */
+            auto_ptr<CommandQueue> command_queue;                   /**< Command Queue. Lock-free, any thread can push into it */
+            deque<Command*> deferred_queue;                         /**< Deferred Command Queue. Only used by the thread processing the commands */
+            deque<Command*> parked_queue;                           /**< Commands received while waiting for a CryptoJob, popped first once it is completed. Only used by the thread processing the commands */
             auto_ptr<Alarm> idle_ike_sa_alarm;                      /**< Idle IKE SA notification alarm */
             auto_ptr<Alarm> rekey_ike_sa_alarm;                     /**< Rekey IKE SA notification alarm */
             auto_ptr<Alarm> halfopen_alarm;                         /**< Alarm limiting the negotiation time of the IKE SA */
@@ -130,6 +142,8 @@ namespace openikev2 {
             auto_ptr<Message> ike_sa_init_res;                      /**< IKE_SA_INIT response message. It is stored in order to generete and check the AUTH payload */
             auto_ptr<Message> last_sent_request;                    /**< Last sent request */
             auto_ptr<Message> last_sent_response;                   /**< Last sent response */
+            auto_ptr<ByteArray> last_received_request;              /**< Wire bytes of the last processed request, to detect its retransmissions */
+            auto_ptr<ByteArray> pending_request;                    /**< Wire bytes of the request waiting for a CryptoJob */
             auto_ptr<Message> eap_init_req;                         /**< EAP INIT request message */
             uint32_t remaining_timeout_retries;                     /**< Remaining retries to send the current request */
             auto_ptr<Alarm> retransmition_alarm;                    /**< Retransmition alarm */
@@ -251,9 +265,17 @@ namespace openikev2 {
              * Process the IKE_SA negotiation payloads request
              * @param message Request Message with the needed payloads
              * @param ike_sa Negotiated IkeSa
+             * @param generate_shared_secret Indicates if the DH shared secret must be generated. Otherwise, it is set later with setSharedSecret()
              * @return Action to be performed after message processing
              */
-            NEGOTIATION_ACTION processIkeSaNegotiationRequest( Message& message, IkeSa & ike_sa );
+            NEGOTIATION_ACTION processIkeSaNegotiationRequest( Message& message, IkeSa & ike_sa, bool generate_shared_secret = true );
+
+            /**
+             * Sets the DiffieHellman object, with the shared secret already generated, of the negotiated IkeSa
+             * @param ike_sa Negotiated IkeSa
+             * @param diffie_hellman DiffieHellman object
+             */
+            void setSharedSecret( IkeSa& ike_sa, auto_ptr<DiffieHellman> diffie_hellman );
 
             /**
              * Creates the IKE_SA negotiation payloads and includes them into the response Message
@@ -292,7 +314,7 @@ namespace openikev2 {
 
             /**
              * Sends the message, writes the log output and stores it as last_sent_request or last_sent_response. If REQUEST, then also initiates the
-             * retransmition alarm
+             * retransmition alarm. The message is serialized only once, so retransmissions reuse its wire bytes
              * @param message Message to be sent
              * @param text Texto to describe what it being sent
              */
@@ -329,6 +351,19 @@ namespace openikev2 {
              */
             IKE_SA_ACTION processCommand();
 
+            /**
+             * Processes a completed CryptoJob, resuming the exchange that requested it
+             * @param job Completed CryptoJob
+             * @return The IKE_SA action to be performed after the job completion
+             */
+            IKE_SA_ACTION processCryptoJob( CryptoJob& job );
+
+            /**
+             * Indicates if the IkeSa is waiting for a CryptoJob. Meanwhile, the other commands are parked
+             * @return TRUE if the IkeSa is waiting for a CryptoJob. FALSE otherwise
+             */
+            bool isWaitingForCryptoJob() const;
+
             /**
              * Close current IkeSa.
              */
@@ -359,7 +394,8 @@ namespace openikev2 {
             virtual string getLogId();
 
             /**
-             * Pushes a new Command into the queue.
+             * Pushes a new Command into the queue. It can be called from any thread without locking.
+             * Commands are never discarded: the ones that do not fit in the lock-free ring wait in an overflow list.
              * @param command Command to be inserted into the queue.
              * @param priority If TRUE, then the command is inserted at the front. Otherwise, is inserted at the back.
              */
@@ -403,8 +439,9 @@ namespace openikev2 {
             /**
              * Creates a new IKE_AUTH response.
              * @param payloads_cert_req_i CERT REQ payloads received in the IKE_AUTH request
+             * @param payload_auth Our AUTH payload
              */
-            MESSAGE_ACTION createIkeAuthNoEapResponse( const vector<Payload_CERT_REQ*> payloads_cert_req_i );
+            MESSAGE_ACTION createIkeAuthNoEapResponse( const vector<Payload_CERT_REQ*> payloads_cert_req_i, auto_ptr<Payload_AUTH> payload_auth );
 
             /**
              * Creates a new CREATE_CHILD_SA exchange request to rekey a CHILD_SA
@@ -509,6 +546,13 @@ namespace openikev2 {
              */
             MESSAGE_ACTION processIkeSaInitRequest( Message& message );
 
+            /**
+             * Completes the processing of an IKE_SA_INIT request once the DH shared secret is generated
+             * @param job Executed DiffieHellmanJob
+             * @return Action to be performed after message processing
+             */
+            MESSAGE_ACTION completeIkeSaInitRequest( DiffieHellmanJob& job );
+
             /**
              * Process an IKE_SA_INIT response Message and performs adequated actions.
              * @param message IKE_SA_INIT response Message.
@@ -530,6 +574,13 @@ namespace openikev2 {
              */
             MESSAGE_ACTION processIkeAuthNoEapRequest( Message& message );
 
+            /**
+             * Completes the processing of an IKE_AUTH request (no EAP) once the AUTH payloads are verified and generated
+             * @param job Executed AuthenticationJob
+             * @return Action to be performed after message processing
+             */
+            MESSAGE_ACTION completeIkeAuthNoEapRequest( AuthenticationJob& job );
+
             /**
              * Process an IKE_AUTH response Message and performs adequated actions.
              * @param message IKE_AUTH response Message.
@@ -754,13 +805,13 @@ namespace openikev2 {
             void processConfigResponse( vector<Payload*> payloads_config );
 
             /**
-             * Retransmits last sent request.
+             * Retransmits last sent request, reusing its wire bytes.
              * @return Action to be performed after retransmit the last request
              */
             IKE_SA_ACTION retransmitLastRequest();
 
             /**
-             * Retransmit las sent response.
+             * Retransmit las sent response, reusing its wire bytes.
              */
             void retransmitLastResponse();
 
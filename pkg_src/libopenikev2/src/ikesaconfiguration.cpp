@@ -8,6 +8,7 @@
 ***************************************************************************/
 #include "ikesaconfiguration.h"
 #include "utils.h"
+#include "cipher.h"
 
 namespace openikev2 {
 
@@ -15,7 +16,7 @@ namespace openikev2 {
         assert( proposal.get() != NULL );
         assert( proposal->protocol_id == Enums::PROTO_IKE );
         assert( proposal->getFirstTransformByType( Enums::ENCR ) != NULL );
-        assert( proposal->getFirstTransformByType( Enums::INTEG ) != NULL );
+        assert( proposal->getFirstTransformByType( Enums::INTEG ) != NULL || Cipher::isAead( ( Enums::ENCR_ID ) proposal->getFirstTransformByType( Enums::ENCR )->id ) );
         assert( proposal->getFirstTransformByType( Enums::D_H ) != NULL );
         assert( proposal->getFirstTransformByType( Enums::PRF ) != NULL );
 
@@ -39,7 +40,7 @@ namespace openikev2 {
 
     void IkeSaConfiguration::setProposal( auto_ptr< Proposal > proposal ) {
         assert( proposal->getFirstTransformByType( Enums::ENCR ) != NULL );
-        assert( proposal->getFirstTransformByType( Enums::INTEG ) != NULL );
+        assert( proposal->getFirstTransformByType( Enums::INTEG ) != NULL || Cipher::isAead( ( Enums::ENCR_ID ) proposal->getFirstTransformByType( Enums::ENCR )->id ) );
         assert( proposal->getFirstTransformByType( Enums::D_H ) != NULL );
         assert( proposal->getFirstTransformByType( Enums::PRF ) != NULL );
 
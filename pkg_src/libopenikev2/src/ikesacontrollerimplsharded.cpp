@@ -0,0 +1,318 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by                                                 *
+ *   Alejandro Perez Mendez     alex@um.es                                 *
+ *   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+ *                                                                         *
+ *   This software may be modified and distributed under the terms         *
+ *   of the Apache license.  See the LICENSE file for details.             *
+ ***************************************************************************/
+#include "ikesacontrollerimplsharded.h"
+
+#include "command.h"
+#include "childsacollection.h"
+#include "spirouting.h"
+#include "sendikesainitreqcommand.h"
+#include "sendnewchildsareqcommand.h"
+#include "networkcontroller.h"
+#include "cryptocontroller.h"
+#include "configuration.h"
+#include "threadcontroller.h"
+#include "autolock.h"
+#include "log.h"
+#include "utils.h"
+
+namespace openikev2 {
+
+    IkeSaControllerImplSharded::IkeSaControllerImplSharded( uint16_t num_workers ) {
+        if ( num_workers == 0 )
+            num_workers = thread::hardware_concurrency();
+        if ( num_workers == 0 )
+            num_workers = 1;
+        if ( num_workers > SpiRouting::getMaxWorkers() )
+            num_workers = SpiRouting::getMaxWorkers();
+
+        this->half_open_counter = 0;
+        this->next_shard = 0;
+
+        for ( uint16_t i = 0; i < num_workers; i++ ) {
+            Shard* shard = new Shard();
+            shard->condition = ThreadController::getCondition();
+            shard->exiting = false;
+            this->shards.push_back( shard );
+        }
+
+        // Workers are started once all the shards exist, since they can push commands into any of them
+        for ( vector<Shard*>::iterator it = this->shards.begin(); it != this->shards.end(); it++ )
+            ( *it )->worker = thread( &IkeSaControllerImplSharded::runWorker, this, ref( **it ) );
+
+        LOG_LOCKED_MESSAGE( "IkeSaController", "Started workers=[" + intToString( ( uint32_t ) num_workers ) + "]", Log::LOG_THRD, true );
+    }
+
+    IkeSaControllerImplSharded::~IkeSaControllerImplSharded() {
+        // Stops all the workers
+        for ( vector<Shard*>::iterator it = this->shards.begin(); it != this->shards.end(); it++ ) {
+            AutoLock auto_lock( *( *it )->condition );
+            ( *it )->exiting = true;
+            ( *it )->condition->notify();
+        }
+
+        for ( vector<Shard*>::iterator it = this->shards.begin(); it != this->shards.end(); it++ )
+            ( *it )->worker.join();
+
+        // Deletes the remaining IKE SAs and the shards
+        for ( vector<Shard*>::iterator it = this->shards.begin(); it != this->shards.end(); it++ ) {
+            for ( map<uint64_t, IkeSaEntry>::iterator it_ike_sa = ( *it )->ike_sas.begin(); it_ike_sa != ( *it )->ike_sas.end(); it_ike_sa++ )
+                delete it_ike_sa->second.ike_sa;
+            delete ( *it );
+        }
+    }
+
+    uint16_t IkeSaControllerImplSharded::getWorkerIndex( uint64_t spi ) const {
+        // The modulo only matters for SPIs not allocated by nextSpi() with the current number of workers
+        return SpiRouting::getIkeSaSpiWorker( spi ) % this->shards.size();
+    }
+
+    IkeSaControllerImplSharded::Shard& IkeSaControllerImplSharded::getShard( uint64_t spi ) const {
+        return *this->shards[ this->getWorkerIndex( spi ) ];
+    }
+
+    void IkeSaControllerImplSharded::schedule( Shard& shard, IkeSaEntry& entry ) {
+        if ( entry.scheduled )
+            return;
+
+        entry.scheduled = true;
+        shard.ready_queue.push_back( entry.ike_sa->my_spi );
+        shard.condition->notify();
+    }
+
+    void IkeSaControllerImplSharded::runWorker( Shard& shard ) {
+        while ( true ) {
+            shard.condition->acquire();
+
+            while ( shard.ready_queue.empty() && !shard.exiting )
+                shard.condition->wait();
+
+            if ( shard.exiting ) {
+                shard.condition->release();
+                return;
+            }
+
+            uint64_t spi = shard.ready_queue.front();
+            shard.ready_queue.pop_front();
+
+            map<uint64_t, IkeSaEntry>::iterator it = shard.ike_sas.find( spi );
+            if ( it == shard.ike_sas.end() ) {
+                shard.condition->release();
+                continue;
+            }
+
+            it->second.scheduled = false;
+            IkeSa* ike_sa = it->second.ike_sa;
+
+            shard.condition->release();
+
+            // Only this worker deletes the IKE SAs of the shard, so the IKE SA can be used without holding the shard lock.
+            // Just one command is executed per turn to keep fairness between the IKE SAs of the shard
+            IkeSa::IKE_SA_ACTION action = IkeSa::IKE_SA_ACTION_CONTINUE;
+            if ( ike_sa->hasMoreCommands() )
+                action = ike_sa->processCommand();
+
+            AutoLock auto_lock( *shard.condition );
+            IkeSaEntry& entry = shard.ike_sas[ spi ];
+
+            if ( action == IkeSa::IKE_SA_ACTION_DELETE_IKE_SA ) {
+                this->removeFromAddressIndex( shard, spi, entry );
+                shard.ike_sas.erase( spi );
+                auto_lock.release();
+                delete ike_sa;
+                continue;
+            }
+
+            this->updateAddressIndex( shard, spi, entry );
+
+            // Commands pushed by the IKE SA itself (or deferred ones) do not schedule it
+            if ( ike_sa->hasMoreCommands() )
+                this->schedule( shard, entry );
+        }
+    }
+
+    uint16_t IkeSaControllerImplSharded::getNumWorkers() const {
+        return this->shards.size();
+    }
+
+    void IkeSaControllerImplSharded::incHalfOpenCounter() {
+        uint32_t value = ++this->half_open_counter;
+        LOG_LOCKED_MESSAGE( "IkeSaController", "Half open IKE SAs=[" + intToString( value ) + "]", Log::LOG_HALF, true );
+    }
+
+    void IkeSaControllerImplSharded::decHalfOpenCounter() {
+        uint32_t value = --this->half_open_counter;
+        LOG_LOCKED_MESSAGE( "IkeSaController", "Half open IKE SAs=[" + intToString( value ) + "]", Log::LOG_HALF, true );
+    }
+
+    bool IkeSaControllerImplSharded::useCookies() {
+        shared_ptr<const GeneralConfiguration> general_conf = Configuration::getInstance().getGeneralConfiguration();
+        return this->half_open_counter >= general_conf->cookie_threshold;
+    }
+
+    uint64_t IkeSaControllerImplSharded::nextSpi() {
+        uint16_t worker = this->next_shard++ % this->shards.size();
+        Shard& shard = *this->shards[ worker ];
+
+        while ( true ) {
+            uint64_t spi = SpiRouting::generateIkeSaSpi( worker );
+
+            AutoLock auto_lock( *shard.condition );
+            if ( shard.ike_sas.find( spi ) == shard.ike_sas.end() )
+                return spi;
+        }
+    }
+
+    void IkeSaControllerImplSharded::addIkeSa( auto_ptr<IkeSa> ike_sa ) {
+        if ( ike_sa->is_half_open )
+            this->incHalfOpenCounter();
+
+        uint64_t spi = ike_sa->my_spi;
+        Shard& shard = this->getShard( spi );
+
+        AutoLock auto_lock( *shard.condition );
+
+        assert( shard.ike_sas.find( spi ) == shard.ike_sas.end() );
+
+        IkeSaEntry& entry = shard.ike_sas[ spi ];
+        entry.ike_sa = ike_sa.release();
+        entry.scheduled = false;
+        entry.indexed = false;
+
+        // The worker cannot process the IkeSa until the shard is released, so it can still be read here
+        this->updateAddressIndex( shard, spi, entry );
+
+        if ( entry.ike_sa->hasMoreCommands() )
+            this->schedule( shard, entry );
+    }
+
+    bool IkeSaControllerImplSharded::pushCommandByAddresses( const IpAddress& ike_sa_src_addr, const IpAddress& ike_sa_dst_addr, auto_ptr<Command> command ) {
+        IpAddressValue src_value( ike_sa_src_addr );
+        IpAddressValue dst_value( ike_sa_dst_addr );
+
+        AddressPair addresses( src_value, dst_value );
+
+        // Only the address index is read: the IkeSa objects are being modified by their workers
+        for ( vector<Shard*>::iterator it = this->shards.begin(); it != this->shards.end(); it++ ) {
+            Shard& shard = **it;
+            AutoLock auto_lock( *shard.condition );
+
+            multimap<AddressPair, uint64_t>::iterator it_index = shard.address_index.find( addresses );
+            if ( it_index == shard.address_index.end() )
+                continue;
+
+            IkeSaEntry& entry = shard.ike_sas[ it_index->second ];
+            entry.ike_sa->pushCommand( command, false );
+            this->schedule( shard, entry );
+            return true;
+        }
+
+        return false;
+    }
+
+    void IkeSaControllerImplSharded::updateAddressIndex( Shard& shard, uint64_t spi, IkeSaEntry& entry ) {
+        IkeSa::IKE_SA_STATE state = entry.ike_sa->getState();
+        bool usable = !( state < IkeSa::STATE_IKE_SA_ESTABLISHED || state == IkeSa::STATE_DELETE_IKE_SA_REQ_SENT || state >= IkeSa::STATE_WAITING_FOR_DELETION );
+
+        if ( !usable ) {
+            this->removeFromAddressIndex( shard, spi, entry );
+            return;
+        }
+
+        AddressPair addresses( entry.ike_sa->my_addr->getIpAddressValue(), entry.ike_sa->peer_addr->getIpAddressValue() );
+        if ( entry.indexed && entry.addresses == addresses )
+            return;
+
+        this->removeFromAddressIndex( shard, spi, entry );
+        shard.address_index.insert( make_pair( addresses, spi ) );
+        entry.addresses = addresses;
+        entry.indexed = true;
+    }
+
+    void IkeSaControllerImplSharded::removeFromAddressIndex( Shard& shard, uint64_t spi, IkeSaEntry& entry ) {
+        if ( !entry.indexed )
+            return;
+
+        pair<multimap<AddressPair, uint64_t>::iterator, multimap<AddressPair, uint64_t>::iterator> range = shard.address_index.equal_range( entry.addresses );
+        for ( multimap<AddressPair, uint64_t>::iterator it = range.first; it != range.second; it++ ) {
+            if ( it->second == spi ) {
+                shard.address_index.erase( it );
+                break;
+            }
+        }
+
+        entry.indexed = false;
+    }
+
+    void IkeSaControllerImplSharded::requestChildSa( IpAddress& ike_sa_src_addr, IpAddress& ike_sa_dst_addr, auto_ptr<ChildSaRequest> child_sa_request ) {
+        // If there is an IKE SA between the addresses, use it
+        if ( this->pushCommandByAddresses( ike_sa_src_addr, ike_sa_dst_addr, auto_ptr<Command> ( new SendNewChildSaReqCommand( child_sa_request->clone() ) ) ) )
+            return;
+
+        // Otherwise, creates a new IKE SA
+        auto_ptr<IkeSa> ike_sa ( new IkeSa( this->nextSpi(), true, NetworkController::getSocketAddress( ike_sa_src_addr.clone(), 500 ), NetworkController::getSocketAddress( ike_sa_dst_addr.clone(), 500 ) ) );
+        ike_sa->pushCommand( auto_ptr<Command> ( new SendIkeSaInitReqCommand( child_sa_request ) ), false );
+        this->addIkeSa( ike_sa );
+    }
+
+    void IkeSaControllerImplSharded::requestChildSaMobility( IpAddress& ike_sa_src_addr, IpAddress& ike_sa_dst_addr, auto_ptr<ChildSaRequest> child_sa_request, IpAddress& ike_sa_coa_addr, bool is_ha ) {
+        // The Mobile Router runs the IKE SA from its Care-of address
+        IpAddress& my_addr = is_ha ? ike_sa_src_addr : ike_sa_coa_addr;
+
+        if ( this->pushCommandByAddresses( my_addr, ike_sa_dst_addr, auto_ptr<Command> ( new SendNewChildSaReqCommand( child_sa_request->clone() ) ) ) )
+            return;
+
+        auto_ptr<IkeSa> ike_sa ( new IkeSa( this->nextSpi(), true, NetworkController::getSocketAddress( my_addr.clone(), 500 ), NetworkController::getSocketAddress( ike_sa_dst_addr.clone(), 500 ) ) );
+        ike_sa->pushCommand( auto_ptr<Command> ( new SendIkeSaInitReqCommand( child_sa_request ) ), false );
+        this->addIkeSa( ike_sa );
+    }
+
+    bool IkeSaControllerImplSharded::pushCommandByIkeSaSpi( uint64_t spi, auto_ptr<Command> command, bool priority ) {
+        Shard& shard = this->getShard( spi );
+        AutoLock auto_lock( *shard.condition );
+
+        map<uint64_t, IkeSaEntry>::iterator it = shard.ike_sas.find( spi );
+        if ( it == shard.ike_sas.end() )
+            return false;
+
+        it->second.ike_sa->pushCommand( command, priority );
+        this->schedule( shard, it->second );
+        return true;
+    }
+
+    IkeSa* IkeSaControllerImplSharded::getIkeSaByIkeSaSpi( uint64_t spi ) {
+        Shard& shard = this->getShard( spi );
+        AutoLock auto_lock( *shard.condition );
+
+        map<uint64_t, IkeSaEntry>::iterator it = shard.ike_sas.find( spi );
+        if ( it == shard.ike_sas.end() )
+            return NULL;
+
+        return it->second.ike_sa;
+    }
+
+    bool IkeSaControllerImplSharded::pushCommandByChildSaSpi( uint32_t spi, auto_ptr<Command> command, bool priority ) {
+        // The SPI index gives the candidate IKE SAs, that are checked under their shard locks
+        vector<uint64_t> ike_sa_spis;
+        ChildSaCollection::findIkeSaSpis( spi, ike_sa_spis );
+
+        for ( vector<uint64_t>::iterator it = ike_sa_spis.begin(); it != ike_sa_spis.end(); it++ ) {
+            Shard& shard = this->getShard( *it );
+            AutoLock auto_lock( *shard.condition );
+
+            map<uint64_t, IkeSaEntry>::iterator it_ike_sa = shard.ike_sas.find( *it );
+            if ( it_ike_sa != shard.ike_sas.end() && it_ike_sa->second.ike_sa->controlsChildSa( spi ) ) {
+                it_ike_sa->second.ike_sa->pushCommand( command, priority );
+                this->schedule( shard, it_ike_sa->second );
+                return true;
+            }
+        }
+
+        return false;
+    }
+}
@@ -0,0 +1,153 @@
+/***************************************************************************
+ *   Copyright (C) 2005 by                                                 *
+ *   Alejandro Perez Mendez     alex@um.es                                 *
+ *   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+ *                                                                         *
+ *   This software may be modified and distributed under the terms         *
+ *   of the Apache license.  See the LICENSE file for details.             *
+ ***************************************************************************/
+#ifndef OPENIKEV2IKESACONTROLLERIMPLSHARDED_H
+#define OPENIKEV2IKESACONTROLLERIMPLSHARDED_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "ikesacontrollerimpl.h"
+#include "ipaddressvalue.h"
+#include "condition.h"
+
+#include <map>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+namespace openikev2 {
+
+    /**
+     This class represents an IkeSaController implementation that distributes the IkeSa objects among several worker threads.
+     Each IkeSa is assigned to a shard encoded in its SPI (see SpiRouting), so the owner of a message is known from its IKE header.
+     The shard worker is the only thread executing the commands of its IkeSa objects, so command processing never takes a global lock.
+     Other threads never read the IkeSa objects: the addresses of the usable ones are indexed in their shard, updated by the worker.
+     @author Alejandro Perez Mendez, Pedro J. Fernandez Ruiz <alex@um.es, pedroj@um.es>
+    */
+    class IkeSaControllerImplSharded : public IkeSaControllerImpl {
+
+            /****************************** STRUCTS ******************************/
+        protected:
+            /** Pair of IKE SA addresses (own address, peer address) */
+            typedef pair<IpAddressValue, IpAddressValue> AddressPair;
+
+            /** IkeSa table entry */
+            struct IkeSaEntry {
+                IkeSa* ike_sa;                              /**< Owned IkeSa */
+                bool scheduled;                             /**< Indicates if the IkeSa is already in the ready queue */
+                bool indexed;                               /**< Indicates if the IkeSa is in the address index */
+                AddressPair addresses;                      /**< Addresses under which the IkeSa is indexed */
+            };
+
+            /** Shard: a worker thread and the IkeSa objects it owns */
+            struct Shard {
+                auto_ptr<Condition> condition;              /**< Condition to protect the shard and wake up the worker */
+                map<uint64_t, IkeSaEntry> ike_sas;          /**< IkeSa objects owned by this shard, indexed by SPI */
+                deque<uint64_t> ready_queue;                /**< SPIs of the IkeSa objects with pending commands */
+                multimap<AddressPair, uint64_t> address_index; /**< SPIs of the IkeSa objects usable to create CHILD_SAs, by addresses */
+                bool exiting;                               /**< Indicates if the worker must finish */
+                thread worker;                              /**< Worker thread */
+            };
+
+            /****************************** ATTRIBUTES ******************************/
+        protected:
+            vector<Shard*> shards;                          /**< Shard collection */
+            atomic<uint32_t> half_open_counter;             /**< Number of half-opened IKE SAs */
+            atomic<uint32_t> next_shard;                    /**< Shard for the next allocated SPI (round robin) */
+
+            /****************************** METHODS ******************************/
+        protected:
+            /**
+             * Gets the shard owning the indicated SPI
+             * @param spi IKE SPI value
+             * @return The shard owning the SPI
+             */
+            Shard& getShard( uint64_t spi ) const;
+
+            /**
+             * Inserts the IkeSa in the ready queue of the shard if it is not there. Shard condition must be acquired.
+             * @param shard Shard owning the IkeSa
+             * @param entry IkeSa table entry
+             */
+            void schedule( Shard& shard, IkeSaEntry& entry );
+
+            /**
+             * Updates the address index entry of an IkeSa with its current state and addresses. Shard condition must be acquired,
+             * and it can only be called by the thread owning the IkeSa (the shard worker, or the thread adding it)
+             * @param shard Shard owning the IkeSa
+             * @param spi IkeSa SPI
+             * @param entry IkeSa table entry
+             */
+            void updateAddressIndex( Shard& shard, uint64_t spi, IkeSaEntry& entry );
+
+            /**
+             * Removes an IkeSa from the address index. Shard condition must be acquired.
+             * @param shard Shard owning the IkeSa
+             * @param spi IkeSa SPI
+             * @param entry IkeSa table entry
+             */
+            void removeFromAddressIndex( Shard& shard, uint64_t spi, IkeSaEntry& entry );
+
+            /**
+             * Main loop of the shard workers
+             * @param shard Shard to be served
+             */
+            void runWorker( Shard& shard );
+
+            /**
+             * Finds an IkeSa suitable to create a new CHILD_SA between the indicated addresses, and pushes the Command into it.
+             * @param ike_sa_src_addr Source address for the IKE_SA
+             * @param ike_sa_dst_addr Destination address for the IKE_SA
+             * @param command Command to be pushed
+             * @return TRUE if such IkeSa exists. FALSE otherwise
+             */
+            virtual bool pushCommandByAddresses( const IpAddress& ike_sa_src_addr, const IpAddress& ike_sa_dst_addr, auto_ptr<Command> command );
+
+        public:
+            /**
+             * Creates a new IkeSaControllerImplSharded and starts its worker threads
+             * @param num_workers Number of workers. If 0, the number of available cores is used. Limited to SpiRouting::getMaxWorkers().
+             */
+            IkeSaControllerImplSharded( uint16_t num_workers );
+
+            /**
+             * Gets the number of workers
+             * @return The number of workers
+             */
+            virtual uint16_t getNumWorkers() const;
+
+            /**
+             * Gets the worker owning the indicated SPI, as encoded in the SPI itself
+             * @param spi IKE SPI value
+             * @return The worker index
+             */
+            virtual uint16_t getWorkerIndex( uint64_t spi ) const;
+
+            virtual void incHalfOpenCounter();
+            virtual void decHalfOpenCounter();
+            virtual bool useCookies();
+            virtual uint64_t nextSpi();
+            virtual void addIkeSa( auto_ptr<IkeSa> ike_sa );
+            virtual void requestChildSa( IpAddress& ike_sa_src_addr, IpAddress& ike_sa_dst_addr, auto_ptr<ChildSaRequest> child_sa_request );
+            virtual void requestChildSaMobility( IpAddress& ike_sa_src_addr, IpAddress& ike_sa_dst_addr, auto_ptr<ChildSaRequest> child_sa_request, IpAddress& ike_sa_coa_addr, bool is_ha );
+            virtual bool pushCommandByIkeSaSpi( uint64_t spi, auto_ptr<Command> command, bool priority );
+            virtual IkeSa* getIkeSaByIkeSaSpi( uint64_t spi );
+            virtual bool pushCommandByChildSaSpi( uint32_t spi, auto_ptr<Command> command, bool priority );
+
+            /**
+             * Stops the workers and deletes all the remaining IkeSa objects
+             */
+            virtual ~IkeSaControllerImplSharded();
+    };
+
+}
+
+#endif
@@ -8,6 +8,8 @@
 ***************************************************************************/
 #include "ipaddress.h"
 
+#include <string.h>
+
 namespace openikev2 {
 
     IpAddress::~ IpAddress() {}
@@ -16,7 +18,23 @@ namespace openikev2 {
         if ( this->getFamily() != other.getFamily() )
             return false;
 
-        return ( *this->getBytes() == *other.getBytes() );
+        // compares through stack buffers to avoid allocating the byte representations
+        uint16_t size = this->getAddressSize();
+        if ( size != other.getAddressSize() )
+            return false;
+
+        if ( size > 16 )
+            return ( *this->getBytes() == *other.getBytes() );
+
+        uint8_t bytes[ 16 ], other_bytes[ 16 ];
+        this->writeBytes( bytes );
+        other.writeBytes( other_bytes );
+        return ( memcmp( bytes, other_bytes, size ) == 0 );
+    }
+
+    void IpAddress::writeBytes( uint8_t* output ) const {
+        auto_ptr<ByteArray> bytes = this->getBytes();
+        memcpy( output, bytes->getRawPointer(), bytes->size() );
     }
 
     auto_ptr< Attribute > IpAddress::cloneAttribute( ) const {
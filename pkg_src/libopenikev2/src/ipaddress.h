@@ -54,6 +54,13 @@ namespace openikev2 {
              */
             virtual auto_ptr<ByteArray> getBytes() const = 0;
 
+            /**
+             * Writes the byte representation of the IpAddress into a caller provided buffer of getAddressSize() bytes.
+             * The default implementation copies getBytes(). Implementations should override it to avoid the allocation.
+             * @param output Buffer to be filled
+             */
+            virtual void writeBytes( uint8_t* output ) const;
+
             /**
              * Creates a new IpAddress object cloning this as an Attribute
              * @return The new Attribute object
@@ -0,0 +1,36 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#include "ipaddressvalue.h"
+#include "networkcontroller.h"
+#include "exception.h"
+
+namespace openikev2 {
+
+    IpAddressValue::IpAddressValue( const IpAddress& ip_address ) {
+        memset( this->bytes, 0, sizeof( this->bytes ) );
+        this->family = ip_address.getFamily();
+
+        if ( ip_address.getAddressSize() != this->size() )
+            throw Exception( "Address size not supported. Address=" + ip_address.toString() );
+
+        ip_address.writeBytes( this->bytes );
+    }
+
+    auto_ptr<ByteArray> IpAddressValue::getBytes() const {
+        return auto_ptr<ByteArray> ( new ByteArray( this->bytes, this->size() ) );
+    }
+
+    auto_ptr<IpAddress> IpAddressValue::getIpAddress() const {
+        return NetworkController::getIpAddress( this->family, this->getBytes() );
+    }
+
+    string IpAddressValue::toString() const {
+        return this->getBytes()->toString();
+    }
+}
@@ -0,0 +1,206 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#ifndef OPENIKEV2IPADDRESSVALUE_H
+#define OPENIKEV2IPADDRESSVALUE_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "ipaddress.h"
+
+#include <string.h>
+
+namespace openikev2 {
+
+    /**
+        This class is a compact, fixed size, copyable representation of an IP address (family plus up to 16 bytes).
+        Unlike IpAddress it never allocates, so it is used wherever addresses are compared, masked or hashed
+        in the hot paths (traffic selector narrowing, network prefix matching, socket address comparison).
+        Bytes beyond the address size are always zero, so whole-object comparison is well defined.
+        @author Alejandro Perez Mendez, Pedro J. Fernandez Ruiz <alex@um.es, pedroj@um.es>
+    */
+    class IpAddressValue {
+            /****************************** ATTRIBUTES ******************************/
+        public:
+            Enums::ADDR_FAMILY family;                  /**< Address family */
+            uint8_t bytes[ 16 ];                        /**< Address bytes, in network order */
+
+            /****************************** METHODS ******************************/
+        public:
+            /**
+             * Creates a new empty IpAddressValue (ADDR_NONE family)
+             */
+            IpAddressValue() : family( Enums::ADDR_NONE ) {
+                memset( this->bytes, 0, sizeof( this->bytes ) );
+            }
+
+            /**
+             * Creates a new IpAddressValue from raw bytes
+             * @param family Address family
+             * @param bytes Address bytes (getAddressSize( family ) bytes)
+             */
+            IpAddressValue( Enums::ADDR_FAMILY family, const uint8_t* bytes ) : family( family ) {
+                memset( this->bytes, 0, sizeof( this->bytes ) );
+                memcpy( this->bytes, bytes, getAddressSize( family ) );
+            }
+
+            /**
+             * Creates a new IpAddressValue from an IpAddress
+             * @param ip_address IpAddress
+             */
+            explicit IpAddressValue( const IpAddress& ip_address );
+
+            /**
+             * Obtains the address size for the indicated family
+             * @param family Address family
+             * @return Address size in bytes (0 for ADDR_NONE)
+             */
+            static uint16_t getAddressSize( Enums::ADDR_FAMILY family ) {
+                return ( family == Enums::ADDR_IPV4 ) ? 4 : ( family == Enums::ADDR_IPV6 ) ? 16 : 0;
+            }
+
+            /**
+             * Obtains the address size of this value
+             * @return Address size in bytes
+             */
+            uint16_t size() const {
+                return getAddressSize( this->family );
+            }
+
+            /**
+             * Compares two values. Family is compared first, then bytes in network order.
+             * @param other Other value
+             * @return <0, 0 or >0 as in memcmp()
+             */
+            int compare( const IpAddressValue& other ) const {
+                if ( this->family != other.family )
+                    return ( this->family < other.family ) ? -1 : 1;
+                return memcmp( this->bytes, other.bytes, this->size() );
+            }
+
+            bool operator==( const IpAddressValue& other ) const {
+                return this->compare( other ) == 0;
+            }
+
+            bool operator!=( const IpAddressValue& other ) const {
+                return this->compare( other ) != 0;
+            }
+
+            bool operator<( const IpAddressValue& other ) const {
+                return this->compare( other ) < 0;
+            }
+
+            bool operator>( const IpAddressValue& other ) const {
+                return this->compare( other ) > 0;
+            }
+
+            bool operator<=( const IpAddressValue& other ) const {
+                return this->compare( other ) <= 0;
+            }
+
+            bool operator>=( const IpAddressValue& other ) const {
+                return this->compare( other ) >= 0;
+            }
+
+            /**
+             * Obtains a hash of the value (FNV-1a over family and address bytes)
+             * @return Hash value
+             */
+            size_t hash() const {
+                uint32_t result = 2166136261U;
+                result = ( result ^ this->family ) * 16777619U;
+                for ( uint16_t i = 0; i < this->size(); i++ )
+                    result = ( result ^ this->bytes[ i ] ) * 16777619U;
+                return result;
+            }
+
+            /**
+             * Obtains the network address of the prefix of the indicated length containing this address
+             * @param prefixlen Prefix length
+             * @return This value with the host bits cleared
+             */
+            IpAddressValue getNetworkValue( uint16_t prefixlen ) const {
+                IpAddressValue result( *this );
+                uint16_t full_bytes = prefixlen / 8;
+                if ( full_bytes >= result.size() )
+                    return result;
+                if ( prefixlen % 8 )
+                    result.bytes[ full_bytes++ ] &= ( uint8_t ) ( 0xFF << ( 8 - ( prefixlen % 8 ) ) );
+                memset( result.bytes + full_bytes, 0, result.size() - full_bytes );
+                return result;
+            }
+
+            /**
+             * Obtains the broadcast address of the prefix of the indicated length containing this address
+             * @param prefixlen Prefix length
+             * @return This value with the host bits set
+             */
+            IpAddressValue getBroadcastValue( uint16_t prefixlen ) const {
+                IpAddressValue result( *this );
+                uint16_t full_bytes = prefixlen / 8;
+                if ( full_bytes >= result.size() )
+                    return result;
+                if ( prefixlen % 8 )
+                    result.bytes[ full_bytes++ ] |= ( uint8_t ) ~( 0xFF << ( 8 - ( prefixlen % 8 ) ) );
+                memset( result.bytes + full_bytes, 0xFF, result.size() - full_bytes );
+                return result;
+            }
+
+            /**
+             * Indicates if the first prefixlen bits of both values are equal
+             * @param other Other value
+             * @param prefixlen Prefix length
+             * @return TRUE if both values are in the same prefix. FALSE otherwise
+             */
+            bool matchesPrefix( const IpAddressValue& other, uint16_t prefixlen ) const {
+                if ( this->family != other.family )
+                    return false;
+                uint16_t full_bytes = prefixlen / 8;
+                if ( memcmp( this->bytes, other.bytes, full_bytes ) != 0 )
+                    return false;
+                if ( prefixlen % 8 ) {
+                    uint8_t mask = 0xFF << ( 8 - ( prefixlen % 8 ) );
+                    if ( ( this->bytes[ full_bytes ] ^ other.bytes[ full_bytes ] ) & mask )
+                        return false;
+                }
+                return true;
+            }
+
+            /**
+             * Gets the byte representation of the address
+             * @return Byte representation
+             */
+            auto_ptr<ByteArray> getBytes() const;
+
+            /**
+             * Creates a new IpAddress object from this value
+             * @return The new IpAddress
+             */
+            auto_ptr<IpAddress> getIpAddress() const;
+
+            /**
+             * Obtains a text representation of the address
+             * @return Text representation
+             */
+            string toString() const;
+    };
+
+    /**
+        Hash functor for using IpAddressValue as key of unordered containers
+        @author Alejandro Perez Mendez, Pedro J. Fernandez Ruiz <alex@um.es, pedroj@um.es>
+    */
+    struct IpAddressValueHash {
+        size_t operator()( const IpAddressValue& value ) const {
+            return value.hash();
+        }
+    };
+}
+
+#endif
@@ -26,6 +26,11 @@ namespace openikev2 {
         return implementation->getSpi( src, dst, protocol );
     }
 
+    uint32_t IpsecController::getSpi( const IpAddress& src, const IpAddress& dst, Enums::PROTOCOL_ID protocol, uint16_t worker ) {
+        assert ( implementation != NULL );
+        return implementation->getSpi( src, dst, protocol, worker );
+    }
+
     void IpsecController::createIpsecSa( const IpAddress& src, const IpAddress& dst, const ChildSa& childsa ) {
         assert ( implementation != NULL );
         implementation->createIpsecSa( src, dst, childsa );
@@ -63,6 +63,12 @@ namespace openikev2 {
              */
             static uint32_t getSpi( const IpAddress& src, const IpAddress& dst, Enums::PROTOCOL_ID ipsec_protocol );
 
+            /**
+             * Request an SPI value to be routed to the indicated worker (see SpiRouting)
+             * @return The SPI value
+             */
+            static uint32_t getSpi( const IpAddress& src, const IpAddress& dst, Enums::PROTOCOL_ID ipsec_protocol, uint16_t worker );
+
             /**
              * Creates an IPSEC SA
              * @param src Source address of the IPSEC SA
@@ -12,6 +12,10 @@ namespace openikev2 {
 
     IpsecControllerImpl::~IpsecControllerImpl() {}
 
+    uint32_t IpsecControllerImpl::getSpi( const IpAddress& src, const IpAddress& dst, Enums::PROTOCOL_ID protocol, uint16_t ) {
+        return this->getSpi( src, dst, protocol );
+    }
+
 }
 
 
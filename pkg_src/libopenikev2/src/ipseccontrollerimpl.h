@@ -58,6 +58,17 @@ namespace openikev2 {
              */
             virtual uint32_t getSpi( const IpAddress& src, const IpAddress& dst, Enums::PROTOCOL_ID protocol ) = 0;
 
+            /**
+             * Request an SPI value to be routed to the indicated worker.
+             * Implementations should allocate it from SpiRouting::getChildSaSpiRange(). The default one ignores the worker.
+             * @param src Source address
+             * @param dst Destination address
+             * @param protocol IPsec protocol
+             * @param worker Worker owning the IKE SA (as encoded in its SPI)
+             * @return The SPI value
+             */
+            virtual uint32_t getSpi( const IpAddress& src, const IpAddress& dst, Enums::PROTOCOL_ID protocol, uint16_t worker );
+
             /**
              * Creates an IPSEC SA
              * @param src Source address of the IPSEC SA
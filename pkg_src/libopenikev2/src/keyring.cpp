@@ -8,89 +8,112 @@
 ***************************************************************************/
 #include "keyring.h"
 #include "cryptocontroller.h"
+#include "bytearrayview.h"
 
 #include <assert.h>
 
 namespace openikev2 {
 
-    KeyRing::~KeyRing() {}
+    KeyRing::~KeyRing() {
+        this->setKeyMaterial( auto_ptr<ByteArray> ( NULL ) );
+    }
+
+    void KeyRing::wipe( void* data, uint32_t size ) {
+        volatile uint8_t* position = ( volatile uint8_t* ) data;
+        while ( size-- > 0 )
+            *position++ = 0;
+    }
+
+    void KeyRing::setKeyMaterial( auto_ptr<ByteArray> key_material ) {
+        if ( this->key_material.get() != NULL )
+            KeyRing::wipe( this->key_material->getRawPointer(), this->key_material->size() );
+        this->key_material = key_material;
+    }
+
+    auto_ptr<ByteArray> KeyRing::nextKey( uint8_t*& position, uint32_t size ) {
+        auto_ptr<ByteArray> result ( new ByteArrayView( position, size ) );
+        position += size;
+        return result;
+    }
 
     void KeyRing::generateIkeSaKeys( ByteArray & nonce_i, ByteArray & nonce_r, uint64_t spi_i, uint64_t spi_r, ByteArray & shared_secret, ByteArray* old_sk_d ) {
-        // Concat the two nonces (Ni | Nr)
-        ByteBuffer nonces( nonce_i.size() + nonce_r.size() );
-        nonces.writeByteArray( nonce_i );
-        nonces.writeByteArray( nonce_r );
+        uint32_t nonces_size = nonce_i.size() + nonce_r.size();
+
+        // generate the S value used in the prf+ function (S = Ni | Nr | SPIi | SPIr). It begins with the two nonces (Ni | Nr)
+        ByteBuffer sequence( nonces_size + 8 + 8 );
+        sequence.writeByteArray( nonce_i );
+        sequence.writeByteArray( nonce_r );
+        sequence.writeBuffer( &spi_i, 8 );
+        sequence.writeBuffer( &spi_r, 8 );
+        ByteArrayView nonces( sequence.getRawPointer(), nonces_size );
+
+        // Single block with SKEYSEED and the concatenated keys (SK_d | SK_ai | SK_ar | SK_ei | SK_er | SK_pi | SK_pr)
+        uint32_t total_size = this->prf->prf_size + this->integ_key_size * 2 + this->encr_key_size * 2 + this->prf->prf_size * 2;
+        auto_ptr<ByteArray> key_material ( new ByteArray( this->prf->prf_size + total_size ) );
+        key_material->setSize( this->prf->prf_size + total_size );
+        ByteArrayView skeyseed( key_material->getRawPointer(), this->prf->prf_size );
 
         // Generate SKEYSEED
         // if not rekeying then old_sk_d = NULL
         // SKEYSEED = prf(Ni | Nr, g^ir)
         if ( old_sk_d == NULL ) {
             assert( shared_secret.size() > 0 );
-            this->skeyseed = this->prf->prf( nonces, shared_secret );
+            this->prf->writePrf( nonces, shared_secret.getRawPointer(), shared_secret.size(), skeyseed.getRawPointer() );
         }
 
         // If rekeying, then old_sk_d != NULL
         // SKEYSEED = prf(SK_d (old), [g^ir (new)] | Ni | Nr)
         else {
             // temp = [g^ir] | Ni | Nr
-            ByteBuffer temp( shared_secret.size() + nonces.size() );
+            ByteBuffer temp( shared_secret.size() + nonces_size );
             temp.writeByteArray( shared_secret );
             temp.writeByteArray( nonces );
-            this->skeyseed = this->prf->prf( *old_sk_d, temp );
+            this->prf->writePrf( *old_sk_d, temp.getRawPointer(), temp.size(), skeyseed.getRawPointer() );
+            KeyRing::wipe( temp.getRawPointer(), temp.size() );
         }
 
-        // Total size of the concatenated keys (SK_d | SK_ai | SK_ar | SK_ei | SK_er | SK_pi | SK_pr)
-        uint16_t total_size = this->prf->prf_size + this->integ_key_size * 2 + this->encr_key_size * 2 + this->prf->prf_size * 2;
-
-        // generate the S value used in the prf+ function  (S = Ni | Nr | SPIi | SPIr)
-        ByteBuffer sequence( nonces.size() + 8 + 8 );
-        sequence.writeByteArray( nonces );
-        sequence.writeBuffer( &spi_i, 8 );
-        sequence.writeBuffer( &spi_r, 8 );
-
-        auto_ptr<ByteArray> concat_keys = this->prf->prfPlus( *this->skeyseed, sequence, total_size );
-
-        ByteBuffer temp( *concat_keys );
-
-        // Copies the values of the keys on their buffers
-        this->sk_d = temp.readByteArray( this->prf->prf_size );
-        this->sk_ai = temp.readByteArray( this->integ_key_size );
-        this->sk_ar = temp.readByteArray( this->integ_key_size );
-        this->sk_ei = temp.readByteArray( this->encr_key_size );
-        this->sk_er = temp.readByteArray( this->encr_key_size );
-        this->sk_pi = temp.readByteArray( this->prf->prf_size );
-        this->sk_pr = temp.readByteArray( this->prf->prf_size );
+        // The keys are derived directly after SKEYSEED
+        this->prf->writePrfPlus( skeyseed, sequence, total_size, key_material->getRawPointer() + this->prf->prf_size );
+
+        // The keys refer to their slices of the block (the old ones are released before wiping their block)
+        uint8_t* position = key_material->getRawPointer();
+        this->skeyseed = KeyRing::nextKey( position, this->prf->prf_size );
+        this->sk_d = KeyRing::nextKey( position, this->prf->prf_size );
+        this->sk_ai = KeyRing::nextKey( position, this->integ_key_size );
+        this->sk_ar = KeyRing::nextKey( position, this->integ_key_size );
+        this->sk_ei = KeyRing::nextKey( position, this->encr_key_size );
+        this->sk_er = KeyRing::nextKey( position, this->encr_key_size );
+        this->sk_pi = KeyRing::nextKey( position, this->prf->prf_size );
+        this->sk_pr = KeyRing::nextKey( position, this->prf->prf_size );
+        this->setKeyMaterial( key_material );
     }
 
     void KeyRing::generateChildSaKeys( ByteArray & nonce_i, ByteArray & nonce_r, ByteArray & sk_d, ByteArray * shared_secret ) {
         // nonces = [g^ir (new)] | Ni | Nr
-        auto_ptr<ByteBuffer> nonces;
-        if ( shared_secret != NULL ) {
-            nonces.reset ( new ByteBuffer( shared_secret->size() + nonce_i.size() + nonce_r.size() ) );
-            nonces->writeByteArray( *shared_secret );
-            nonces->writeByteArray( nonce_i );
-            nonces->writeByteArray( nonce_r );
-        }
-        else {
-            nonces.reset ( new ByteBuffer( nonce_i.size() + nonce_r.size() ) );
-            nonces->writeByteArray( nonce_i );
-            nonces->writeByteArray( nonce_r );
-        }
+        uint32_t shared_secret_size = ( shared_secret != NULL ) ? shared_secret->size() : 0;
+        ByteBuffer nonces( shared_secret_size + nonce_i.size() + nonce_r.size() );
+        if ( shared_secret != NULL )
+            nonces.writeByteArray( *shared_secret );
+        nonces.writeByteArray( nonce_i );
+        nonces.writeByteArray( nonce_r );
 
-        // Total size of the concatenated keys = (encr_size + inter_size) * 2
-        uint16_t total_size = ( this->encr_key_size + this->integ_key_size ) * 2;
+        // Single block with the concatenated keys (SK_ei | SK_ai | SK_er | SK_ar)
+        uint32_t total_size = ( this->encr_key_size + this->integ_key_size ) * 2;
+        auto_ptr<ByteArray> key_material ( new ByteArray( total_size ) );
+        key_material->setSize( total_size );
 
         // Generates the key material
-        auto_ptr<ByteArray> concat_keys = this->prf->prfPlus( sk_d, *nonces, total_size );
-
-        ByteBuffer temp( concat_keys->size() );
-        temp.writeByteArray( *concat_keys );
-
-        // Copies the values of the keys on their buffers
-        this->sk_ei = temp.readByteArray( this->encr_key_size );
-        this->sk_ai = temp.readByteArray( this->integ_key_size );
-        this->sk_er = temp.readByteArray( this->encr_key_size );
-        this->sk_ar = temp.readByteArray( this->integ_key_size );
+        this->prf->writePrfPlus( sk_d, nonces, total_size, key_material->getRawPointer() );
+        if ( shared_secret != NULL )
+            KeyRing::wipe( nonces.getRawPointer(), shared_secret_size );
+
+        // The keys refer to their slices of the block
+        uint8_t* position = key_material->getRawPointer();
+        this->sk_ei = KeyRing::nextKey( position, this->encr_key_size );
+        this->sk_ai = KeyRing::nextKey( position, this->integ_key_size );
+        this->sk_er = KeyRing::nextKey( position, this->encr_key_size );
+        this->sk_ar = KeyRing::nextKey( position, this->integ_key_size );
+        this->setKeyMaterial( key_material );
     }
 
     string KeyRing::toStringTab( uint8_t tabs ) const {
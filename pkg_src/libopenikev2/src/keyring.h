@@ -18,7 +18,8 @@
 namespace openikev2 {
 
     /**
-        This class represents a KeyRing
+        This class represents a KeyRing. All the keys are derived into a single key material block, and the sk_* keys
+        refer to slices of it. The block is wiped when it is replaced and when the KeyRing is destroyed.
         @author Alejandro Perez Mendez, Pedro J. Fernandez Ruiz <alex@um.es, pedroj@um.es>
     */
     class KeyRing: public Printable {
@@ -28,6 +29,7 @@ namespace openikev2 {
             PseudoRandomFunction* prf;              /**< Pseudo random function used for key derivation */
             uint32_t encr_key_size;                 /**< Encryption key size */
             uint32_t integ_key_size;                /**< Integrity key size */
+            auto_ptr<ByteArray> key_material;       /**< Block containing all the keys. The sk_* keys refer to it */
         public:
             auto_ptr<ByteArray> sk_ai;              /**< Key used for integrity operations in the initiator */
             auto_ptr<ByteArray> sk_ar;              /**< Key used for integrity operations in the responder */
@@ -40,7 +42,29 @@ namespace openikev2 {
             auto_ptr<ByteArray> skeyseed;           /**< Skeyseed (IKE_SA only) */
 
             /****************************** METHODS ******************************/
+        protected:
+            /**
+             * Replaces the key material block, wiping the previous one
+             * @param key_material New key material block
+             */
+            void setKeyMaterial( auto_ptr<ByteArray> key_material );
+
+            /**
+             * Gets a key referring to the key material block, and advances the position
+             * @param position Position of the key in the key material block. It is advanced to the next key
+             * @param size Key size
+             * @return The key. It must not outlive the key material block
+             */
+            static auto_ptr<ByteArray> nextKey( uint8_t*& position, uint32_t size );
+
         public:
+            /**
+             * Overwrites memory with zeros, in a way the compiler cannot optimize away
+             * @param data Memory to be wiped
+             * @param size Memory size
+             */
+            static void wipe( void* data, uint32_t size );
+
             /**
              * Generate the IKE_SA keys
              * @param nonce_i Initiator nonce
@@ -0,0 +1,25 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#include "keyringopenssl.h"
+#include "cipheropenssl.h"
+
+namespace openikev2 {
+
+    KeyRingOpenSSL::KeyRingOpenSSL( Proposal& proposal, const PseudoRandomFunction& prf ) {
+        this->prf = ( PseudoRandomFunction* ) & prf;
+
+        Transform* encr_transform = proposal.getFirstTransformByType( Enums::ENCR );
+        this->encr_key_size = ( encr_transform != NULL ) ? CipherOpenSSL::getEncrKeySize( *encr_transform ) : 0;
+
+        Transform* integ_transform = proposal.getFirstTransformByType( Enums::INTEG );
+        this->integ_key_size = ( integ_transform != NULL ) ? CipherOpenSSL::getIntegKeySize( ( Enums::INTEG_ID ) integ_transform->id ) : 0;
+    }
+
+    KeyRingOpenSSL::~KeyRingOpenSSL() {}
+}
@@ -0,0 +1,39 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#ifndef OPENIKEV2KEYRINGOPENSSL_H
+#define OPENIKEV2KEYRINGOPENSSL_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "keyring.h"
+
+namespace openikev2 {
+
+    /**
+        This class represents a KeyRing whose key sizes are the ones of the algorithms supported by CipherOpenSSL
+        @author Alejandro Perez Mendez, Pedro J. Fernandez Ruiz <alex@um.es, pedroj@um.es>
+    */
+    class KeyRingOpenSSL : public KeyRing {
+
+            /****************************** METHODS ******************************/
+        public:
+            /**
+             * Creates a new KeyRingOpenSSL
+             * @param proposal Proposal containing all the transforms
+             * @param prf PRF to be used. It must exist while the KeyRing is used
+             */
+            KeyRingOpenSSL( Proposal& proposal, const PseudoRandomFunction& prf );
+
+            virtual ~KeyRingOpenSSL();
+    };
+}
+
+#endif
@@ -17,27 +17,61 @@ namespace openikev2 {
 
     LogImpl* Log::implementation( NULL );
     auto_ptr<Mutex> Log::log_mutex( NULL );
+    atomic<uint16_t> Log::enabled_types( Log::LOG_ALL );
+    bool Log::concurrent_implementation( false );
 
     void Log::setImplementation( LogImpl* implementation ) {
         Log::implementation = implementation;
+        Log::concurrent_implementation = ( implementation != NULL ) && implementation->isConcurrent();
         log_mutex = ThreadController::getMutex();
     }
 
-    void Log::writeLockedMessage( string who, string message, uint16_t type, bool main_info ) {
+    void Log::setEnabledTypes( uint16_t types ) {
+        Log::enabled_types.store( types, memory_order_relaxed );
+    }
+
+    uint16_t Log::getEnabledTypes() {
+        return Log::enabled_types.load( memory_order_relaxed );
+    }
+
+    void Log::writeLockedMessage( const string& who, const string& message, uint16_t type, bool main_info ) {
+        if ( !Log::isEnabled( type ) )
+            return;
+
+        // Concurrent implementations write every message atomically
+        if ( Log::concurrent_implementation ) {
+            implementation->writeMessage( who, message, type, main_info );
+            return;
+        }
+
         AutoLock auto_lock( *log_mutex );
         implementation->writeMessage( who, message, type, main_info );
     }
 
-    void Log::writeMessage( string who, string message, uint16_t type, bool main_info ) {
+    void Log::writeMessage( const string& who, const string& message, uint16_t type, bool main_info ) {
+        if ( !Log::isEnabled( type ) )
+            return;
+
         implementation->writeMessage( who, message, type, main_info );
     }
 
     void Log::acquire( ) {
-        Log::log_mutex->acquire();
+        if ( Log::concurrent_implementation )
+            implementation->beginGroup();
+        else
+            Log::log_mutex->acquire();
     }
 
     void Log::release( ) {
-        Log::log_mutex->release();
+        if ( Log::concurrent_implementation )
+            implementation->endGroup();
+        else
+            Log::log_mutex->release();
+    }
+
+    void Log::flush( ) {
+        if ( implementation != NULL )
+            implementation->flush();
     }
 
     string Log::LOG_TYPE_STR( uint16_t type ) {
@@ -21,9 +21,22 @@
 #include "mutex.h"
 
 #include <memory>
+#include <atomic>
 
 using namespace std;
 
+/**
+ * Writes a log message only if its type is enabled. The message expression is not evaluated otherwise.
+ */
+#define LOG_MESSAGE( who, message, type, main_info ) \
+    do { if ( openikev2::Log::isEnabled( type ) ) openikev2::Log::writeMessage( who, message, type, main_info ); } while ( 0 )
+
+/**
+ * Writes a log message, locking and unlocking the mutex, only if its type is enabled. The message expression is not evaluated otherwise.
+ */
+#define LOG_LOCKED_MESSAGE( who, message, type, main_info ) \
+    do { if ( openikev2::Log::isEnabled( type ) ) openikev2::Log::writeLockedMessage( who, message, type, main_info ); } while ( 0 )
+
 namespace openikev2 {
     class LogImpl;
 
@@ -58,6 +71,8 @@ namespace openikev2 {
         protected:
             static LogImpl* implementation;             /**< Log writer implementation to be used */
             static auto_ptr<Mutex> log_mutex;           /**< Mutex_Posix to keep mutual exclusion */
+            static atomic<uint16_t> enabled_types;      /**< Mask of the enabled log message types */
+            static bool concurrent_implementation;      /**< Indicates if the implementation supports concurrent writes (no mutex needed) */
 
             /****************************** METHODS ******************************/
         public:
@@ -74,6 +89,27 @@ namespace openikev2 {
              */
             static void setImplementation( LogImpl* implementation );
 
+            /**
+             * Sets the mask of the enabled log message types. Messages of disabled types are discarded without reaching the implementation.
+             * @param types Mask of enabled types (Log::LOG_INFO | Log::LOG_ERRO, ...). Log::LOG_ALL by default.
+             */
+            static void setEnabledTypes( uint16_t types );
+
+            /**
+             * Gets the mask of the enabled log message types
+             * @return Mask of enabled types
+             */
+            static uint16_t getEnabledTypes();
+
+            /**
+             * Indicates if any of the log message types is enabled
+             * @param type Type of log message (Log::LOG_INFO, D_THRD, ...)
+             * @return TRUE if enabled. FALSE otherwise
+             */
+            static bool isEnabled( uint16_t type ) {
+                return ( enabled_types.load( memory_order_relaxed ) & type ) != 0;
+            }
+
             /**
              * Writes a log message to the log file.
              * @param who Module writting the message
@@ -81,7 +117,7 @@ namespace openikev2 {
              * @param type Type of log message (Log::LOG_INFO, D_THRD, ...)
              * @param main_info Indicates if date must be writed
              */
-            static void writeMessage( string who, string message, uint16_t type, bool main_info );
+            static void writeMessage( const string& who, const string& message, uint16_t type, bool main_info );
 
             /**
              * Writes a log message to the log file, locking and unlocking the mutex.
@@ -90,10 +126,11 @@ namespace openikev2 {
              * @param type Type of log message (Log::LOG_INFO, D_THRD, ...)
              * @param main_info Indicates if date must be writed
              */
-            static void writeLockedMessage( string who, string message, uint16_t type, bool main_info );
+            static void writeLockedMessage( const string& who, const string& message, uint16_t type, bool main_info );
 
             /**
-             * Locks log writer, avoiding simultaneous writings of several threads
+             * Locks log writer, avoiding simultaneous writings of several threads.
+             * With concurrent implementations it only starts a group of messages that will be written together.
              */
             static void acquire();
 
@@ -101,6 +138,11 @@ namespace openikev2 {
              * Unlocks log writer
              */
             static void release();
+
+            /**
+             * Writes all the pending messages of the implementation. It should be called before closing the application.
+             */
+            static void flush();
     };
 }
 
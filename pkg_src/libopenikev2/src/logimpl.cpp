@@ -16,6 +16,16 @@
 #include "exception.h"
 
 namespace openikev2 {
+    bool LogImpl::isConcurrent() const {
+        return false;
+    }
+
+    void LogImpl::beginGroup() {}
+
+    void LogImpl::endGroup() {}
+
+    void LogImpl::flush() {}
+
     LogImpl::~ LogImpl() {
     }
 }
@@ -33,6 +33,29 @@ namespace openikev2 {
              */
             virtual void writeMessage( string who, string message, uint16_t type, bool main_info ) = 0;
 
+            /**
+             * Indicates if writeMessage() can be called concurrently by several threads.
+             * Otherwise Log serializes the calls using its mutex. Default implementation returns FALSE.
+             * @return TRUE if concurrent writes are supported. FALSE otherwise
+             */
+            virtual bool isConcurrent() const;
+
+            /**
+             * Starts a group of messages written by the current thread, that must not be mixed with other threads ones.
+             * Only called for concurrent implementations. Groups can be nested.
+             */
+            virtual void beginGroup();
+
+            /**
+             * Ends a group of messages written by the current thread. Only called for concurrent implementations.
+             */
+            virtual void endGroup();
+
+            /**
+             * Writes all the pending messages. Default implementation does nothing.
+             */
+            virtual void flush();
+
             virtual ~LogImpl();
     };
 
@@ -0,0 +1,266 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#include "logimplasync.h"
+#include "threadcontroller.h"
+#include "autolock.h"
+#include "utils.h"
+
+#include <string.h>
+#include <time.h>
+#include <chrono>
+
+namespace openikev2 {
+    atomic<uint64_t> LogImplAsync::next_id( 1 );
+    thread_local LogImplAsync::ThreadRing LogImplAsync::thread_ring;
+
+    LogImplAsync::Ring::Ring( size_t size ) {
+        size_t real_size = 1024;
+        while ( real_size < size )
+            real_size <<= 1;
+
+        this->data = new uint8_t[ real_size ];
+        this->mask = real_size - 1;
+        this->head.store( 0, memory_order_relaxed );
+        this->tail.store( 0, memory_order_relaxed );
+        this->pending_head = 0;
+        this->group_depth = 0;
+        this->group_start = 0;
+        this->group_messages = 0;
+        this->group_dropped = false;
+        this->dropped.store( 0, memory_order_relaxed );
+        this->orphaned.store( false, memory_order_relaxed );
+    }
+
+    LogImplAsync::Ring::~Ring() {
+        delete[] this->data;
+    }
+
+    LogImplAsync::ThreadRing::~ThreadRing() {
+        if ( this->ring.get() != NULL ) {
+            // Publishes an unfinished group before leaving
+            this->ring->head.store( this->ring->pending_head, memory_order_release );
+            this->ring->orphaned.store( true, memory_order_release );
+        }
+    }
+
+    LogImplAsync::LogImplAsync( string filename, size_t ring_size ) {
+        this->id = next_id++;
+        this->ring_size = ring_size;
+        this->rings_mutex = ThreadController::getMutex();
+        this->drain_mutex = ThreadController::getMutex();
+        this->total_dropped.store( 0 );
+
+        this->file = filename.empty() ? NULL : fopen( filename.c_str(), "a" );
+        this->close_file = ( this->file != NULL );
+        if ( this->file == NULL )
+            this->file = stdout;
+
+        this->exiting = false;
+        this->writer = thread( &LogImplAsync::runWriter, this );
+    }
+
+    LogImplAsync::~LogImplAsync() {
+        this->exiting = true;
+        this->writer.join();
+
+        // Writes the messages published after the last writer iteration
+        this->flush();
+
+        if ( this->close_file )
+            fclose( this->file );
+    }
+
+    LogImplAsync::Ring& LogImplAsync::getRing() {
+        if ( thread_ring.ring.get() == NULL || thread_ring.owner_id != this->id ) {
+            shared_ptr<Ring> ring( new Ring( this->ring_size ) );
+
+            AutoLock auto_lock( *this->rings_mutex );
+            this->rings.push_back( ring );
+
+            // The previous Ring (if any) belongs to a former implementation, which keeps it alive if needed
+            thread_ring.owner_id = this->id;
+            thread_ring.ring = ring;
+        }
+
+        return *thread_ring.ring;
+    }
+
+    void LogImplAsync::copyIn( Ring& ring, size_t position, const void* data, size_t size ) {
+        size_t offset = position & ring.mask;
+        size_t first = min( size, ring.mask + 1 - offset );
+
+        memcpy( ring.data + offset, data, first );
+        memcpy( ring.data, ( const uint8_t* ) data + first, size - first );
+    }
+
+    void LogImplAsync::copyOut( Ring& ring, size_t position, void* data, size_t size ) {
+        size_t offset = position & ring.mask;
+        size_t first = min( size, ring.mask + 1 - offset );
+
+        memcpy( data, ring.data + offset, first );
+        memcpy( ( uint8_t* ) data + first, ring.data, size - first );
+    }
+
+    void LogImplAsync::writeMessage( string who, string message, uint16_t type, bool main_info ) {
+        Ring& ring = this->getRing();
+
+        RecordHeader header;
+        header.time_msec = chrono::duration_cast<chrono::milliseconds> ( chrono::system_clock::now().time_since_epoch() ).count();
+        header.who_size = who.size();
+        header.message_size = message.size();
+        header.type = type;
+        header.main_info = main_info;
+
+        size_t record_size = sizeof( RecordHeader ) + who.size() + message.size();
+        size_t used = ring.pending_head - ring.tail.load( memory_order_acquire );
+
+        // If there is no room, the message is dropped. The writer thread will report it
+        if ( ring.group_dropped || record_size > ring.mask + 1 - used ) {
+            ring.group_dropped = ( ring.group_depth > 0 );
+            ring.dropped.fetch_add( 1, memory_order_relaxed );
+            this->total_dropped.fetch_add( 1, memory_order_relaxed );
+            return;
+        }
+
+        copyIn( ring, ring.pending_head, &header, sizeof( RecordHeader ) );
+        copyIn( ring, ring.pending_head + sizeof( RecordHeader ), who.data(), who.size() );
+        copyIn( ring, ring.pending_head + sizeof( RecordHeader ) + who.size(), message.data(), message.size() );
+        ring.pending_head += record_size;
+        ring.group_messages++;
+
+        // Records inside a group are published when it ends
+        if ( ring.group_depth == 0 )
+            ring.head.store( ring.pending_head, memory_order_release );
+    }
+
+    bool LogImplAsync::isConcurrent() const {
+        return true;
+    }
+
+    void LogImplAsync::beginGroup() {
+        Ring& ring = this->getRing();
+
+        if ( ring.group_depth++ == 0 ) {
+            ring.group_start = ring.pending_head;
+            ring.group_messages = 0;
+            ring.group_dropped = false;
+        }
+    }
+
+    void LogImplAsync::endGroup() {
+        Ring& ring = this->getRing();
+
+        if ( ring.group_depth == 0 || --ring.group_depth > 0 )
+            return;
+
+        // An incomplete group is discarded as a whole. Its records were not published yet
+        if ( ring.group_dropped ) {
+            ring.pending_head = ring.group_start;
+            ring.dropped.fetch_add( ring.group_messages, memory_order_relaxed );
+            this->total_dropped.fetch_add( ring.group_messages, memory_order_relaxed );
+            ring.group_dropped = false;
+        }
+
+        ring.head.store( ring.pending_head, memory_order_release );
+    }
+
+    bool LogImplAsync::drainRing( Ring& ring ) {
+        size_t tail = ring.tail.load( memory_order_relaxed );
+        size_t head = ring.head.load( memory_order_acquire );
+        string output;
+
+        while ( tail != head ) {
+            RecordHeader header;
+            copyOut( ring, tail, &header, sizeof( RecordHeader ) );
+            tail += sizeof( RecordHeader );
+
+            string who( header.who_size, ' ' );
+            copyOut( ring, tail, &who[ 0 ], header.who_size );
+            tail += header.who_size;
+
+            string message( header.message_size, ' ' );
+            copyOut( ring, tail, &message[ 0 ], header.message_size );
+            tail += header.message_size;
+
+            if ( header.main_info ) {
+                time_t seconds = header.time_msec / 1000;
+                struct tm local_time;
+                char date[ 32 ];
+                localtime_r( &seconds, &local_time );
+                strftime( date, sizeof( date ), "%Y/%m/%d %H:%M:%S", &local_time );
+
+                char msec[ 8 ];
+                snprintf( msec, sizeof( msec ), ".%03d", ( int ) ( header.time_msec % 1000 ) );
+
+                output += "[" + string( date ) + msec + "] [" + Log::LOG_TYPE_STR( header.type ) + "] " + who + ": ";
+            }
+
+            output += message + "\n";
+        }
+
+        // Gives the space back to the producer once the records are copied
+        ring.tail.store( tail, memory_order_release );
+
+        uint64_t dropped = ring.dropped.exchange( 0, memory_order_relaxed );
+        if ( dropped > 0 )
+            output += "[" + Log::LOG_TYPE_STR( Log::LOG_WARN ) + "] LogImplAsync: " + intToString( dropped ) + " messages dropped (ring full)\n";
+
+        if ( output.empty() )
+            return false;
+
+        fwrite( output.data(), 1, output.size(), this->file );
+        return true;
+    }
+
+    bool LogImplAsync::drain() {
+        AutoLock drain_lock( *this->drain_mutex );
+
+        // Takes a snapshot of the rings, so producers can register meanwhile
+        vector<shared_ptr<Ring> > snapshot;
+        {
+            AutoLock rings_lock( *this->rings_mutex );
+            snapshot = this->rings;
+        }
+
+        bool written = false;
+        for ( vector<shared_ptr<Ring> >::iterator it = snapshot.begin(); it != snapshot.end(); it++ )
+            written = this->drainRing( **it ) || written;
+
+        if ( written )
+            fflush( this->file );
+
+        // Forgets the rings of finished threads once they are empty
+        AutoLock rings_lock( *this->rings_mutex );
+        vector<shared_ptr<Ring> >::iterator it = this->rings.begin();
+        while ( it != this->rings.end() ) {
+            Ring& ring = **it;
+            if ( ring.orphaned.load( memory_order_acquire ) && ring.tail.load( memory_order_relaxed ) == ring.head.load( memory_order_acquire ) )
+                it = this->rings.erase( it );
+            else
+                it++;
+        }
+
+        return written;
+    }
+
+    void LogImplAsync::runWriter() {
+        while ( !this->exiting ) {
+            if ( !this->drain() )
+                this_thread::sleep_for( chrono::milliseconds( LOG_ASYNC_WRITE_INTERVAL ) );
+        }
+    }
+
+    void LogImplAsync::flush() {
+        this->drain();
+    }
+
+    uint64_t LogImplAsync::getDroppedMessages() const {
+        return this->total_dropped.load( memory_order_relaxed );
+    }
+}
@@ -0,0 +1,162 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#ifndef OPENIKEV2LOGIMPLASYNC_H
+#define OPENIKEV2LOGIMPLASYNC_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "logimpl.h"
+#include "mutex.h"
+
+#include <stdio.h>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#define LOG_ASYNC_RING_SIZE         65536   // Default size (in bytes) of the per-thread rings
+#define LOG_ASYNC_WRITE_INTERVAL    10      // Milliseconds the writer thread sleeps when there are no pending messages
+
+namespace openikev2 {
+
+    /**
+        This class implements a concurrent LogImpl. Each thread writes its messages in its own lock-free ring buffer
+        (single producer, single consumer), and a background thread drains all of them to a file or to the standard output.
+        Memory is bounded: messages not fitting in the ring are dropped and counted. Message groups (Log::acquire() and
+        Log::release()) are published at once, so they are written together (or entirely dropped).
+        @author Pedro J. Fernandez Ruiz, Alejandro Perez Mendez <pedroj@um.es, alex@um.es>
+    */
+    class LogImplAsync : public LogImpl {
+
+            /****************************** STRUCTS ******************************/
+        protected:
+            /** Header of each record in the ring. It is followed by the "who" and the message texts */
+            struct RecordHeader {
+                int64_t time_msec;                      /**< Writing time (milliseconds since the epoch) */
+                uint32_t who_size;                      /**< Size of the "who" text */
+                uint32_t message_size;                  /**< Size of the message text */
+                uint16_t type;                          /**< Type of log message */
+                bool main_info;                         /**< Indicates if date must be writed */
+            };
+
+            /** Ring buffer of a writer thread */
+            struct Ring {
+                uint8_t* data;                          /**< Ring memory */
+                size_t mask;                            /**< Ring size - 1 (size is power of two) */
+                atomic<size_t> head;                    /**< Published write position. Written by the producer */
+                atomic<size_t> tail;                    /**< Read position. Written by the consumer */
+                size_t pending_head;                    /**< Write position, including the records not published yet */
+                uint32_t group_depth;                   /**< Nesting level of the current message group */
+                size_t group_start;                     /**< Write position where the current message group starts */
+                uint32_t group_messages;                /**< Messages written in the current message group */
+                bool group_dropped;                     /**< Indicates if the current message group is being dropped */
+                atomic<uint64_t> dropped;               /**< Messages dropped since the last report */
+                atomic<bool> orphaned;                  /**< Indicates that the producer thread has finished */
+
+                Ring( size_t size );
+                ~Ring();
+            };
+
+            /** Reference from a thread to its Ring. Marks the Ring as orphaned when the thread finishes */
+            struct ThreadRing {
+                uint64_t owner_id;                      /**< Identifier of the LogImplAsync owning the Ring */
+                shared_ptr<Ring> ring;                  /**< Ring of the thread */
+
+                ~ThreadRing();
+            };
+
+            /****************************** ATTRIBUTES ******************************/
+        protected:
+            static atomic<uint64_t> next_id;            /**< Next LogImplAsync identifier */
+            static thread_local ThreadRing thread_ring; /**< Ring of the current thread */
+
+            uint64_t id;                                /**< Identifier of this LogImplAsync */
+            FILE* file;                                 /**< Output file */
+            bool close_file;                            /**< Indicates if the file must be closed on destruction */
+            size_t ring_size;                           /**< Size of the rings */
+            auto_ptr<Mutex> rings_mutex;                /**< Mutex protecting the rings collection */
+            vector<shared_ptr<Ring> > rings;            /**< Rings of all the writer threads */
+            auto_ptr<Mutex> drain_mutex;                /**< Mutex serializing the draining of the rings */
+            atomic<uint64_t> total_dropped;             /**< Total dropped messages */
+            atomic<bool> exiting;                       /**< Indicates if the writer thread must finish */
+            thread writer;                              /**< Writer thread */
+
+            /****************************** METHODS ******************************/
+        protected:
+            /**
+             * Gets the Ring of the current thread, registering a new one if needed
+             * @return The Ring of the current thread
+             */
+            Ring& getRing();
+
+            /**
+             * Copies data into the ring at the indicated position, wrapping around its end
+             * @param ring Ring
+             * @param position Write position
+             * @param data Data to be copied
+             * @param size Data size
+             */
+            static void copyIn( Ring& ring, size_t position, const void* data, size_t size );
+
+            /**
+             * Copies data from the ring at the indicated position, wrapping around its end
+             * @param ring Ring
+             * @param position Read position
+             * @param data Destination buffer
+             * @param size Data size
+             */
+            static void copyOut( Ring& ring, size_t position, void* data, size_t size );
+
+            /**
+             * Writes all the published records of every Ring to the file
+             * @return TRUE if some record was written. FALSE otherwise
+             */
+            bool drain();
+
+            /**
+             * Writes all the published records of a Ring to the file
+             * @param ring Ring to be drained
+             * @return TRUE if some record was written. FALSE otherwise
+             */
+            bool drainRing( Ring& ring );
+
+            /**
+             * Main loop of the writer thread
+             */
+            void runWriter();
+
+        public:
+            /**
+             * Creates a new LogImplAsync writing to a file, and starts its writer thread
+             * @param filename File name. If empty or cannot be opened, the standard output is used
+             * @param ring_size Size (in bytes) of each thread ring
+             */
+            LogImplAsync( string filename, size_t ring_size = LOG_ASYNC_RING_SIZE );
+
+            /**
+             * Gets the number of messages dropped because their thread ring was full
+             * @return Number of dropped messages
+             */
+            uint64_t getDroppedMessages() const;
+
+            virtual void writeMessage( string who, string message, uint16_t type, bool main_info );
+            virtual bool isConcurrent() const;
+            virtual void beginGroup();
+            virtual void endGroup();
+            virtual void flush();
+
+            /**
+             * Stops the writer thread, writing all the pending messages
+             */
+            virtual ~LogImplAsync();
+    };
+}
+
+#endif
@@ -9,8 +9,10 @@
 
 #include "message.h"
 #include "payloadfactory.h"
+#include "bytearrayview.h"
 #include "exception.h"
 #include "log.h"
+#include <netinet/in.h>
 #include <string.h>
 
 namespace openikev2 {
@@ -30,57 +32,67 @@ namespace openikev2 {
 
         this->first_payload_type = Payload::PAYLOAD_NONE;
         this->first_payload_type_sk = Payload::PAYLOAD_NONE;
+        this->lazy_parsing = false;
     }
 
-    Message::Message( auto_ptr<SocketAddress> src_addr, auto_ptr<SocketAddress> dst_addr, ByteBuffer& byte_buffer ) {
+    Message::Message( auto_ptr<SocketAddress> src_addr, auto_ptr<SocketAddress> dst_addr, ByteBuffer& byte_buffer, bool lazy_parsing ) {
         this->src_addr = src_addr;
         this->dst_addr = dst_addr;
         this->first_payload_type_sk = Payload::PAYLOAD_NONE;
+        this->lazy_parsing = lazy_parsing;
 
-        // get a copy of the message binary representation
-        this->binary_representation = byte_buffer.clone();
+        // get a copy of the received data. Parsed payloads refer to it instead of copying their fields
+        this->received_buffer.reset( new ByteBuffer( byte_buffer ) );
+        ByteBuffer& data_buffer = *this->received_buffer;
+
+        // the binary representation is the received data itself
+        this->binary_representation.reset( new ByteArrayView( data_buffer.getReadPosition(), data_buffer.size() ) );
 
         // Size must be at least size of fixed header
-        if ( byte_buffer.size() < 28 )
-            throw ParsingException( "Buffer seems to be too small to contain a Message: " + intToString( byte_buffer.size() ) );
+        if ( data_buffer.size() < 28 )
+            throw ParsingException( "Buffer seems to be too small to contain a Message: " + intToString( data_buffer.size() ) );
 
         // Reads Initiator SPI
-        byte_buffer.readBuffer( 8, &this->spi_i );
+        data_buffer.readBuffer( 8, &this->spi_i );
 
         // Reads Responder SPI
-        byte_buffer.readBuffer( 8, &this->spi_r );
+        data_buffer.readBuffer( 8, &this->spi_r );
 
         // reads the first payload type
-        this->first_payload_type = ( Payload::PAYLOAD_TYPE ) byte_buffer.readInt8();
+        this->first_payload_type = ( Payload::PAYLOAD_TYPE ) data_buffer.readInt8();
 
         // Reads version numbers
-        uint8_t version = byte_buffer.readInt8();
+        uint8_t version = data_buffer.readInt8();
         this->major_version = ( version & 0xF0 ) >> 4;
         this->minor_version = ( version & 0x0F );
 
         // Reads exchange type
-        this->exchange_type = ( EXCHANGE_TYPE ) byte_buffer.readInt8();
+        this->exchange_type = ( EXCHANGE_TYPE ) data_buffer.readInt8();
 
         // Reads Flags
-        uint8_t flags = byte_buffer.readInt8();
+        uint8_t flags = data_buffer.readInt8();
         this->is_initiator = ( flags & 0x08 );
         this->message_type = ( MESSAGE_TYPE ) ( ( flags & 0x20 ) >> 5 );
         this->can_use_higher_major_version = ( flags & 0x10 );
 
         // Reads message ID
-        this->message_id = byte_buffer.readInt32();
+        this->message_id = data_buffer.readInt32();
 
         // Reads message size
-        uint32_t message_length = byte_buffer.readInt32();
+        uint32_t message_length = data_buffer.readInt32();
 
         // Checks message length
-        if ( byte_buffer.size() + 28 != message_length )
-            throw ParsingException( "Indicated message length and real message length don't match. real_length=" + intToString( byte_buffer.size() + 28 ) + " indicated_length=" + intToString( message_length ) );
+        if ( data_buffer.size() + 28 != message_length )
+            throw ParsingException( "Indicated message length and real message length don't match. real_length=" + intToString( data_buffer.size() + 28 ) + " indicated_length=" + intToString( message_length ) );
 
-        // generate unencrypted payloads
-        Payload::PAYLOAD_TYPE last_next_payload_type = Message::generatePayloads( this->first_payload_type, byte_buffer, this->unencrypted_payloads.get() );
+        // generate unencrypted payloads (or just their locations)
+        Payload::PAYLOAD_TYPE last_next_payload_type;
+        if ( this->lazy_parsing )
+            last_next_payload_type = Message::scanPayloads( this->first_payload_type, data_buffer, this->unencrypted_payloads.get(), this->unencrypted_locations );
+        else
+            last_next_payload_type = Message::generatePayloads( this->first_payload_type, data_buffer, this->unencrypted_payloads.get() );
 
-        // get the payload_sk (if exists)
+        // get the payload_sk (if exists). It is always decoded
         Payload* payload_sk = this->getFirstPayloadByType( Payload::PAYLOAD_SK );
 
         // If there is a Payload_SK in the Message
@@ -92,6 +104,8 @@ namespace openikev2 {
             // store it in the special attribute and pop it from the collection
             this->payload_sk.reset( ( Payload_SK* ) payload_sk );
             this->unencrypted_payloads->pop_back();
+            if ( !this->unencrypted_locations.empty() )
+                this->unencrypted_locations.pop_back();
 
             // stores the first payload type of the payload_sk
             this->first_payload_type_sk = last_next_payload_type;
@@ -104,6 +118,10 @@ namespace openikev2 {
     }
 
     Message::Message( const Message & other ) {
+        // clones are always fully decoded
+        other.decodeAllPayloads();
+        this->lazy_parsing = false;
+
         this->can_use_higher_major_version = other.can_use_higher_major_version;
         this->major_version = other.major_version;
         this->minor_version = other.minor_version;
@@ -155,7 +173,7 @@ namespace openikev2 {
                     throw UnknownPayloadException( "Unknonwn critical payload: " + Payload::PAYLOAD_TYPE_STR( current_payload_type ), current_payload_type );
 
                 // if it is not critical
-                Log::writeLockedMessage( "Message", "Unknown payload type=[" + intToString( current_payload_type ) + "]", Log::LOG_ERRO, true );
+                LOG_LOCKED_MESSAGE( "Message", "Unknown payload type=[" + intToString( current_payload_type ) + "]", Log::LOG_ERRO, true );
             }
 
             // If payload is known
@@ -181,40 +199,142 @@ namespace openikev2 {
         return next_payload_type;
     }
 
-    auto_ptr< ByteArray > Message::generateBinaryRepresentation( Payload::PAYLOAD_TYPE last_payload_type, const vector< Payload * > payloads ) {
-        auto_ptr<ByteBuffer> byte_buffer ( new ByteBuffer( MAX_MESSAGE_SIZE ) );
+    Payload::PAYLOAD_TYPE Message::scanPayloads( Payload::PAYLOAD_TYPE first_payload_type, ByteBuffer& byte_buffer, vector<Payload*> &payloads, vector<PayloadLocation> &locations ) {
+        Payload::PAYLOAD_TYPE current_payload_type = first_payload_type;
+        Payload::PAYLOAD_TYPE next_payload_type = Payload::PAYLOAD_NONE;
+
+        // while data available
+        while ( byte_buffer.size() > 0 && current_payload_type != Payload::PAYLOAD_NONE ) {
+            // reads next payload type
+            next_payload_type = ( Payload::PAYLOAD_TYPE ) byte_buffer.readInt8();
+
+            // reads critical bit
+            uint8_t critical = byte_buffer.readInt8() >> 7;
+
+            // reads the payload length and skips the payload body
+            uint8_t* position = byte_buffer.getReadPosition();
+            uint16_t payload_length = byte_buffer.readInt16();
+
+            if ( payload_length < 4 )
+                throw ParsingException( "Payload length cannot be < 4 bytes: " + Payload::PAYLOAD_TYPE_STR( current_payload_type ) );
+
+            byte_buffer.skip( payload_length - 4 );
+
+            // if the payload is unknown
+            if ( !PayloadFactory::isKnownPayloadType( current_payload_type ) ) {
+                // if the payload is critical
+                if ( critical )
+                    throw UnknownPayloadException( "Unknonwn critical payload: " + Payload::PAYLOAD_TYPE_STR( current_payload_type ), current_payload_type );
+
+                // if it is not critical
+                LOG_LOCKED_MESSAGE( "Message", "Unknown payload type=[" + intToString( current_payload_type ) + "]", Log::LOG_ERRO, true );
+            }
+
+            // If payload is known, records its location
+            else {
+                PayloadLocation location;
+                location.type = current_payload_type;
+                location.byte_buffer = &byte_buffer;
+                location.position = position;
+                location.length = payload_length;
+
+                payloads.push_back( NULL );
+                locations.push_back( location );
+            }
+
+            // updates the current payload type
+            current_payload_type = next_payload_type;
+        }
+
+        // If next payload = 0 and there is still data available, then report error
+        if ( byte_buffer.size() > 0 )
+            throw ParsingException( "Message has more data than needed. Found premature next_payload=0" );
+
+        // if there isn't more data and the next_payload is not 0 and the last payload is not an payload_sk, then report error
+        if ( byte_buffer.size() == 0 && current_payload_type != Payload::PAYLOAD_NONE && locations.size() > 0 &&
+                locations.back().type != Payload::PAYLOAD_SK )
+            throw ParsingException( "Message must end with next_payload=0 or next_payload=PAYLOAD_SK" );
+
+        // return the next payload type of the last fixed payload header
+        return next_payload_type;
+    }
+
+    auto_ptr<Payload> Message::decodePayload( const PayloadLocation& location ) {
+        ByteBuffer& byte_buffer = *location.byte_buffer;
+        byte_buffer.setReadPosition( location.position );
+
+        auto_ptr<Payload> payload = PayloadFactory::createPayload( location.type, byte_buffer );
+
+        // the payload must use exactly the length indicated in its header
+        if ( byte_buffer.getReadPosition() != location.position + location.length - 2 )
+            throw ParsingException( "Payload length doesn't match its contents: " + Payload::PAYLOAD_TYPE_STR( location.type ) );
+
+        return payload;
+    }
+
+    void Message::decodePayloadsByType( Payload::PAYLOAD_TYPE type ) const {
+        for ( uint32_t i = 0; i < this->unencrypted_locations.size(); i++ ) {
+            if ( this->unencrypted_payloads[ i ] == NULL && this->unencrypted_locations[ i ].type == type )
+                this->unencrypted_payloads[ i ] = Message::decodePayload( this->unencrypted_locations[ i ] ).release();
+        }
 
+        for ( uint32_t i = 0; i < this->encrypted_locations.size(); i++ ) {
+            if ( this->encrypted_payloads[ i ] == NULL && this->encrypted_locations[ i ].type == type )
+                this->encrypted_payloads[ i ] = Message::decodePayload( this->encrypted_locations[ i ] ).release();
+        }
+    }
+
+    void Message::decodeAllPayloads() const {
+        for ( uint32_t i = 0; i < this->unencrypted_locations.size(); i++ ) {
+            if ( this->unencrypted_payloads[ i ] == NULL )
+                this->unencrypted_payloads[ i ] = Message::decodePayload( this->unencrypted_locations[ i ] ).release();
+        }
+        this->unencrypted_locations.clear();
+
+        for ( uint32_t i = 0; i < this->encrypted_locations.size(); i++ ) {
+            if ( this->encrypted_payloads[ i ] == NULL )
+                this->encrypted_payloads[ i ] = Message::decodePayload( this->encrypted_locations[ i ] ).release();
+        }
+        this->encrypted_locations.clear();
+    }
+
+    void Message::writePayloads( ByteBuffer& byte_buffer, Payload::PAYLOAD_TYPE last_payload_type, const vector< Payload * >& payloads ) {
         // writes all the payloads
         for ( vector<Payload*>::const_iterator it = payloads.begin(); it != payloads.end(); it++ ) {
             // writes the next_payload_type
             if ( it < payloads.end() - 1 )
-                byte_buffer->writeInt8( ( *( it + 1 ) ) ->type );
+                byte_buffer.writeInt8( ( *( it + 1 ) ) ->type );
             else
-                byte_buffer->writeInt8( last_payload_type );
+                byte_buffer.writeInt8( last_payload_type );
 
             // writes reserved bytes
-            byte_buffer->fillBytes( 1, 0 );
+            byte_buffer.fillBytes( 1, 0 );
 
             // writes payload
-            ( *it ) ->getBinaryRepresentation( *byte_buffer );
+            ( *it ) ->getBinaryRepresentation( byte_buffer );
         }
-
-        return auto_ptr<ByteArray> ( byte_buffer );
     }
 
+    ByteBuffer& Message::getSerializationBuffer() {
+        static thread_local ByteBuffer serialization_buffer( MAX_MESSAGE_SIZE );
+        return serialization_buffer;
+    }
 
     vector< Payload * > Message::getPayloadsByType( Payload::PAYLOAD_TYPE type ) const {
         vector<Payload*> result;
 
+        // decodes the payloads of this type, if still not decoded. Other payloads can remain NULL
+        this->decodePayloadsByType( type );
+
         // search in the unencrypted payloads
         for ( vector<Payload*>::const_iterator it = this->unencrypted_payloads->begin(); it != this->unencrypted_payloads->end(); it++ ) {
-            if ( ( *it ) ->type == type )
+            if ( ( *it ) != NULL && ( *it ) ->type == type )
                 result.push_back( *it );
         }
 
         // seatch in the encrypted payloads
         for ( vector<Payload*>::const_iterator it = this->encrypted_payloads->begin(); it != this->encrypted_payloads->end(); it++ ) {
-            if ( ( *it ) ->type == type )
+            if ( ( *it ) != NULL && ( *it ) ->type == type )
                 result.push_back( *it );
         }
 
@@ -276,6 +396,9 @@ namespace openikev2 {
 
     void Message::addPayload( auto_ptr<Payload> payload, bool is_encrypted ) {
         assert ( payload.get() );
+        // the collections are modified, so every payload must be decoded
+        this->decodeAllPayloads();
+
 
         // this method invalidate the cached binary representation
         this->binary_representation.reset( NULL );
@@ -295,6 +418,9 @@ namespace openikev2 {
 
     void Message::addPayloadNotify( auto_ptr<Payload_NOTIFY> notify_payload, bool is_encrypted ) {
         assert ( notify_payload.get() );
+        // the collections are modified, so every payload must be decoded
+        this->decodeAllPayloads();
+
 
         // this method invalidate the cached binary representation
         this->binary_representation.reset( NULL );
@@ -317,80 +443,83 @@ namespace openikev2 {
         if ( this->binary_representation.get() )
             return * this->binary_representation;
 
-        // Buffer to store the payload binary representation
-        auto_ptr<ByteArray> payloads_binary_representation;
+        this->decodeAllPayloads();
 
-        // When a Payload_SK must be included
-        if ( cipher != NULL ) {
-            // creates the Payload_SK
-            auto_ptr<ByteArray> to_be_encrypted = Message::generateBinaryRepresentation( Payload::PAYLOAD_NONE, this->encrypted_payloads.get() );
-            this->payload_sk.reset( new Payload_SK( *cipher, *to_be_encrypted ) );
-
-            // Adds it at the end of a temporal collection
-            vector<Payload*> real_unencrypted_payloads = this->unencrypted_payloads.get();
-            real_unencrypted_payloads.push_back( this->payload_sk.get() );
+        // The whole Message is written once in the serialization buffer, encrypting the Payload_SK contents in place
+        ByteBuffer& byte_buffer = Message::getSerializationBuffer();
+        byte_buffer.reset();
 
-            // generates the binary representation of the temporal collection
+        if ( cipher != NULL ) {
             this->first_payload_type_sk = ( this->encrypted_payloads->size() > 0 ) ? this->encrypted_payloads->front() ->type : Payload::PAYLOAD_NONE;
             this->first_payload_type = ( this->unencrypted_payloads->size() > 0 ) ? this->unencrypted_payloads->front() ->type : Payload::PAYLOAD_SK;
-
-            payloads_binary_representation = Message::generateBinaryRepresentation( this->first_payload_type_sk, real_unencrypted_payloads );
         }
-
-        // When no Payload_SK is needed
         else {
             this->first_payload_type = ( this->unencrypted_payloads->size() > 0 ) ? this->unencrypted_payloads->front() ->type : Payload::PAYLOAD_NONE;
-            payloads_binary_representation = Message::generateBinaryRepresentation( Payload::PAYLOAD_NONE, this->unencrypted_payloads.get() );
         }
 
-        // generate the message in a new ByteBuffer
-        auto_ptr<ByteBuffer> byte_buffer ( new ByteBuffer( MAX_MESSAGE_SIZE ) );
-
         // writes initiator SPI
-        byte_buffer->writeBuffer ( &this->spi_i, 8 );
+        byte_buffer.writeBuffer ( &this->spi_i, 8 );
 
         // writes responder SPI
-        byte_buffer->writeBuffer ( &this->spi_r, 8 );
+        byte_buffer.writeBuffer ( &this->spi_r, 8 );
 
         // Writes first payload type
-        byte_buffer->writeInt8( this->first_payload_type );
+        byte_buffer.writeInt8( this->first_payload_type );
 
         // Writes version numbers
-        byte_buffer->writeInt8( ( this->major_version << 4 ) | ( this->minor_version & 0x0F ) );
+        byte_buffer.writeInt8( ( this->major_version << 4 ) | ( this->minor_version & 0x0F ) );
 
         // Writes exchange type
-        byte_buffer->writeInt8( this->exchange_type );
+        byte_buffer.writeInt8( this->exchange_type );
 
         // Writes Flags
-        byte_buffer->writeInt8( ( this->is_initiator << 3 ) | ( ( uint8_t ) this->message_type << 5 ) | ( this->can_use_higher_major_version << 4 ) );
+        byte_buffer.writeInt8( ( this->is_initiator << 3 ) | ( ( uint8_t ) this->message_type << 5 ) | ( this->can_use_higher_major_version << 4 ) );
 
         // Writes message ID
-        byte_buffer->writeInt32( this->message_id );
+        byte_buffer.writeInt32( this->message_id );
 
-        // writes the message length
-        byte_buffer->writeInt32( 28 + payloads_binary_representation->size() );
+        // writes a provisional message length
+        uint8_t* message_length_position = byte_buffer.getWritePosition();
+        byte_buffer.writeInt32( 0 );
 
-        // Generate the payloads binary representation
-        byte_buffer->writeByteArray( *payloads_binary_representation );
+        // When a Payload_SK must be included
+        uint8_t* payload_sk_length_position = NULL;
+        if ( cipher != NULL ) {
+            Message::writePayloads( byte_buffer, Payload::PAYLOAD_SK, this->unencrypted_payloads.get() );
 
-        // Check if message is large
-        if ( byte_buffer->size() > WARNING_MESSAGE_SIZE )
-            Log::writeMessage( "Message", "A message exceeds the WARN limit size (" + intToString( WARNING_MESSAGE_SIZE ) + " bytes). You may want to use HASH & URL certificate.", Log::LOG_WARN, true );
+            // writes the Payload_SK generic header
+            byte_buffer.writeInt8( this->first_payload_type_sk );
+            byte_buffer.fillBytes( 1, 0 );
 
-        // writes the binary representation
-        this->binary_representation = byte_buffer;
+            // writes the encrypted payloads inside the Payload_SK
+            payload_sk_length_position = Payload_SK::beginBinaryRepresentation( *cipher, byte_buffer );
+            Message::writePayloads( byte_buffer, Payload::PAYLOAD_NONE, this->encrypted_payloads.get() );
+            Payload_SK::endBinaryRepresentation( *cipher, byte_buffer, payload_sk_length_position );
 
-        // get the integrity checksum if needed
-        if ( cipher != NULL ) {
-            // obtain the checksum
-            auto_ptr<ByteArray> message_data ( new ByteArray ( this->binary_representation->getRawPointer(), this->binary_representation->size() - cipher->integ_hash_size ) );
-            auto_ptr<ByteArray> integrity_checksum = cipher->computeIntegrity( *message_data );
+            // Payload_SK only lives in the binary representation of the outgoing Messages
+            this->payload_sk.reset( NULL );
+        }
 
-            // writes it in the end of the message
-            uint8_t* position = &this->binary_representation->getRawPointer() [ this->binary_representation->size() - integrity_checksum->size() ];
-            memcpy( position, integrity_checksum->getRawPointer(), integrity_checksum->size() );
+        // When no Payload_SK is needed
+        else {
+            Message::writePayloads( byte_buffer, Payload::PAYLOAD_NONE, this->unencrypted_payloads.get() );
         }
 
+        // sets the message length
+        uint32_t message_length = htonl( byte_buffer.size() );
+        memcpy( message_length_position, &message_length, 4 );
+
+        // Check if message is large
+        if ( byte_buffer.size() > WARNING_MESSAGE_SIZE )
+            LOG_MESSAGE( "Message", "A message exceeds the WARN limit size (" + intToString( WARNING_MESSAGE_SIZE ) + " bytes). You may want to use HASH & URL certificate.", Log::LOG_WARN, true );
+
+        // writes the integrity checksum in the end of the message if needed (AEAD ciphers encrypt the Payload_SK now)
+        if ( cipher != NULL )
+            Payload_SK::sealBinaryRepresentation( *cipher, byte_buffer.getRawPointer(), payload_sk_length_position, byte_buffer.getWritePosition() );
+
+        // stores an exact-size copy of the binary representation
+        this->binary_representation.reset( new ByteArray( byte_buffer.getRawPointer(), byte_buffer.size() ) );
+
         return *this->binary_representation;
     }
 
@@ -399,14 +528,18 @@ namespace openikev2 {
         if ( cipher == NULL )
             return ;
 
-        auto_ptr<ByteArray> decrypted_body = this->payload_sk->getDecryptedBody( *cipher );
-
-        ByteBuffer byte_buffer( *decrypted_body );
+        // the decrypted data is kept, since the generated Payloads refer to it
+        this->decrypted_buffer.reset( new ByteBuffer( this->payload_sk->getDecryptedBody( *cipher ) ) );
 
-        Message::generatePayloads( this->first_payload_type_sk, byte_buffer, this->encrypted_payloads.get() );
+        if ( this->lazy_parsing )
+            Message::scanPayloads( this->first_payload_type_sk, *this->decrypted_buffer, this->encrypted_payloads.get(), this->encrypted_locations );
+        else
+            Message::generatePayloads( this->first_payload_type_sk, *this->decrypted_buffer, this->encrypted_payloads.get() );
     }
 
     string Message::toStringTab( uint8_t tabs ) const {
+        this->decodeAllPayloads();
+
         ByteBuffer temp( 100 );
 
         ostringstream oss;
@@ -457,15 +590,21 @@ namespace openikev2 {
         if ( cipher == NULL )
             return true;
 
-        ByteBuffer byte_buffer( *this->binary_representation );
+        // AEAD ciphers check the ICV while decrypting the Payload_SK
+        if ( cipher->is_aead )
+            return this->payload_sk.get() != NULL && this->payload_sk->decryptAuthenticated( *cipher, *this->binary_representation );
+
+        if ( this->binary_representation->size() < cipher->integ_hash_size )
+            return false;
 
-        auto_ptr<ByteArray> message_data = byte_buffer.readByteArray( this->binary_representation->size() - cipher->integ_hash_size );
-        auto_ptr<ByteArray> message_integrity_checksum = byte_buffer.readByteArray( cipher->integ_hash_size );
+        uint32_t message_data_size = this->binary_representation->size() - cipher->integ_hash_size;
+        ByteArrayView message_data( this->binary_representation->getRawPointer(), message_data_size );
+        ByteArrayView message_integrity_checksum( this->binary_representation->getRawPointer() + message_data_size, cipher->integ_hash_size );
 
         // computes the expected integrity checksum
-        auto_ptr<ByteArray> computed_integrity_checksum = cipher->computeIntegrity( *message_data );
+        auto_ptr<ByteArray> computed_integrity_checksum = cipher->computeIntegrity( message_data );
 
-        return ( *computed_integrity_checksum == *message_integrity_checksum );
+        return ( *computed_integrity_checksum == message_integrity_checksum );
     }
 
     auto_ptr<Message> Message::clone() const {
@@ -473,6 +612,9 @@ namespace openikev2 {
     }
 
     void Message::replaceFirstPayloadByType( Payload::PAYLOAD_TYPE type, auto_ptr< Payload > new_payload ) {
+        // the collections are modified, so every payload must be decoded
+        this->decodeAllPayloads();
+
         // this method invalidate the cached binary representation
         this->binary_representation.reset( NULL );
 
@@ -483,19 +625,22 @@ namespace openikev2 {
                 ( *it ) = new_payload.release();
                 return ;
             }
+        }
 
-            // seatch in the encrypted payloads
-            for ( vector<Payload*>::iterator it = this->encrypted_payloads->begin(); it != this->encrypted_payloads->end(); it++ ) {
-                if ( ( *it ) ->type == type ) {
-                    delete ( *it );
-                    ( *it ) = new_payload.release();
-                    return ;
-                }
+        // search in the encrypted payloads
+        for ( vector<Payload*>::iterator it = this->encrypted_payloads->begin(); it != this->encrypted_payloads->end(); it++ ) {
+            if ( ( *it ) ->type == type ) {
+                delete ( *it );
+                ( *it ) = new_payload.release();
+                return ;
             }
         }
     }
 
     void Message::replaceFirstNotifyByType( Payload_NOTIFY::NOTIFY_TYPE notify_type, auto_ptr< Payload_NOTIFY > new_payload ) {
+        // the collections are modified, so every payload must be decoded
+        this->decodeAllPayloads();
+
         // this method invalidate the cached binary representation
         this->binary_representation.reset( NULL );
 
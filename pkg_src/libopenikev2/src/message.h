@@ -47,10 +47,25 @@ namespace openikev2 {
                 RESPONSE            /**< Response */
             };
 
+            /****************************** STRUCTS ******************************/
+        protected:
+            /** Location of a received Payload, recorded while scanning the generic payload headers */
+            struct PayloadLocation {
+                Payload::PAYLOAD_TYPE type;                 /**< Payload type */
+                ByteBuffer* byte_buffer;                    /**< Buffer containing the Payload */
+                uint8_t* position;                          /**< Position of the "payload length" field */
+                uint16_t length;                            /**< Payload length, including the generic header */
+            };
+
             /****************************** ATTRIBUTES ******************************/
         protected:
-            AutoVector<Payload> unencrypted_payloads;   /**< Unencrypted Payload collection. */
-            AutoVector<Payload> encrypted_payloads;     /**< Encrypted Payload collection. */
+            auto_ptr<ByteBuffer> received_buffer;       /**< Copy of the received data. Parsed Payloads refer to it. */
+            auto_ptr<ByteBuffer> decrypted_buffer;      /**< Decrypted Payload_SK data. Decrypted Payloads refer to it. */
+            mutable AutoVector<Payload> unencrypted_payloads;       /**< Unencrypted Payload collection. NULL for the still not decoded ones. */
+            mutable AutoVector<Payload> encrypted_payloads;         /**< Encrypted Payload collection. NULL for the still not decoded ones. */
+            mutable vector<PayloadLocation> unencrypted_locations;  /**< Locations of the unencrypted Payloads (empty when all are decoded) */
+            mutable vector<PayloadLocation> encrypted_locations;    /**< Locations of the encrypted Payloads (empty when all are decoded) */
+            bool lazy_parsing;                                      /**< Indicates if the received Payloads are decoded on first access */
             Payload::PAYLOAD_TYPE first_payload_type;   /**< The type of the first payload in the mensage */
             Payload::PAYLOAD_TYPE first_payload_type_sk;/**< The type of the first payload in the payload_sk */
             auto_ptr<ByteArray> binary_representation;  /**< Message binary representation. */
@@ -82,12 +97,41 @@ namespace openikev2 {
             static Payload::PAYLOAD_TYPE generatePayloads( Payload::PAYLOAD_TYPE first_payload_type, ByteBuffer& byte_buffer, vector<Payload*> &payloads );
 
             /**
-             * Generates the binary representation of a Payload collection
-             * @param last_payload_type The last payload type
+             * Scans the generic payload headers, recording the location of each Payload without decoding it
+             * @param first_payload_type Type of the first payload
+             * @param byte_buffer Concatenated binary representation of the payloads
+             * @param payloads Collection to be filled by this method with a NULL entry for each known Payload
+             * @param locations Collection to be filled by this method with the location of each known Payload
+             * @return The next payload type of the last fixed payload header
+             */
+            static Payload::PAYLOAD_TYPE scanPayloads( Payload::PAYLOAD_TYPE first_payload_type, ByteBuffer& byte_buffer, vector<Payload*> &payloads, vector<PayloadLocation> &locations );
+
+            /**
+             * Decodes a scanned Payload
+             * @param location Location of the Payload
+             * @return The decoded Payload
+             */
+            static auto_ptr<Payload> decodePayload( const PayloadLocation& location );
+
+            /**
+             * Decodes the still not decoded Payloads of the indicated type
+             * @param type Type of the Payloads
+             */
+            void decodePayloadsByType( Payload::PAYLOAD_TYPE type ) const;
+
+            /**
+             * Writes the binary representation of a Payload collection (including the generic payload headers)
+             * @param byte_buffer Buffer where the Payloads will be written
+             * @param last_payload_type The next payload type of the last Payload
              * @param payloads Payload Collection
-             * @return Binary representation of the Payloads
              */
-            static auto_ptr<ByteArray> generateBinaryRepresentation( Payload::PAYLOAD_TYPE last_payload_type, const vector<Payload*> payloads );
+            static void writePayloads( ByteBuffer& byte_buffer, Payload::PAYLOAD_TYPE last_payload_type, const vector<Payload*>& payloads );
+
+            /**
+             * Gets the per-thread buffer where the Messages are serialized before storing their exact-size binary representation
+             * @return The serialization buffer of the calling thread
+             */
+            static ByteBuffer& getSerializationBuffer();
 
         public:
             /**
@@ -111,8 +155,10 @@ namespace openikev2 {
              * @param src_addr Source address
              * @param dst_addr Destination address
              * @param byte_buffer Buffer containing the binary representation of the message
+             * @param lazy_parsing If TRUE, only the generic payload headers are parsed, and each Payload is decoded the first time
+             * its type is requested. Decoding errors are then reported by the Payload accessors.
              */
-            Message( auto_ptr<SocketAddress> src_addr, auto_ptr<SocketAddress> dst_addr, ByteBuffer& byte_buffer );
+            Message( auto_ptr<SocketAddress> src_addr, auto_ptr<SocketAddress> dst_addr, ByteBuffer& byte_buffer, bool lazy_parsing = false );
 
             /**
              * Creates a new Message cloning another one
@@ -220,6 +266,12 @@ namespace openikev2 {
              */
             void decryptPayloadSK( Cipher *cipher );
 
+            /**
+             * Decodes all the still not decoded Payloads. Received messages are decoded before being processed, so a
+             * malformed Payload is reported here instead of by the Payload accessors
+             */
+            void decodeAllPayloads() const;
+
             /**
              * Checks the Message integrity
              * @param cipher Cipher used to check integrity (NULL if not applicable)
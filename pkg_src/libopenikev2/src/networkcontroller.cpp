@@ -92,6 +92,11 @@ namespace openikev2 {
         implementation->sendMessage( message, cipher );
     }
 
+    void NetworkController::retransmitMessage( Message & message ) {
+        assert ( implementation != NULL );
+        implementation->retransmitMessage( message );
+    }
+
     void NetworkController::addSrcAddress( auto_ptr< IpAddress > new_src_address ) {
         assert ( implementation != NULL );
         implementation->addSrcAddress ( new_src_address );
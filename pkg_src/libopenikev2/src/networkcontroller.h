@@ -114,6 +114,12 @@ namespace openikev2 {
              */
             static void sendMessage( Message &message, Cipher* cipher );
 
+            /**
+             * Sends again an already sent Message to the peer, without generating nor encrypting it again
+             * @param message Message to be retransmitted
+             */
+            static void retransmitMessage( Message &message );
+
             /**
              * Adds a new source address to receive from
              * @param new_src_address New source address
@@ -46,6 +46,10 @@ namespace openikev2 {
         this->registerNotifyController( Payload_NOTIFY::HTTP_CERT_LOOKUP_SUPPORTED, auto_ptr<NotifyController> ( new NotifyController_HTTP_CERT_LOOKUP_SUPPORTED() ) );
     }
 
+    void NetworkControllerImpl::retransmitMessage( Message & message ) {
+        this->sendMessage( message, NULL );
+    }
+
     NetworkControllerImpl::~NetworkControllerImpl() {
         for ( map<uint16_t, NotifyController*>::iterator it = this->notify_controllers.begin(); it != this->notify_controllers.end(); it++ )
             delete it->second;
@@ -93,6 +93,13 @@ namespace openikev2 {
              */
             virtual void sendMessage( Message &message, Cipher* cipher ) = 0;
 
+            /**
+             * Sends again an already sent Message, using the wire bytes cached as its binary representation.
+             * The default implementation relies on sendMessage() without Cipher, since the cached bytes are returned as they are.
+             * @param message Message to be retransmitted
+             */
+            virtual void retransmitMessage( Message &message );
+
             /**
              * Adds a new source address to receive from
              * @param new_src_address New source address
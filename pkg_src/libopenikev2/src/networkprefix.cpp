@@ -12,28 +12,26 @@
 #include "exception.h"
 #include "networkcontroller.h"
 
+#include <string.h>
+
 namespace openikev2 {
 
     NetworkPrefix::NetworkPrefix( auto_ptr< IpAddress > network_address, uint16_t prefixlen ) {
+        if ( network_address->getAddressSize() > sizeof( this->network_value.bytes ) )
+            throw Exception( "Address size not supported. Address=" + network_address->toString() );
+
         if (prefixlen > network_address->getAddressSize() * 8 )
             throw Exception("Prefixlen is greater than address size. Prefixlen=" + intToString(prefixlen) + " Address=" + network_address->toString() );
 
-        this->network_address = network_address;
         this->prefixlen = prefixlen;
-
-        auto_ptr<ByteArray> addr = this->network_address->getBytes();
-        auto_ptr<ByteArray> mask = this->getMask();
-        auto_ptr<ByteBuffer> bytes ( new ByteBuffer ( addr->size() ) );
-
-        for ( uint16_t i = 0; i < addr->size(); i++ )
-            bytes->writeInt8( ( *addr )[i] & ( *mask ) [i] );
-
-        this->network_address = NetworkController::getIpAddress( this->network_address->getFamily(), auto_ptr<ByteArray> ( bytes ) );
+        this->network_value = IpAddressValue( *network_address ).getNetworkValue( prefixlen );
+        this->network_address = this->network_value.getIpAddress();
     }
 
     NetworkPrefix::NetworkPrefix( const NetworkPrefix & other ) {
         this->network_address = other.network_address->clone();
         this->prefixlen = other.prefixlen;
+        this->network_value = other.network_value;
     }
 
     NetworkPrefix::~NetworkPrefix() {
@@ -47,6 +45,14 @@ namespace openikev2 {
         return this->prefixlen;
     }
 
+    const IpAddressValue& NetworkPrefix::getNetworkValue() const {
+        return this->network_value;
+    }
+
+    IpAddressValue NetworkPrefix::getBroadcastValue() const {
+        return this->network_value.getBroadcastValue( this->prefixlen );
+    }
+
     auto_ptr< NetworkPrefix > NetworkPrefix::clone() const {
         return auto_ptr<NetworkPrefix> ( new NetworkPrefix( *this ) );
     }
@@ -57,27 +63,16 @@ namespace openikev2 {
 
 
     bool NetworkPrefix::containsIpAddress( const IpAddress & ip_address ) const {
-        // checks family
-        if ( this->network_address->getFamily() != ip_address.getFamily() )
+        // checks family and size before building the value
+        if ( this->network_value.family != ip_address.getFamily() || this->network_value.size() != ip_address.getAddressSize() )
             return false;
 
-        // checks size
-        if ( this->network_address->getAddressSize() != ip_address.getAddressSize() )
-            return false;
-
-        uint16_t bytelen = ( this->prefixlen / 8 );
-        if ( this->prefixlen % 8 )
-            bytelen++;
-
-        auto_ptr<ByteArray> addr1 = this->network_address->getBytes();
-        auto_ptr<ByteArray> addr2 = ip_address.getBytes();
-        auto_ptr<ByteArray> mask_A = this->getMask();
-
-        for ( uint16_t i = 0; i < bytelen;i++ )
-            if ( ( ( *addr1 )[i] & ( *mask_A )[i] ) != ( ( *addr2 )[i] & ( *mask_A )[i] ) )
-                return false;
+        return this->containsIpAddress( IpAddressValue( ip_address ) );
+    }
 
-        return true;
+    bool NetworkPrefix::containsIpAddress( const IpAddressValue & address_value ) const {
+        // The network value is already masked
+        return this->network_value.matchesPrefix( address_value, this->prefixlen );
     }
 
     auto_ptr< ByteArray > NetworkPrefix::getMask() const {
@@ -98,15 +93,7 @@ namespace openikev2 {
     }
 
     auto_ptr< IpAddress > NetworkPrefix::getBroadCastAddress() const {
-        auto_ptr<ByteArray> addr = this->network_address->getBytes();
-        auto_ptr<ByteArray> mask = this->getMask();
-
-        auto_ptr<ByteBuffer> result ( new ByteBuffer ( addr->size() ) );
-
-        for ( uint8_t i = 0; i < addr->size(); i++ )
-            result->writeInt8( ( *addr )[i] | ~( *mask ) [i] );
-
-        return auto_ptr<IpAddress> ( NetworkController::getIpAddress( this->network_address->getFamily(), auto_ptr<ByteArray> ( result ) ) );
+        return this->getBroadcastValue().getIpAddress();
     }
 
     auto_ptr< Attribute > NetworkPrefix::cloneAttribute() const {
@@ -117,7 +104,7 @@ namespace openikev2 {
         if ( this->prefixlen != other.prefixlen )
             return false;
 
-        return ( *this->network_address == *other.network_address );
+        return ( this->network_value == other.network_value );
     }
 
     uint16_t NetworkPrefix::getPrefixLen( const ByteArray & mask ) {
@@ -10,6 +10,7 @@
 #define OPENIKEV2NETWORKPREFIX_H
 
 #include "ipaddress.h"
+#include "ipaddressvalue.h"
 #include "attribute.h"
 
 namespace openikev2 {
@@ -23,6 +24,7 @@ namespace openikev2 {
         protected:
             auto_ptr<IpAddress> network_address;        /**< Network address */
             uint16_t prefixlen;                         /**< Prefix length */
+            IpAddressValue network_value;               /**< Value representation of the (masked) network address */
 
             /****************************** METHODS ******************************/
         public:
@@ -51,6 +53,18 @@ namespace openikev2 {
              */
             virtual uint16_t getPrefixLen() const;
 
+            /**
+             * Gets the network address as a value
+             * @return The (masked) network address value
+             */
+            virtual const IpAddressValue& getNetworkValue() const;
+
+            /**
+             * Obtains the broadcast address of the network as a value
+             * @return The broadcast address value
+             */
+            virtual IpAddressValue getBroadcastValue() const;
+
             /**
              * Obtains the broadcast address of the network
              * @return The broadcast address of the network
@@ -98,6 +112,13 @@ namespace openikev2 {
             */
             virtual bool containsIpAddress( const IpAddress& ip_address ) const;
 
+            /**
+            * Indicates if the address value is contained in the network prefix.
+            * @param address_value Address value to be checked
+            * @return TRUE if the address is contained in the network prefix. FALSE otherwise
+            */
+            virtual bool containsIpAddress( const IpAddressValue& address_value ) const;
+
             virtual auto_ptr<Attribute> cloneAttribute() const ;
 
             virtual string toStringTab( uint8_t tabs ) const;
@@ -22,24 +22,24 @@ namespace openikev2 {
 
         // If is a request
         if ( message.message_type == Message::REQUEST ) {
-            Log::writeLockedMessage( ike_sa.getLogId(), "AUTHENTICATION_FAILED notify payload in request", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "AUTHENTICATION_FAILED notify payload in request", Log::LOG_ERRO, true );
             ike_sa.sendNotifyResponse( message.exchange_type, Payload_NOTIFY::INVALID_SYNTAX);
             return IkeSa::NOTIFY_ACTION_ERROR;
         }
 
         // If exchange is invalid
         if ( message.exchange_type != Message::IKE_AUTH ) {
-            Log::writeLockedMessage( ike_sa.getLogId(), "AUTHENTICATION_FAILED notify payload in a wrong exchange", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "AUTHENTICATION_FAILED notify payload in a wrong exchange", Log::LOG_ERRO, true );
             return IkeSa::NOTIFY_ACTION_ERROR;
         }
 
         // Check notify field correction
         if ( notify.protocol_id > Enums::PROTO_IKE || notify.spi_value.get() != NULL || notify.notification_data.get() != NULL ) {
-            Log::writeLockedMessage( ike_sa.getLogId(), "INVALID SYNTAX in AUTHENTICATION_FAILED notify.", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "INVALID SYNTAX in AUTHENTICATION_FAILED notify.", Log::LOG_ERRO, true );
             return IkeSa::NOTIFY_ACTION_ERROR;
         }
 
-        Log::writeLockedMessage( ike_sa.getLogId(), "AUTHENTICATION FAILED: Peer does not authenticaticate us", Log::LOG_ERRO, true );
+        LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "AUTHENTICATION FAILED: Peer does not authenticaticate us", Log::LOG_ERRO, true );
         return IkeSa::NOTIFY_ACTION_ERROR;
     }
 }
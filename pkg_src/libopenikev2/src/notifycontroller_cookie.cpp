@@ -22,7 +22,7 @@ namespace openikev2 {
 
         // Checks if exchange type is IKE_SA_INIT req, else ignore return error
         if ( message.exchange_type != Message::IKE_SA_INIT ) {
-            Log::writeLockedMessage( ike_sa.getLogId(), "COOKIE notify payload in wrong exchange", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "COOKIE notify payload in wrong exchange", Log::LOG_ERRO, true );
             if ( message.message_type == Message::REQUEST )
                 ike_sa.sendNotifyResponse( message.exchange_type, Payload_NOTIFY::INVALID_SYNTAX );
             return IkeSa::NOTIFY_ACTION_ERROR;
@@ -30,7 +30,7 @@ namespace openikev2 {
 
         // Check notify field correction
         if ( notify.protocol_id > Enums::PROTO_IKE || notify.spi_value.get() != NULL || notify.notification_data.get() == NULL ) {
-            Log::writeLockedMessage( ike_sa.getLogId(), "INVALID SYNTAX in COOKIE notify.", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "INVALID SYNTAX in COOKIE notify.", Log::LOG_ERRO, true );
             if ( message.message_type == Message::REQUEST )
                 ike_sa.sendNotifyResponse( message.exchange_type, Payload_NOTIFY::INVALID_SYNTAX );
             return IkeSa::NOTIFY_ACTION_ERROR;
@@ -38,16 +38,15 @@ namespace openikev2 {
 
         // If cookie is contained in a REQUEST, then check the cookie
         if ( message.message_type == Message::REQUEST ) {
-            auto_ptr<Payload_NOTIFY> expected_cookie = CryptoController::generateCookie( message );
-
             // If the cookie value is valid, return CONTINUE
-            if ( *notify.notification_data == *expected_cookie->notification_data ) {
+            if ( CryptoController::checkCookie( message, *notify.notification_data ) ) {
                 return IkeSa::NOTIFY_ACTION_CONTINUE;
             }
 
             // If the cookie value is invalid, send the correct cookie and return ERROR
             else {
-                Log::writeLockedMessage( ike_sa.getLogId(), "Cookie received but not valid. Sending correct cookie", Log::LOG_WARN, true );
+                auto_ptr<Payload_NOTIFY> expected_cookie = CryptoController::generateCookie( message );
+                LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "Cookie received but not valid. Sending correct cookie", Log::LOG_WARN, true );
                 ike_sa.sendNotifyResponse( Message::IKE_SA_INIT,  expected_cookie );
                 return IkeSa::NOTIFY_ACTION_ERROR;
             }
@@ -71,7 +70,7 @@ namespace openikev2 {
             // Update the IKE_SA_INIT request message
             ike_sa.ike_sa_init_req = ike_sa.last_sent_request->clone();
 
-            Log::writeLockedMessage( ike_sa.getLogId(), "Peer sends a cookie: Retransmiting last request with the cookie.", Log::LOG_WARN, true );
+            LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "Peer sends a cookie: Retransmiting last request with the cookie.", Log::LOG_WARN, true );
             return IkeSa::NOTIFY_ACTION_OMIT;
         }
 
@@ -20,7 +20,7 @@ namespace openikev2 {
 
         // If is not an IKE_SA_INIT response or an IKE_AUTH request
         if ( !( message.exchange_type == Message::IKE_SA_INIT && message.message_type == Message::RESPONSE ) && !( message.exchange_type == Message::IKE_AUTH && message.message_type == Message::REQUEST ) ) {
-            Log::writeLockedMessage( ike_sa.getLogId(), "Received a HTTP_CERT_LOOKUP_SUPPORTED notify in an invalid message type.", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "Received a HTTP_CERT_LOOKUP_SUPPORTED notify in an invalid message type.", Log::LOG_ERRO, true );
 
             // If is a request
             if ( message.message_type == Message::REQUEST )
@@ -30,13 +30,13 @@ namespace openikev2 {
 
         // Check notify field correction
         if ( notify.protocol_id > Enums::PROTO_IKE || notify.spi_value.get() != NULL || notify.notification_data.get() != NULL ) {
-            Log::writeLockedMessage( ike_sa.getLogId(), "INVALID SYNTAX in HTTP_CERT_LOOKUP_SUPPORTED notify.", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "INVALID SYNTAX in HTTP_CERT_LOOKUP_SUPPORTED notify.", Log::LOG_ERRO, true );
             if ( message.message_type == Message::REQUEST )
                 ike_sa.sendNotifyResponse( message.exchange_type, Payload_NOTIFY::INVALID_SYNTAX);
             return IkeSa::NOTIFY_ACTION_ERROR;
         }
 
-        Log::writeLockedMessage( ike_sa.getLogId(), "Peer supports HTTP CERT LOOKUP.", Log::LOG_WARN, true );
+        LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "Peer supports HTTP CERT LOOKUP.", Log::LOG_WARN, true );
 
         ike_sa.peer_supports_hash_url = true;
 
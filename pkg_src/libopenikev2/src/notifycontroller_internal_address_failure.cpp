@@ -22,7 +22,7 @@ namespace openikev2 {
 
         // Check message type
         if ( ! (message.exchange_type != Message::IKE_AUTH && message.message_type == Message::RESPONSE) ) {
-            Log::writeLockedMessage( ike_sa.getLogId(), "INTERNAL_ADDRESS_FAILURE notify in wrong message", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "INTERNAL_ADDRESS_FAILURE notify in wrong message", Log::LOG_ERRO, true );
             if (message.message_type == Message::REQUEST)
                 ike_sa.sendNotifyResponse( message.exchange_type, Payload_NOTIFY::INVALID_SYNTAX);
             return IkeSa::NOTIFY_ACTION_ERROR;
@@ -30,11 +30,11 @@ namespace openikev2 {
 
         // Check notify field correction
         if ( notify.protocol_id > Enums::PROTO_IKE || notify.spi_value.get() != NULL || notify.notification_data.get() != NULL ) {
-            Log::writeLockedMessage( ike_sa.getLogId(), "INVALID SYNTAX in INTERNAL_ADDRESS_FAILURE notify.", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "INVALID SYNTAX in INTERNAL_ADDRESS_FAILURE notify.", Log::LOG_ERRO, true );
             return IkeSa::NOTIFY_ACTION_ERROR;
         }
 
-        Log::writeLockedMessage( ike_sa.getLogId(), "Peer failed assigning internal address.", Log::LOG_ERRO, true );
+        LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "Peer failed assigning internal address.", Log::LOG_ERRO, true );
         return IkeSa::NOTIFY_ACTION_ERROR;
     }
 }
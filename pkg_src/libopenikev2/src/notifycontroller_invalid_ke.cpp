@@ -23,20 +23,20 @@ namespace openikev2 {
 
         // If is a request
         if ( message.message_type == Message::REQUEST ) {
-            Log::writeLockedMessage( ike_sa.getLogId(), "INVALID_KE_PAYLOAD notify in request.", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "INVALID_KE_PAYLOAD notify in request.", Log::LOG_ERRO, true );
             ike_sa.sendNotifyResponse( message.exchange_type, Payload_NOTIFY::INVALID_SYNTAX );
             return IkeSa::NOTIFY_ACTION_ERROR;
         }
 
         // If exchange is invalid
         if ( message.exchange_type != Message::IKE_SA_INIT && message.exchange_type != Message::CREATE_CHILD_SA ) {
-            Log::writeLockedMessage( ike_sa.getLogId(), "INVALID_KE_PAYLOAD notify in wrong exchange.", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "INVALID_KE_PAYLOAD notify in wrong exchange.", Log::LOG_ERRO, true );
             return IkeSa::NOTIFY_ACTION_ERROR;
         }
 
         // Check notify field correction
         if ( notify.protocol_id > Enums::PROTO_IKE || notify.spi_value.get() != NULL || notify.notification_data.get() == NULL || notify.notification_data->size() != 2 ) {
-            Log::writeLockedMessage( ike_sa.getLogId(), "INVALID SYNTAX in INVALID_KE_PAYLOAD notify.", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "INVALID SYNTAX in INVALID_KE_PAYLOAD notify.", Log::LOG_ERRO, true );
             return IkeSa::NOTIFY_ACTION_ERROR;
         }
 
@@ -46,18 +46,18 @@ namespace openikev2 {
             ByteBuffer temp( *notify.notification_data );
             uint16_t group = temp.readInt16();
 
-            Log::writeLockedMessage( ike_sa.getLogId(), "Peer prefers a different DH group=[" + intToString( group ) + "]", Log::LOG_WARN, true );
+            LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "Peer prefers a different DH group=[" + intToString( group ) + "]", Log::LOG_WARN, true );
 
             // Checks if selected groups is different to the current (to avoid retransmitions issues)
             if ( ike_sa.dh->group_id == group ) {
-                Log::writeLockedMessage( ike_sa.getLogId(), "Received retransmition of an old response. Omitting", Log::LOG_ERRO, true );
+                LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "Received retransmition of an old response. Omitting", Log::LOG_ERRO, true );
                 return IkeSa::NOTIFY_ACTION_OMIT;
             }
 
             // If desired group isn't in the original initiator proposal, then error
             Transform dh_transform( Enums::D_H, group );
             if ( !ike_sa.getIkeSaConfiguration().getProposal().hasTransform( dh_transform ) ) {
-                Log::writeLockedMessage( ike_sa.getLogId(), "INVALID_KE_PAYLOAD contains a non proposed DH group=[" + intToString( group ) + "]", Log::LOG_ERRO, true );
+                LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "INVALID_KE_PAYLOAD contains a non proposed DH group=[" + intToString( group ) + "]", Log::LOG_ERRO, true );
                 return IkeSa::NOTIFY_ACTION_ERROR;
             }
 
@@ -105,18 +105,18 @@ namespace openikev2 {
             ByteBuffer temp( *notify.notification_data );
             uint16_t group = temp.readInt16();
 
-            Log::writeLockedMessage( ike_sa.getLogId(), "Peer preffers different DH group=[" + intToString( group ) + "]", Log::LOG_WARN, true );
+            LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "Peer preffers different DH group=[" + intToString( group ) + "]", Log::LOG_WARN, true );
 
             // Checks if selected groups is different to the current (to avoid retransmitions issues)
             if ( old_dh->group_id == group ) {
-                Log::writeLockedMessage( ike_sa.getLogId(), "Received retransmition of an old response.", Log::LOG_ERRO, true );
+                LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "Received retransmition of an old response.", Log::LOG_ERRO, true );
                 return IkeSa::NOTIFY_ACTION_OMIT;
             }
 
             // If desired group isn't in the original initiator proposal, then error
             Transform dh_transform( Enums::D_H, group );
             if ( !proposal->hasTransform( dh_transform ) ) {
-                Log::writeLockedMessage( ike_sa.getLogId(), "INVALID_KE_PAYLOAD contains a non proposed DH group=[" + intToString( group ) + "]", Log::LOG_ERRO, true );
+                LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "INVALID_KE_PAYLOAD contains a non proposed DH group=[" + intToString( group ) + "]", Log::LOG_ERRO, true );
                 return IkeSa::NOTIFY_ACTION_ERROR;
             }
 
@@ -128,6 +128,9 @@ namespace openikev2 {
             ike_sa.last_sent_request->message_id++;
             ike_sa.my_message_id++;
 
+            // The cached binary representation was dropped, so the request is encrypted again before retransmitting it
+            ike_sa.last_sent_request->getBinaryRepresentation( ike_sa.send_cipher.get() );
+
             ike_sa.remaining_timeout_retries++;
             ike_sa.retransmitLastRequest();
 
@@ -20,28 +20,28 @@ namespace openikev2 {
 
         // If is a request
         if ( message.message_type == Message::REQUEST ) {
-            Log::writeLockedMessage( ike_sa.getLogId(), "NO_PROPOSAL_CHOSEN notify in a request.", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "NO_PROPOSAL_CHOSEN notify in a request.", Log::LOG_ERRO, true );
             ike_sa.sendNotifyResponse( message.exchange_type, Payload_NOTIFY::INVALID_SYNTAX);
             return IkeSa::NOTIFY_ACTION_ERROR;
         }
 
         // If exchange is invalid
         if ( message.exchange_type == Message::INFORMATIONAL ) {
-            Log::writeLockedMessage( ike_sa.getLogId(), "NO_PROPOSAL_CHOSEN notify in wrong exchange.", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "NO_PROPOSAL_CHOSEN notify in wrong exchange.", Log::LOG_ERRO, true );
             return IkeSa::NOTIFY_ACTION_ERROR;
         }
 
         // Check notify field correction
         if ( notify.protocol_id > Enums::PROTO_IKE || notify.spi_value.get() != NULL || notify.notification_data.get() != NULL ){
-            Log::writeLockedMessage( ike_sa.getLogId(), "INVALID SYNTAX in NO_PROPOSAL_CHOSEN notify.", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "INVALID SYNTAX in NO_PROPOSAL_CHOSEN notify.", Log::LOG_ERRO, true );
             return IkeSa::NOTIFY_ACTION_ERROR;
         }
 
         if ( message.exchange_type == Message::IKE_SA_INIT || (message.exchange_type == Message::CREATE_CHILD_SA && child_sa == NULL) ) {
-            Log::writeLockedMessage( ike_sa.getLogId(), "Peer doesn't choose any IKE_SA proposal.", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "Peer doesn't choose any IKE_SA proposal.", Log::LOG_ERRO, true );
         }
         else if ( message.exchange_type == Message::IKE_AUTH || (message.exchange_type == Message::CREATE_CHILD_SA && child_sa != NULL)  ) {
-            Log::writeLockedMessage( ike_sa.getLogId(), "Peer doesn't choose any CHILD_SA proposal.", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "Peer doesn't choose any CHILD_SA proposal.", Log::LOG_ERRO, true );
         }
         else{
             assert (0);
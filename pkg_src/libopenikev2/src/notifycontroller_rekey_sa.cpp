@@ -19,7 +19,7 @@ namespace openikev2 {
         assert( notify.notification_type == Payload_NOTIFY::REKEY_SA );
 
         if ( message.exchange_type != Message::CREATE_CHILD_SA || child_sa == NULL ) {
-            Log::writeLockedMessage( ike_sa.getLogId(), "REKEY_SA notify in unspected message", Log::LOG_WARN, true );
+            LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "REKEY_SA notify in unspected message", Log::LOG_WARN, true );
             return IkeSa::NOTIFY_ACTION_ERROR;
         }
 
@@ -34,7 +34,7 @@ namespace openikev2 {
         // If CHILD_SA doesn't exist or we are also deleting this CHILD_SA
         // Section 5.11.5 IKEv2 clarifications document */
         if ( rekeyed_child_sa == NULL || ( ike_sa.getState() == IkeSa::STATE_DELETE_CHILD_SA_REQ_SENT && rekeyed_child_sa->getState() == ChildSa::CHILD_SA_DELETING ) ) {
-            Log::writeLockedMessage(ike_sa.getLogId(), "NO PROPOSAL CHOSEN: Rekeying an Unknown IPSEC SPI", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE(ike_sa.getLogId(), "NO PROPOSAL CHOSEN: Rekeying an Unknown IPSEC SPI", Log::LOG_ERRO, true );
             ike_sa.sendNotifyResponse(Message::CREATE_CHILD_SA, Payload_NOTIFY::NO_PROPOSAL_CHOSEN);
             return IkeSa::NOTIFY_ACTION_ERROR;
         }
@@ -21,24 +21,24 @@ namespace openikev2 {
 
         // If is a request
         if ( message.message_type == Message::REQUEST ) {
-            Log::writeLockedMessage( ike_sa.getLogId(), "SINGLE_PAIR_REQUIRED notify in a request.", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "SINGLE_PAIR_REQUIRED notify in a request.", Log::LOG_ERRO, true );
             ike_sa.sendNotifyResponse( message.exchange_type, Payload_NOTIFY::INVALID_SYNTAX);
             return IkeSa::NOTIFY_ACTION_ERROR;
         }
 
         // If exchange is invalid
         if ( message.exchange_type != Message::IKE_AUTH && message.exchange_type != Message::CREATE_CHILD_SA ) {
-            Log::writeLockedMessage( ike_sa.getLogId(), "SINGLE_PAIR_REQUIRED notify in a wrong exchange.", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "SINGLE_PAIR_REQUIRED notify in a wrong exchange.", Log::LOG_ERRO, true );
             return IkeSa::NOTIFY_ACTION_ERROR;
         }
 
         // Check notify field correction
         if ( notify.protocol_id > Enums::PROTO_IKE || notify.spi_value.get() || notify.notification_data.get() ) {
-            Log::writeLockedMessage( ike_sa.getLogId(), "INVALID SYNTAX in SINGLE_PAIR_REQUIRED notify.", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "INVALID SYNTAX in SINGLE_PAIR_REQUIRED notify.", Log::LOG_ERRO, true );
             return IkeSa::NOTIFY_ACTION_ERROR;
         }
 
-        Log::writeLockedMessage( ike_sa.getLogId(), "Peer require single pair TS.", Log::LOG_ERRO, true );
+        LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "Peer require single pair TS.", Log::LOG_ERRO, true );
         return IkeSa::NOTIFY_ACTION_ERROR;
     }
 
@@ -23,7 +23,7 @@ namespace openikev2 {
 
         // Only can appear in AUTH and CREATE_CHILD exchanges
         if ( message.exchange_type != Message::IKE_AUTH && message.exchange_type != Message::CREATE_CHILD_SA ) {
-            Log::writeLockedMessage ( ike_sa.getLogId(), "USE_TRANSPORT_MODE notify in invalid exchage.", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "USE_TRANSPORT_MODE notify in invalid exchage.", Log::LOG_ERRO, true );
             if ( message.message_type == Message::REQUEST )
                 ike_sa.sendNotifyResponse ( message.exchange_type, Payload_NOTIFY::INVALID_SYNTAX );
             return IkeSa::NOTIFY_ACTION_ERROR;
@@ -31,7 +31,7 @@ namespace openikev2 {
 
         // Check notify field correction
         if ( notify.protocol_id > Enums::PROTO_IKE || notify.spi_value.get() || notify.notification_data.get() ) {
-            Log::writeLockedMessage ( ike_sa.getLogId(), "INVALID SYNTAX in USE_TRANSPORT_MODE notify.", Log::LOG_ERRO, true );
+            LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "INVALID SYNTAX in USE_TRANSPORT_MODE notify.", Log::LOG_ERRO, true );
             if ( message.message_type == Message::REQUEST )
                 ike_sa.sendNotifyResponse ( message.exchange_type, Payload_NOTIFY::INVALID_SYNTAX );
             return IkeSa::NOTIFY_ACTION_ERROR;
@@ -39,7 +39,7 @@ namespace openikev2 {
 
         child_sa->mode = Enums::TRANSPORT_MODE;
 
-        Log::writeLockedMessage ( ike_sa.getLogId(), "Transport mode requested by the peer.", Log::LOG_INFO, true );
+        LOG_LOCKED_MESSAGE( ike_sa.getLogId(), "Transport mode requested by the peer.", Log::LOG_INFO, true );
         return IkeSa::NOTIFY_ACTION_CONTINUE;
     }
 
@@ -45,7 +45,7 @@ namespace openikev2 {
         byte_buffer.skip( 3 );
 
         // auth field size is equal to payload_length - 8 (fixed data)
-        auto_ptr<ByteArray> auth_field = byte_buffer.readByteArray( payload_length - 8 );
+        auto_ptr<ByteArray> auth_field = byte_buffer.readByteArrayView( payload_length - 8 );
 
         return auto_ptr<Payload_AUTH> ( new Payload_AUTH( auth_method, auth_field ) );
     }
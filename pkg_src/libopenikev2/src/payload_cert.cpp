@@ -36,7 +36,7 @@ namespace openikev2 {
         Enums::CERT_ENCODING cert_encoding = ( Enums::CERT_ENCODING ) byte_buffer.readInt8();
 
         // reads the certificate data
-        auto_ptr<ByteArray> certificate_data = byte_buffer.readByteArray( payload_length - 5 );
+        auto_ptr<ByteArray> certificate_data = byte_buffer.readByteArrayView( payload_length - 5 );
 
         return auto_ptr<Payload_CERT> ( new Payload_CERT ( cert_encoding, certificate_data ) );
     }
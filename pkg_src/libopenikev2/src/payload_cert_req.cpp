@@ -46,7 +46,7 @@ namespace openikev2 {
         uint16_t count = ( payload_length - 5 ) / 20;
 
         for ( uint16_t i = 0; i < count; i++ ) {
-            auto_ptr<ByteArray> ca_hash = byte_buffer.readByteArray( 20 );
+            auto_ptr<ByteArray> ca_hash = byte_buffer.readByteArrayView( 20 );
             result->addCaPublicKeyHash( ca_hash );
         }
 
@@ -39,7 +39,7 @@ namespace openikev2 {
         byte_buffer.skip( 3 );
 
         // reads id data
-        auto_ptr<ByteArray> id_data = byte_buffer.readByteArray( payload_length - 8 );
+        auto_ptr<ByteArray> id_data = byte_buffer.readByteArrayView( payload_length - 8 );
 
         auto_ptr<ID> id ( new ID( id_type, id_data ) );
 
@@ -50,8 +50,13 @@ namespace openikev2 {
         // skips the reserved bytes
         byte_buffer.skip( 2 );
 
+        // Public values of the known groups have a fixed size (RFC 7296, section 3.4 and RFC 5903, section 7)
+        uint32_t public_key_size = DiffieHellman::getPublicKeySize( group );
+        if ( public_key_size > 0 && payload_length != 8 + public_key_size )
+            throw ParsingException( "Payload_KE public key size does not match the group " + Enums::DH_ID_STR( group ) );
+
         // public key size is equal to payload_length - 8 (fixed data)
-        auto_ptr<ByteArray> public_key = byte_buffer.readByteArray( payload_length - 8 );
+        auto_ptr<ByteArray> public_key = byte_buffer.readByteArrayView( payload_length - 8 );
 
         return auto_ptr<Payload_KE> ( new Payload_KE( group, public_key ) );
     }
@@ -81,7 +86,7 @@ namespace openikev2 {
 
         oss << Printable::generateTabs( tabs ) << "<PAYLOAD_KE> {\n";
 
-        oss << Printable::generateTabs( tabs + 1 ) << "gruop_id=" << this->group << "\n";
+        oss << Printable::generateTabs( tabs + 1 ) << "gruop_id=" << Enums::DH_ID_STR( this->group ) << "\n";
 
         oss << Printable::generateTabs( tabs + 1 ) << "public_key=" << this->public_key->toStringTab( tabs + 2 ) << endl;
 
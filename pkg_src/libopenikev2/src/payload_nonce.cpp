@@ -15,14 +15,13 @@ namespace openikev2 {
     Payload_NONCE::Payload_NONCE()
             : Payload( PAYLOAD_NONCE, false ) {
 
-        // Creates a new random object
-        auto_ptr<Random> random ( CryptoController::getRandom() );
-
         // Generate nonce length
-        uint16_t nonce_length = random->getRandomInt32( 16, 256 );
+        uint16_t nonce_length = CryptoController::getRandomInt32( 16, 256 );
 
         // Fills nonce value with random bytes
-        this->nonce = random->getRandomBytes( nonce_length );
+        this->nonce.reset( new ByteArray( nonce_length ) );
+        CryptoController::writeRandomBytes( this->nonce->getRawPointer(), nonce_length );
+        this->nonce->setSize( nonce_length );
     }
 
     Payload_NONCE::Payload_NONCE( auto_ptr<ByteArray> nonce )
@@ -36,11 +35,10 @@ namespace openikev2 {
         // Checks if nonce length has correct value
         assert( nonce_length >= 16 && nonce_length <= 256 );
 
-        // Creates a new random object
-        auto_ptr<Random> random ( CryptoController::getRandom() );
-
         // Fills nonce value with random bytes
-        this->nonce = random->getRandomBytes( nonce_length );
+        this->nonce.reset( new ByteArray( nonce_length ) );
+        CryptoController::writeRandomBytes( this->nonce->getRawPointer(), nonce_length );
+        this->nonce->setSize( nonce_length );
     }
 
     Payload_NONCE::Payload_NONCE( const Payload_NONCE& other )
@@ -59,7 +57,7 @@ namespace openikev2 {
             throw ParsingException( "Payload_NONCE length cannot be < 20 bytes nor > 260." );
 
         // reads nonce value
-        auto_ptr<ByteArray> nonce = byte_buffer.readByteArray( payload_length - 4 );
+        auto_ptr<ByteArray> nonce = byte_buffer.readByteArrayView( payload_length - 4 );
 
         return auto_ptr<Payload_NONCE> ( new Payload_NONCE( nonce ) );
     }
@@ -74,12 +74,12 @@ namespace openikev2 {
 
         auto_ptr<ByteArray> spi_value;
         if ( spi_size > 0 )
-            spi_value = byte_buffer.readByteArray( spi_size );
+            spi_value = byte_buffer.readByteArrayView( spi_size );
 
         uint16_t data_size = payload_length - 8 - spi_size;
         auto_ptr<ByteArray> notification_data;
         if ( data_size > 0 )
-            notification_data = byte_buffer.readByteArray( data_size );
+            notification_data = byte_buffer.readByteArrayView( data_size );
 
         return auto_ptr<Payload_NOTIFY> ( new Payload_NOTIFY( notification_type, protocol_id, spi_value, notification_data ) );
     }
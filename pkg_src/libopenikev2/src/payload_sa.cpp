@@ -67,7 +67,7 @@ namespace openikev2 {
 
             // If this is a multiprotocol proposal, then omit it
             else if ( proposal->proposal_number == expected_proposal_number - 1 ) {
-                Log::writeLockedMessage( "Payload_SA", "libopenikev2 doesn't support multiprotocol proposals. Ommiting it", Log::LOG_WARN, true );
+                LOG_LOCKED_MESSAGE( "Payload_SA", "libopenikev2 doesn't support multiprotocol proposals. Ommiting it", Log::LOG_WARN, true );
 
                 // get the last inserted proposals and, if the type matches with the received on
                 if ( proposals->size() > 0 && proposals->back()->proposal_number == proposal->proposal_number )
@@ -9,47 +9,29 @@
 #include "payload_sk.h"
 #include "cryptocontroller.h"
 #include "exception.h"
+#include "bytearrayview.h"
+#include <netinet/in.h>
+#include <string.h>
+#include <assert.h>
 
 namespace openikev2 {
 
     Payload_SK::Payload_SK( Cipher& cipher, ByteArray& decrypted_body )
             : Payload ( PAYLOAD_SK, false ) {
 
-        // creates a new random object
-        auto_ptr<Random> random = CryptoController::getRandom();
+        if ( cipher.is_aead )
+            throw CipherException( "AEAD Payload_SK must be generated within its Message" );
 
-        // creates the IV
-        auto_ptr<ByteArray> initialization_vector = random->getRandomBytes( cipher.encr_block_size );
-
-        // calculates the padding len
-        uint16_t padding_len = ( cipher.encr_block_size - 1 ) - ( decrypted_body.size() % cipher.encr_block_size );
-
-        // Creates the buffer to be encrypted
-        ByteBuffer to_be_encrypted( decrypted_body.size() + padding_len + 1 );
-
-        // appends the decripted data
-        to_be_encrypted.writeByteArray( decrypted_body );
-
-        // appends the padding
-        to_be_encrypted.fillBytes( padding_len, 0x1F );
+        // Room for the length field + IV + decrypted data + maximum padding + padding len + checksum
+        auto_ptr<ByteBuffer> pdata ( new ByteBuffer( 2 + cipher.iv_size + cipher.encr_block_size + decrypted_body.size() + cipher.integ_hash_size ) );
 
-        // appends the padding len
-        to_be_encrypted.writeInt8( padding_len );
-
-        // generate the encrypted body
-        auto_ptr<ByteArray> encrypted_body = cipher.encrypt( to_be_encrypted, *initialization_vector );
-
-        // Create the payload data with the size = iv_size + encrypted_data_size + checksum_size
-        auto_ptr<ByteBuffer> pdata ( new ByteBuffer( cipher.encr_block_size + encrypted_body->size() + cipher.integ_hash_size ) );
-
-        // append the IV
-        pdata->writeByteArray( *initialization_vector );
+        // the data is encrypted in place, in the same buffer
+        uint8_t* payload_length_position = Payload_SK::beginBinaryRepresentation( cipher, *pdata );
+        pdata->writeByteArray( decrypted_body );
+        Payload_SK::endBinaryRepresentation( cipher, *pdata, payload_length_position );
 
-        // append the encrypted data
-        pdata->writeByteArray( *encrypted_body );
-
-        // append the 0 integrity checksum
-        pdata->fillBytes( cipher.integ_hash_size, 0 );
+        // payload data doesn't include the length field
+        pdata->skip( 2 );
 
         this->payload_data = pdata;
     }
@@ -75,11 +57,102 @@ namespace openikev2 {
             throw ParsingException( "Payload_SK length cannot be < 4 bytes." );
 
         // read all the data
-        auto_ptr<ByteArray> payload_data = byte_buffer.readByteArray( payload_length - 4 );
+        auto_ptr<ByteArray> payload_data = byte_buffer.readByteArrayView( payload_length - 4 );
 
         return auto_ptr<Payload_SK> ( new Payload_SK( payload_data ) );
     }
 
+    uint8_t* Payload_SK::beginBinaryRepresentation( Cipher& cipher, ByteBuffer& byte_buffer ) {
+        uint8_t* payload_length_position = byte_buffer.getWritePosition();
+
+        // writes a provisional payload length
+        byte_buffer.writeInt16( 0 );
+
+        // creates the IV
+        uint8_t* initialization_vector = byte_buffer.getWritePosition();
+        byte_buffer.fillBytes( cipher.iv_size, 0 );
+        cipher.writeInitializationVector( initialization_vector );
+
+        return payload_length_position;
+    }
+
+    void Payload_SK::endBinaryRepresentation( Cipher& cipher, ByteBuffer& byte_buffer, uint8_t* payload_length_position ) {
+        uint8_t* initialization_vector = payload_length_position + 2;
+        uint8_t* decrypted_body = initialization_vector + cipher.iv_size;
+        uint32_t decrypted_body_size = byte_buffer.getWritePosition() - decrypted_body;
+
+        // calculates the padding len
+        uint16_t padding_len = ( cipher.encr_block_size - 1 ) - ( decrypted_body_size % cipher.encr_block_size );
+
+        // appends the padding
+        byte_buffer.fillBytes( padding_len, 0x1F );
+
+        // appends the padding len
+        byte_buffer.writeInt8( padding_len );
+
+        // encrypts the decrypted body + padding + padding len. AEAD ciphers need the whole Message, so they encrypt when sealing
+        if ( !cipher.is_aead )
+            cipher.encryptInPlace( decrypted_body, decrypted_body_size + padding_len + 1, initialization_vector );
+
+        // append the 0 integrity checksum
+        byte_buffer.fillBytes( cipher.integ_hash_size, 0 );
+
+        // sets the payload length (the generic payload header is included)
+        uint16_t payload_length = htons( 2 + ( byte_buffer.getWritePosition() - payload_length_position ) );
+        memcpy( payload_length_position, &payload_length, 2 );
+    }
+
+    void Payload_SK::sealBinaryRepresentation( Cipher& cipher, uint8_t* message_position, uint8_t* payload_length_position, uint8_t* message_end ) {
+        uint8_t* checksum = message_end - cipher.integ_hash_size;
+
+        if ( !cipher.is_aead ) {
+            cipher.writeIntegrity( message_position, checksum - message_position, checksum );
+            return;
+        }
+
+        // the associated data goes from the IKE header to the Payload_SK generic header (RFC 5282, section 5.1)
+        uint8_t* initialization_vector = payload_length_position + 2;
+        uint8_t* decrypted_body = initialization_vector + cipher.iv_size;
+        cipher.encryptAuthenticated( decrypted_body, checksum - decrypted_body, initialization_vector, message_position, initialization_vector - message_position, checksum );
+    }
+
+    bool Payload_SK::decryptAuthenticated( Cipher& cipher, const ByteArray& message ) {
+        assert( cipher.is_aead );
+
+        if ( this->payload_data->size() < cipher.iv_size + cipher.integ_hash_size || message.size() < this->payload_data->size() )
+            return false;
+
+        // the Payload_SK is the last payload, so the associated data is everything before its payload data
+        uint32_t encrypted_body_size = this->payload_data->size() - cipher.iv_size - cipher.integ_hash_size;
+        const uint8_t* initialization_vector = this->payload_data->getRawPointer();
+        const uint8_t* encrypted_body = initialization_vector + cipher.iv_size;
+
+        auto_ptr<ByteArray> decrypted_body ( new ByteArray( encrypted_body_size ) );
+        if ( !cipher.decryptAuthenticated( encrypted_body, encrypted_body_size, initialization_vector, message.getRawPointer(), message.size() - this->payload_data->size(), encrypted_body + encrypted_body_size, decrypted_body->getRawPointer() ) )
+            return false;
+
+        decrypted_body->setSize( encrypted_body_size );
+        if ( !Payload_SK::removePadding( *decrypted_body ) )
+            return false;
+
+        this->authenticated_body = decrypted_body;
+        return true;
+    }
+
+    bool Payload_SK::removePadding( ByteArray& decrypted_body ) {
+        if ( decrypted_body.size() == 0 )
+            return false;
+
+        // get the padding len (the last byte in the array)
+        uint8_t padding_len = decrypted_body[ decrypted_body.size() - 1 ];
+        if ( padding_len + 1u > decrypted_body.size() )
+            return false;
+
+        // truncates the decrypted body
+        decrypted_body.setSize( decrypted_body.size() - padding_len - 1 );
+        return true;
+    }
+
     Payload_SK::~Payload_SK() {}
 
     void Payload_SK::getBinaryRepresentation( ByteBuffer& byte_buffer ) const {
@@ -91,23 +164,28 @@ namespace openikev2 {
     }
 
     auto_ptr<ByteArray> Payload_SK::getDecryptedBody( Cipher& cipher ) {
-        ByteBuffer byte_buffer ( this->payload_data->size() );
-        byte_buffer.writeByteArray( *this->payload_data );
+        // AEAD ciphers decrypt when checking the ICV
+        if ( cipher.is_aead ) {
+            if ( this->authenticated_body.get() == NULL )
+                throw ParsingException( "Payload_SK has not been authenticated" );
+            return this->authenticated_body;
+        }
 
-        // reads the initilization vector
-        auto_ptr<ByteArray> initialization_vector = byte_buffer.readByteArray( cipher.encr_block_size );
+        if ( this->payload_data->size() < cipher.iv_size + cipher.integ_hash_size )
+            throw ParsingException( "Payload_SK is too small to contain the IV and the integrity checksum" );
 
-        // reads the encrypted body
-        auto_ptr<ByteArray> encrypted_body = byte_buffer.readByteArray( this->payload_data->size() - cipher.encr_block_size - cipher.integ_hash_size );
+        // refers to the initilization vector
+        ByteArrayView initialization_vector( this->payload_data->getRawPointer(), cipher.iv_size );
 
-        // reads the decrypted body + padding + padding len
-        auto_ptr<ByteArray> decrypted_body = cipher.decrypt( *encrypted_body, *initialization_vector );
+        // refers to the encrypted body
+        ByteArrayView encrypted_body( this->payload_data->getRawPointer() + cipher.iv_size, this->payload_data->size() - cipher.iv_size - cipher.integ_hash_size );
 
-        // get the padding len (the last byte in the array)
-        uint8_t padding_len = ( *decrypted_body ) [ decrypted_body->size() - 1 ];
+        // reads the decrypted body + padding + padding len
+        auto_ptr<ByteArray> decrypted_body = cipher.decrypt( encrypted_body, initialization_vector );
 
-        // truncates the decrypted body
-        decrypted_body->setSize( decrypted_body->size() - padding_len - 1 );
+        // removes the padding and the padding len
+        if ( !Payload_SK::removePadding( *decrypted_body ) )
+            throw ParsingException( "Payload_SK has an invalid padding length" );
 
         return decrypted_body;
     }
@@ -22,12 +22,15 @@ namespace openikev2 {
 
     /**
         This class represents an Encripted Payload.
+        With AEAD ciphers (RFC 5282), the IKE header and the unencrypted payloads up to the Payload_SK generic header
+        are the associated data, so the encryption is performed by sealBinaryRepresentation() once the Message length is known.
         @author Alejandro Perez Mendez, Pedro J. Fernandez Ruiz <alex@um.es, pedroj@um.es>
     */
     class Payload_SK : public Payload {
             /****************************** ATTRIBUTES ******************************/
         protected:
             auto_ptr<ByteArray> payload_data;     /**< All the payload data (IV + encrypted payloads + padding + padding len + checksum */
+            auto_ptr<ByteArray> authenticated_body; /**< Decrypted body, once authenticated by decryptAuthenticated() */
 
             /****************************** METHODS ******************************/
         protected:
@@ -37,9 +40,16 @@ namespace openikev2 {
              */
             Payload_SK( auto_ptr<ByteArray> payload_data );
 
+            /**
+             * Removes the padding and the padding len from a decrypted body
+             * @param decrypted_body Decrypted body + padding + padding len
+             * @return TRUE if the padding is valid. FALSE otherwise
+             */
+            static bool removePadding( ByteArray& decrypted_body );
+
         public:
             /**
-             * Creates a new Payload_SK
+             * Creates a new Payload_SK. AEAD ciphers are not supported, since the associated data is the enclosing Message
              * @param cipher Cipher used to encrypt the data
              * @param decrypted_body Data to be encrypted
              */
@@ -58,7 +68,43 @@ namespace openikev2 {
             static auto_ptr<Payload_SK> parse( ByteBuffer& byte_buffer );
 
             /**
-             * Gets the decripted body
+             * Starts writing a Payload_SK directly into a ByteBuffer: writes a provisional "payload length" field and the IV.
+             * The payloads to be encrypted must be written next, and then endBinaryRepresentation() must be called.
+             * @param cipher Cipher to be used
+             * @param byte_buffer Buffer with its write pointer at the "payload length" field
+             * @return Position of the "payload length" field
+             */
+            static uint8_t* beginBinaryRepresentation( Cipher& cipher, ByteBuffer& byte_buffer );
+
+            /**
+             * Finishes writing a Payload_SK started with beginBinaryRepresentation(): appends the padding, encrypts
+             * in place (except AEAD ciphers), leaves room for the integrity checksum (zero filled) and sets the "payload length" field.
+             * @param cipher Cipher to be used
+             * @param byte_buffer Buffer where the Payload_SK is being written
+             * @param payload_length_position Position returned by beginBinaryRepresentation()
+             */
+            static void endBinaryRepresentation( Cipher& cipher, ByteBuffer& byte_buffer, uint8_t* payload_length_position );
+
+            /**
+             * Protects a Message containing a Payload_SK written with endBinaryRepresentation(), once the Message length is set:
+             * writes the integrity checksum or, with AEAD ciphers, encrypts the payload and writes its ICV.
+             * @param cipher Cipher to be used
+             * @param message_position Position of the beginning of the Message
+             * @param payload_length_position Position returned by beginBinaryRepresentation()
+             * @param message_end Position of the end of the Message
+             */
+            static void sealBinaryRepresentation( Cipher& cipher, uint8_t* message_position, uint8_t* payload_length_position, uint8_t* message_end );
+
+            /**
+             * Checks the ICV and decrypts the body using an AEAD cipher. The decrypted body is kept for getDecryptedBody()
+             * @param cipher AEAD cipher to be used
+             * @param message Binary representation of the Message. The Payload_SK must be its last payload
+             * @return TRUE if the ICV is valid. FALSE otherwise
+             */
+            virtual bool decryptAuthenticated( Cipher& cipher, const ByteArray& message );
+
+            /**
+             * Gets the decripted body. With AEAD ciphers, decryptAuthenticated() must be called before
              * @param cipher Cipher to be used
              * @return The decrypted body
              */
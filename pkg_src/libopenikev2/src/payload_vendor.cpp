@@ -42,7 +42,7 @@ namespace openikev2 {
             throw ParsingException( "Payload_VENDOR length cannot be < 4 bytes." );
 
         // reads the vendor ID
-        auto_ptr<ByteArray> vendor_id = byte_buffer.readByteArray( payload_size - 4 );
+        auto_ptr<ByteArray> vendor_id = byte_buffer.readByteArrayView( payload_size - 4 );
 
         return auto_ptr<Payload_VENDOR> ( new Payload_VENDOR( vendor_id ) );
     }
@@ -65,6 +65,30 @@ namespace openikev2 {
                 return auto_ptr<Payload> ( NULL );
         }
     }
+
+    bool PayloadFactory::isKnownPayloadType( Payload::PAYLOAD_TYPE type ) {
+        switch ( type ) {
+            case Payload::PAYLOAD_AUTH:
+            case Payload::PAYLOAD_NONCE:
+            case Payload::PAYLOAD_KE:
+            case Payload::PAYLOAD_IDi:
+            case Payload::PAYLOAD_IDr:
+            case Payload::PAYLOAD_TSi:
+            case Payload::PAYLOAD_TSr:
+            case Payload::PAYLOAD_SA:
+            case Payload::PAYLOAD_DEL:
+            case Payload::PAYLOAD_NOTIFY:
+            case Payload::PAYLOAD_CONF:
+            case Payload::PAYLOAD_EAP:
+            case Payload::PAYLOAD_CERT:
+            case Payload::PAYLOAD_CERT_REQ:
+            case Payload::PAYLOAD_VENDOR:
+            case Payload::PAYLOAD_SK:
+                return true;
+            default:
+                return false;
+        }
+    }
 }
 
 
@@ -28,6 +28,13 @@ namespace openikev2 {
              * @return The parsed payload
              */
             static auto_ptr<Payload> createPayload( Payload::PAYLOAD_TYPE type, ByteBuffer& byte_buffer );
+
+            /**
+             * Indicates if createPayload() is able to parse Payloads of the indicated type
+             * @param type Payload type
+             * @return TRUE if the type is known. FALSE otherwise
+             */
+            static bool isKnownPayloadType( Payload::PAYLOAD_TYPE type );
     };
 }
 #endif
@@ -44,8 +44,9 @@ namespace openikev2 {
     void PeerConfiguration::deleteNetworkPrefix( const NetworkPrefix& network_prefix ) {
         for ( vector<NetworkPrefix*>::iterator it = this->network_prefixes->begin(); it != this->network_prefixes->end(); it++ ) {
             if ( network_prefix == *( *it ) ) {
-                this->network_prefixes->erase( it );
                 delete ( *it );
+                this->network_prefixes->erase( it );
+                return;
             }
         }
     }
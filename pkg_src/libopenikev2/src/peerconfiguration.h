@@ -23,6 +23,7 @@ namespace openikev2 {
     */
     class PeerConfiguration : public Printable {
             friend class Configuration;
+            friend class PeerConfigurationIndex;
 
             /****************************** ATTRIBUTES ******************************/
         protected:
@@ -0,0 +1,138 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#include "peerconfigurationindex.h"
+
+#include <string.h>
+#include <assert.h>
+#include <algorithm>
+
+namespace openikev2 {
+
+    PeerConfigurationIndex::PeerConfigurationIndex() {
+        this->ipv4_root = NULL;
+        this->ipv6_root = NULL;
+    }
+
+    PeerConfigurationIndex::~PeerConfigurationIndex() {
+        this->clear();
+    }
+
+    void PeerConfigurationIndex::clear() {
+        deleteNode( this->ipv4_root );
+        deleteNode( this->ipv6_root );
+        this->ipv4_root = NULL;
+        this->ipv6_root = NULL;
+    }
+
+    PeerConfigurationIndex::Node* PeerConfigurationIndex::newNode( const uint8_t* prefix, uint16_t prefixlen ) {
+        Node* node = new Node();
+        memset( node->prefix, 0, sizeof( node->prefix ) );
+        memcpy( node->prefix, prefix, prefixlen / 8 );
+        if ( prefixlen % 8 )
+            node->prefix[ prefixlen / 8 ] = prefix[ prefixlen / 8 ] & ( 0xFF << ( 8 - ( prefixlen % 8 ) ) );
+        node->prefixlen = prefixlen;
+        node->children[ 0 ] = NULL;
+        node->children[ 1 ] = NULL;
+        return node;
+    }
+
+    void PeerConfigurationIndex::deleteNode( Node* node ) {
+        if ( node == NULL )
+            return;
+        deleteNode( node->children[ 0 ] );
+        deleteNode( node->children[ 1 ] );
+        delete node;
+    }
+
+    uint8_t PeerConfigurationIndex::getBit( const uint8_t* bytes, uint16_t position ) {
+        return ( bytes[ position / 8 ] >> ( 7 - ( position % 8 ) ) ) & 1;
+    }
+
+    uint16_t PeerConfigurationIndex::getCommonBits( const uint8_t* bytes1, const uint8_t* bytes2, uint16_t max_bits ) {
+        uint16_t result = 0;
+
+        // Whole bytes first, then the bits of the first different byte
+        while ( result + 8 <= max_bits && bytes1[ result / 8 ] == bytes2[ result / 8 ] )
+            result += 8;
+
+        while ( result < max_bits && getBit( bytes1, result ) == getBit( bytes2, result ) )
+            result++;
+
+        return result;
+    }
+
+    void PeerConfigurationIndex::insert( Node*& node, const uint8_t* prefix, uint16_t prefixlen, shared_ptr<const PeerConfiguration> peer_configuration ) {
+        if ( node == NULL ) {
+            node = newNode( prefix, prefixlen );
+            node->entries.push_back( peer_configuration );
+            return;
+        }
+
+        uint16_t common_bits = getCommonBits( node->prefix, prefix, min( node->prefixlen, prefixlen ) );
+
+        // The node prefix contains the new one: goes down the trie
+        if ( common_bits == node->prefixlen ) {
+            if ( prefixlen == node->prefixlen )
+                node->entries.push_back( peer_configuration );
+            else
+                insert( node->children[ getBit( prefix, node->prefixlen ) ], prefix, prefixlen, peer_configuration );
+            return;
+        }
+
+        // Otherwise, the paths split where they differ
+        Node* split_node = newNode( prefix, common_bits );
+        split_node->children[ getBit( node->prefix, common_bits ) ] = node;
+        node = split_node;
+
+        if ( prefixlen == common_bits )
+            split_node->entries.push_back( peer_configuration );
+        else
+            insert( split_node->children[ getBit( prefix, common_bits ) ], prefix, prefixlen, peer_configuration );
+    }
+
+    void PeerConfigurationIndex::addPeerConfiguration( shared_ptr<const PeerConfiguration> peer_configuration ) {
+        for ( vector<NetworkPrefix*>::const_iterator it = peer_configuration->network_prefixes->begin(); it != peer_configuration->network_prefixes->end(); it++ ) {
+            const IpAddressValue& network_value = ( *it )->getNetworkValue();
+            if ( network_value.family != Enums::ADDR_IPV4 && network_value.family != Enums::ADDR_IPV6 )
+                continue;
+
+            insert( ( network_value.family == Enums::ADDR_IPV4 ) ? this->ipv4_root : this->ipv6_root, network_value.bytes, ( *it )->getPrefixLen(), peer_configuration );
+        }
+    }
+
+    shared_ptr<const PeerConfiguration> PeerConfigurationIndex::find( const IpAddress& ip_address, Enums::ROLE_ID role ) const {
+        assert( role != Enums::ROLE_ANY );
+
+        Enums::ADDR_FAMILY family = ip_address.getFamily();
+        if ( family != Enums::ADDR_IPV4 && family != Enums::ADDR_IPV6 )
+            return shared_ptr<const PeerConfiguration>();
+
+        IpAddressValue address_value( ip_address );
+        const uint8_t* address = address_value.bytes;
+        uint16_t address_bits = address_value.size() * 8;
+
+        // Goes down the trie while the node prefixes contain the address, keeping the longest suitable match
+        const shared_ptr<const PeerConfiguration>* result = NULL;
+        const Node* node = ( family == Enums::ADDR_IPV4 ) ? this->ipv4_root : this->ipv6_root;
+        while ( node != NULL && node->prefixlen <= address_bits && getCommonBits( node->prefix, address, node->prefixlen ) == node->prefixlen ) {
+            for ( vector<shared_ptr<const PeerConfiguration> >::const_iterator it = node->entries.begin(); it != node->entries.end(); it++ ) {
+                if ( ( *it )->role == Enums::ROLE_ANY || ( *it )->role == role ) {
+                    result = &( *it );
+                    break;
+                }
+            }
+
+            if ( node->prefixlen == address_bits )
+                break;
+            node = node->children[ getBit( address, node->prefixlen ) ];
+        }
+
+        return ( result != NULL ) ? *result : shared_ptr<const PeerConfiguration>();
+    }
+}
@@ -0,0 +1,117 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#ifndef OPENIKEV2PEERCONFIGURATIONINDEX_H
+#define OPENIKEV2PEERCONFIGURATIONINDEX_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "peerconfiguration.h"
+
+#include <memory>
+#include <vector>
+
+namespace openikev2 {
+
+    /**
+        This class indexes the PeerConfigurations by their network prefixes, in one path compressed binary trie per
+        address family. Lookups follow the bits of the address (longest prefix match), and don't allocate any memory.
+        When several PeerConfigurations have the same prefix, the first one added with a suitable role is selected.
+        @author Alejandro Perez Mendez, Pedro J. Fernandez Ruiz <alex@um.es, pedroj@um.es>
+    */
+    class PeerConfigurationIndex {
+
+            /****************************** STRUCTS ******************************/
+        protected:
+            /** Node of the trie. Nodes without entries only split the paths */
+            struct Node {
+                uint8_t prefix[ 16 ];                                       /**< Prefix bits (masked) */
+                uint16_t prefixlen;                                         /**< Prefix length */
+                Node* children[ 2 ];                                        /**< Subtries for the next bit being 0 and 1 */
+                vector<shared_ptr<const PeerConfiguration> > entries;       /**< PeerConfigurations with exactly this prefix, in addition order */
+            };
+
+            /****************************** ATTRIBUTES ******************************/
+        protected:
+            Node* ipv4_root;                                                /**< Root of the IPv4 trie */
+            Node* ipv6_root;                                                /**< Root of the IPv6 trie */
+
+            /****************************** METHODS ******************************/
+        protected:
+            /**
+             * Creates a new Node
+             * @param prefix Prefix bits. Only the first prefixlen bits are copied
+             * @param prefixlen Prefix length
+             * @return The new Node
+             */
+            static Node* newNode( const uint8_t* prefix, uint16_t prefixlen );
+
+            /**
+             * Deletes a Node and all its subtries
+             * @param node Node to be deleted
+             */
+            static void deleteNode( Node* node );
+
+            /**
+             * Gets a bit of an address
+             * @param bytes Address bytes
+             * @param position Bit position (0 is the most significant bit)
+             * @return The bit value
+             */
+            static uint8_t getBit( const uint8_t* bytes, uint16_t position );
+
+            /**
+             * Gets the number of leading bits two addresses have in common
+             * @param bytes1 One address
+             * @param bytes2 Other address
+             * @param max_bits Maximum number of bits to be compared
+             * @return Number of common leading bits, up to max_bits
+             */
+            static uint16_t getCommonBits( const uint8_t* bytes1, const uint8_t* bytes2, uint16_t max_bits );
+
+            /**
+             * Inserts a PeerConfiguration in a trie
+             * @param node Root of the trie. It is updated if the trie changes its root
+             * @param prefix Prefix bits
+             * @param prefixlen Prefix length
+             * @param peer_configuration PeerConfiguration
+             */
+            static void insert( Node*& node, const uint8_t* prefix, uint16_t prefixlen, shared_ptr<const PeerConfiguration> peer_configuration );
+
+        public:
+            /**
+             * Creates a new empty PeerConfigurationIndex
+             */
+            PeerConfigurationIndex();
+
+            /**
+             * Indexes all the network prefixes of a PeerConfiguration
+             * @param peer_configuration PeerConfiguration
+             */
+            void addPeerConfiguration( shared_ptr<const PeerConfiguration> peer_configuration );
+
+            /**
+             * Removes all the indexed PeerConfigurations
+             */
+            void clear();
+
+            /**
+             * Finds the PeerConfiguration with the longest network prefix containing the IP address and a suitable role
+             * @param ip_address Peer IP address
+             * @param role Role (cannot be ANY)
+             * @return The PeerConfiguration. Empty if there isn't any suitable one
+             */
+            shared_ptr<const PeerConfiguration> find( const IpAddress& ip_address, Enums::ROLE_ID role ) const;
+
+            virtual ~PeerConfigurationIndex();
+    };
+}
+
+#endif
@@ -16,6 +16,7 @@ namespace openikev2 {
     Proposal::Proposal( Enums::PROTOCOL_ID protocol_id ) {
         // assigns the proposal number
         this->proposal_number = 0;
+        this->transform_types = 0;
 
         // Assigns protocol id
         this->protocol_id = protocol_id;
@@ -41,6 +42,7 @@ namespace openikev2 {
         this->protocol_id = protocol_id;
         this->spi = spi;
         this->proposal_number = 0;
+        this->transform_types = 0;
     }
 
     auto_ptr<Proposal> Proposal::parse( ByteBuffer& byte_buffer ) {
@@ -70,7 +72,7 @@ namespace openikev2 {
         uint8_t transform_count = byte_buffer.readInt8();
 
         // Reads spi value and stores it in the internal variable
-        auto_ptr<ByteArray> spi = byte_buffer.readByteArray( spi_size );
+        auto_ptr<ByteArray> spi = byte_buffer.readByteArrayView( spi_size );
 
         // Creates the Proposal
         auto_ptr<Proposal> result ( new Proposal( protocol_id, spi ) );
@@ -138,6 +140,12 @@ namespace openikev2 {
 
         }
 
+        if ( transform->type <= Enums::ESN ) {
+            this->transform_types |= 1 << transform->type;
+            if ( transform->id < PROPOSAL_TABLE_IDS )
+                this->transform_ids[ transform->type ].set( transform->id );
+        }
+
         this->transforms->push_back( transform.release() );
     }
 
@@ -230,9 +238,32 @@ namespace openikev2 {
                 it++;
             }
         }
+
+        if ( type <= Enums::ESN ) {
+            this->transform_types &= ~( 1 << type );
+            this->transform_ids[ type ].reset();
+        }
+    }
+
+    bool Proposal::hasTransformType( Enums::TRANSFORM_TYPE type ) const {
+        if ( type > Enums::ESN )
+            return this->getFirstTransformByType( type ) != NULL;
+        return ( this->transform_types & ( 1 << type ) ) != 0;
+    }
+
+    bool Proposal::mayHaveTransform( Enums::TRANSFORM_TYPE type, uint16_t id ) const {
+        // Unknown types and big IDs are not indexed
+        if ( type > Enums::ESN )
+            return true;
+        if ( id >= PROPOSAL_TABLE_IDS )
+            return ( this->transform_types & ( 1 << type ) ) != 0;
+        return this->transform_ids[ type ].test( id );
     }
 
     bool Proposal::hasTransform( const Transform & transform ) const {
+        if ( !this->mayHaveTransform( transform.type, transform.id ) )
+            return false;
+
         for ( vector<Transform*>::const_iterator it = this->transforms->begin(); it != this->transforms->end(); it++ ) {
             Transform* current_transform = ( *it );
             if ( *current_transform == transform )
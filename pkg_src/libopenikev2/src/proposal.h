@@ -15,6 +15,10 @@
 
 #include "transform.h"
 
+#include <bitset>
+
+#define PROPOSAL_TABLE_IDS          256     // Transform IDs indexed by the per type tables of each Proposal
+
 using namespace std;
 
 namespace openikev2 {
@@ -32,6 +36,10 @@ namespace openikev2 {
             Enums::PROTOCOL_ID protocol_id;         /**< Protocol id */
             uint8_t proposal_number;                /**< Number of the proposal */
 
+        protected:
+            uint8_t transform_types;                                        /**< Bit N is set if there are transforms of type N */
+            bitset<PROPOSAL_TABLE_IDS> transform_ids[ Enums::ESN + 1 ];     /**< IDs of the transforms of each type. Kept by addTransform() and deleteTransformsByType() */
+
             /****************************** METHODS ******************************/
         public:
             /**
@@ -79,6 +87,21 @@ namespace openikev2 {
              */
             virtual bool hasTransform( const Transform& transform ) const;
 
+            /**
+             * Indicates if the Proposal has transforms of the indicated type, without scanning them
+             * @param type Transform type.
+             * @return TRUE if the Proposal has transforms of this type. FALSE otherwise
+             */
+            bool hasTransformType( Enums::TRANSFORM_TYPE type ) const;
+
+            /**
+             * Fast check against the per type tables, without scanning the transforms or their attributes
+             * @param type Transform type.
+             * @param id Transform ID.
+             * @return FALSE if the Proposal doesn't have any transform with this type and ID. TRUE if it may have it
+             */
+            bool mayHaveTransform( Enums::TRANSFORM_TYPE type, uint16_t id ) const;
+
             /**
              * Indicates if the Proposals has the same transform types than other
              * @param other Other proposal
@@ -9,41 +9,53 @@
 #include "pseudorandomfunction.h"
 #include "bytebuffer.h"
 #include "bytearray.h"
+#include "bytearrayview.h"
+#include "exception.h"
+#include "utils.h"
+
+#include <string.h>
 
 namespace openikev2 {
     PseudoRandomFunction::~PseudoRandomFunction() {}
 
     auto_ptr< ByteArray > PseudoRandomFunction::prfPlus( const ByteArray & key, const ByteArray & sequence, uint32_t needed_size ) const {
-        uint32_t iterations = ( needed_size / this->prf_size ) + 1;
+        auto_ptr<ByteArray> result ( new ByteArray( needed_size ) );
+        this->writePrfPlus( key, sequence, needed_size, result->getRawPointer() );
+        result->setSize( needed_size );
+        return result;
+    }
 
-        // The result size will be iter * prf_size
-        auto_ptr<ByteBuffer> result ( new ByteBuffer( iterations * this->prf_size ) );
+    void PseudoRandomFunction::writePrf( const ByteArray & key, const uint8_t * data, uint32_t size, uint8_t * result ) const {
+        ByteArrayView data_view( data, size );
+        auto_ptr<ByteArray> prf_value = this->prf( key, data_view );
+        memcpy( result, prf_value->getRawPointer(), this->prf_size );
+    }
 
-        // New sequence must have, at least, prf_size + sequence size + 1
-        ByteBuffer new_sequence( this->prf_size + sequence.size() + 1 );
+    void PseudoRandomFunction::writePrfPlus( const ByteArray & key, const ByteArray & sequence, uint32_t needed_size, uint8_t * output ) const {
+        // The iteration counter is a single octet (RFC 7296, section 2.13)
+        if ( needed_size > 255 * this->prf_size )
+            throw CipherException( "Too much key material requested to prf+: " + intToString( needed_size ) );
 
-        // For the first iteration, temp must be an empty ByteArray
-        auto_ptr<ByteArray> temp( new ByteArray( 0 ) );
+        // New sequence = T(i-1) | S | i. It is reused by all the iterations
+        ByteBuffer new_sequence( 2 * this->prf_size + sequence.size() + 1 );
+        uint8_t* previous = NULL;
 
-        // Make the iteratins
-        for ( uint8_t current_iter = 1; current_iter <= iterations; current_iter++ ) {
-            // Resets new_sequence
+        for ( uint32_t written = 0, current_iter = 1; written < needed_size; current_iter++ ) {
             new_sequence.reset();
-
-            // New sequence = Ti | S | iter
-            new_sequence.writeByteArray( *temp );
+            if ( previous != NULL )
+                new_sequence.writeBuffer( previous, this->prf_size );
             new_sequence.writeByteArray( sequence );
             new_sequence.writeInt8( current_iter );
 
-            // Calculate temp = prf(K, S | 0x01) = prf(K, new_sequence)
-            auto_ptr<ByteArray> new_sequence_array = new_sequence.readByteArray( new_sequence.size() );
-            temp = this->prf( key, *new_sequence_array );
+            // T(i) is written after the input, so the last partial block is truncated when copied
+            uint8_t* current = new_sequence.getWritePosition();
+            this->writePrf( key, new_sequence.getRawPointer(), new_sequence.size(), current );
 
-            // Adds temp to the result
-            result->writeByteArray( *temp );
+            uint32_t copy_size = ( needed_size - written < this->prf_size ) ? needed_size - written : this->prf_size;
+            memcpy( output + written, current, copy_size );
+            previous = output + written;
+            written += copy_size;
         }
-
-        return auto_ptr<ByteArray> ( result );
     }
 
 }
@@ -45,6 +45,25 @@ namespace openikev2 {
              */
             virtual auto_ptr<ByteArray> prfPlus( const ByteArray& key, const ByteArray& sequence, uint32_t needed_size ) const;
 
+            /**
+             * Computes the PRF value and writes it in the indicated position. The default implementation relies on prf()
+             * @param key Key
+             * @param data Data to compute the PRF value
+             * @param size Data size
+             * @param result Position where the prf_size bytes of the PRF value will be written
+             */
+            virtual void writePrf( const ByteArray& key, const uint8_t* data, uint32_t size, uint8_t* result ) const;
+
+            /**
+             * Computes the PRF+ value and writes it in the indicated position. The default implementation relies on writePrf(),
+             * so implementations should redefine it to avoid the intermediate buffer.
+             * @param key Key
+             * @param sequence Sequence (S)
+             * @param needed_size Needed key material size
+             * @param output Position where the needed_size bytes of key material will be written
+             */
+            virtual void writePrfPlus( const ByteArray& key, const ByteArray& sequence, uint32_t needed_size, uint8_t* output ) const;
+
             virtual ~PseudoRandomFunction();
     };
 }
@@ -0,0 +1,90 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#include "pseudorandomfunctionopenssl.h"
+#include "exception.h"
+#include "utils.h"
+
+#include <string.h>
+#include <openssl/crypto.h>
+
+namespace openikev2 {
+
+    const char* PseudoRandomFunctionOpenSSL::getDigestName( Enums::PRF_ID prf_id ) {
+        switch ( prf_id ) {
+            case Enums::PRF_HMAC_MD5:
+                return "MD5";
+            case Enums::PRF_HMAC_SHA1:
+                return "SHA1";
+            case Enums::PRF_HMAC_SHA2_256:
+                return "SHA256";
+            case Enums::PRF_HMAC_SHA2_384:
+                return "SHA384";
+            case Enums::PRF_HMAC_SHA2_512:
+                return "SHA512";
+            default:
+                return NULL;
+        }
+    }
+
+    PseudoRandomFunctionOpenSSL::PseudoRandomFunctionOpenSSL( Enums::PRF_ID prf_id ) {
+        const char* digest_name = getDigestName( prf_id );
+        if ( digest_name == NULL )
+            throw CipherException( "PRF algorithm not supported: " + Enums::PRF_ID_STR( prf_id ) );
+
+        this->hmac.reset( new HmacOpenSSL( digest_name ) );
+        this->prf_size = this->hmac->hmac_size;
+    }
+
+    PseudoRandomFunctionOpenSSL::~PseudoRandomFunctionOpenSSL() {}
+
+    auto_ptr<ByteArray> PseudoRandomFunctionOpenSSL::prf( const ByteArray& key, const ByteArray& data ) const {
+        auto_ptr<ByteArray> result ( new ByteArray( this->prf_size ) );
+        this->writePrf( key, data.getRawPointer(), data.size(), result->getRawPointer() );
+        result->setSize( this->prf_size );
+        return result;
+    }
+
+    void PseudoRandomFunctionOpenSSL::writePrf( const ByteArray& key, const uint8_t* data, uint32_t size, uint8_t* result ) const {
+        this->hmac->setKey( key.getRawPointer(), key.size() );
+        this->hmac->compute( data, size, result );
+    }
+
+    void PseudoRandomFunctionOpenSSL::writePrfPlus( const ByteArray& key, const ByteArray& sequence, uint32_t needed_size, uint8_t* output ) const {
+        // The iteration counter is a single octet (RFC 7296, section 2.13)
+        if ( needed_size > 255 * this->prf_size )
+            throw CipherException( "Too much key material requested to prf+: " + intToString( needed_size ) );
+
+        this->hmac->setKey( key.getRawPointer(), key.size() );
+
+        uint8_t last_block[ EVP_MAX_MD_SIZE ];
+        const uint8_t* previous = NULL;
+        uint32_t written = 0;
+        for ( uint8_t current_iter = 1; written < needed_size; current_iter++ ) {
+            // T(i) = prf(K, T(i-1) | S | i)
+            this->hmac->begin();
+            if ( previous != NULL )
+                this->hmac->update( previous, this->prf_size );
+            this->hmac->update( sequence.getRawPointer(), sequence.size() );
+            this->hmac->update( &current_iter, 1 );
+
+            // Complete blocks are written in place, and they are the T(i-1) of the next iteration
+            if ( needed_size - written >= this->prf_size ) {
+                this->hmac->finish( output + written );
+                previous = output + written;
+                written += this->prf_size;
+            }
+            else {
+                this->hmac->finish( last_block );
+                memcpy( output + written, last_block, needed_size - written );
+                OPENSSL_cleanse( last_block, sizeof( last_block ) );
+                written = needed_size;
+            }
+        }
+    }
+}
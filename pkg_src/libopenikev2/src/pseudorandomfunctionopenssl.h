@@ -0,0 +1,57 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#ifndef OPENIKEV2PSEUDORANDOMFUNCTIONOPENSSL_H
+#define OPENIKEV2PSEUDORANDOMFUNCTIONOPENSSL_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "pseudorandomfunction.h"
+#include "hmacopenssl.h"
+#include "enums.h"
+
+namespace openikev2 {
+
+    /**
+        This class implements the HMAC based PseudoRandomFunctions using OpenSSL.
+        The key schedule of the last used key is kept, so prfPlus() iterations do not load it again. Each prf+ iteration
+        feeds T(i-1), S and the counter incrementally into the HMAC context, writing T(i) directly in the output.
+        @author Alejandro Perez Mendez, Pedro J. Fernandez Ruiz <alex@um.es, pedroj@um.es>
+    */
+    class PseudoRandomFunctionOpenSSL : public PseudoRandomFunction {
+
+            /****************************** ATTRIBUTES ******************************/
+        protected:
+            auto_ptr<HmacOpenSSL> hmac;             /**< HMAC context */
+
+            /****************************** METHODS ******************************/
+        public:
+            /**
+             * Gets the digest name used by a PRF algorithm
+             * @param prf_id PRF algorithm
+             * @return Digest name. NULL if not supported
+             */
+            static const char* getDigestName( Enums::PRF_ID prf_id );
+
+            /**
+             * Creates a new PseudoRandomFunctionOpenSSL
+             * @param prf_id PRF algorithm
+             */
+            PseudoRandomFunctionOpenSSL( Enums::PRF_ID prf_id );
+
+            virtual auto_ptr<ByteArray> prf( const ByteArray& key, const ByteArray& data ) const;
+            virtual void writePrf( const ByteArray& key, const uint8_t* data, uint32_t size, uint8_t* result ) const;
+            virtual void writePrfPlus( const ByteArray& key, const ByteArray& sequence, uint32_t needed_size, uint8_t* output ) const;
+
+            virtual ~PseudoRandomFunctionOpenSSL();
+    };
+}
+
+#endif
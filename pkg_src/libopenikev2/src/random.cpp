@@ -8,8 +8,15 @@
 ***************************************************************************/
 #include "random.h"
 
+#include <string.h>
+
 namespace openikev2 {
 
     Random::~Random() {}
 
+    void Random::writeRandomBytes( uint8_t* buffer, uint32_t size ) {
+        auto_ptr<ByteArray> random_bytes = this->getRandomBytes( size );
+        memcpy( buffer, random_bytes->getRawPointer(), size );
+    }
+
 }
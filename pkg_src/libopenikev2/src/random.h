@@ -50,6 +50,13 @@ namespace openikev2 {
              */
             virtual uint64_t getRandomInt64( uint64_t min, uint64_t max ) = 0;
 
+            /**
+             * Fills a caller provided buffer with random bytes, without allocating any ByteArray
+             * @param buffer Buffer to be filled
+             * @param size Number of bytes to be written
+             */
+            virtual void writeRandomBytes( uint8_t* buffer, uint32_t size );
+
             virtual ~Random();
     };
 }
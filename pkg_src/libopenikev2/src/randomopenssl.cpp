@@ -0,0 +1,103 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#include "randomopenssl.h"
+#include "exception.h"
+
+#include <openssl/rand.h>
+#include <openssl/crypto.h>
+#include <pthread.h>
+#include <string.h>
+
+namespace openikev2 {
+
+    thread_local RandomOpenSSL::RandomBuffer RandomOpenSSL::thread_buffer;
+    atomic<uint32_t> RandomOpenSSL::fork_generation ( 0 );
+
+    RandomOpenSSL::RandomBuffer::~RandomBuffer() {
+        OPENSSL_cleanse( this->bytes, sizeof( this->bytes ) );
+    }
+
+    RandomOpenSSL::~RandomOpenSSL() {}
+
+    void RandomOpenSSL::onFork() {
+        fork_generation++;
+    }
+
+    void RandomOpenSSL::fill( void* buffer, uint32_t size ) {
+        static int atfork_result = pthread_atfork( NULL, NULL, RandomOpenSSL::onFork );
+        ( void ) atfork_result;
+
+        // The bytes inherited from the parent process are also being handed out there. OpenSSL reseeds its own DRBG
+        uint32_t generation = fork_generation.load( memory_order_relaxed );
+        if ( thread_buffer.fork_generation != generation ) {
+            OPENSSL_cleanse( thread_buffer.bytes, thread_buffer.available );
+            thread_buffer.available = 0;
+            thread_buffer.fork_generation = generation;
+        }
+
+        // Big requests would drain the buffer, so they go directly to the CSPRNG
+        if ( size > RANDOM_BUFFER_SIZE / 4 ) {
+            if ( RAND_bytes( ( unsigned char* ) buffer, size ) != 1 )
+                throw CipherException( "Cannot generate random bytes" );
+            return;
+        }
+
+        if ( thread_buffer.available < size ) {
+            if ( RAND_bytes( thread_buffer.bytes, RANDOM_BUFFER_SIZE ) != 1 ) {
+                thread_buffer.available = 0;
+                throw CipherException( "Cannot generate random bytes" );
+            }
+            thread_buffer.available = RANDOM_BUFFER_SIZE;
+        }
+
+        // Bytes are taken from the end of the unused area, and wiped once copied
+        thread_buffer.available -= size;
+        memcpy( buffer, thread_buffer.bytes + thread_buffer.available, size );
+        OPENSSL_cleanse( thread_buffer.bytes + thread_buffer.available, size );
+    }
+
+    auto_ptr<ByteArray> RandomOpenSSL::getRandomBytes( uint32_t size ) {
+        auto_ptr<ByteArray> result ( new ByteArray( size ) );
+        fill( result->getRawPointer(), size );
+        result->setSize( size );
+        return result;
+    }
+
+    uint32_t RandomOpenSSL::getRandomInt32( uint32_t min, uint32_t max ) {
+        return ( uint32_t ) this->getRandomInt64( min, max );
+    }
+
+    uint64_t RandomOpenSSL::getRandomInt64( uint64_t min, uint64_t max ) {
+        uint64_t value;
+
+        if ( min >= max )
+            return min;
+
+        uint64_t range = max - min + 1;
+
+        // Full range
+        if ( range == 0 ) {
+            fill( &value, sizeof( value ) );
+            return value;
+        }
+
+        // Rejects the values of the last incomplete interval, to avoid bias
+        uint64_t limit = UINT64_MAX - ( UINT64_MAX % range );
+        do {
+            fill( &value, sizeof( value ) );
+        }
+        while ( value >= limit );
+
+        return min + value % range;
+    }
+
+    void RandomOpenSSL::writeRandomBytes( uint8_t* buffer, uint32_t size ) {
+        fill( buffer, size );
+    }
+}
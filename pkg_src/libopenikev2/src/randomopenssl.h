@@ -0,0 +1,77 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#ifndef OPENIKEV2RANDOMOPENSSL_H
+#define OPENIKEV2RANDOMOPENSSL_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "random.h"
+
+#include <atomic>
+
+#define RANDOM_BUFFER_SIZE          4096    // Random bytes pulled at once from the OpenSSL CSPRNG by each thread
+
+namespace openikev2 {
+
+    /**
+        This class implements a Random generator using the OpenSSL CSPRNG.
+        Each thread keeps its own buffer, filled in bulk from the CSPRNG, so the small requests (IVs, nonces, SPIs) don't
+        take any lock or allocate any memory. Bytes are wiped from the buffer once handed out, and the buffer is
+        discarded in the child process after a fork(), so parent and child never share random bytes.
+        @author Alejandro Perez Mendez, Pedro J. Fernandez Ruiz <alex@um.es, pedroj@um.es>
+    */
+    class RandomOpenSSL : public Random {
+
+            /****************************** STRUCTS ******************************/
+        protected:
+            /** Per thread buffer of random bytes */
+            struct RandomBuffer {
+                uint8_t bytes[ RANDOM_BUFFER_SIZE ];        /**< Random bytes. Only the first "available" ones are unused */
+                uint32_t available;                         /**< Number of unused random bytes */
+                uint32_t fork_generation;                   /**< Fork generation when the buffer was filled */
+
+                /**
+                 * Wipes the buffer
+                 */
+                ~RandomBuffer();
+            };
+
+            /****************************** ATTRIBUTES ******************************/
+        protected:
+            static thread_local RandomBuffer thread_buffer; /**< Buffer of the current thread */
+            static atomic<uint32_t> fork_generation;        /**< Incremented in the child process after each fork() */
+
+            /****************************** METHODS ******************************/
+        protected:
+            /**
+             * Invalidates the buffers inherited from the parent process. Called in the child process after fork()
+             */
+            static void onFork();
+
+        public:
+            /**
+             * Fills a buffer with random bytes, taking them from the buffer of the current thread
+             * @param buffer Buffer to be filled
+             * @param size Buffer size
+             */
+            static void fill( void* buffer, uint32_t size );
+
+        public:
+            virtual auto_ptr<ByteArray> getRandomBytes( uint32_t size );
+            virtual uint32_t getRandomInt32( uint32_t min, uint32_t max );
+            virtual uint64_t getRandomInt64( uint64_t min, uint64_t max );
+            virtual void writeRandomBytes( uint8_t* buffer, uint32_t size );
+
+            virtual ~RandomOpenSSL();
+    };
+}
+
+#endif
@@ -20,6 +20,10 @@ namespace openikev2 {
         return ( this->getIpAddress() == other.getIpAddress() );
     }
 
+    IpAddressValue SocketAddress::getIpAddressValue() const {
+        return IpAddressValue( this->getIpAddress() );
+    }
+
 }
 
 
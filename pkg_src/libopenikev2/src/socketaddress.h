@@ -10,6 +10,7 @@
 #define OPENIKEV2SOCKETADDRESS_H
 
 #include "ipaddress.h"
+#include "ipaddressvalue.h"
 
 namespace openikev2 {
 
@@ -39,6 +40,12 @@ namespace openikev2 {
              */
             virtual uint16_t getPort() const = 0;
 
+            /**
+             * Gets the IP address as a compact value.
+             * @return The IP address value
+             */
+            virtual IpAddressValue getIpAddressValue() const;
+
             /**
              * Sets the IP address
              * @param ip_address New IP address
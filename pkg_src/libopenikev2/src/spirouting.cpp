@@ -0,0 +1,58 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#include "spirouting.h"
+#include "cryptocontroller.h"
+
+#include <assert.h>
+
+namespace openikev2 {
+
+    atomic<uint8_t> SpiRouting::node_id( 0 );
+
+    void SpiRouting::setNodeId( uint8_t node_id ) {
+        SpiRouting::node_id = node_id & ( ( 1 << SPI_ROUTING_NODE_BITS ) - 1 );
+    }
+
+    uint8_t SpiRouting::getNodeId() {
+        return SpiRouting::node_id;
+    }
+
+    uint16_t SpiRouting::getMaxWorkers() {
+        return 1 << SPI_ROUTING_WORKER_BITS;
+    }
+
+    uint64_t SpiRouting::generateIkeSaSpi( uint16_t worker ) {
+        assert( worker < getMaxWorkers() );
+
+        const uint16_t random_bits = 64 - SPI_ROUTING_NODE_BITS - SPI_ROUTING_WORKER_BITS;
+        uint64_t prefix = ( ( uint64_t ) getNodeId() << SPI_ROUTING_WORKER_BITS ) | worker;
+
+        // The random part is never 0, so neither is the SPI
+        return ( prefix << random_bits ) | CryptoController::getRandomInt64( 1, ( 1ULL << random_bits ) - 1 );
+    }
+
+    void SpiRouting::getChildSaSpiRange( uint16_t worker, uint32_t& min, uint32_t& max ) {
+        assert( worker < getMaxWorkers() );
+
+        const uint16_t random_bits = 32 - SPI_ROUTING_NODE_BITS - SPI_ROUTING_WORKER_BITS;
+        uint32_t prefix = ( ( uint32_t ) getNodeId() << SPI_ROUTING_WORKER_BITS ) | worker;
+
+        // SPI values 0-255 are reserved (RFC 4303)
+        min = prefix << random_bits;
+        if ( min < 256 )
+            min = 256;
+        max = ( prefix << random_bits ) | ( ( 1U << random_bits ) - 1 );
+    }
+
+    uint32_t SpiRouting::generateChildSaSpi( uint16_t worker ) {
+        uint32_t min, max;
+        getChildSaSpiRange( worker, min, max );
+        return CryptoController::getRandomInt32( min, max );
+    }
+}
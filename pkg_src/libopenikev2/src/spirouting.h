@@ -0,0 +1,120 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#ifndef OPENIKEV2SPIROUTING_H
+#define OPENIKEV2SPIROUTING_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include <stdint.h>
+#include <atomic>
+
+#define SPI_ROUTING_NODE_BITS 4         // Most significant bits of our SPIs encoding the node ID
+#define SPI_ROUTING_WORKER_BITS 8       // Bits of our SPIs (after the node ID) encoding the owning worker
+
+using namespace std;
+
+namespace openikev2 {
+
+    /**
+        This class defines how the SPIs we allocate encode their routing information, so a receiving thread can
+        dispatch a message (or an IPsec event) to the owning worker from the SPI alone, without any shared lookup.
+        The most significant bits hold the node ID, followed by the worker index. The remaining bits are random.
+        IKE SA SPIs keep 52 random bits, and Child SA SPIs keep 20 (allocated from a contiguous range per worker,
+        as kernel SPI allocators expect).
+        @author Alejandro Perez Mendez, Pedro J. Fernandez Ruiz <alex@um.es, pedroj@um.es>
+    */
+    class SpiRouting {
+
+            /****************************** ATTRIBUTES ******************************/
+        protected:
+            static atomic<uint8_t> node_id;         /**< Node ID of this process */
+
+            /****************************** METHODS ******************************/
+        public:
+            /**
+             * Sets the node ID encoded in the SPIs allocated by this process
+             * @param node_id Node ID (only the lower SPI_ROUTING_NODE_BITS bits are used)
+             */
+            static void setNodeId( uint8_t node_id );
+
+            /**
+             * Gets the node ID encoded in the SPIs allocated by this process
+             * @return The node ID
+             */
+            static uint8_t getNodeId();
+
+            /**
+             * Gets the maximum number of workers that can be encoded in the SPIs
+             * @return The maximum number of workers
+             */
+            static uint16_t getMaxWorkers();
+
+            /**
+             * Generates a random IKE SA SPI owned by the indicated worker of this node
+             * @param worker Worker index (lower than getMaxWorkers())
+             * @return The SPI value (never 0)
+             */
+            static uint64_t generateIkeSaSpi( uint16_t worker );
+
+            /**
+             * Gets the worker index encoded in an IKE SA SPI
+             * @param spi IKE SA SPI
+             * @return The worker index
+             */
+            static uint16_t getIkeSaSpiWorker( uint64_t spi ) {
+                return ( spi >> ( 64 - SPI_ROUTING_NODE_BITS - SPI_ROUTING_WORKER_BITS ) ) & ( ( 1 << SPI_ROUTING_WORKER_BITS ) - 1 );
+            }
+
+            /**
+             * Gets the node ID encoded in an IKE SA SPI
+             * @param spi IKE SA SPI
+             * @return The node ID
+             */
+            static uint8_t getIkeSaSpiNode( uint64_t spi ) {
+                return spi >> ( 64 - SPI_ROUTING_NODE_BITS );
+            }
+
+            /**
+             * Gets the range of Child SA SPIs owned by the indicated worker of this node
+             * @param worker Worker index (lower than getMaxWorkers())
+             * @param min Where the minimum SPI value is stored (never lower than 256)
+             * @param max Where the maximum SPI value is stored
+             */
+            static void getChildSaSpiRange( uint16_t worker, uint32_t& min, uint32_t& max );
+
+            /**
+             * Generates a random Child SA SPI owned by the indicated worker of this node
+             * @param worker Worker index (lower than getMaxWorkers())
+             * @return The SPI value
+             */
+            static uint32_t generateChildSaSpi( uint16_t worker );
+
+            /**
+             * Gets the worker index encoded in a Child SA SPI
+             * @param spi Child SA SPI
+             * @return The worker index
+             */
+            static uint16_t getChildSaSpiWorker( uint32_t spi ) {
+                return ( spi >> ( 32 - SPI_ROUTING_NODE_BITS - SPI_ROUTING_WORKER_BITS ) ) & ( ( 1 << SPI_ROUTING_WORKER_BITS ) - 1 );
+            }
+
+            /**
+             * Gets the node ID encoded in a Child SA SPI
+             * @param spi Child SA SPI
+             * @return The node ID
+             */
+            static uint8_t getChildSaSpiNode( uint32_t spi ) {
+                return spi >> ( 32 - SPI_ROUTING_NODE_BITS );
+            }
+    };
+}
+
+#endif
@@ -11,7 +11,6 @@
 #include "exception.h"
 #include "enums.h"
 #include "utils.h"
-#include "networkprefix.h"
 
 #include <assert.h>
 
@@ -20,6 +19,12 @@ namespace openikev2 {
     TrafficSelector::TrafficSelector( TS_TYPE ts_type, auto_ptr<ByteArray> start_addr, auto_ptr<ByteArray> end_addr, uint16_t start_port, uint16_t end_port, uint8_t ip_protocol_id ) {
         assert( ( start_port <= end_port ) || ( start_port == 65535 && end_port == 0 ) );
 
+        this->construct( ts_type, getAddressValue( ts_type, *start_addr ), getAddressValue( ts_type, *end_addr ), start_port, end_port, ip_protocol_id );
+    }
+
+    TrafficSelector::TrafficSelector( TS_TYPE ts_type, const IpAddressValue& start_addr, const IpAddressValue& end_addr, uint16_t start_port, uint16_t end_port, uint8_t ip_protocol_id ) {
+        assert( ( start_port <= end_port ) || ( start_port == 65535 && end_port == 0 ) );
+
         this->construct( ts_type, start_addr, end_addr, start_port, end_port, ip_protocol_id );
     }
 
@@ -28,7 +33,7 @@ namespace openikev2 {
 
         uint16_t start_port = ( start_icmp_type << 8 ) | start_icmp_code;
         uint16_t end_port = ( end_icmp_type << 8 ) | end_icmp_code;
-        this->construct( ts_type, start_addr, end_addr, start_port, end_port, ip_protocol_id );
+        this->construct( ts_type, getAddressValue( ts_type, *start_addr ), getAddressValue( ts_type, *end_addr ), start_port, end_port, ip_protocol_id );
     }
 
     TrafficSelector::TrafficSelector( IpAddress& address, uint8_t prefixlen, uint8_t icmp_type, uint8_t icmp_code, uint8_t ip_protocol_id ) {
@@ -55,8 +60,8 @@ namespace openikev2 {
         this->start_port = other.start_port;
         this->end_port = other.end_port;
 
-        this->start_addr = other.start_addr->clone();
-        this->end_addr = other.end_addr->clone();
+        this->start_addr = other.start_addr;
+        this->end_addr = other.end_addr;
     }
 
     TrafficSelector::TrafficSelector( ByteBuffer& byte_buffer ) {
@@ -87,20 +92,22 @@ namespace openikev2 {
         if ( ( this->start_port > this->end_port ) && ( this->start_port != 65535 && this->end_port != 0 ) )
             throw ParsingException( "TS has invalid port range." );
 
-        // reads the start address
-        this->start_addr = byte_buffer.readByteArray( TrafficSelector::getExpectedAddressSize( this->ts_type ) );
-        this->end_addr = byte_buffer.readByteArray( TrafficSelector::getExpectedAddressSize( this->ts_type ) );
+        // reads the start and end addresses directly into the values
+        this->start_addr.family = TrafficSelector::getFamily( this->ts_type );
+        byte_buffer.readBuffer( this->start_addr.size(), this->start_addr.bytes );
+        this->end_addr.family = this->start_addr.family;
+        byte_buffer.readBuffer( this->end_addr.size(), this->end_addr.bytes );
 
         // checks the address range
-        if ( *this->start_addr > *this->end_addr )
+        if ( this->start_addr > this->end_addr )
             throw ParsingException( "TS has invalid address range." );
     }
 
     TrafficSelector::~TrafficSelector( ) {}
 
-    void TrafficSelector::construct( TS_TYPE ts_type, auto_ptr<ByteArray> start_addr, auto_ptr<ByteArray> end_addr, uint16_t start_port, uint16_t end_port, uint8_t ip_protocol_id ) {
-        assert ( start_addr->size() == getExpectedAddressSize( ts_type ) );
-        assert ( end_addr->size() == getExpectedAddressSize( ts_type ) );
+    void TrafficSelector::construct( TS_TYPE ts_type, const IpAddressValue& start_addr, const IpAddressValue& end_addr, uint16_t start_port, uint16_t end_port, uint8_t ip_protocol_id ) {
+        assert ( start_addr.family == getFamily( ts_type ) );
+        assert ( end_addr.family == getFamily( ts_type ) );
 
         this->ts_type = ts_type;
 
@@ -129,10 +136,9 @@ namespace openikev2 {
             this->end_port = port;
         }
 
-        NetworkPrefix prefix ( address.clone(), prefixlen );
-
-        this->start_addr = prefix.getNetworkAddress().getBytes();
-        this->end_addr = prefix.getBroadCastAddress()->getBytes();
+        IpAddressValue address_value( address );
+        this->start_addr = address_value.getNetworkValue( prefixlen );
+        this->end_addr = address_value.getBroadcastValue( prefixlen );
 
     }
 
@@ -159,13 +165,13 @@ namespace openikev2 {
             return auto_ptr<TrafficSelector> ( NULL );
 
         // the selected start address will be the maximun
-        auto_ptr<ByteArray> selected_start_address = ( *ts1.start_addr > *ts2.start_addr ) ? ts1.start_addr->clone() : ts2.start_addr->clone();
+        const IpAddressValue& selected_start_address = ( ts1.start_addr > ts2.start_addr ) ? ts1.start_addr : ts2.start_addr;
 
         // the selected end address will be the minimun
-        auto_ptr<ByteArray> selected_end_address = ( *ts1.end_addr < *ts2.end_addr ) ? ts1.end_addr->clone() : ts2.end_addr->clone();
+        const IpAddressValue& selected_end_address = ( ts1.end_addr < ts2.end_addr ) ? ts1.end_addr : ts2.end_addr;
 
         // check selected addresses
-        if ( ( *selected_start_address > *selected_end_address ) )
+        if ( selected_start_address > selected_end_address )
             return auto_ptr<TrafficSelector> ( NULL );
 
         // creates the result
@@ -182,10 +188,10 @@ namespace openikev2 {
         if ( this->start_port > other.start_port || this->end_port < other.end_port )
             return false;
 
-        if ( *this->start_addr > *other.start_addr )
+        if ( this->start_addr > other.start_addr )
             return false;
 
-        if ( *this->end_addr < *other.end_addr )
+        if ( this->end_addr < other.end_addr )
             return false;
 
         return true;
@@ -205,10 +211,10 @@ namespace openikev2 {
         if ( this->start_port != other.start_port || this->end_port != other.end_port )
             return false;
 
-        if ( !( *this->start_addr == *other.start_addr ) )
+        if ( this->start_addr != other.start_addr )
             return false;
 
-        if ( !( *this->end_addr == *other.end_addr ) )
+        if ( this->end_addr != other.end_addr )
             return false;
 
         return true;
@@ -222,7 +228,7 @@ namespace openikev2 {
         byte_buffer.writeInt8( this->ip_protocol_id );
 
         // writes selector length
-        byte_buffer.writeInt16( 8 + this->start_addr->size() + this->end_addr->size() );
+        byte_buffer.writeInt16( 8 + this->start_addr.size() + this->end_addr.size() );
 
         // writes start port
         byte_buffer.writeInt16( this->start_port );
@@ -231,10 +237,10 @@ namespace openikev2 {
         byte_buffer.writeInt16( this->end_port );
 
         // writes strart address
-        byte_buffer.writeByteArray( *this->start_addr );
+        byte_buffer.writeBuffer( this->start_addr.bytes, this->start_addr.size() );
 
         // writes end address
-        byte_buffer.writeByteArray( *this->end_addr );
+        byte_buffer.writeBuffer( this->end_addr.bytes, this->end_addr.size() );
     }
 
     string TrafficSelector::toStringTab( uint8_t tabs ) const {
@@ -252,9 +258,9 @@ namespace openikev2 {
         temp_dport.writeInt16( this->end_port );
         oss << Printable::generateTabs( tabs + 1 ) << "port range = " << temp_sport.toString() << "-" << temp_dport.toString() << "\n";
 
-        oss << Printable::generateTabs( tabs + 1 ) << "start_address=" << this->start_addr->toStringTab( tabs + 1 ) << endl;
+        oss << Printable::generateTabs( tabs + 1 ) << "start_address=" << this->start_addr.getBytes()->toStringTab( tabs + 1 ) << endl;
 
-        oss << Printable::generateTabs( tabs + 1 ) << "end_address=" << this->end_addr->toStringTab( tabs + 1 ) << endl;
+        oss << Printable::generateTabs( tabs + 1 ) << "end_address=" << this->end_addr.getBytes()->toStringTab( tabs + 1 ) << endl;
 
         oss << Printable::generateTabs( tabs ) << "}\n";
 
@@ -270,6 +276,20 @@ namespace openikev2 {
             assert( 0 );
     }
 
+    Enums::ADDR_FAMILY TrafficSelector::getFamily( TS_TYPE ts_type ) {
+        if ( ts_type == TS_IPV4_ADDR_RANGE )
+            return Enums::ADDR_IPV4;
+        else if ( ts_type == TS_IPV6_ADDR_RANGE )
+            return Enums::ADDR_IPV6;
+        else
+            assert( 0 );
+    }
+
+    IpAddressValue TrafficSelector::getAddressValue( TS_TYPE ts_type, const ByteArray& address ) {
+        assert ( address.size() == getExpectedAddressSize( ts_type ) );
+        return IpAddressValue( getFamily( ts_type ), address.getRawPointer() );
+    }
+
     string TrafficSelector::TS_TYPE_STR( TS_TYPE ts_type ) {
         switch ( ts_type ) {
             case TrafficSelector::TS_IPV4_ADDR_RANGE:
@@ -15,6 +15,7 @@
 
 #include "printable.h"
 #include "ipaddress.h"
+#include "ipaddressvalue.h"
 #include "bytebuffer.h"
 
 namespace openikev2 {
@@ -36,8 +37,8 @@ namespace openikev2 {
             /****************************** ATTRIBUTES ******************************/
         public:
             TS_TYPE ts_type;                /**< Traffic selector type */
-            auto_ptr<ByteArray> start_addr;/**< Smallest address included in this TS */
-            auto_ptr<ByteArray> end_addr;   /**< Largest address included in this TS */
+            IpAddressValue start_addr;      /**< Smallest address included in this TS */
+            IpAddressValue end_addr;        /**< Largest address included in this TS */
             uint16_t start_port;            /**< Smallest port number allowed by this TS */
             uint16_t end_port;              /**< Largest port number allowed by this TS */
             uint8_t ip_protocol_id;         /**< IP protocol ID (e.g. UDP/TCP/ICMP) */
@@ -52,6 +53,21 @@ namespace openikev2 {
              */
             static uint16_t getExpectedAddressSize( TS_TYPE ts_type );
 
+            /**
+             * Gets the address family for the TS type
+             * @param ts_type TS TYPE
+             * @return The address family
+             */
+            static Enums::ADDR_FAMILY getFamily( TS_TYPE ts_type );
+
+            /**
+             * Builds an address value from its byte representation, checking its size
+             * @param ts_type TS TYPE
+             * @param address Address bytes
+             * @return The address value
+             */
+            static IpAddressValue getAddressValue( TS_TYPE ts_type, const ByteArray& address );
+
             /**
              * Set up the Traffic Selector attributes, setting its parameters. This is the full featured construct method
              * @param ts_type TrafficSelector type
@@ -61,7 +77,7 @@ namespace openikev2 {
              * @param end_port Ending port number.
              * @param ip_protocol_id IP protocol ID.
              */
-            void construct( TS_TYPE ts_type, auto_ptr<ByteArray> start_addr, auto_ptr<ByteArray> end_addr, uint16_t start_port, uint16_t end_port, uint8_t ip_protocol_id );
+            void construct( TS_TYPE ts_type, const IpAddressValue& start_addr, const IpAddressValue& end_addr, uint16_t start_port, uint16_t end_port, uint8_t ip_protocol_id );
 
             /**
              * Set up the Traffic Selector, based on an IP subnet
@@ -84,6 +100,17 @@ namespace openikev2 {
              */
             TrafficSelector( TS_TYPE ts_type, auto_ptr<ByteArray> start_addr, auto_ptr<ByteArray> end_addr, uint16_t start_port, uint16_t end_port, uint8_t ip_protocol_id );
 
+            /**
+             * Creates a new Traffic Selector (for all the IP protocols) from address values
+             * @param ts_type TrafficSelector type
+             * @param start_addr Starting address.
+             * @param end_addr Ending address.
+             * @param start_port Starting port number.
+             * @param end_port Ending port number.
+             * @param ip_protocol_id IP protocol ID.
+             */
+            TrafficSelector( TS_TYPE ts_type, const IpAddressValue& start_addr, const IpAddressValue& end_addr, uint16_t start_port, uint16_t end_port, uint8_t ip_protocol_id );
+
             /**
              * Creates a new Traffic Selector (for ICMP/ICMPv6 protocols)
              * @param ts_type TrafficSelector type
@@ -0,0 +1,318 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#include "trafficselectorindex.h"
+
+#include <string.h>
+#include <assert.h>
+
+namespace openikev2 {
+
+    TrafficSelectorIndex::Node::Node( const TrafficSelector& traffic_selector, uint64_t id, uint64_t serial, uint16_t bucket_key )
+            : traffic_selector( traffic_selector ), max_end( traffic_selector.end_addr ) {
+        this->id = id;
+        this->serial = serial;
+        this->bucket_key = bucket_key;
+        this->height = 1;
+        this->children[ 0 ] = NULL;
+        this->children[ 1 ] = NULL;
+    }
+
+    TrafficSelectorIndex::TrafficSelectorIndex() {
+        this->next_serial = 0;
+        this->count = 0;
+    }
+
+    TrafficSelectorIndex::~TrafficSelectorIndex() {
+        this->clear();
+    }
+
+    uint16_t TrafficSelectorIndex::getBucketKey( TrafficSelector::TS_TYPE ts_type, uint8_t ip_protocol_id ) {
+        return ( ( uint16_t ) ts_type << 8 ) | ip_protocol_id;
+    }
+
+    bool TrafficSelectorIndex::isBefore( const Node* node1, const Node* node2 ) {
+        int result = node1->traffic_selector.start_addr.compare( node2->traffic_selector.start_addr );
+        if ( result != 0 )
+            return result < 0;
+        return node1->serial < node2->serial;
+    }
+
+    void TrafficSelectorIndex::update( Node* node ) {
+        node->height = 1;
+        node->max_end = node->traffic_selector.end_addr;
+
+        for ( uint16_t i = 0; i < 2; i++ ) {
+            Node* child = node->children[ i ];
+            if ( child == NULL )
+                continue;
+            if ( child->height + 1 > node->height )
+                node->height = child->height + 1;
+            if ( child->max_end > node->max_end )
+                node->max_end = child->max_end;
+        }
+    }
+
+    void TrafficSelectorIndex::rotate( Node*& node, uint8_t direction ) {
+        Node* child = node->children[ 1 - direction ];
+        node->children[ 1 - direction ] = child->children[ direction ];
+        child->children[ direction ] = node;
+        update( node );
+        update( child );
+        node = child;
+    }
+
+    void TrafficSelectorIndex::rebalance( Node*& node ) {
+        int16_t left_height = ( node->children[ 0 ] != NULL ) ? node->children[ 0 ]->height : 0;
+        int16_t right_height = ( node->children[ 1 ] != NULL ) ? node->children[ 1 ]->height : 0;
+
+        if ( left_height - right_height > 1 ) {
+            Node* child = node->children[ 0 ];
+            int16_t child_left = ( child->children[ 0 ] != NULL ) ? child->children[ 0 ]->height : 0;
+            int16_t child_right = ( child->children[ 1 ] != NULL ) ? child->children[ 1 ]->height : 0;
+            if ( child_right > child_left )
+                rotate( node->children[ 0 ], 0 );
+            rotate( node, 1 );
+        }
+        else if ( right_height - left_height > 1 ) {
+            Node* child = node->children[ 1 ];
+            int16_t child_left = ( child->children[ 0 ] != NULL ) ? child->children[ 0 ]->height : 0;
+            int16_t child_right = ( child->children[ 1 ] != NULL ) ? child->children[ 1 ]->height : 0;
+            if ( child_left > child_right )
+                rotate( node->children[ 1 ], 1 );
+            rotate( node, 0 );
+        }
+        else {
+            update( node );
+        }
+    }
+
+    void TrafficSelectorIndex::insert( Node*& root, Node* node ) {
+        if ( root == NULL ) {
+            root = node;
+            return;
+        }
+
+        insert( root->children[ isBefore( node, root ) ? 0 : 1 ], node );
+        rebalance( root );
+    }
+
+    TrafficSelectorIndex::Node* TrafficSelectorIndex::detachFirst( Node*& root ) {
+        if ( root->children[ 0 ] == NULL ) {
+            Node* result = root;
+            root = root->children[ 1 ];
+            result->children[ 1 ] = NULL;
+            return result;
+        }
+
+        Node* result = detachFirst( root->children[ 0 ] );
+        rebalance( root );
+        return result;
+    }
+
+    void TrafficSelectorIndex::detach( Node*& root, Node* node ) {
+        assert( root != NULL );
+
+        if ( root != node ) {
+            detach( root->children[ isBefore( node, root ) ? 0 : 1 ], node );
+            rebalance( root );
+            return;
+        }
+
+        // Replaces the node with its successor, or with its only child
+        if ( node->children[ 0 ] != NULL && node->children[ 1 ] != NULL ) {
+            Node* successor = detachFirst( node->children[ 1 ] );
+            successor->children[ 0 ] = node->children[ 0 ];
+            successor->children[ 1 ] = node->children[ 1 ];
+            root = successor;
+            rebalance( root );
+        }
+        else {
+            root = ( node->children[ 0 ] != NULL ) ? node->children[ 0 ] : node->children[ 1 ];
+        }
+
+        node->children[ 0 ] = NULL;
+        node->children[ 1 ] = NULL;
+    }
+
+    void TrafficSelectorIndex::deleteTree( Node* node ) {
+        if ( node == NULL )
+            return;
+        deleteTree( node->children[ 0 ] );
+        deleteTree( node->children[ 1 ] );
+        delete node;
+    }
+
+    void TrafficSelectorIndex::collect( const Node* node, const IpAddressValue& start_limit, const IpAddressValue& end_limit, vector<const Node*>& candidates ) {
+        // No node in this subtree reaches end_limit
+        if ( node == NULL || node->max_end < end_limit )
+            return;
+
+        collect( node->children[ 0 ], start_limit, end_limit, candidates );
+
+        // Nodes are sorted by start address, so the right subtree cannot match either
+        if ( node->traffic_selector.start_addr > start_limit )
+            return;
+
+        if ( node->traffic_selector.end_addr >= end_limit )
+            candidates.push_back( node );
+
+        collect( node->children[ 1 ], start_limit, end_limit, candidates );
+    }
+
+    bool TrafficSelectorIndex::portsOverlap( const TrafficSelector& ts1, const TrafficSelector& ts2 ) {
+        // 65535-0 is the OPAQUE port range. It only overlaps with OPAQUE and with the whole port range (RFC 7296 3.13.1)
+        bool opaque1 = ( ts1.start_port == 65535 && ts1.end_port == 0 );
+        bool opaque2 = ( ts2.start_port == 65535 && ts2.end_port == 0 );
+        if ( opaque1 || opaque2 ) {
+            const TrafficSelector& other = opaque1 ? ts2 : ts1;
+            return ( opaque1 && opaque2 ) || ( other.start_port == 0 && other.end_port == 65535 );
+        }
+
+        uint16_t start_port = ( ts1.start_port > ts2.start_port ) ? ts1.start_port : ts2.start_port;
+        uint16_t end_port = ( ts1.end_port < ts2.end_port ) ? ts1.end_port : ts2.end_port;
+        return start_port <= end_port;
+    }
+
+    bool TrafficSelectorIndex::isNarrower( const TrafficSelector& ts1, const TrafficSelector& ts2 ) {
+        // Compares the address spans (end - start), computed as big endian integers
+        uint8_t span1[ 16 ], span2[ 16 ];
+        uint16_t size = ts1.start_addr.size();
+        int16_t borrow1 = 0, borrow2 = 0;
+        for ( int16_t i = size - 1; i >= 0; i-- ) {
+            int16_t difference1 = ts1.end_addr.bytes[ i ] - ts1.start_addr.bytes[ i ] - borrow1;
+            borrow1 = ( difference1 < 0 );
+            span1[ i ] = ( uint8_t ) difference1;
+
+            int16_t difference2 = ts2.end_addr.bytes[ i ] - ts2.start_addr.bytes[ i ] - borrow2;
+            borrow2 = ( difference2 < 0 );
+            span2[ i ] = ( uint8_t ) difference2;
+        }
+
+        int result = memcmp( span1, span2, size );
+        if ( result != 0 )
+            return result < 0;
+
+        // Same address span, compares the port spans
+        uint16_t port_span1 = ts1.end_port - ts1.start_port;
+        uint16_t port_span2 = ts2.end_port - ts2.start_port;
+        if ( port_span1 != port_span2 )
+            return port_span1 < port_span2;
+
+        // A specific protocol is narrower than any protocol
+        return ( ts1.ip_protocol_id != Enums::IP_PROTO_ANY && ts2.ip_protocol_id == Enums::IP_PROTO_ANY );
+    }
+
+    void TrafficSelectorIndex::addTrafficSelector( const TrafficSelector& traffic_selector, uint64_t id ) {
+        uint16_t bucket_key = getBucketKey( traffic_selector.ts_type, traffic_selector.ip_protocol_id );
+        Node* node = new Node( traffic_selector, id, this->next_serial++, bucket_key );
+
+        insert( this->buckets[ bucket_key ], node );
+        this->nodes_by_id[ id ].push_back( node );
+        this->count++;
+    }
+
+    uint32_t TrafficSelectorIndex::deleteTrafficSelectors( uint64_t id ) {
+        map<uint64_t, vector<Node*> >::iterator it = this->nodes_by_id.find( id );
+        if ( it == this->nodes_by_id.end() )
+            return 0;
+
+        uint32_t deleted = it->second.size();
+        for ( vector<Node*>::iterator it_node = it->second.begin(); it_node != it->second.end(); it_node++ ) {
+            Node* node = *it_node;
+            map<uint16_t, Node*>::iterator it_bucket = this->buckets.find( node->bucket_key );
+            assert( it_bucket != this->buckets.end() );
+
+            detach( it_bucket->second, node );
+            if ( it_bucket->second == NULL )
+                this->buckets.erase( it_bucket );
+
+            delete node;
+        }
+
+        this->nodes_by_id.erase( it );
+        this->count -= deleted;
+        return deleted;
+    }
+
+    const TrafficSelector* TrafficSelectorIndex::findCovering( const TrafficSelector& traffic_selector, uint64_t* id ) const {
+        // Covering selectors have the same protocol or any protocol
+        uint16_t keys[ 2 ] = { getBucketKey( traffic_selector.ts_type, traffic_selector.ip_protocol_id ), getBucketKey( traffic_selector.ts_type, Enums::IP_PROTO_ANY ) };
+        uint16_t num_keys = ( traffic_selector.ip_protocol_id == Enums::IP_PROTO_ANY ) ? 1 : 2;
+
+        const Node* result = NULL;
+        vector<const Node*> candidates;
+        for ( uint16_t i = 0; i < num_keys; i++ ) {
+            map<uint16_t, Node*>::const_iterator it = this->buckets.find( keys[ i ] );
+            if ( it == this->buckets.end() )
+                continue;
+
+            candidates.clear();
+            collect( it->second, traffic_selector.start_addr, traffic_selector.end_addr, candidates );
+
+            for ( vector<const Node*>::const_iterator it_candidate = candidates.begin(); it_candidate != candidates.end(); it_candidate++ ) {
+                const Node& candidate = **it_candidate;
+                if ( !( candidate.traffic_selector >= traffic_selector ) )
+                    continue;
+
+                if ( result == NULL || isNarrower( candidate.traffic_selector, result->traffic_selector ) )
+                    result = &candidate;
+            }
+        }
+
+        if ( result == NULL )
+            return NULL;
+
+        if ( id != NULL )
+            *id = result->id;
+
+        return &result->traffic_selector;
+    }
+
+    void TrafficSelectorIndex::findOverlapping( const TrafficSelector& traffic_selector, vector<uint64_t>& ids ) const {
+        // Any protocol overlaps with every protocol bucket of the TS type. Otherwise only the same protocol and any protocol buckets
+        vector<const Node*> selected_buckets;
+        if ( traffic_selector.ip_protocol_id == Enums::IP_PROTO_ANY ) {
+            map<uint16_t, Node*>::const_iterator it_end = this->buckets.upper_bound( getBucketKey( traffic_selector.ts_type, 255 ) );
+            for ( map<uint16_t, Node*>::const_iterator it = this->buckets.lower_bound( getBucketKey( traffic_selector.ts_type, 0 ) ); it != it_end; it++ )
+                selected_buckets.push_back( it->second );
+        }
+        else {
+            uint8_t protocols[ 2 ] = { traffic_selector.ip_protocol_id, Enums::IP_PROTO_ANY };
+            for ( uint16_t i = 0; i < 2; i++ ) {
+                map<uint16_t, Node*>::const_iterator it = this->buckets.find( getBucketKey( traffic_selector.ts_type, protocols[ i ] ) );
+                if ( it != this->buckets.end() )
+                    selected_buckets.push_back( it->second );
+            }
+        }
+
+        vector<const Node*> candidates;
+        for ( vector<const Node*>::const_iterator it = selected_buckets.begin(); it != selected_buckets.end(); it++ ) {
+            // Overlapping ranges start before this end and end after this start
+            candidates.clear();
+            collect( *it, traffic_selector.end_addr, traffic_selector.start_addr, candidates );
+
+            for ( vector<const Node*>::const_iterator it_candidate = candidates.begin(); it_candidate != candidates.end(); it_candidate++ ) {
+                if ( portsOverlap( ( *it_candidate )->traffic_selector, traffic_selector ) )
+                    ids.push_back( ( *it_candidate )->id );
+            }
+        }
+    }
+
+    uint32_t TrafficSelectorIndex::size() const {
+        return this->count;
+    }
+
+    void TrafficSelectorIndex::clear() {
+        for ( map<uint16_t, Node*>::iterator it = this->buckets.begin(); it != this->buckets.end(); it++ )
+            deleteTree( it->second );
+        this->buckets.clear();
+        this->nodes_by_id.clear();
+        this->count = 0;
+    }
+}
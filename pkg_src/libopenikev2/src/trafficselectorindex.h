@@ -0,0 +1,203 @@
+/***************************************************************************
+*   Copyright (C) 2005 by                                                 *
+*   Alejandro Perez Mendez     alex@um.es                                 *
+*   Pedro J. Fernandez Ruiz    pedroj@um.es                               *
+*                                                                         *
+*   This software may be modified and distributed under the terms         *
+*   of the Apache license.  See the LICENSE file for details.             *
+***************************************************************************/
+#ifndef OPENIKEV2TRAFFICSELECTORINDEX_H
+#define OPENIKEV2TRAFFICSELECTORINDEX_H
+
+#ifdef HAVE_CONFIG_H
+#include "config.h"
+#endif
+
+#include "trafficselector.h"
+
+#include <map>
+#include <vector>
+
+namespace openikev2 {
+
+    /**
+        This class indexes TrafficSelectors by (TS type, IP protocol, address range), so IpsecControllerImpl
+        implementations can narrow proposals against the configured selectors, and check new selectors against the
+        existing policies, without comparing every pair.
+        Each (TS type, IP protocol) bucket is an augmented interval tree: an AVL tree ordered by start address, where
+        each node keeps the maximum end address of its subtree. Insertions and deletions are logarithmic, and queries go
+        down only the subtrees that may match (logarithmic plus the number of address matches). Port ranges are checked
+        on those candidates.
+        Each indexed TrafficSelector carries a caller defined identifier (e.g. a policy index or a Child SA SPI).
+        @author Alejandro Perez Mendez, Pedro J. Fernandez Ruiz <alex@um.es, pedroj@um.es>
+    */
+    class TrafficSelectorIndex {
+
+            /****************************** STRUCTS ******************************/
+        protected:
+            /** Node of the interval tree */
+            struct Node {
+                TrafficSelector traffic_selector;                           /**< Indexed TrafficSelector */
+                uint64_t id;                                                /**< Caller defined identifier */
+                uint64_t serial;                                            /**< Insertion number, to order entries with the same start address */
+                uint16_t bucket_key;                                        /**< Key of the bucket containing the node */
+                IpAddressValue max_end;                                     /**< Maximum end address of the subtree */
+                int16_t height;                                             /**< Height of the subtree */
+                Node* children[ 2 ];                                        /**< Left and right subtrees */
+
+                Node( const TrafficSelector& traffic_selector, uint64_t id, uint64_t serial, uint16_t bucket_key );
+            };
+
+            /****************************** ATTRIBUTES ******************************/
+        protected:
+            map<uint16_t, Node*> buckets;                                   /**< Tree roots, by getBucketKey() */
+            map<uint64_t, vector<Node*> > nodes_by_id;                      /**< Nodes of each identifier */
+            uint64_t next_serial;                                           /**< Insertion number of the next node */
+            uint32_t count;                                                 /**< Number of indexed TrafficSelectors */
+
+            /****************************** METHODS ******************************/
+        protected:
+            /**
+             * Gets the bucket key for a TS type and IP protocol
+             * @param ts_type TS type
+             * @param ip_protocol_id IP protocol ID
+             * @return The bucket key
+             */
+            static uint16_t getBucketKey( TrafficSelector::TS_TYPE ts_type, uint8_t ip_protocol_id );
+
+            /**
+             * Indicates if a node goes before another one in the tree order (start address, insertion number)
+             * @param node1 One node
+             * @param node2 Other node
+             * @return TRUE if node1 goes before node2. FALSE otherwise
+             */
+            static bool isBefore( const Node* node1, const Node* node2 );
+
+            /**
+             * Recomputes the height and the maximum end address of a node from its children
+             * @param node Node
+             */
+            static void update( Node* node );
+
+            /**
+             * Rotates a subtree
+             * @param node Root of the subtree. It is updated with the new root
+             * @param direction 0 to rotate left (right child goes up), 1 to rotate right (left child goes up)
+             */
+            static void rotate( Node*& node, uint8_t direction );
+
+            /**
+             * Restores the AVL balance of a subtree whose children are balanced, and updates it
+             * @param node Root of the subtree. It is updated with the new root
+             */
+            static void rebalance( Node*& node );
+
+            /**
+             * Inserts a node in a subtree
+             * @param root Root of the subtree. It is updated with the new root
+             * @param node Node to be inserted
+             */
+            static void insert( Node*& root, Node* node );
+
+            /**
+             * Detaches the first node of a subtree
+             * @param root Root of the subtree. It is updated with the new root
+             * @return The detached node
+             */
+            static Node* detachFirst( Node*& root );
+
+            /**
+             * Detaches a node from a subtree
+             * @param root Root of the subtree. It is updated with the new root
+             * @param node Node to be detached
+             */
+            static void detach( Node*& root, Node* node );
+
+            /**
+             * Deletes all the nodes of a subtree
+             * @param node Root of the subtree
+             */
+            static void deleteTree( Node* node );
+
+            /**
+             * Collects the nodes of a subtree with start address <= start_limit and end address >= end_limit
+             * @param node Root of the subtree
+             * @param start_limit Maximum start address
+             * @param end_limit Minimum end address
+             * @param candidates Collected nodes
+             */
+            static void collect( const Node* node, const IpAddressValue& start_limit, const IpAddressValue& end_limit, vector<const Node*>& candidates );
+
+            /**
+             * Indicates if the port ranges of two TrafficSelectors overlap
+             * @param ts1 One TrafficSelector
+             * @param ts2 Other TrafficSelector
+             * @return TRUE if the port ranges overlap. FALSE otherwise
+             */
+            static bool portsOverlap( const TrafficSelector& ts1, const TrafficSelector& ts2 );
+
+            /**
+             * Indicates if the address range of one TrafficSelector is narrower than the other one
+             * @param ts1 One TrafficSelector
+             * @param ts2 Other TrafficSelector
+             * @return TRUE if ts1 covers less addresses (or the same and less ports) than ts2. FALSE otherwise
+             */
+            static bool isNarrower( const TrafficSelector& ts1, const TrafficSelector& ts2 );
+
+            /**
+             * The index owns its nodes, so it cannot be copied
+             */
+            TrafficSelectorIndex( const TrafficSelectorIndex& other );
+            TrafficSelectorIndex& operator=( const TrafficSelectorIndex& other );
+
+        public:
+            /**
+             * Creates a new empty TrafficSelectorIndex
+             */
+            TrafficSelectorIndex();
+
+            /**
+             * Adds a TrafficSelector to the index
+             * @param traffic_selector TrafficSelector (it is copied)
+             * @param id Caller defined identifier
+             */
+            virtual void addTrafficSelector( const TrafficSelector& traffic_selector, uint64_t id );
+
+            /**
+             * Deletes all the TrafficSelectors with the indicated identifier
+             * @param id Caller defined identifier
+             * @return Number of deleted TrafficSelectors
+             */
+            virtual uint32_t deleteTrafficSelectors( uint64_t id );
+
+            /**
+             * Finds the narrowest indexed TrafficSelector that covers (is a superset of) the indicated one
+             * @param traffic_selector TrafficSelector to be covered
+             * @param id Where the identifier of the found TrafficSelector is stored (if not NULL)
+             * @return The narrowest covering TrafficSelector, or NULL if there is no one
+             */
+            virtual const TrafficSelector* findCovering( const TrafficSelector& traffic_selector, uint64_t* id = NULL ) const;
+
+            /**
+             * Finds the indexed TrafficSelectors overlapping (having a non empty intersection with) the indicated one
+             * @param traffic_selector TrafficSelector
+             * @param ids Where the identifiers of the overlapping TrafficSelectors are appended
+             */
+            virtual void findOverlapping( const TrafficSelector& traffic_selector, vector<uint64_t>& ids ) const;
+
+            /**
+             * Gets the number of indexed TrafficSelectors
+             * @return The number of indexed TrafficSelectors
+             */
+            virtual uint32_t size() const;
+
+            /**
+             * Deletes all the indexed TrafficSelectors
+             */
+            virtual void clear();
+
+            virtual ~TrafficSelectorIndex();
+    };
+}
+
+#endif